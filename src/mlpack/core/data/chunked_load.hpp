@@ -0,0 +1,91 @@
+/**
+ * @file chunked_load.hpp
+ * @author Ryan Curtin
+ *
+ * Definition of the ChunkedLoader class, which loads a text dataset a few
+ * points at a time, so that datasets larger than memory can be processed.
+ */
+#ifndef __MLPACK_CORE_DATA_CHUNKED_LOAD_HPP
+#define __MLPACK_CORE_DATA_CHUNKED_LOAD_HPP
+
+#include <mlpack/core/util/log.hpp>
+#include <mlpack/core/arma_extend/arma_extend.hpp> // Includes Armadillo.
+#include <string>
+#include <fstream>
+#include <vector>
+
+namespace mlpack {
+namespace data {
+
+/**
+ * Load a dataset from a CSV (.csv) or raw ASCII (.txt) file in chunks of at
+ * most a given number of points, instead of all at once like data::Load().
+ * Each line of the file is one point, and each chunk is transposed, just like
+ * data::Load() does, so each column of a chunk is one point.  Values may be
+ * separated by commas or whitespace.  Every point must have the same number of
+ * dimensions; if not, or if the file cannot be read, a fatal error is raised.
+ *
+ * @code
+ * data::ChunkedLoader loader("queries.csv");
+ * arma::mat chunk;
+ * while (loader.LoadChunk(chunk, 10000))
+ * {
+ *   // Process the points in chunk.
+ * }
+ * @endcode
+ */
+class ChunkedLoader
+{
+ public:
+  /**
+   * Open the given file for loading.
+   *
+   * @param filename Name of the file to load from.
+   */
+  ChunkedLoader(const std::string& filename);
+
+  /**
+   * Load at most maxPoints points from the file into the given matrix, which
+   * will have one column per point.  If there are no points left in the file,
+   * the matrix is emptied and false is returned.
+   *
+   * @param chunk Matrix to load the points into.
+   * @param maxPoints Maximum number of points to load.
+   * @return false if there were no points left to load.
+   */
+  template<typename eT>
+  bool LoadChunk(arma::Mat<eT>& chunk, const size_t maxPoints);
+
+  //! Get the number of dimensions of each point (0 if no point has been read).
+  size_t Dimensionality() const { return dimensionality; }
+  //! Get the number of points loaded so far.
+  size_t PointsLoaded() const { return pointsLoaded; }
+
+ private:
+  //! The name of the file.
+  std::string filename;
+  //! The stream the file is read from.
+  std::ifstream stream;
+  //! The number of dimensions of each point.
+  size_t dimensionality;
+  //! The number of points loaded so far.
+  size_t pointsLoaded;
+  //! The number of lines read so far.
+  size_t lineNumber;
+  //! The values of the points in the current chunk.
+  std::vector<double> values;
+
+  /**
+   * Read the next nonempty line of the file and append its values to the
+   * list of values.  Returns false if the end of the file has been reached.
+   */
+  bool ReadPoint();
+};
+
+}; // namespace data
+}; // namespace mlpack
+
+// Include implementation.
+#include "chunked_load_impl.hpp"
+
+#endif
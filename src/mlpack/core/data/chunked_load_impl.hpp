@@ -0,0 +1,123 @@
+/**
+ * @file chunked_load_impl.hpp
+ * @author Ryan Curtin
+ *
+ * Implementation of the ChunkedLoader class.
+ */
+#ifndef __MLPACK_CORE_DATA_CHUNKED_LOAD_IMPL_HPP
+#define __MLPACK_CORE_DATA_CHUNKED_LOAD_IMPL_HPP
+
+// In case it hasn't already been included.
+#include "chunked_load.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <mlpack/core/util/timers.hpp>
+
+namespace mlpack {
+namespace data {
+
+inline ChunkedLoader::ChunkedLoader(const std::string& filename) :
+    filename(filename),
+    dimensionality(0),
+    pointsLoaded(0),
+    lineNumber(0)
+{
+  // Only text formats without a header can be read a line at a time.
+  const size_t ext = filename.rfind('.');
+  std::string extension = (ext == std::string::npos) ? "" :
+      filename.substr(ext + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+      ::tolower);
+
+  if (extension != "csv" && extension != "txt")
+  {
+    Log::Fatal << "Cannot load '" << filename << "' in chunks; only CSV (.csv)"
+        << " and raw ASCII (.txt) files are supported." << std::endl;
+  }
+
+  stream.open(filename.c_str(), std::ios::in);
+  if (!stream.is_open())
+    Log::Fatal << "Cannot open file '" << filename << "'. " << std::endl;
+}
+
+template<typename eT>
+bool ChunkedLoader::LoadChunk(arma::Mat<eT>& chunk, const size_t maxPoints)
+{
+  Timer::Start("loading_data");
+
+  values.clear();
+  size_t points = 0;
+  while (points < maxPoints && ReadPoint())
+    ++points;
+
+  // The values are stored point by point, which is the column-major layout of
+  // the transposed matrix.
+  chunk.set_size(dimensionality, points);
+  std::copy(values.begin(), values.end(), chunk.memptr());
+
+  pointsLoaded += points;
+
+  Timer::Stop("loading_data");
+
+  return (points > 0);
+}
+
+inline bool ChunkedLoader::ReadPoint()
+{
+  std::string line;
+  while (std::getline(stream, line))
+  {
+    ++lineNumber;
+    const size_t oldSize = values.size();
+
+    // Parse each value in the line; values may be separated by commas or by
+    // whitespace.
+    const char* position = line.c_str();
+    while (true)
+    {
+      position += std::strspn(position, ", \t\r");
+      if (*position == '\0')
+        break;
+
+      char* end;
+      const double value = std::strtod(position, &end);
+      if (end == position)
+      {
+        Log::Fatal << "Cannot parse line " << lineNumber << " of '"
+            << filename << "'." << std::endl;
+      }
+
+      values.push_back(value);
+      position = end;
+    }
+
+    // Skip empty lines.
+    const size_t lineDimensionality = values.size() - oldSize;
+    if (lineDimensionality == 0)
+      continue;
+
+    if (dimensionality == 0)
+      dimensionality = lineDimensionality;
+
+    if (lineDimensionality != dimensionality)
+    {
+      Log::Fatal << "Line " << lineNumber << " of '" << filename << "' has "
+          << lineDimensionality << " dimensions, but previous lines have "
+          << dimensionality << " dimensions." << std::endl;
+    }
+
+    return true;
+  }
+
+  if (stream.bad())
+    Log::Fatal << "Error while reading '" << filename << "'." << std::endl;
+
+  return false;
+}
+
+}; // namespace data
+}; // namespace mlpack
+
+#endif
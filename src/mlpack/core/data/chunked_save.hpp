@@ -0,0 +1,65 @@
+/**
+ * @file chunked_save.hpp
+ * @author Ryan Curtin
+ *
+ * Definition of the ChunkedSaver class, which saves a dataset to a text file a
+ * few points at a time, so that results larger than memory can be written.
+ */
+#ifndef __MLPACK_CORE_DATA_CHUNKED_SAVE_HPP
+#define __MLPACK_CORE_DATA_CHUNKED_SAVE_HPP
+
+#include <mlpack/core/util/log.hpp>
+#include <mlpack/core/arma_extend/arma_extend.hpp> // Includes Armadillo.
+#include <string>
+#include <fstream>
+
+namespace mlpack {
+namespace data {
+
+/**
+ * Save a dataset to a CSV (.csv) or raw ASCII (.txt) file in chunks of points,
+ * instead of all at once like data::Save().  Each chunk is transposed before it
+ * is written, just like data::Save() does, so each column of a chunk becomes
+ * one line of the file.  The file which results from saving a matrix in chunks
+ * is the same as the file data::Save() would write for the whole matrix.  If
+ * the file cannot be written, a fatal error is raised.
+ */
+class ChunkedSaver
+{
+ public:
+  /**
+   * Open the given file for saving, replacing any existing file.
+   *
+   * @param filename Name of the file to save to.
+   */
+  ChunkedSaver(const std::string& filename);
+
+  /**
+   * Append the points (columns) of the given matrix to the file.
+   *
+   * @param chunk Matrix holding the points to save.
+   */
+  template<typename eT>
+  void SaveChunk(const arma::Mat<eT>& chunk);
+
+  //! Get the number of points saved so far.
+  size_t PointsSaved() const { return pointsSaved; }
+
+ private:
+  //! The name of the file.
+  std::string filename;
+  //! The stream the file is written to.
+  std::ofstream stream;
+  //! The type of the file.
+  arma::file_type saveType;
+  //! The number of points saved so far.
+  size_t pointsSaved;
+};
+
+}; // namespace data
+}; // namespace mlpack
+
+// Include implementation.
+#include "chunked_save_impl.hpp"
+
+#endif
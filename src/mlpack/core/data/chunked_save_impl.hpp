@@ -0,0 +1,73 @@
+/**
+ * @file chunked_save_impl.hpp
+ * @author Ryan Curtin
+ *
+ * Implementation of the ChunkedSaver class.
+ */
+#ifndef __MLPACK_CORE_DATA_CHUNKED_SAVE_IMPL_HPP
+#define __MLPACK_CORE_DATA_CHUNKED_SAVE_IMPL_HPP
+
+// In case it hasn't already been included.
+#include "chunked_save.hpp"
+
+#include <algorithm>
+#include <mlpack/core/util/timers.hpp>
+
+namespace mlpack {
+namespace data {
+
+inline ChunkedSaver::ChunkedSaver(const std::string& filename) :
+    filename(filename),
+    pointsSaved(0)
+{
+  const size_t ext = filename.rfind('.');
+  std::string extension = (ext == std::string::npos) ? "" :
+      filename.substr(ext + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+      ::tolower);
+
+  // These are the same types data::Save() uses for these extensions.  Neither
+  // has a header, so chunks can simply be written one after another.
+  if (extension == "csv")
+  {
+    saveType = arma::csv_ascii;
+  }
+  else if (extension == "txt")
+  {
+    saveType = arma::raw_ascii;
+  }
+  else
+  {
+    Log::Fatal << "Cannot save '" << filename << "' in chunks; only CSV (.csv)"
+        << " and raw ASCII (.txt) files are supported." << std::endl;
+  }
+
+  stream.open(filename.c_str(), std::ios::out | std::ios::trunc);
+  if (!stream.is_open())
+  {
+    Log::Fatal << "Cannot open file '" << filename << "' for writing. "
+        << "Save failed." << std::endl;
+  }
+}
+
+template<typename eT>
+void ChunkedSaver::SaveChunk(const arma::Mat<eT>& chunk)
+{
+  if (chunk.n_cols == 0)
+    return;
+
+  Timer::Start("saving_data");
+
+  arma::Mat<eT> tmp = trans(chunk);
+  if (!tmp.quiet_save(stream, saveType))
+    Log::Fatal << "Save to '" << filename << "' failed." << std::endl;
+
+  pointsSaved += chunk.n_cols;
+
+  Timer::Stop("saving_data");
+}
+
+}; // namespace data
+}; // namespace mlpack
+
+#endif
@@ -12,5 +12,7 @@
 #include "binary_space_tree/single_tree_traverser.hpp"
 #include "binary_space_tree/dual_tree_traverser.hpp"
 #include "binary_space_tree/traits.hpp"
+#include "binary_space_tree/mapped_tree.hpp"
+#include "rule_traits.hpp"
 
 #endif
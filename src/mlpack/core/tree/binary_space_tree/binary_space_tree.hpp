@@ -8,6 +8,7 @@
 
 #include <mlpack/core.hpp>
 
+#include "../hrectbound.hpp"
 #include "../statistic.hpp"
 
 namespace mlpack {
@@ -30,6 +31,8 @@ namespace tree /** Trees and tree-building procedures. */ {
  *     bounds/.
  * @tparam StatisticType Extra data contained in the node.  See statistic.hpp
  *     for the necessary skeleton interface.
+ * @tparam MatType The type of matrix the tree is built on; arma::mat and
+ *     arma::fmat (single precision) are supported.
  */
 template<typename BoundType,
          typename StatisticType = EmptyStatistic,
@@ -61,10 +64,30 @@ class BinarySpaceTree
   double furthestDescendantDistance;
   //! The dataset.
   MatType& dataset;
+  //! If Compact() has been called on this node, this holds the memory for all
+  //! of its descendants (and their bounds); otherwise, it is NULL.
+  char* arena;
+  //! The number of nodes held in the arena.
+  size_t arenaSize;
+  //! Whether or not this node is held in the arena of one of its ancestors.
+  bool inArena;
+
+  //! MappedTree fills in the nodes of trees that are loaded from files.
+  template<typename TreeType>
+  friend class MappedTree;
+
+  //! Nodes with at least this many points build their children and compute
+  //! their bounds in parallel (if OpenMP is available).
+  static const size_t parallelBuildThreshold = 2000;
 
  public:
   //! So other classes can use TreeType::Mat.
   typedef MatType Mat;
+  //! So other classes can use TreeType::ElemType.  This is double for
+  //! arma::mat and float for arma::fmat.
+  typedef typename MatType::elem_type ElemType;
+  //! So other classes can use TreeType::Statistic.
+  typedef StatisticType Statistic;
 
   //! A single-tree traverser for binary space trees; see
   //! single_tree_traverser.hpp for implementation.
@@ -79,6 +102,10 @@ class BinarySpaceTree
    * Construct this as the root node of a binary space tree using the given
    * dataset.  This will modify the ordering of the points in the dataset!
    *
+   * If OpenMP is available, the children of large nodes are built in parallel.
+   * The resulting tree (and the ordering of the dataset) is identical to the
+   * tree that a serial build would produce.
+   *
    * @param data Dataset to create tree from.  This will be modified!
    * @param leafSize Size of each leaf in the tree.
    */
@@ -202,6 +229,26 @@ class BinarySpaceTree
    */
   ~BinarySpaceTree();
 
+  /**
+   * Move all of the descendants of this node into a single contiguous block of
+   * memory, in depth-first (preorder) order, so that the left child of each
+   * descendant immediately follows it in memory.  If the bound stores its
+   * ranges on the heap (as HRectBound does), the ranges of all the descendants
+   * are moved into the same block, directly after the nodes.  This greatly
+   * reduces the number of cache misses during traversals of large trees, and
+   * the compacted tree can be used with the usual traversers.
+   *
+   * This should be called once the tree is built and before it is used.  All
+   * pointers to descendants of this node are invalidated, so statistics which
+   * hold pointers to other nodes (or to their statistics) will be invalid
+   * afterwards.  The structure of a compacted tree should not be modified (with
+   * ExtendTree(), for instance).
+   */
+  void Compact();
+
+  //! Return whether or not this node is part of a compacted tree.
+  bool IsCompact() const { return (arena != NULL) || inArena; }
+
   /**
    * Find a node in this tree by its begin and count (const).
    *
@@ -271,9 +318,9 @@ class BinarySpaceTree
   size_t& SplitDimension() { return splitDimension; }
 
   //! Get the dataset which the tree is built on.
-  const arma::mat& Dataset() const { return dataset; }
+  const MatType& Dataset() const { return dataset; }
   //! Modify the dataset which the tree is built on.  Be careful!
-  arma::mat& Dataset() { return dataset; }
+  MatType& Dataset() { return dataset; }
 
   //! Get the metric which the tree uses.
   typename BoundType::MetricType Metric() const { return bound.Metric(); }
@@ -349,19 +396,19 @@ class BinarySpaceTree
   }
 
   //! Return the minimum distance to another point.
-  double MinDistance(const arma::vec& point) const
+  double MinDistance(const arma::Col<ElemType>& point) const
   {
     return bound.MinDistance(point);
   }
 
   //! Return the maximum distance to another point.
-  double MaxDistance(const arma::vec& point) const
+  double MaxDistance(const arma::Col<ElemType>& point) const
   {
     return bound.MaxDistance(point);
   }
 
   //! Return the minimum and maximum distance to another point.
-  math::Range RangeDistance(const arma::vec& point) const
+  math::Range RangeDistance(const arma::Col<ElemType>& point) const
   {
     return bound.RangeDistance(point);
   }
@@ -416,13 +463,86 @@ class BinarySpaceTree
       count(count),
       bound(bound),
       stat(stat),
-      leafSize(leafSize) { }
+      leafSize(leafSize),
+      arena(NULL),
+      arenaSize(0),
+      inArena(false) { }
 
   BinarySpaceTree* CopyMe()
   {
     return new BinarySpaceTree(begin, count, bound, stat, leafSize);
   }
 
+  /**
+   * Create a node which has no children, no points, and an empty bound, for
+   * the given dataset.  This is used by MappedTree, which fills in the rest of
+   * the node when a tree is loaded from a file.
+   *
+   * @param data Dataset the tree is built on.
+   * @param inArena Whether or not the node is held in the arena of an ancestor.
+   * @param parent Parent of the new node.
+   */
+  BinarySpaceTree(MatType& data, const bool inArena, BinarySpaceTree* parent);
+
+  /**
+   * Copy the given node, but not its children, and give the copy the given
+   * parent.  This is used to move nodes into the arena of a compacted tree.
+   *
+   * @param other Node to copy.
+   * @param parent Parent of the new node.
+   */
+  BinarySpaceTree(const BinarySpaceTree& other, BinarySpaceTree* parent);
+
+  /**
+   * Copy the given node into the arena at position nodeIndex (and its bound
+   * into the ranges at position rangeIndex), then recursively copy its
+   * descendants.  The indices are advanced past everything that was copied.
+   *
+   * @param node Node to copy.
+   * @param parent Parent of the copy.
+   * @param nodes Nodes of the arena.
+   * @param nodeIndex Position of the next free node in the arena.
+   * @param ranges Ranges of the arena.
+   * @param rangeIndex Position of the next free range in the arena.
+   */
+  static BinarySpaceTree* CopyToArena(const BinarySpaceTree& node,
+                                      BinarySpaceTree* parent,
+                                      BinarySpaceTree* nodes,
+                                      size_t& nodeIndex,
+                                      math::Range* ranges,
+                                      size_t& rangeIndex);
+
+  /**
+   * Free the children of this node (and all their descendants), whether they
+   * are held in an arena or not.
+   */
+  void DeleteChildren();
+
+  /**
+   * Expand the bound of this node so that it contains all of the points of
+   * this node.  This general version handles any type of bound, one point
+   * after another.
+   *
+   * @param data Dataset which we are using.
+   * @param nodeBound The bound of this node.
+   */
+  template<typename AnyBoundType>
+  void UpdateBound(MatType& data, AnyBoundType& nodeBound);
+
+  /**
+   * Expand the hyperrectangle bound of this node so that it contains all of the
+   * points of this node.  For large nodes, the bounds of blocks of points are
+   * computed in parallel and then merged.  The union of hyperrectangles is
+   * exact, so the bound is the same as the one found by the general version;
+   * this is not true of other bounds (like BallBound), so they aren't merged.
+   *
+   * @param data Dataset which we are using.
+   * @param nodeBound The bound of this node.
+   */
+  template<int Power, bool TakeRoot>
+  void UpdateBound(MatType& data,
+                   bound::HRectBound<Power, TakeRoot>& nodeBound);
+
   /**
    * Splits the current node, assigning its left and right children recursively.
    *
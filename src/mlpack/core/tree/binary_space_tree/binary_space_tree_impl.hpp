@@ -13,9 +13,45 @@
 #include <mlpack/core/util/log.hpp>
 #include <mlpack/core/util/string_util.hpp>
 
+#include "../hrectbound.hpp"
+
+#include <new>
+
+#ifdef HAS_OPENMP
+  #include <omp.h>
+#endif
+
 namespace mlpack {
 namespace tree {
 
+/**
+ * Return the number of ranges that the given bound can store in the arena of a
+ * compacted tree.  Bounds that don't store ranges on the heap don't use the
+ * arena.
+ */
+template<typename BoundType>
+inline size_t ArenaRanges(const BoundType& /* bound */) { return 0; }
+
+template<int Power, bool TakeRoot>
+inline size_t ArenaRanges(const bound::HRectBound<Power, TakeRoot>& bound)
+{
+  return bound.Dim();
+}
+
+/**
+ * Move the ranges of the given bound into the arena of a compacted tree, if the
+ * bound can do that.
+ */
+template<typename BoundType>
+inline void MoveToArena(BoundType& /* bound */, math::Range* /* memory */) { }
+
+template<int Power, bool TakeRoot>
+inline void MoveToArena(bound::HRectBound<Power, TakeRoot>& bound,
+                        math::Range* memory)
+{
+  bound.UseMemory(memory);
+}
+
 // Each of these overloads is kept as a separate function to keep the overhead
 // from the two std::vectors out, if possible.
 template<typename BoundType, typename StatisticType, typename MatType>
@@ -29,10 +65,18 @@ BinarySpaceTree<BoundType, StatisticType, MatType>::BinarySpaceTree(
     count(data.n_cols), /* and spans all of the dataset. */
     leafSize(leafSize),
     bound(data.n_rows),
-    dataset(data)
+    dataset(data),
+    arena(NULL),
+    arenaSize(0),
+    inArena(false)
 {
-  // Do the actual splitting of this node.
-  SplitNode(data);
+  // Do the actual splitting of this node.  Children of large nodes are built
+  // as OpenMP tasks, which must be run inside a parallel region.
+  #pragma omp parallel if (count >= parallelBuildThreshold)
+  {
+    #pragma omp single
+    SplitNode(data);
+  }
 
   // Create the statistic depending on if we are a leaf or not.
   stat = StatisticType(*this);
@@ -50,15 +94,24 @@ BinarySpaceTree<BoundType, StatisticType, MatType>::BinarySpaceTree(
     count(data.n_cols),
     leafSize(leafSize),
     bound(data.n_rows),
-    dataset(data)
+    dataset(data),
+    arena(NULL),
+    arenaSize(0),
+    inArena(false)
 {
   // Initialize oldFromNew correctly.
   oldFromNew.resize(data.n_cols);
+  #pragma omp parallel for if (count >= parallelBuildThreshold)
   for (size_t i = 0; i < data.n_cols; i++)
     oldFromNew[i] = i; // Fill with unharmed indices.
 
-  // Now do the actual splitting.
-  SplitNode(data, oldFromNew);
+  // Now do the actual splitting.  Children of large nodes are built as OpenMP
+  // tasks, which must be run inside a parallel region.
+  #pragma omp parallel if (count >= parallelBuildThreshold)
+  {
+    #pragma omp single
+    SplitNode(data, oldFromNew);
+  }
 
   // Create the statistic depending on if we are a leaf or not.
   stat = StatisticType(*this);
@@ -77,21 +130,31 @@ BinarySpaceTree<BoundType, StatisticType, MatType>::BinarySpaceTree(
     count(data.n_cols),
     leafSize(leafSize),
     bound(data.n_rows),
-    dataset(data)
+    dataset(data),
+    arena(NULL),
+    arenaSize(0),
+    inArena(false)
 {
   // Initialize the oldFromNew vector correctly.
   oldFromNew.resize(data.n_cols);
+  #pragma omp parallel for if (count >= parallelBuildThreshold)
   for (size_t i = 0; i < data.n_cols; i++)
     oldFromNew[i] = i; // Fill with unharmed indices.
 
-  // Now do the actual splitting.
-  SplitNode(data, oldFromNew);
+  // Now do the actual splitting.  Children of large nodes are built as OpenMP
+  // tasks, which must be run inside a parallel region.
+  #pragma omp parallel if (count >= parallelBuildThreshold)
+  {
+    #pragma omp single
+    SplitNode(data, oldFromNew);
+  }
 
   // Create the statistic depending on if we are a leaf or not.
   stat = StatisticType(*this);
 
   // Map the newFromOld indices correctly.
   newFromOld.resize(data.n_cols);
+  #pragma omp parallel for if (count >= parallelBuildThreshold)
   for (size_t i = 0; i < data.n_cols; i++)
     newFromOld[oldFromNew[i]] = i;
 }
@@ -110,7 +173,10 @@ BinarySpaceTree<BoundType, StatisticType, MatType>::BinarySpaceTree(
     count(count),
     leafSize(leafSize),
     bound(data.n_rows),
-    dataset(data)
+    dataset(data),
+    arena(NULL),
+    arenaSize(0),
+    inArena(false)
 {
   // Perform the actual splitting.
   SplitNode(data);
@@ -134,7 +200,10 @@ BinarySpaceTree<BoundType, StatisticType, MatType>::BinarySpaceTree(
     count(count),
     leafSize(leafSize),
     bound(data.n_rows),
-    dataset(data)
+    dataset(data),
+    arena(NULL),
+    arenaSize(0),
+    inArena(false)
 {
   // Hopefully the vector is initialized correctly!  We can't check that
   // entirely but we can do a minor sanity check.
@@ -163,7 +232,10 @@ BinarySpaceTree<BoundType, StatisticType, MatType>::BinarySpaceTree(
     count(count),
     leafSize(leafSize),
     bound(data.n_rows),
-    dataset(data)
+    dataset(data),
+    arena(NULL),
+    arenaSize(0),
+    inArena(false)
 {
   // Hopefully the vector is initialized correctly!  We can't check that
   // entirely but we can do a minor sanity check.
@@ -213,7 +285,10 @@ BinarySpaceTree<BoundType, StatisticType, MatType>::BinarySpaceTree(
     stat(other.stat),
     splitDimension(other.splitDimension),
     furthestDescendantDistance(other.furthestDescendantDistance),
-    dataset(other.dataset)
+    dataset(other.dataset),
+    arena(NULL),
+    arenaSize(0),
+    inArena(false)
 {
   // Create left and right children (if any).
   if (other.Left())
@@ -237,10 +312,168 @@ BinarySpaceTree<BoundType, StatisticType, MatType>::BinarySpaceTree(
 template<typename BoundType, typename StatisticType, typename MatType>
 BinarySpaceTree<BoundType, StatisticType, MatType>::~BinarySpaceTree()
 {
-  if (left)
-    delete left;
-  if (right)
-    delete right;
+  DeleteChildren();
+}
+
+/**
+ * Create an empty node, to be filled in by MappedTree.
+ */
+template<typename BoundType, typename StatisticType, typename MatType>
+BinarySpaceTree<BoundType, StatisticType, MatType>::BinarySpaceTree(
+    MatType& data,
+    const bool inArena,
+    BinarySpaceTree* parent) :
+    left(NULL),
+    right(NULL),
+    parent(parent),
+    begin(0),
+    count(0),
+    leafSize(0),
+    splitDimension(0),
+    furthestDescendantDistance(0.0),
+    dataset(data),
+    arena(NULL),
+    arenaSize(0),
+    inArena(inArena)
+{
+  // Nothing to do.
+}
+
+/**
+ * Copy only the given node, for use in the arena of a compacted tree.
+ */
+template<typename BoundType, typename StatisticType, typename MatType>
+BinarySpaceTree<BoundType, StatisticType, MatType>::BinarySpaceTree(
+    const BinarySpaceTree& other,
+    BinarySpaceTree* parent) :
+    left(NULL),
+    right(NULL),
+    parent(parent),
+    begin(other.begin),
+    count(other.count),
+    leafSize(other.leafSize),
+    bound(other.bound),
+    stat(other.stat),
+    splitDimension(other.splitDimension),
+    furthestDescendantDistance(other.furthestDescendantDistance),
+    dataset(other.dataset),
+    arena(NULL),
+    arenaSize(0),
+    inArena(true)
+{
+  // Nothing to do.
+}
+
+/**
+ * Move all the descendants of this node (and their bounds) into one contiguous
+ * block of memory.
+ */
+template<typename BoundType, typename StatisticType, typename MatType>
+void BinarySpaceTree<BoundType, StatisticType, MatType>::Compact()
+{
+  // The descendants of a node in an arena are already compact, and they can't
+  // be freed individually anyway.
+  if (inArena || IsLeaf())
+    return;
+
+  // Count the nodes and ranges that the arena must hold.
+  size_t numNodes = 0;
+  size_t numRanges = 0;
+  std::vector<const BinarySpaceTree*> stack;
+  stack.push_back(this);
+  while (!stack.empty())
+  {
+    const BinarySpaceTree* node = stack.back();
+    stack.pop_back();
+
+    if (node != this)
+    {
+      ++numNodes;
+      numRanges += ArenaRanges(node->Bound());
+    }
+
+    if (node->Left())
+      stack.push_back(node->Left());
+    if (node->Right())
+      stack.push_back(node->Right());
+  }
+
+  // The ranges are stored directly after the nodes.  The size of a node is a
+  // multiple of its alignment, which is at least the alignment of a range.
+  char* newArena = new char[numNodes * sizeof(BinarySpaceTree) +
+      numRanges * sizeof(math::Range)];
+  BinarySpaceTree* nodes = reinterpret_cast<BinarySpaceTree*>(newArena);
+  math::Range* ranges = reinterpret_cast<math::Range*>(newArena +
+      numNodes * sizeof(BinarySpaceTree));
+
+  size_t nodeIndex = 0;
+  size_t rangeIndex = 0;
+  BinarySpaceTree* newLeft = CopyToArena(*left, this, nodes, nodeIndex, ranges,
+      rangeIndex);
+  BinarySpaceTree* newRight = (right == NULL) ? NULL : CopyToArena(*right, this,
+      nodes, nodeIndex, ranges, rangeIndex);
+
+  // Now the old descendants can be freed.
+  DeleteChildren();
+
+  left = newLeft;
+  right = newRight;
+  arena = newArena;
+  arenaSize = numNodes;
+}
+
+template<typename BoundType, typename StatisticType, typename MatType>
+BinarySpaceTree<BoundType, StatisticType, MatType>*
+BinarySpaceTree<BoundType, StatisticType, MatType>::CopyToArena(
+    const BinarySpaceTree& node,
+    BinarySpaceTree* parent,
+    BinarySpaceTree* nodes,
+    size_t& nodeIndex,
+    math::Range* ranges,
+    size_t& rangeIndex)
+{
+  BinarySpaceTree* copy = new (nodes + nodeIndex) BinarySpaceTree(node,
+      parent);
+  ++nodeIndex;
+
+  MoveToArena(copy->Bound(), ranges + rangeIndex);
+  rangeIndex += ArenaRanges(copy->Bound());
+
+  if (node.Left())
+    copy->Left() = CopyToArena(*node.Left(), copy, nodes, nodeIndex, ranges,
+        rangeIndex);
+  if (node.Right())
+    copy->Right() = CopyToArena(*node.Right(), copy, nodes, nodeIndex, ranges,
+        rangeIndex);
+
+  return copy;
+}
+
+template<typename BoundType, typename StatisticType, typename MatType>
+void BinarySpaceTree<BoundType, StatisticType, MatType>::DeleteChildren()
+{
+  if (arena)
+  {
+    // Every descendant is in the arena, so we destroy them all here; their own
+    // destructors will not touch their children.
+    BinarySpaceTree* nodes = reinterpret_cast<BinarySpaceTree*>(arena);
+    for (size_t i = 0; i < arenaSize; ++i)
+      nodes[i].~BinarySpaceTree();
+
+    delete[] arena;
+    arena = NULL;
+    arenaSize = 0;
+  }
+  else if (!inArena)
+  {
+    if (left)
+      delete left;
+    if (right)
+      delete right;
+  }
+
+  left = NULL;
+  right = NULL;
 }
 
 /**
@@ -456,12 +689,60 @@ inline size_t BinarySpaceTree<BoundType, StatisticType, MatType>::End() const
   return begin + count;
 }
 
+template<typename BoundType, typename StatisticType, typename MatType>
+template<typename AnyBoundType>
+void BinarySpaceTree<BoundType, StatisticType, MatType>::UpdateBound(
+    MatType& data,
+    AnyBoundType& nodeBound)
+{
+  nodeBound |= data.cols(begin, begin + count - 1);
+}
+
+template<typename BoundType, typename StatisticType, typename MatType>
+template<int Power, bool TakeRoot>
+void BinarySpaceTree<BoundType, StatisticType, MatType>::UpdateBound(
+    MatType& data,
+    bound::HRectBound<Power, TakeRoot>& nodeBound)
+{
+#ifdef HAS_OPENMP
+  // For large nodes, split the points into one block per thread, find the bound
+  // of each block in its own task, and then merge the block bounds.  Merging
+  // hyperrectangle bounds is exact, so this gives the same bound as the serial
+  // computation.
+  const size_t numBlocks = (size_t) omp_get_num_threads();
+  if ((numBlocks > 1) && (count >= parallelBuildThreshold))
+  {
+    std::vector<bound::HRectBound<Power, TakeRoot> > blockBounds(numBlocks,
+        bound::HRectBound<Power, TakeRoot>(data.n_rows));
+
+    for (size_t b = 0; b < numBlocks; ++b)
+    {
+      #pragma omp task shared(data, blockBounds) firstprivate(b)
+      {
+        const size_t blockBegin = begin + (b * count) / numBlocks;
+        const size_t blockEnd = begin + ((b + 1) * count) / numBlocks;
+        if (blockEnd > blockBegin)
+          blockBounds[b] |= data.cols(blockBegin, blockEnd - 1);
+      }
+    }
+    #pragma omp taskwait
+
+    for (size_t b = 0; b < numBlocks; ++b)
+      nodeBound |= blockBounds[b];
+
+    return;
+  }
+#endif
+
+  nodeBound |= data.cols(begin, begin + count - 1);
+}
+
 template<typename BoundType, typename StatisticType, typename MatType>
 void
     BinarySpaceTree<BoundType, StatisticType, MatType>::SplitNode(MatType& data)
 {
   // We need to expand the bounds of this node properly.
-  bound |= data.cols(begin, begin + count - 1);
+  UpdateBound(data, bound);
 
   // Calculate the furthest descendant distance.
   furthestDescendantDistance = 0.5 * bound.Diameter();
@@ -500,11 +781,15 @@ void
   size_t splitCol = GetSplitIndex(data, splitDim, splitVal);
 
   // Now that we know the split column, we will recursively split the children
-  // by calling their constructors (which perform this splitting process).
+  // by calling their constructors (which perform this splitting process).  The
+  // children work on disjoint sets of columns, so for large nodes the left
+  // child is built in a separate task while this thread builds the right child.
+  #pragma omp task if (count >= parallelBuildThreshold) shared(data)
   left = new BinarySpaceTree<BoundType, StatisticType, MatType>(data, begin,
       splitCol - begin, this, leafSize);
   right = new BinarySpaceTree<BoundType, StatisticType, MatType>(data, splitCol,
       begin + count - splitCol, this, leafSize);
+  #pragma omp taskwait
 }
 
 template<typename BoundType, typename StatisticType, typename MatType>
@@ -514,7 +799,7 @@ void BinarySpaceTree<BoundType, StatisticType, MatType>::SplitNode(
 {
   // This should be a single function for Bound.
   // We need to expand the bounds of this node properly.
-  bound |= data.cols(begin, begin + count - 1);
+  UpdateBound(data, bound);
 
   // Calculate the furthest descendant distance.
   furthestDescendantDistance = 0.5 * bound.Diameter();
@@ -553,11 +838,16 @@ void BinarySpaceTree<BoundType, StatisticType, MatType>::SplitNode(
   size_t splitCol = GetSplitIndex(data, splitDim, splitVal, oldFromNew);
 
   // Now that we know the split column, we will recursively split the children
-  // by calling their constructors (which perform this splitting process).
+  // by calling their constructors (which perform this splitting process).  The
+  // children work on disjoint sets of columns (and disjoint parts of
+  // oldFromNew), so for large nodes the left child is built in a separate task
+  // while this thread builds the right child.
+  #pragma omp task if (count >= parallelBuildThreshold) shared(data, oldFromNew)
   left = new BinarySpaceTree<BoundType, StatisticType, MatType>(data, begin,
       splitCol - begin, oldFromNew, this, leafSize);
   right = new BinarySpaceTree<BoundType, StatisticType, MatType>(data, splitCol,
       begin + count - splitCol, oldFromNew, this, leafSize);
+  #pragma omp taskwait
 }
 
 template<typename BoundType, typename StatisticType, typename MatType>
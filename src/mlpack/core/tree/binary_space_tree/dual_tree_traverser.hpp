@@ -13,6 +13,9 @@
 #include <mlpack/core.hpp>
 
 #include "binary_space_tree.hpp"
+#include "../rule_traits.hpp"
+
+#include <boost/type_traits/integral_constant.hpp>
 
 namespace mlpack {
 namespace tree {
@@ -30,6 +33,10 @@ class BinarySpaceTree<BoundType, StatisticType, MatType>::DualTreeTraverser
   /**
    * Traverse the two trees.  This does not reset the number of prunes.
    *
+   * If MLPACK was compiled with OpenMP and RuleTraits<RuleType>::IsParallelSafe
+   * is true, the query tree is split into disjoint subtrees which are
+   * traversed in parallel, each with its own copy of the rules.
+   *
    * @param queryNode The query node to be traversed.
    * @param referenceNode The reference node to be traversed.
    */
@@ -70,6 +77,34 @@ class BinarySpaceTree<BoundType, StatisticType, MatType>::DualTreeTraverser
 
   //! The number of times a base case was calculated.
   size_t numBaseCases;
+
+  /**
+   * Compute the base cases between two leaves, one pair at a time.  This is
+   * used when the rules do not have BaseCases().
+   */
+  void LeafBaseCases(BinarySpaceTree& queryNode,
+                     BinarySpaceTree& referenceNode,
+                     const boost::false_type&);
+
+  /**
+   * Compute the base cases between two leaves with one call to the BaseCases()
+   * method of the rules, for all the query points which are not pruned.
+   */
+  void LeafBaseCases(BinarySpaceTree& queryNode,
+                     BinarySpaceTree& referenceNode,
+                     const boost::true_type&);
+
+  /**
+   * Split the query node into a set of disjoint query subtrees, then traverse
+   * each of those against the reference node in parallel.  Each thread uses
+   * its own copy of the rules, and the traversal statistics of each thread
+   * are added to this traverser's statistics when all threads are finished.
+   *
+   * @param queryNode The query node to be traversed.
+   * @param referenceNode The reference node to be traversed.
+   */
+  void ParallelTraverse(BinarySpaceTree& queryNode,
+                        BinarySpaceTree& referenceNode);
 };
 
 }; // namespace tree
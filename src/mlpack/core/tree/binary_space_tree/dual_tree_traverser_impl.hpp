@@ -12,6 +12,10 @@
 // In case it hasn't been included yet.
 #include "dual_tree_traverser.hpp"
 
+#ifdef HAS_OPENMP
+  #include <omp.h>
+#endif
+
 namespace mlpack {
 namespace tree {
 
@@ -33,27 +37,25 @@ DualTreeTraverser<RuleType>::Traverse(
     BinarySpaceTree<BoundType, StatisticType, MatType>& queryNode,
     BinarySpaceTree<BoundType, StatisticType, MatType>& referenceNode)
 {
+#ifdef HAS_OPENMP
+  // If the rules allow it, and we are not already running in parallel, split
+  // the query tree up and traverse the pieces in parallel.
+  if (RuleTraits<RuleType>::IsParallelSafe && !queryNode.IsLeaf() &&
+      !omp_in_parallel() && (omp_get_max_threads() > 1))
+  {
+    ParallelTraverse(queryNode, referenceNode);
+    return;
+  }
+#endif
+
   // Increment the visit counter.
   ++numVisited;
 
   // If both are leaves, we must evaluate the base case.
   if (queryNode.IsLeaf() && referenceNode.IsLeaf())
   {
-    // Loop through each of the points in each node.
-    for (size_t query = queryNode.Begin(); query < queryNode.End(); ++query)
-    {
-      // See if we need to investigate this point (this function should be
-      // implemented for the single-tree recursion too).
-      const double score = rule.Score(query, referenceNode);
-
-      if (score == DBL_MAX)
-        continue; // We can't improve this particular point.
-
-      for (size_t ref = referenceNode.Begin(); ref < referenceNode.End(); ++ref)
-        rule.BaseCase(query, ref);
-
-      numBaseCases += referenceNode.Count();
-    }
+    LeafBaseCases(queryNode, referenceNode, boost::integral_constant<bool,
+        RuleTraits<RuleType>::HasBlockBaseCase>());
   }
   else if ((!queryNode.IsLeaf()) && referenceNode.IsLeaf())
   {
@@ -246,6 +248,119 @@ DualTreeTraverser<RuleType>::Traverse(
   }
 }
 
+template<typename BoundType, typename StatisticType, typename MatType>
+template<typename RuleType>
+void BinarySpaceTree<BoundType, StatisticType, MatType>::
+DualTreeTraverser<RuleType>::ParallelTraverse(
+    BinarySpaceTree<BoundType, StatisticType, MatType>& queryNode,
+    BinarySpaceTree<BoundType, StatisticType, MatType>& referenceNode)
+{
+  // Build a frontier of disjoint query subtrees by repeatedly splitting the
+  // largest non-leaf node in the frontier.  We want several subtrees per
+  // thread, so that threads which finish early can pick up more work.
+  std::vector<BinarySpaceTree*> frontier;
+  frontier.push_back(&queryNode);
+
+#ifdef HAS_OPENMP
+  const size_t targetSize = 8 * (size_t) omp_get_max_threads();
+#else
+  const size_t targetSize = 1;
+#endif
+
+  while (frontier.size() < targetSize)
+  {
+    size_t largest = frontier.size();
+    for (size_t i = 0; i < frontier.size(); ++i)
+    {
+      if (!frontier[i]->IsLeaf() && ((largest == frontier.size()) ||
+          (frontier[i]->Count() > frontier[largest]->Count())))
+        largest = i;
+    }
+
+    if (largest == frontier.size())
+      break; // Everything in the frontier is a leaf.
+
+    BinarySpaceTree* node = frontier[largest];
+    frontier[largest] = node->Left();
+    frontier.push_back(node->Right());
+  }
+
+  size_t prunes = 0;
+  size_t visited = 0;
+  size_t scores = 0;
+  size_t baseCases = 0;
+
+  // Each subtree gets its own copy of the rules and its own traverser, so there
+  // is no shared traversal state between threads.
+  #pragma omp parallel for schedule(dynamic) \
+      reduction(+:prunes, visited, scores, baseCases)
+  for (size_t i = 0; i < frontier.size(); ++i)
+  {
+    RuleType threadRule(rule);
+    DualTreeTraverser<RuleType> threadTraverser(threadRule);
+
+    threadTraverser.Traverse(*frontier[i], referenceNode);
+
+    prunes += threadTraverser.NumPrunes();
+    visited += threadTraverser.NumVisited();
+    scores += threadTraverser.NumScores();
+    baseCases += threadTraverser.NumBaseCases();
+  }
+
+  numPrunes += prunes;
+  numVisited += visited;
+  numScores += scores;
+  numBaseCases += baseCases;
+}
+
+template<typename BoundType, typename StatisticType, typename MatType>
+template<typename RuleType>
+void BinarySpaceTree<BoundType, StatisticType, MatType>::
+DualTreeTraverser<RuleType>::LeafBaseCases(
+    BinarySpaceTree<BoundType, StatisticType, MatType>& queryNode,
+    BinarySpaceTree<BoundType, StatisticType, MatType>& referenceNode,
+    const boost::false_type&)
+{
+  // Loop through each of the points in each node.
+  for (size_t query = queryNode.Begin(); query < queryNode.End(); ++query)
+  {
+    // See if we need to investigate this point (this function should be
+    // implemented for the single-tree recursion too).
+    const double score = rule.Score(query, referenceNode);
+
+    if (score == DBL_MAX)
+      continue; // We can't improve this particular point.
+
+    for (size_t ref = referenceNode.Begin(); ref < referenceNode.End(); ++ref)
+      rule.BaseCase(query, ref);
+
+    numBaseCases += referenceNode.Count();
+  }
+}
+
+template<typename BoundType, typename StatisticType, typename MatType>
+template<typename RuleType>
+void BinarySpaceTree<BoundType, StatisticType, MatType>::
+DualTreeTraverser<RuleType>::LeafBaseCases(
+    BinarySpaceTree<BoundType, StatisticType, MatType>& queryNode,
+    BinarySpaceTree<BoundType, StatisticType, MatType>& referenceNode,
+    const boost::true_type&)
+{
+  // Collect the query points which can't be pruned.
+  std::vector<size_t> queryIndices;
+  queryIndices.reserve(queryNode.Count());
+  for (size_t query = queryNode.Begin(); query < queryNode.End(); ++query)
+    if (rule.Score(query, referenceNode) != DBL_MAX)
+      queryIndices.push_back(query);
+
+  if (queryIndices.empty())
+    return;
+
+  rule.BaseCases(queryIndices, referenceNode.Begin(), referenceNode.End());
+
+  numBaseCases += queryIndices.size() * referenceNode.Count();
+}
+
 }; // namespace tree
 }; // namespace mlpack
 
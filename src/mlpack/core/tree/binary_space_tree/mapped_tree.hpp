@@ -0,0 +1,160 @@
+/**
+ * @file mapped_tree.hpp
+ * @author Ryan Curtin
+ *
+ * Definition of the MappedTree class, which saves a BinarySpaceTree (along with
+ * its reordered dataset) to a binary file and loads it again by mapping the
+ * file into memory, so that the tree does not need to be rebuilt.
+ */
+#ifndef __MLPACK_CORE_TREE_BINARY_SPACE_TREE_MAPPED_TREE_HPP
+#define __MLPACK_CORE_TREE_BINARY_SPACE_TREE_MAPPED_TREE_HPP
+
+#include <mlpack/core.hpp>
+
+#include "binary_space_tree.hpp"
+
+namespace mlpack {
+namespace tree {
+
+/**
+ * A BinarySpaceTree which is loaded from a file written by MappedTree::Save().
+ * The file holds the reordered dataset, the mapping from the new point indices
+ * to the old point indices, and every node of the tree along with its bound.
+ *
+ * The file is mapped into memory, and the dataset and the bounds of the nodes
+ * are used directly from the mapping, without being copied.  The nodes are
+ * allocated in one contiguous block, in the same depth-first order that
+ * BinarySpaceTree::Compact() uses, so a loaded tree is already compact.  The
+ * statistic of each node is recomputed when the tree is loaded.  The mapping
+ * is private, so modifying the dataset or the tree does not modify the file.
+ *
+ * A typical use is to build a reference tree once, save it, and then answer
+ * many sets of queries with it:
+ *
+ * @code
+ * // Build and save.
+ * std::vector<size_t> oldFromNew;
+ * TreeType tree(dataset, oldFromNew);
+ * MappedTree<TreeType>::Save("tree.bin", tree, oldFromNew);
+ *
+ * // Later, possibly in another process.
+ * MappedTree<TreeType> mappedTree("tree.bin");
+ * TreeType& tree = mappedTree.Tree();
+ * @endcode
+ *
+ * Files are written in the byte order and word size of the machine that
+ * creates them, so they should not be moved to machines with a different
+ * architecture.
+ *
+ * @tparam TreeType Type of tree to save and load.  This must be a
+ *     BinarySpaceTree using HRectBound and arma::mat.
+ */
+template<typename TreeType>
+class MappedTree
+{
+ public:
+  /**
+   * Save the given tree, which must be the root of a tree, to the given file.
+   * The dataset that the tree is built on is saved too, as is the given
+   * mapping of the new point indices to the old point indices.  If the file
+   * cannot be written, a fatal error is raised.
+   *
+   * @param filename File to save the tree to.
+   * @param tree Root of the tree to save.
+   * @param oldFromNew Mapping from new point indices to old point indices,
+   *     as given by the constructor of the tree.
+   */
+  static void Save(const std::string& filename,
+                   const TreeType& tree,
+                   const std::vector<size_t>& oldFromNew);
+
+  /**
+   * Load a tree which was saved with Save() by mapping the given file into
+   * memory.  If the file cannot be read or is not a valid tree file, a fatal
+   * error is raised.
+   *
+   * @param filename File to load the tree from.
+   */
+  MappedTree(const std::string& filename);
+
+  /**
+   * Free the tree and unmap the file.  This invalidates any references to the
+   * tree and the dataset.
+   */
+  ~MappedTree();
+
+  //! Get the root of the tree.
+  const TreeType& Tree() const { return *tree; }
+  //! Modify the root of the tree.
+  TreeType& Tree() { return *tree; }
+
+  //! Get the (reordered) dataset that the tree is built on.
+  const arma::mat& Dataset() const { return dataset; }
+  //! Modify the (reordered) dataset that the tree is built on.  Be careful!
+  arma::mat& Dataset() { return dataset; }
+
+  //! Get the mapping from new point indices to old point indices.
+  const std::vector<size_t>& OldFromNew() const { return oldFromNew; }
+
+ private:
+  //! Layout of the beginning of a tree file.
+  struct FileHeader
+  {
+    char magic[8];
+    uint64_t version;
+    uint64_t dimension;
+    uint64_t numPoints;
+    uint64_t numNodes;
+    uint64_t leafSize;
+  };
+
+  //! Layout of each node in a tree file.  Children are given as node indices;
+  //! index 0 is the root, so it also means there is no child.
+  struct NodeRecord
+  {
+    uint64_t begin;
+    uint64_t count;
+    uint64_t left;
+    uint64_t right;
+    uint64_t splitDimension;
+    double furthestDescendantDistance;
+  };
+
+  /**
+   * Append the given node and its descendants to the list of nodes in
+   * depth-first order, and append their bounds to the list of bounds.  Returns
+   * the index of the node.
+   */
+  static size_t SaveNode(const TreeType& node,
+                         std::vector<NodeRecord>& nodes,
+                         std::vector<double>& bounds);
+
+  /**
+   * Map the given file into memory and check that it is a valid tree file,
+   * storing the size of the mapping.  Returns the mapped memory.
+   */
+  static char* MapFile(const std::string& filename, size_t& mappingSize);
+
+  //! Return the header of the mapped file.
+  const FileHeader& Header() const
+  { return *reinterpret_cast<const FileHeader*>(mapping); }
+
+  //! The size of the mapped file.
+  size_t mappingSize;
+  //! The mapped file.
+  char* mapping;
+  //! The dataset, which uses memory from the mapped file.
+  arma::mat dataset;
+  //! The mapping from new point indices to old point indices.
+  std::vector<size_t> oldFromNew;
+  //! The root of the tree.
+  TreeType* tree;
+};
+
+}; // namespace tree
+}; // namespace mlpack
+
+// Include implementation.
+#include "mapped_tree_impl.hpp"
+
+#endif
@@ -0,0 +1,331 @@
+/**
+ * @file mapped_tree_impl.hpp
+ * @author Ryan Curtin
+ *
+ * Implementation of the MappedTree class, which saves and loads
+ * BinarySpaceTrees through memory-mapped files.
+ */
+#ifndef __MLPACK_CORE_TREE_BINARY_SPACE_TREE_MAPPED_TREE_IMPL_HPP
+#define __MLPACK_CORE_TREE_BINARY_SPACE_TREE_MAPPED_TREE_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "mapped_tree.hpp"
+
+#include <fstream>
+#include <limits>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mlpack {
+namespace tree {
+
+//! The magic string at the beginning of every tree file.
+static const char mappedTreeMagic[8] = { 'M', 'L', 'P', 'K', 'T', 'R', 'E',
+    'E' };
+//! The version of the tree file format.
+static const uint64_t mappedTreeVersion = 1;
+
+//! Set product to a * b, returning false (and leaving product unmodified) if
+//! the product does not fit in 64 bits.
+inline bool MultiplyWithoutOverflow(const uint64_t a,
+                                    const uint64_t b,
+                                    uint64_t& product)
+{
+  if (a != 0 && b > std::numeric_limits<uint64_t>::max() / a)
+    return false;
+
+  product = a * b;
+  return true;
+}
+
+template<typename TreeType>
+void MappedTree<TreeType>::Save(const std::string& filename,
+                                const TreeType& tree,
+                                const std::vector<size_t>& oldFromNew)
+{
+  const arma::mat& data = tree.Dataset();
+  if (oldFromNew.size() != data.n_cols)
+  {
+    Log::Fatal << "MappedTree::Save(): the mapping has " << oldFromNew.size()
+        << " points, but the dataset has " << data.n_cols << " points."
+        << std::endl;
+  }
+
+  // Gather all the nodes and bounds, in depth-first order.
+  std::vector<NodeRecord> nodes;
+  std::vector<double> bounds;
+  SaveNode(tree, nodes, bounds);
+
+  FileHeader header;
+  std::copy(mappedTreeMagic, mappedTreeMagic + 8, header.magic);
+  header.version = mappedTreeVersion;
+  header.dimension = data.n_rows;
+  header.numPoints = data.n_cols;
+  header.numNodes = nodes.size();
+  header.leafSize = tree.LeafSize();
+
+  std::vector<uint64_t> mapping(oldFromNew.begin(), oldFromNew.end());
+
+  std::ofstream stream(filename.c_str(), std::ios::out | std::ios::binary |
+      std::ios::trunc);
+  if (!stream.is_open())
+  {
+    Log::Fatal << "Cannot open file '" << filename << "' to save tree."
+        << std::endl;
+  }
+
+  stream.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+  stream.write(reinterpret_cast<const char*>(data.memptr()),
+      data.n_elem * sizeof(double));
+  stream.write(reinterpret_cast<const char*>(&mapping[0]),
+      mapping.size() * sizeof(uint64_t));
+  stream.write(reinterpret_cast<const char*>(&nodes[0]),
+      nodes.size() * sizeof(NodeRecord));
+  stream.write(reinterpret_cast<const char*>(&bounds[0]),
+      bounds.size() * sizeof(double));
+
+  if (!stream.good())
+  {
+    Log::Fatal << "Error while writing tree to file '" << filename << "'."
+        << std::endl;
+  }
+}
+
+template<typename TreeType>
+MappedTree<TreeType>::MappedTree(const std::string& filename) :
+    mappingSize(0),
+    mapping(MapFile(filename, mappingSize)),
+    dataset(reinterpret_cast<double*>(mapping + sizeof(FileHeader)),
+        Header().dimension, Header().numPoints, false, true),
+    tree(NULL)
+{
+  const size_t dimension = Header().dimension;
+  const size_t numPoints = Header().numPoints;
+  const size_t numNodes = Header().numNodes;
+
+  // Find each of the sections of the file.
+  char* position = mapping + sizeof(FileHeader) +
+      dimension * numPoints * sizeof(double);
+  const uint64_t* fileOldFromNew = reinterpret_cast<const uint64_t*>(position);
+  position += numPoints * sizeof(uint64_t);
+  const NodeRecord* records = reinterpret_cast<const NodeRecord*>(position);
+  position += numNodes * sizeof(NodeRecord);
+  math::Range* ranges = reinterpret_cast<math::Range*>(position);
+
+  // Check every index in the file before it is used, so that a corrupt file
+  // can't make us read or write outside of the mapping.
+  bool valid = true;
+  for (size_t i = 0; i < numPoints; ++i)
+    if (fileOldFromNew[i] >= numPoints)
+      valid = false;
+
+  // Children always come after their parents, so we can find the parent of
+  // every node (and check the structure) in one pass.  Every node other than
+  // the root must be the child of exactly one node, and every node must have
+  // either two children or none.
+  std::vector<size_t> parents(numNodes, numNodes);
+  for (size_t i = 0; i < numNodes && valid; ++i)
+  {
+    if (records[i].begin > numPoints ||
+        records[i].count > numPoints - records[i].begin)
+      valid = false;
+
+    if ((records[i].left == 0) != (records[i].right == 0))
+      valid = false;
+
+    const size_t children[2] = { records[i].left, records[i].right };
+    for (size_t c = 0; c < 2 && valid; ++c)
+    {
+      if (children[c] == 0)
+        continue;
+
+      if (children[c] <= i || children[c] >= numNodes ||
+          parents[children[c]] != numNodes)
+        valid = false;
+      else
+        parents[children[c]] = i;
+    }
+  }
+
+  for (size_t i = 1; i < numNodes && valid; ++i)
+    if (parents[i] >= numNodes)
+      valid = false;
+
+  if (!valid)
+  {
+    // The destructor will not be called, so the mapping must be released here.
+    munmap(mapping, mappingSize);
+    Log::Fatal << "Tree file '" << filename << "' is corrupt." << std::endl;
+  }
+
+  oldFromNew.assign(fileOldFromNew, fileOldFromNew + numPoints);
+
+  // The root is allocated by itself, and every other node lives in the arena
+  // of the root, just like in a compacted tree.
+  std::vector<TreeType*> nodes(numNodes);
+  tree = new TreeType(dataset, false, (TreeType*) NULL);
+  nodes[0] = tree;
+  if (numNodes > 1)
+  {
+    tree->arena = new char[(numNodes - 1) * sizeof(TreeType)];
+    TreeType* arenaNodes = reinterpret_cast<TreeType*>(tree->arena);
+    for (size_t i = 1; i < numNodes; ++i)
+    {
+      nodes[i] = new (arenaNodes + (i - 1)) TreeType(dataset, true,
+          nodes[parents[i]]);
+      ++tree->arenaSize;
+    }
+  }
+
+  for (size_t i = 0; i < numNodes; ++i)
+  {
+    TreeType& node = *nodes[i];
+    node.begin = records[i].begin;
+    node.count = records[i].count;
+    node.leafSize = Header().leafSize;
+    node.splitDimension = records[i].splitDimension;
+    node.furthestDescendantDistance = records[i].furthestDescendantDistance;
+    node.left = (records[i].left == 0) ? NULL : nodes[records[i].left];
+    node.right = (records[i].right == 0) ? NULL : nodes[records[i].right];
+    node.bound.UseExistingMemory(ranges + i * dimension, dimension);
+  }
+
+  // The statistics are built from the bottom of the tree up, like they are
+  // when the tree is built.
+  for (size_t i = numNodes; i > 0; --i)
+    nodes[i - 1]->Stat() = typename TreeType::Statistic(*nodes[i - 1]);
+}
+
+template<typename TreeType>
+MappedTree<TreeType>::~MappedTree()
+{
+  // The tree uses the mapping, so it must be destroyed first.
+  if (tree)
+    delete tree;
+
+  munmap(mapping, mappingSize);
+}
+
+template<typename TreeType>
+size_t MappedTree<TreeType>::SaveNode(const TreeType& node,
+                                      std::vector<NodeRecord>& nodes,
+                                      std::vector<double>& bounds)
+{
+  const size_t index = nodes.size();
+  nodes.push_back(NodeRecord());
+
+  for (size_t d = 0; d < node.Bound().Dim(); ++d)
+  {
+    bounds.push_back(node.Bound()[d].Lo());
+    bounds.push_back(node.Bound()[d].Hi());
+  }
+
+  // The children must be saved after this node has been added.
+  const size_t left = (node.Left() == NULL) ? 0 : SaveNode(*node.Left(), nodes,
+      bounds);
+  const size_t right = (node.Right() == NULL) ? 0 : SaveNode(*node.Right(),
+      nodes, bounds);
+
+  NodeRecord& record = nodes[index];
+  record.begin = node.Begin();
+  record.count = node.Count();
+  record.left = left;
+  record.right = right;
+  record.splitDimension = node.SplitDimension();
+  record.furthestDescendantDistance = node.FurthestDescendantDistance();
+
+  return index;
+}
+
+template<typename TreeType>
+char* MappedTree<TreeType>::MapFile(const std::string& filename,
+                                    size_t& mappingSize)
+{
+  // The bounds are used directly from the file, so the layout of a range must
+  // be two doubles.
+  if (sizeof(math::Range) != 2 * sizeof(double))
+    Log::Fatal << "MappedTree is not supported on this platform." << std::endl;
+
+  const int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    Log::Fatal << "Cannot open file '" << filename << "' to load tree."
+        << std::endl;
+  }
+
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) != 0 || fileStat.st_size < (off_t)
+      sizeof(FileHeader))
+  {
+    close(fd);
+    Log::Fatal << "File '" << filename << "' is not a tree file." << std::endl;
+  }
+  mappingSize = fileStat.st_size;
+
+  // The mapping is private and writable, so that the dataset and the bounds can
+  // be modified (and the file will not be).
+  void* memory = mmap(NULL, mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+      fd, 0);
+  close(fd);
+  if (memory == MAP_FAILED)
+    Log::Fatal << "Cannot map file '" << filename << "'." << std::endl;
+
+  char* mapping = reinterpret_cast<char*>(memory);
+  const FileHeader& header = *reinterpret_cast<const FileHeader*>(mapping);
+  if (!std::equal(mappedTreeMagic, mappedTreeMagic + 8, header.magic))
+  {
+    munmap(memory, mappingSize);
+    Log::Fatal << "File '" << filename << "' is not a tree file." << std::endl;
+  }
+
+  if (header.version != mappedTreeVersion)
+  {
+    munmap(memory, mappingSize);
+    Log::Fatal << "Tree file '" << filename << "' has unsupported version "
+        << header.version << "." << std::endl;
+  }
+
+  // The sizes in the header can't be trusted, so each section size is checked
+  // for overflow, and the sum of the sections must not pass the end of the
+  // file, before the sizes are used.
+  uint64_t sectionSizes[4];
+  bool valid = (header.numNodes > 0) &&
+      MultiplyWithoutOverflow(header.dimension, header.numPoints,
+          sectionSizes[0]) &&
+      MultiplyWithoutOverflow(sectionSizes[0], sizeof(double),
+          sectionSizes[0]) &&
+      MultiplyWithoutOverflow(header.numPoints, sizeof(uint64_t),
+          sectionSizes[1]) &&
+      MultiplyWithoutOverflow(header.numNodes, sizeof(NodeRecord),
+          sectionSizes[2]) &&
+      MultiplyWithoutOverflow(header.numNodes, header.dimension,
+          sectionSizes[3]) &&
+      MultiplyWithoutOverflow(sectionSizes[3], 2 * sizeof(double),
+          sectionSizes[3]);
+
+  uint64_t expectedSize = sizeof(FileHeader);
+  for (size_t i = 0; i < 4 && valid; ++i)
+  {
+    if (sectionSizes[i] > mappingSize - expectedSize)
+      valid = false;
+    else
+      expectedSize += sectionSizes[i];
+  }
+
+  if (!valid || expectedSize != mappingSize)
+  {
+    munmap(memory, mappingSize);
+    Log::Fatal << "Tree file '" << filename << "' is corrupt." << std::endl;
+  }
+
+  return mapping;
+}
+
+}; // namespace tree
+}; // namespace mlpack
+
+#endif
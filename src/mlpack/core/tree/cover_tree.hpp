@@ -12,5 +12,6 @@
 #include "cover_tree/single_tree_traverser.hpp"
 #include "cover_tree/dual_tree_traverser.hpp"
 #include "cover_tree/traits.hpp"
+#include "rule_traits.hpp"
 
 #endif
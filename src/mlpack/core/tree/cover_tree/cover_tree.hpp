@@ -78,6 +78,11 @@ namespace tree {
  * used.  The StatisticType policy allows you to define statistics which can be
  * gathered during the creation of the tree.
  *
+ * Each child is built from the points which the children before it have not
+ * taken, so the children of a node are built one after another; but if OpenMP
+ * is available, the distance computations of the large nodes are split between
+ * threads.  The tree is the same for any number of threads.
+ *
  * @tparam MetricType Metric type to use during tree construction.
  * @tparam RootPointPolicy Determines which point to use as the root node.
  * @tparam StatisticType Statistic to be used during tree creation.
@@ -329,6 +334,10 @@ class CoverTree
   MetricType& Metric() const { return *metric; }
 
  private:
+  //! Distances from a point to at least this many points are computed in
+  //! parallel during construction (if OpenMP is available).
+  static const size_t parallelDistanceThreshold = 2000;
+
   //! Reference to the matrix which this tree is built on.
   const arma::mat& dataset;
 
@@ -378,7 +387,9 @@ class CoverTree
    * Fill the vector of distances with the distances between the point specified
    * by pointIndex and each point in the indices array.  The distances of the
    * first pointSetSize points in indices are calculated (so, this does not
-   * necessarily need to use all of the points in the arrays).
+   * necessarily need to use all of the points in the arrays).  If OpenMP is
+   * available and the point set is large, the distances are computed in
+   * parallel, so the metric must be safe to call from several threads.
    *
    * @param pointIndex Point to build the distances for.
    * @param indices List of indices to compute distances for.
@@ -645,8 +645,12 @@ void CoverTree<MetricType, RootPointPolicy, StatisticType>::ComputeDistances(
     const size_t pointSetSize)
 {
   // For each point, rebuild the distances.  The indices do not need to be
-  // modified.
+  // modified.  Each distance is independent, so when there is enough work
+  // (near the top of the tree), the points are split between threads; the
+  // distances are the same either way, so the tree does not change.
   distanceComps += pointSetSize;
+  #pragma omp parallel for schedule(static) \
+      if (pointSetSize >= parallelDistanceThreshold)
   for (size_t i = 0; i < pointSetSize; ++i)
   {
     distances[i] = metric->Evaluate(dataset.unsafe_col(pointIndex),
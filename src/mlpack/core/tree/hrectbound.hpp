@@ -51,6 +51,27 @@ class HRectBound
   //! Destructor: clean up memory.
   ~HRectBound();
 
+  /**
+   * Move the ranges of this bound into the given memory, which must have room
+   * for at least Dim() ranges and must outlive this bound.  The bound will not
+   * free that memory.  This allows the bounds of many objects (such as the
+   * nodes of a tree) to be stored contiguously; see BinarySpaceTree::Compact().
+   *
+   * @param memory Memory to hold the ranges of this bound.
+   */
+  void UseMemory(math::Range* memory);
+
+  /**
+   * Use the ranges that are already stored in the given memory as this bound,
+   * without copying them.  The memory must hold at least the given number of
+   * ranges and must outlive this bound, which will not free it.  This is used
+   * to load trees from files without copying their bounds; see MappedTree.
+   *
+   * @param memory Memory holding the ranges of the bound.
+   * @param dimension Dimensionality of the bound.
+   */
+  void UseExistingMemory(math::Range* memory, const size_t dimension);
+
   /**
    * Resets all dimensions to the empty set (so that this bound contains
    * nothing).
@@ -162,6 +183,8 @@ class HRectBound
   size_t dim;
   //! The bounds for each dimension.
   math::Range* bounds;
+  //! Whether or not the memory for the bounds is owned by this object.
+  bool ownsMemory;
 };
 
 }; // namespace bound
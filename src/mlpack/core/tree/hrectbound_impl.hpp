@@ -23,7 +23,8 @@ namespace bound {
 template<int Power, bool TakeRoot>
 HRectBound<Power, TakeRoot>::HRectBound() :
     dim(0),
-    bounds(NULL)
+    bounds(NULL),
+    ownsMemory(true)
 { /* Nothing to do. */ }
 
 /**
@@ -33,7 +34,8 @@ HRectBound<Power, TakeRoot>::HRectBound() :
 template<int Power, bool TakeRoot>
 HRectBound<Power, TakeRoot>::HRectBound(const size_t dimension) :
     dim(dimension),
-    bounds(new math::Range[dim])
+    bounds(new math::Range[dim]),
+    ownsMemory(true)
 { /* Nothing to do. */ }
 
 /***
@@ -42,7 +44,8 @@ HRectBound<Power, TakeRoot>::HRectBound(const size_t dimension) :
 template<int Power, bool TakeRoot>
 HRectBound<Power, TakeRoot>::HRectBound(const HRectBound& other) :
     dim(other.Dim()),
-    bounds(new math::Range[dim])
+    bounds(new math::Range[dim]),
+    ownsMemory(true)
 {
   // Copy other bounds over.
   for (size_t i = 0; i < dim; i++)
@@ -59,11 +62,12 @@ HRectBound<Power, TakeRoot>& HRectBound<Power, TakeRoot>::operator=(
   if (dim != other.Dim())
   {
     // Reallocation is necessary.
-    if (bounds)
+    if (bounds && ownsMemory)
       delete[] bounds;
 
     dim = other.Dim();
     bounds = new math::Range[dim];
+    ownsMemory = true;
   }
 
   // Now copy each of the bound values.
@@ -79,10 +83,41 @@ HRectBound<Power, TakeRoot>& HRectBound<Power, TakeRoot>::operator=(
 template<int Power, bool TakeRoot>
 HRectBound<Power, TakeRoot>::~HRectBound()
 {
-  if (bounds)
+  if (bounds && ownsMemory)
     delete[] bounds;
 }
 
+/**
+ * Move the ranges into memory which is owned by someone else.
+ */
+template<int Power, bool TakeRoot>
+void HRectBound<Power, TakeRoot>::UseMemory(math::Range* memory)
+{
+  for (size_t i = 0; i < dim; i++)
+    memory[i] = bounds[i];
+
+  if (bounds && ownsMemory)
+    delete[] bounds;
+
+  bounds = memory;
+  ownsMemory = false;
+}
+
+/**
+ * Use ranges which are already stored in memory owned by someone else.
+ */
+template<int Power, bool TakeRoot>
+void HRectBound<Power, TakeRoot>::UseExistingMemory(math::Range* memory,
+                                                    const size_t dimension)
+{
+  if (bounds && ownsMemory)
+    delete[] bounds;
+
+  dim = dimension;
+  bounds = memory;
+  ownsMemory = false;
+}
+
 /**
  * Resets all dimensions to the empty set.
  */
@@ -325,8 +360,9 @@ HRectBound<Power, TakeRoot>& HRectBound<Power, TakeRoot>::operator|=(
 {
   Log::Assert(data.n_rows == dim);
 
-  arma::vec mins(min(data, 1));
-  arma::vec maxs(max(data, 1));
+  // The data may be of any element type; the bound itself is held in doubles.
+  arma::Col<typename MatType::elem_type> mins(min(data, 1));
+  arma::Col<typename MatType::elem_type> maxs(max(data, 1));
 
   for (size_t i = 0; i < dim; i++)
     bounds[i] |= math::Range(mins[i], maxs[i]);
@@ -0,0 +1,68 @@
+/**
+ * @file rule_traits.hpp
+ * @author Ryan Curtin
+ *
+ * This file implements the basic, unspecialized RuleTraits class, which
+ * provides information about the RuleType classes used by tree traversers.
+ * Each rule type should specialize this class if it has properties other than
+ * the defaults.
+ */
+#ifndef __MLPACK_CORE_TREE_RULE_TRAITS_HPP
+#define __MLPACK_CORE_TREE_RULE_TRAITS_HPP
+
+namespace mlpack {
+namespace tree {
+
+/**
+ * The RuleTraits class provides compile-time information about the rules that
+ * a traverser is instantiated with.  By default it makes the weakest possible
+ * assumptions about the rules, so that traversers behave exactly as a serial
+ * depth-first traversal would.  A rule type can specialize this class to allow
+ * traversers to use extra optimizations.
+ *
+ * A specialization for a hypothetical rule type might look like this:
+ *
+ * @code
+ * template<typename MetricType, typename TreeType>
+ * class RuleTraits<MyRules<MetricType, TreeType> >
+ * {
+ *  public:
+ *   static const bool IsParallelSafe = true;
+ * };
+ * @endcode
+ */
+template<typename RuleType>
+class RuleTraits
+{
+ public:
+  /**
+   * This is true if copies of the rule object may be used at the same time, in
+   * different threads, to traverse disjoint sets of query points (or disjoint
+   * query subtrees) against the same reference tree.  Results from one query
+   * point must never be written to the same location as results from another
+   * query point, and any state shared between the copies must not be modified
+   * during traversal (or it must be protected).
+   */
+  static const bool IsParallelSafe = false;
+
+  /**
+   * This is true if the rules provide a BaseCases() method which computes the
+   * base cases between a set of query points and a contiguous range of
+   * reference points, with the same results as calling BaseCase() for each
+   * pair (though the order of calls may differ).  Traversers which reach
+   * leaves holding contiguous points can then hand the whole leaf-leaf block
+   * to the rules at once.  The signature is:
+   *
+   * @code
+   * void BaseCases(const std::vector<size_t>& queryIndices,
+   *                const size_t referenceBegin,
+   *                const size_t referenceEnd);
+   * @endcode
+   */
+  static const bool HasBlockBaseCase = false;
+};
+
+}; // namespace tree
+}; // namespace mlpack
+
+#endif
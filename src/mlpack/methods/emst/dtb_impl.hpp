@@ -129,6 +129,11 @@ void DualTreeBoruvka<MetricType, TreeType>::ComputeMST(arma::mat& results)
 
   while (edges.size() < (data.n_cols - 1))
   {
+    // Compress every path in the union-find structure, so that calls to Find()
+    // during the (possibly parallel) traversal do not modify it.
+    for (size_t i = 0; i < data.n_cols; ++i)
+      connections.Find(i);
+
     typename TreeType::template DualTreeTraverser<RuleType> traverser(rules);
 
     traverser.Traverse(*tree, *tree);
@@ -8,6 +8,7 @@
 #define __MLPACK_METHODS_EMST_DTB_RULES_HPP
 
 #include <mlpack/core.hpp>
+#include <mlpack/core/tree/rule_traits.hpp>
 
 namespace mlpack {
 namespace emst {
@@ -129,9 +130,36 @@ class DTBRules
    */
   inline double CalculateBound(TreeType& queryNode) const;
 
+  /**
+   * Get the distance to the candidate nearest neighbor of the given component.
+   * Other threads may be updating it, so it is read atomically.
+   */
+  inline double NeighborDistance(const size_t component) const;
+
 }; // class DTBRules
 
 } // emst namespace
+
+namespace tree {
+
+/**
+ * Candidate edges are stored per component, and components can span several
+ * query subtrees; DTBRules::BaseCase() protects those updates with a critical
+ * section, the candidate distances are read and written atomically, and the
+ * component membership is not modified during a traversal,
+ * so copies of DTBRules can traverse disjoint query subtrees in parallel.  The
+ * UnionFind object must be fully path-compressed before the traversal starts
+ * (see DualTreeBoruvka::ComputeMST()), so that Find() does not write.
+ */
+template<typename MetricType, typename TreeType>
+class RuleTraits<emst::DTBRules<MetricType, TreeType> >
+{
+ public:
+  static const bool IsParallelSafe = true;
+  static const bool HasBlockBaseCase = false;
+};
+
+} // tree namespace
 } // mlpack namespace
 
 #include "dtb_rules_impl.hpp"
@@ -48,18 +48,29 @@ double DTBRules<MetricType, TreeType>::BaseCase(const size_t queryIndex,
     double distance = metric.Evaluate(dataSet.col(queryIndex),
                                       dataSet.col(referenceIndex));
 
-    if (distance < neighborsDistances[queryComponentIndex])
+    if (distance < NeighborDistance(queryComponentIndex))
     {
       Log::Assert(queryIndex != referenceIndex);
 
-      neighborsDistances[queryComponentIndex] = distance;
-      neighborsInComponent[queryComponentIndex] = queryIndex;
-      neighborsOutComponent[queryComponentIndex] = referenceIndex;
+      // Other threads may be traversing points in the same component, so the
+      // candidate must be checked again before it is replaced.
+      #pragma omp critical(DTBRulesBaseCase)
+      {
+        if (distance < neighborsDistances[queryComponentIndex])
+        {
+          // Threads outside of the critical section may be reading this.
+          #pragma omp atomic write
+          neighborsDistances[queryComponentIndex] = distance;
+          neighborsInComponent[queryComponentIndex] = queryIndex;
+          neighborsOutComponent[queryComponentIndex] = referenceIndex;
+        }
+      }
     }
   }
 
-  if (newUpperBound < neighborsDistances[queryComponentIndex])
-    newUpperBound = neighborsDistances[queryComponentIndex];
+  const double neighborDistance = NeighborDistance(queryComponentIndex);
+  if (newUpperBound < neighborDistance)
+    newUpperBound = neighborDistance;
 
   Log::Assert(newUpperBound >= 0.0);
 
@@ -84,7 +95,7 @@ double DTBRules<MetricType, TreeType>::Score(const size_t queryIndex,
 
   // If all the points in the reference node are farther than the candidate
   // nearest neighbor for the query's component, we prune.
-  return neighborsDistances[queryComponentIndex] < distance
+  return NeighborDistance(queryComponentIndex) < distance
       ? DBL_MAX : distance;
 }
 
@@ -109,7 +120,7 @@ double DTBRules<MetricType, TreeType>::Score(const size_t queryIndex,
 
   // If all the points in the reference node are farther than the candidate
   // nearest neighbor for the query's component, we prune.
-  return (neighborsDistances[queryComponentIndex] < distance) ? DBL_MAX :
+  return (NeighborDistance(queryComponentIndex) < distance) ? DBL_MAX :
       distance;
 }
 
@@ -120,7 +131,7 @@ double DTBRules<MetricType, TreeType>::Rescore(const size_t queryIndex,
 {
   // We don't need to check component membership again, because it can't
   // change inside a single iteration.
-  return (oldScore > neighborsDistances[connections.Find(queryIndex)])
+  return (oldScore > NeighborDistance(connections.Find(queryIndex)))
       ? DBL_MAX : oldScore;
 }
 
@@ -188,7 +199,7 @@ inline double DTBRules<MetricType, TreeType>::CalculateBound(
   for (size_t i = 0; i < queryNode.NumPoints(); ++i)
   {
     const size_t pointComponent = connections.Find(queryNode.Point(i));
-    const double bound = neighborsDistances[pointComponent];
+    const double bound = NeighborDistance(pointComponent);
 
     if (bound > worstPointBound)
       worstPointBound = bound;
@@ -223,6 +234,16 @@ inline double DTBRules<MetricType, TreeType>::CalculateBound(
   return queryNode.Stat().Bound();
 }
 
+template<typename MetricType, typename TreeType>
+inline double DTBRules<MetricType, TreeType>::NeighborDistance(
+    const size_t component) const
+{
+  double distance;
+  #pragma omp atomic read
+  distance = neighborsDistances[component];
+  return distance;
+}
+
 }; // namespace emst
 }; // namespace mlpack
 
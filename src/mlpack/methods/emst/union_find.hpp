@@ -57,9 +57,13 @@ class UnionFind
     }
     else
     {
-      // This ensures that the tree has a small depth
-      parent[x] = Find(parent[x]);
-      return parent[x];
+      // This ensures that the tree has a small depth.  We only write when the
+      // parent actually changes, so that Find() on a fully compressed
+      // structure is read-only (and can be called from several threads).
+      const size_t root = Find(parent[x]);
+      if (parent[x] != root)
+        parent[x] = root;
+      return root;
     }
   }
 
@@ -0,0 +1,156 @@
+/**
+ * @file block_kernel.hpp
+ * @author Ryan Curtin
+ *
+ * Evaluation of a kernel between every pair of points from two blocks of
+ * points.  For kernels which only depend on the dot product of their arguments
+ * (LinearKernel, PolynomialKernel, and CosineDistance), all the dot products
+ * between the two blocks are computed with one matrix product.
+ */
+#ifndef __MLPACK_METHODS_FASTMKS_BLOCK_KERNEL_HPP
+#define __MLPACK_METHODS_FASTMKS_BLOCK_KERNEL_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/kernels/linear_kernel.hpp>
+#include <mlpack/core/kernels/polynomial_kernel.hpp>
+#include <mlpack/core/kernels/cosine_distance.hpp>
+
+namespace mlpack {
+namespace fastmks {
+
+/**
+ * Evaluate a kernel between blocks of points.  This general version calls
+ * KernelType::Evaluate() for each pair of points; it is specialized for
+ * kernels which can be evaluated with a matrix product.
+ *
+ * @tparam KernelType Type of kernel to evaluate.
+ */
+template<typename KernelType>
+class BlockKernel
+{
+ public:
+  /**
+   * Evaluate the kernel between each column of a and each column of b, so that
+   * result(i, j) = K(a_i, b_j).
+   *
+   * @param kernel Kernel to evaluate.
+   * @param a First block of points.
+   * @param b Second block of points.
+   * @param result Matrix to store the kernel values in.
+   */
+  static void Evaluate(KernelType& kernel,
+                       const arma::mat& a,
+                       const arma::mat& b,
+                       arma::mat& result)
+  {
+    result.set_size(a.n_cols, b.n_cols);
+    for (size_t j = 0; j < b.n_cols; ++j)
+      for (size_t i = 0; i < a.n_cols; ++i)
+        result(i, j) = kernel.Evaluate(a.unsafe_col(i), b.unsafe_col(j));
+  }
+
+  /**
+   * Compute the square root of the self-kernel, sqrt(K(x, x)), of each point
+   * in the given dataset.
+   *
+   * @param kernel Kernel to evaluate.
+   * @param data Dataset to compute the self-kernels of.
+   * @param selfKernels Vector to store the self-kernels in.
+   */
+  static void SelfKernels(KernelType& kernel,
+                          const arma::mat& data,
+                          arma::vec& selfKernels)
+  {
+    selfKernels.set_size(data.n_cols);
+    for (size_t i = 0; i < data.n_cols; ++i)
+      selfKernels[i] = sqrt(kernel.Evaluate(data.unsafe_col(i),
+                                            data.unsafe_col(i)));
+  }
+};
+
+//! The linear kernel is the dot product.
+template<>
+class BlockKernel<kernel::LinearKernel>
+{
+ public:
+  static void Evaluate(kernel::LinearKernel& /* kernel */,
+                       const arma::mat& a,
+                       const arma::mat& b,
+                       arma::mat& result)
+  {
+    result = trans(a) * b;
+  }
+
+  static void SelfKernels(kernel::LinearKernel& /* kernel */,
+                          const arma::mat& data,
+                          arma::vec& selfKernels)
+  {
+    selfKernels = trans(sqrt(sum(data % data, 0)));
+  }
+};
+
+//! The polynomial kernel is a power of the offset dot product.
+template<>
+class BlockKernel<kernel::PolynomialKernel>
+{
+ public:
+  static void Evaluate(kernel::PolynomialKernel& kernel,
+                       const arma::mat& a,
+                       const arma::mat& b,
+                       arma::mat& result)
+  {
+    result = trans(a) * b;
+    result += kernel.Offset();
+    result = pow(result, kernel.Degree());
+  }
+
+  static void SelfKernels(kernel::PolynomialKernel& kernel,
+                          const arma::mat& data,
+                          arma::vec& selfKernels)
+  {
+    selfKernels = trans(sum(data % data, 0));
+    selfKernels += kernel.Offset();
+    selfKernels = sqrt(pow(selfKernels, kernel.Degree()));
+  }
+};
+
+//! The cosine distance is the dot product divided by the norms.
+template<>
+class BlockKernel<kernel::CosineDistance>
+{
+ public:
+  static void Evaluate(kernel::CosineDistance& /* kernel */,
+                       const arma::mat& a,
+                       const arma::mat& b,
+                       arma::mat& result)
+  {
+    result = trans(a) * b;
+
+    const arma::rowvec aNorms = sqrt(sum(a % a, 0));
+    const arma::rowvec bNorms = sqrt(sum(b % b, 0));
+    for (size_t j = 0; j < b.n_cols; ++j)
+    {
+      for (size_t i = 0; i < a.n_cols; ++i)
+      {
+        // Just like CosineDistance::Evaluate(), the kernel is 0 if either
+        // point is 0.
+        const double denominator = aNorms[i] * bNorms[j];
+        result(i, j) = (denominator == 0.0) ? 0.0 : result(i, j) / denominator;
+      }
+    }
+  }
+
+  static void SelfKernels(kernel::CosineDistance& /* kernel */,
+                          const arma::mat& data,
+                          arma::vec& selfKernels)
+  {
+    selfKernels.set_size(data.n_cols);
+    for (size_t i = 0; i < data.n_cols; ++i)
+      selfKernels[i] = (norm(data.unsafe_col(i), 2) == 0.0) ? 0.0 : 1.0;
+  }
+};
+
+}; // namespace fastmks
+}; // namespace mlpack
+
+#endif
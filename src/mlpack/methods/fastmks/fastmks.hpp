@@ -11,6 +11,7 @@
 #include <mlpack/core.hpp>
 #include <mlpack/core/metrics/ip_metric.hpp>
 #include "fastmks_stat.hpp"
+#include "block_kernel.hpp"
 #include <mlpack/core/tree/cover_tree.hpp>
 
 namespace mlpack {
@@ -166,6 +167,10 @@ class FastMKS
    * product to point 4 in the query set will be stored in row 0 and column 4 of
    * the indices matrix.
    *
+   * If OpenMP is available, single-tree and naive search split the query
+   * points between threads.  Only one search may be run at a time on a FastMKS
+   * object.
+   *
    * @param k The number of maximum kernels to find.
    * @param indices Matrix to store resulting indices of max-kernel search in.
    * @param products Matrix to store resulting max-kernel values in.
@@ -174,10 +179,34 @@ class FastMKS
               arma::Mat<size_t>& indices,
               arma::mat& products);
 
+  /**
+   * Search for the maximum inner products of the points in the given query
+   * set, in the same way as the other overload of Search().  The query set
+   * given to the constructor (if any) is ignored, and the reference tree is
+   * reused, so one FastMKS object can answer many batches of queries.  For
+   * dual-tree search, a tree is built on the given query set.
+   *
+   * @param querySet Set of query points.
+   * @param k The number of maximum kernels to find.
+   * @param indices Matrix to store resulting indices of max-kernel search in.
+   * @param products Matrix to store resulting max-kernel values in.
+   */
+  void Search(const arma::mat& querySet,
+              const size_t k,
+              arma::Mat<size_t>& indices,
+              arma::mat& products);
+
   //! Get the inner-product metric induced by the given kernel.
   const metric::IPMetric<KernelType>& Metric() const { return metric; }
-  //! Modify the inner-product metric induced by the given kernel.
-  metric::IPMetric<KernelType>& Metric() { return metric; }
+  //! Modify the inner-product metric induced by the given kernel.  The cached
+  //! self-kernels are recomputed at the next search, in case the kernel
+  //! changes.
+  metric::IPMetric<KernelType>& Metric()
+  {
+    queryKernels.reset();
+    referenceKernels.reset();
+    return metric;
+  }
 
  private:
   //! The reference dataset.
@@ -202,6 +231,24 @@ class FastMKS
   //! The instantiated inner-product metric induced by the given kernel.
   metric::IPMetric<KernelType> metric;
 
+  //! Cached query set self-kernels (sqrt(K(q, q)) for each q); empty until
+  //! the first tree search, and unused if the query set is the reference set.
+  arma::vec queryKernels;
+  //! Cached reference set self-kernels (sqrt(K(r, r)) for each r); empty
+  //! until the first tree search.
+  arma::vec referenceKernels;
+
+  //! Search for the maximum inner products of the given query set, using the
+  //! given query tree (only needed for dual-tree search).
+  void Search(const arma::mat& querySet,
+              TreeType* queryTree,
+              const size_t k,
+              arma::Mat<size_t>& indices,
+              arma::mat& products);
+
+  //! Reset the statistics of the given node and its descendants.
+  static void ResetStatistics(TreeType& node);
+
   //! Utility function.  Copied too many times from too many places.
   void InsertNeighbor(arma::Mat<size_t>& indices,
                       arma::mat& products,
@@ -138,8 +138,9 @@ FastMKS<KernelType, TreeType>::FastMKS(const arma::mat& referenceSet,
     naive(naive),
     metric(referenceTree->Metric())
 {
-  // The query tree cannot be the same as the reference tree.
-  if (referenceTree)
+  // The query tree cannot be the same as the reference tree.  It is only
+  // needed for dual-tree search.
+  if (referenceTree && !single && !naive)
     queryTree = new TreeType(*referenceTree);
 }
 
@@ -186,6 +187,37 @@ template<typename KernelType, typename TreeType>
 void FastMKS<KernelType, TreeType>::Search(const size_t k,
                                            arma::Mat<size_t>& indices,
                                            arma::mat& products)
+{
+  Search(querySet, queryTree, k, indices, products);
+}
+
+template<typename KernelType, typename TreeType>
+void FastMKS<KernelType, TreeType>::Search(const arma::mat& querySet,
+                                           const size_t k,
+                                           arma::Mat<size_t>& indices,
+                                           arma::mat& products)
+{
+  // Dual-tree search needs a tree on the new query points; the reference tree
+  // is reused.
+  TreeType* batchQueryTree = NULL;
+  if (!naive && !single)
+  {
+    Timer::Start("tree_building");
+    batchQueryTree = new TreeType(querySet, metric);
+    Timer::Stop("tree_building");
+  }
+
+  Search(querySet, batchQueryTree, k, indices, products);
+
+  delete batchQueryTree;
+}
+
+template<typename KernelType, typename TreeType>
+void FastMKS<KernelType, TreeType>::Search(const arma::mat& querySet,
+                                           TreeType* queryTree,
+                                           const size_t k,
+                                           arma::Mat<size_t>& indices,
+                                           arma::mat& products)
 {
   // No remapping will be necessary because we are using the cover tree.
   indices.set_size(k, querySet.n_cols);
@@ -197,25 +229,53 @@ void FastMKS<KernelType, TreeType>::Search(const size_t k,
   // Naive implementation.
   if (naive)
   {
-    // Simple double loop.  Stupid, slow, but a good benchmark.
-    for (size_t q = 0; q < querySet.n_cols; ++q)
+    // Evaluate the kernel between blocks of query points and blocks of
+    // reference points; for kernels depending only on the dot product, each
+    // block of kernel values is one matrix product.  Within each block, the
+    // results are inserted just like in the simple double loop.  Each query
+    // block is handled by one thread.
+    const size_t blockSize = 256;
+    const size_t numQueryBlocks = (querySet.n_cols + blockSize - 1) /
+        blockSize;
+
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t block = 0; block < numQueryBlocks; ++block)
     {
-      for (size_t r = 0; r < referenceSet.n_cols; ++r)
+      const size_t qBegin = block * blockSize;
+      const size_t qEnd = std::min(qBegin + blockSize,
+          (size_t) querySet.n_cols);
+      const arma::mat queryBlock = querySet.cols(qBegin, qEnd - 1);
+
+      arma::mat referenceBlock;
+      arma::mat blockKernels;
+      for (size_t rBegin = 0; rBegin < referenceSet.n_cols; rBegin += blockSize)
       {
-        if ((&querySet == &referenceSet) && (q == r))
-          continue;
+        const size_t rEnd = std::min(rBegin + blockSize,
+            (size_t) referenceSet.n_cols);
+        referenceBlock = referenceSet.cols(rBegin, rEnd - 1);
 
-        const double eval = metric.Kernel().Evaluate(querySet.unsafe_col(q),
-            referenceSet.unsafe_col(r));
+        BlockKernel<KernelType>::Evaluate(metric.Kernel(), queryBlock,
+            referenceBlock, blockKernels);
 
-        size_t insertPosition;
-        for (insertPosition = 0; insertPosition < indices.n_rows;
-            ++insertPosition)
-          if (eval > products(insertPosition, q))
-            break;
+        for (size_t q = qBegin; q < qEnd; ++q)
+        {
+          for (size_t r = rBegin; r < rEnd; ++r)
+          {
+            if ((&querySet == &referenceSet) && (q == r))
+              continue;
 
-        if (insertPosition < indices.n_rows)
-          InsertNeighbor(indices, products, q, insertPosition, r, eval);
+            const double eval = blockKernels(q - qBegin, r - rBegin);
+
+            size_t insertPosition;
+            for (insertPosition = 0; insertPosition < indices.n_rows;
+                ++insertPosition)
+              if (eval > products(insertPosition, q))
+                break;
+
+            if (insertPosition < indices.n_rows)
+              InsertNeighbor(indices, products, q, insertPosition, r, eval);
+          }
+        }
       }
     }
 
@@ -224,26 +284,66 @@ void FastMKS<KernelType, TreeType>::Search(const size_t k,
     return;
   }
 
+  // The self-kernels of the reference set and of the query set given at
+  // construction are only computed once, and only for tree search.  Those of
+  // other query sets are computed for each search.
+  if (referenceKernels.n_elem != referenceSet.n_cols)
+    BlockKernel<KernelType>::SelfKernels(metric.Kernel(), referenceSet,
+        referenceKernels);
+
+  arma::vec batchQueryKernels;
+  const arma::vec* searchQueryKernels = &batchQueryKernels;
+  if (&querySet == &referenceSet)
+  {
+    searchQueryKernels = &referenceKernels;
+  }
+  else if (&querySet == &this->querySet)
+  {
+    if (queryKernels.n_elem != querySet.n_cols)
+      BlockKernel<KernelType>::SelfKernels(metric.Kernel(), querySet,
+          queryKernels);
+    searchQueryKernels = &queryKernels;
+  }
+  else
+  {
+    BlockKernel<KernelType>::SelfKernels(metric.Kernel(), querySet,
+        batchQueryKernels);
+  }
+
   // Single-tree implementation.
   if (single)
   {
-    // Create rules object (this will store the results).  This constructor
-    // precalculates each self-kernel value.
+    // Create rules object (this will store the results).
     typedef FastMKSRules<KernelType, TreeType> RuleType;
-    RuleType rules(referenceSet, querySet, indices, products, metric.Kernel());
+    RuleType rules(referenceSet, querySet, indices, products, metric.Kernel(),
+        *searchQueryKernels, referenceKernels);
 
-    typename TreeType::template SingleTreeTraverser<RuleType> traverser(rules);
+    size_t numPrunes = 0;
+    size_t baseCases = 0;
+    size_t scores = 0;
 
-    for (size_t i = 0; i < querySet.n_cols; ++i)
-      traverser.Traverse(i, *referenceTree);
+    // Each thread gets its own copy of the rules (and its own traverser), and
+    // only writes the results of the query points it searches for.
+    #pragma omp parallel if (tree::RuleTraits<RuleType>::IsParallelSafe) \
+        reduction(+:numPrunes, baseCases, scores)
+    {
+      RuleType threadRules(rules);
+      typename TreeType::template SingleTreeTraverser<RuleType>
+          traverser(threadRules);
+
+      #pragma omp for schedule(dynamic, 16)
+      for (size_t i = 0; i < querySet.n_cols; ++i)
+        traverser.Traverse(i, *referenceTree);
 
-    // Save the number of pruned nodes.
-    const size_t numPrunes = traverser.NumPrunes();
+      numPrunes += traverser.NumPrunes();
+      baseCases += threadRules.BaseCases();
+      scores += threadRules.Scores();
+    }
 
     Log::Info << "Pruned " << numPrunes << " nodes." << std::endl;
 
-    Log::Info << rules.BaseCases() << " base cases." << std::endl;
-    Log::Info << rules.Scores() << " scores." << std::endl;
+    Log::Info << baseCases << " base cases." << std::endl;
+    Log::Info << scores << " scores." << std::endl;
 
     Timer::Stop("computing_products");
     return;
@@ -251,7 +351,13 @@ void FastMKS<KernelType, TreeType>::Search(const size_t k,
 
   // Dual-tree implementation.
   typedef FastMKSRules<KernelType, TreeType> RuleType;
-  RuleType rules(referenceSet, querySet, indices, products, metric.Kernel());
+  RuleType rules(referenceSet, querySet, indices, products, metric.Kernel(),
+      *searchQueryKernels, referenceKernels);
+
+  // The tree statistics refer to the nodes of the last search, which may have
+  // used another query tree.
+  ResetStatistics(*queryTree);
+  ResetStatistics(*referenceTree);
 
   typename TreeType::template DualTreeTraverser<RuleType> traverser(rules);
 
@@ -267,6 +373,18 @@ void FastMKS<KernelType, TreeType>::Search(const size_t k,
   return;
 }
 
+// Reset the statistics of each node to their initial values.
+template<typename KernelType, typename TreeType>
+void FastMKS<KernelType, TreeType>::ResetStatistics(TreeType& node)
+{
+  node.Stat().Bound() = -DBL_MAX;
+  node.Stat().LastKernel() = 0.0;
+  node.Stat().LastKernelNode() = NULL;
+
+  for (size_t i = 0; i < node.NumChildren(); ++i)
+    ResetStatistics(node.Child(i));
+}
+
 /**
  * Helper function to insert a point into the neighbors and distances matrices.
  *
@@ -15,6 +15,10 @@
 
 #include "fastmks.hpp"
 
+#ifdef HAS_OPENMP
+  #include <omp.h>
+#endif
+
 using namespace std;
 using namespace mlpack;
 using namespace mlpack::fastmks;
@@ -44,7 +48,11 @@ PROGRAM_INFO("FastMKS (Fast Max-Kernel Search)",
     "to the kernel evaluation between those two points."
     "\n\n"
     "This executable performs FastMKS using a cover tree.  The base used to "
-    "build the cover tree can be specified with the --base option.");
+    "build the cover tree can be specified with the --base option."
+    "\n\n"
+    "If OpenMP is available, single-tree and naive search split the query "
+    "points between threads; the number of threads can be set with --threads "
+    "(-t).");
 
 // Define our input parameters.
 PARAM_STRING_REQ("reference_file", "File containing the reference dataset.",
@@ -67,6 +75,9 @@ PARAM_FLAG("single", "If true, single-tree search is used (as opposed to "
 // Cover tree parameter.
 PARAM_DOUBLE("base", "Base to use during cover tree construction.", "b", 2.0);
 
+PARAM_INT("threads", "Number of threads to use (0 uses the OpenMP default).",
+    "t", 0);
+
 // Kernel parameters.
 PARAM_DOUBLE("degree", "Degree of polynomial kernel.", "d", 2.0);
 PARAM_DOUBLE("offset", "Offset of kernel (for polynomial and hyptan kernels).",
@@ -116,11 +127,21 @@ void RunFastMKS(const arma::mat& referenceData,
       TreeType;
   IPMetric<KernelType> metric(kernel);
   TreeType referenceTree(referenceData, metric, base);
+
+  // Single-tree and naive search do not need a query tree.
+  if (single || naive)
+  {
+    FastMKS<KernelType> fastmks(referenceData, &referenceTree,
+        (single && !naive), naive);
+    fastmks.Search(queryData, k, indices, products);
+    return;
+  }
+
   TreeType queryTree(queryData, metric, base);
 
   // Create FastMKS object.
   FastMKS<KernelType> fastmks(referenceData, &referenceTree, queryData,
-      &queryTree, (single && !naive), naive);
+      &queryTree, false, false);
 
   // Now search with it.
   fastmks.Search(k, indices, products);
@@ -193,6 +214,21 @@ int main(int argc, char** argv)
         << "specified)." << endl;
   }
 
+  const int threads = CLI::GetParam<int>("threads");
+  if (threads < 0)
+  {
+    Log::Fatal << "Invalid number of threads (" << threads << ")! Must be "
+        << "greater than or equal to 0." << endl;
+  }
+
+#ifdef HAS_OPENMP
+  if (threads > 0)
+    omp_set_num_threads(threads);
+#else
+  if (threads > 1)
+    Log::Warn << "OpenMP is not available; --threads is ignored." << endl;
+#endif
+
   // Naive mode overrides single mode.
   if (naive && single)
   {
@@ -9,22 +9,43 @@
 
 #include <mlpack/core.hpp>
 #include <mlpack/core/tree/cover_tree/cover_tree.hpp>
+#include <mlpack/core/tree/rule_traits.hpp>
 
 namespace mlpack {
 namespace fastmks {
 
 /**
  * The base case and pruning rules for FastMKS (fast max-kernel search).
+ *
+ * In single-tree search with trees whose first point is the centroid (such as
+ * cover trees), the kernel evaluation of each reference node is stored in the
+ * rules instead of the tree statistics, so copies of the rules can search for
+ * different query points in parallel.
  */
 template<typename KernelType, typename TreeType>
 class FastMKSRules
 {
  public:
+  /**
+   * Construct the rules for the given datasets.  The self-kernels of the
+   * points, sqrt(K(x, x)), are given so that they are not recomputed for each
+   * search; they can be computed with BlockKernel::SelfKernels().
+   *
+   * @param referenceSet Set of reference points.
+   * @param querySet Set of query points.
+   * @param indices Matrix to store the indices of the maximum kernels in.
+   * @param products Matrix to store the maximum kernels in.
+   * @param kernel Kernel to evaluate.
+   * @param queryKernels Self-kernels of the query points.
+   * @param referenceKernels Self-kernels of the reference points.
+   */
   FastMKSRules(const arma::mat& referenceSet,
                const arma::mat& querySet,
                arma::Mat<size_t>& indices,
                arma::mat& products,
-               KernelType& kernel);
+               KernelType& kernel,
+               const arma::vec& queryKernels,
+               const arma::vec& referenceKernels);
 
   //! Compute the base case (kernel value) between two points.
   double BaseCase(const size_t queryIndex, const size_t referenceIndex);
@@ -101,9 +122,9 @@ class FastMKSRules
   arma::mat& products;
 
   //! Cached query set self-kernels (|| q || for each q).
-  arma::vec queryKernels;
+  const arma::vec& queryKernels;
   //! Cached reference set self-kernels (|| r || for each r).
-  arma::vec referenceKernels;
+  const arma::vec& referenceKernels;
 
   //! The instantiated kernel.
   KernelType& kernel;
@@ -115,6 +136,15 @@ class FastMKSRules
   //! The last kernel evaluation resulting from BaseCase().
   double lastKernel;
 
+  //! The kernel evaluations between the current query point and the reference
+  //! points scored for it, in single-tree search (only used if the first point
+  //! of each node is its centroid).
+  arma::vec pointKernels;
+
+  //! Get the kernel evaluation between the current query point and the parent
+  //! of the given reference node, in single-tree search.
+  double ParentKernel(const TreeType& referenceNode) const;
+
   //! Calculate the bound for a given query node.
   double CalculateBound(TreeType& queryNode) const;
 
@@ -131,6 +161,26 @@ class FastMKSRules
 };
 
 }; // namespace fastmks
+
+namespace tree {
+
+/**
+ * Each query point only writes to its own column of the results, so copies of
+ * FastMKSRules can search for different query points in parallel, as long as
+ * single-tree search does not store kernel evaluations in the reference tree
+ * statistics (which it does unless the first point of each node is its
+ * centroid).
+ */
+template<typename KernelType, typename TreeType>
+class RuleTraits<fastmks::FastMKSRules<KernelType, TreeType> >
+{
+ public:
+  static const bool IsParallelSafe =
+      TreeTraits<TreeType>::FirstPointIsCentroid;
+  static const bool HasBlockBaseCase = false;
+};
+
+}; // namespace tree
 }; // namespace mlpack
 
 // Include implementation.
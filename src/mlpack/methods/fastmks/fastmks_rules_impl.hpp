@@ -14,15 +14,20 @@ namespace mlpack {
 namespace fastmks {
 
 template<typename KernelType, typename TreeType>
-FastMKSRules<KernelType, TreeType>::FastMKSRules(const arma::mat& referenceSet,
-                                                 const arma::mat& querySet,
-                                                 arma::Mat<size_t>& indices,
-                                                 arma::mat& products,
-                                                 KernelType& kernel) :
+FastMKSRules<KernelType, TreeType>::FastMKSRules(
+    const arma::mat& referenceSet,
+    const arma::mat& querySet,
+    arma::Mat<size_t>& indices,
+    arma::mat& products,
+    KernelType& kernel,
+    const arma::vec& queryKernels,
+    const arma::vec& referenceKernels) :
     referenceSet(referenceSet),
     querySet(querySet),
     indices(indices),
     products(products),
+    queryKernels(queryKernels),
+    referenceKernels(referenceKernels),
     kernel(kernel),
     lastQueryIndex(-1),
     lastReferenceIndex(-1),
@@ -30,16 +35,10 @@ FastMKSRules<KernelType, TreeType>::FastMKSRules(const arma::mat& referenceSet,
     baseCases(0),
     scores(0)
 {
-  // Precompute each self-kernel.
-  queryKernels.set_size(querySet.n_cols);
-  for (size_t i = 0; i < querySet.n_cols; ++i)
-    queryKernels[i] = sqrt(kernel.Evaluate(querySet.unsafe_col(i),
-                                           querySet.unsafe_col(i)));
-
-  referenceKernels.set_size(referenceSet.n_cols);
-  for (size_t i = 0; i < referenceSet.n_cols; ++i)
-    referenceKernels[i] = sqrt(kernel.Evaluate(referenceSet.unsafe_col(i),
-                                               referenceSet.unsafe_col(i)));
+  // In single-tree search with trees whose first point is the centroid, the
+  // kernel evaluation of each reference node is stored by point.
+  if (tree::TreeTraits<TreeType>::FirstPointIsCentroid)
+    pointKernels.set_size(referenceSet.n_cols);
 }
 
 template<typename KernelType, typename TreeType>
@@ -105,7 +104,7 @@ double FastMKSRules<KernelType, TreeType>::Score(const size_t queryIndex,
     double maxKernelBound;
     const double parentDist = referenceNode.ParentDistance();
     const double combinedDistBound = parentDist + furthestDist;
-    const double lastKernel = referenceNode.Parent()->Stat().LastKernel();
+    const double lastKernel = ParentKernel(referenceNode);
     if (kernel::KernelTraits<KernelType>::IsNormalized)
     {
       const double squaredDist = std::pow(combinedDistBound, 2.0);
@@ -142,12 +141,15 @@ double FastMKSRules<KernelType, TreeType>::Score(const size_t queryIndex,
         referenceNode.Parent() != NULL &&
         referenceNode.Point(0) == referenceNode.Parent()->Point(0))
     {
-      kernelEval = referenceNode.Parent()->Stat().LastKernel();
+      kernelEval = ParentKernel(referenceNode);
     }
     else
     {
       kernelEval = BaseCase(queryIndex, referenceNode.Point(0));
     }
+
+    // Store the evaluation in the rules, not in the (shared) reference tree.
+    pointKernels[referenceNode.Point(0)] = kernelEval;
   }
   else
   {
@@ -156,9 +158,9 @@ double FastMKSRules<KernelType, TreeType>::Score(const size_t queryIndex,
     referenceNode.Centroid(refCentroid);
 
     kernelEval = kernel.Evaluate(queryPoint, refCentroid);
-  }
 
-  referenceNode.Stat().LastKernel() = kernelEval;
+    referenceNode.Stat().LastKernel() = kernelEval;
+  }
 
   double maxKernel;
   if (kernel::KernelTraits<KernelType>::IsNormalized)
@@ -404,6 +406,19 @@ double FastMKSRules<KernelType, TreeType>::Score(TreeType& queryNode,
   return (maxKernel > bestKernel) ? (1.0 / maxKernel) : DBL_MAX;
 }
 
+template<typename KernelType, typename TreeType>
+inline double FastMKSRules<KernelType, TreeType>::ParentKernel(
+    const TreeType& referenceNode) const
+{
+  // The parent is always scored with the query point before the child.  Any
+  // other node with the same point was evaluated with the same query point, so
+  // the stored value is correct.
+  if (tree::TreeTraits<TreeType>::FirstPointIsCentroid)
+    return pointKernels[referenceNode.Parent()->Point(0)];
+  else
+    return referenceNode.Parent()->Stat().LastKernel();
+}
+
 template<typename KernelType, typename TreeType>
 double FastMKSRules<KernelType, TreeType>::Rescore(const size_t queryIndex,
                                                    TreeType& /*referenceNode*/,
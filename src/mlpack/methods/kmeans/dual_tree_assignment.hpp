@@ -0,0 +1,171 @@
+/**
+ * @file dual_tree_assignment.hpp
+ * @author Ryan Curtin
+ *
+ * An AssignmentPolicy for K-Means which uses a kd-tree on the points and a
+ * kd-tree on the centroids to assign whole nodes of points at once.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_DUAL_TREE_ASSIGNMENT_HPP
+#define __MLPACK_METHODS_KMEANS_DUAL_TREE_ASSIGNMENT_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/metrics/lmetric.hpp>
+#include <mlpack/core/tree/binary_space_tree.hpp>
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * An assignment step which builds a kd-tree on the points, once, and a kd-tree
+ * on the centroids, in each call.  The point tree is traversed from the root,
+ * and each node of it keeps a list of the nodes of the centroid tree which may
+ * hold the closest centroid of some point in the node.  A centroid node is
+ * dropped from the list (blacklisted) when its minimum distance to the point
+ * node is more than the maximum distance from the point node to some other
+ * centroid node; a single centroid is also dropped when another centroid is
+ * closer to every point of the node, which is the test of Pelleg and Moore:
+ *
+ * @inproceedings{pelleg1999accelerating,
+ *   title={Accelerating exact k-means algorithms with geometric reasoning},
+ *   author={Pelleg, Dan and Moore, Andrew},
+ *   booktitle={Proceedings of the Fifth ACM SIGKDD International Conference on
+ *       Knowledge Discovery and Data Mining (KDD '99)},
+ *   pages={277--281},
+ *   year={1999}
+ * }
+ *
+ * When only one centroid is left, every point in the node is assigned to it
+ * without computing any distances.  Centroid nodes which are larger than the
+ * point node are split before they are tested, so whole groups of far-away
+ * centroids are dropped at once.  The lists of each level of the point tree are
+ * kept in storage which is allocated with the tree and reused in every call.
+ *
+ * The assignments are the same as those given by NaiveAssignment.  The pruning
+ * uses squared Euclidean distances, so it is only done when the metric is the
+ * Euclidean or squared Euclidean distance; with any other metric, the points
+ * are assigned by NaiveAssignment.  The data must be a dense matrix.  This
+ * works best for low-dimensional data.  A copy of the data is held with the
+ * tree.
+ */
+class DualTreeAssignment
+{
+ public:
+  /**
+   * Create the assignment policy, optionally specifying the leaf size of the
+   * tree on the points.
+   *
+   * @param leafSize Maximum number of points in each leaf of the point tree.
+   */
+  DualTreeAssignment(const size_t leafSize = 20);
+
+  /**
+   * Copy the parameters of the given policy.  The tree and the storage are not
+   * copied; they are built on the first call to Assign().
+   */
+  DualTreeAssignment(const DualTreeAssignment& other);
+
+  //! Copy the parameters of the given policy, dropping the tree.
+  DualTreeAssignment& operator=(const DualTreeAssignment& other);
+
+  //! Free the tree.
+  ~DualTreeAssignment();
+
+  /**
+   * Assign each point to its closest centroid, updating the counts of points
+   * in each cluster.  The pruning of the tree is only valid for the Euclidean
+   * distance, so with any other metric this just calls
+   * NaiveAssignment::Assign().
+   *
+   * @tparam MetricType Type of distance metric.
+   * @tparam MatType Type of data (arma::mat or arma::sp_mat).
+   * @param data Dataset being clustered.
+   * @param centroids Centroids of each cluster (one per column).
+   * @param metric Instantiated distance metric.
+   * @param assignments Cluster assignments of each point; these are modified.
+   * @param counts Number of points in each cluster; these are modified.
+   * @return Number of points whose assignment changed.
+   */
+  template<typename MetricType, typename MatType>
+  size_t Assign(const MatType& data,
+                const MatType& centroids,
+                const MetricType& metric,
+                arma::Col<size_t>& assignments,
+                arma::Col<size_t>& counts);
+
+  /**
+   * Assign each point to its closest centroid with the dual-tree algorithm,
+   * updating the counts of points in each cluster.  This overload is used for
+   * the Euclidean and squared Euclidean distances.  The tree on the points is
+   * built on the first call (and whenever the number of points changes).
+   *
+   * @tparam TakeRoot Whether the metric takes the square root of distances.
+   * @tparam MatType Type of data (arma::mat).
+   * @param data Dataset being clustered.
+   * @param centroids Centroids of each cluster (one per column).
+   * @param metric Instantiated distance metric.
+   * @param assignments Cluster assignments of each point; these are modified.
+   * @param counts Number of points in each cluster; these are modified.
+   * @return Number of points whose assignment changed.
+   */
+  template<bool TakeRoot, typename MatType>
+  size_t Assign(const MatType& data,
+                const MatType& centroids,
+                const metric::LMetric<2, TakeRoot>& metric,
+                arma::Col<size_t>& assignments,
+                arma::Col<size_t>& counts);
+
+  //! Get the leaf size of the point tree.
+  size_t LeafSize() const { return leafSize; }
+  //! Modify the leaf size of the point tree (takes effect on the next tree).
+  size_t& LeafSize() { return leafSize; }
+
+ private:
+  //! The type of tree used for the points and the centroids.  The bounds give
+  //! squared distances.
+  typedef tree::BinarySpaceTree<bound::HRectBound<2, false>,
+      tree::EmptyStatistic> TreeType;
+
+  //! Maximum number of points in each leaf of the point tree.
+  size_t leafSize;
+  //! The copy of the data that the point tree is built on (reordered).
+  arma::mat treeData;
+  //! Mapping from the point indices of the tree to those of the data.
+  std::vector<size_t> oldFromNew;
+  //! The tree on the points, or NULL if it hasn't been built yet.
+  TreeType* tree;
+  //! The depth of the point tree.
+  size_t treeDepth;
+
+  //! Mapping from the centroid indices of the centroid tree to the centroids.
+  std::vector<size_t> centroidIndices;
+  //! The candidate lists of each level of the point tree; each level has room
+  //! for one node of the centroid tree per centroid.
+  std::vector<const TreeType*> candidates;
+  //! Stack of centroid nodes waiting to be tested.
+  std::vector<const TreeType*> work;
+  //! The candidate centroids of a leaf of the point tree.
+  std::vector<size_t> leafCandidates;
+
+  /**
+   * Assign the points in the given node of the point tree, given the candidate
+   * list of its parent (stored at the given level of the candidate lists).
+   *
+   * @return Number of points whose assignment changed.
+   */
+  template<typename MetricType, typename MatType>
+  size_t AssignNode(const TreeType& node,
+                    const size_t level,
+                    const size_t parentCandidates,
+                    const MatType& data,
+                    const MatType& centroids,
+                    const MetricType& metric,
+                    arma::Col<size_t>& assignments);
+};
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+// Include implementation.
+#include "dual_tree_assignment_impl.hpp"
+
+#endif
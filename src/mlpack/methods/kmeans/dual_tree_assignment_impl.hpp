@@ -0,0 +1,304 @@
+/**
+ * @file dual_tree_assignment_impl.hpp
+ * @author Ryan Curtin
+ *
+ * Implementation of the DualTreeAssignment class.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_DUAL_TREE_ASSIGNMENT_IMPL_HPP
+#define __MLPACK_METHODS_KMEANS_DUAL_TREE_ASSIGNMENT_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "dual_tree_assignment.hpp"
+#include "naive_assignment.hpp"
+#include "recount_clusters.hpp"
+
+#include <algorithm>
+
+namespace mlpack {
+namespace kmeans {
+
+inline DualTreeAssignment::DualTreeAssignment(const size_t leafSize) :
+    leafSize(leafSize),
+    tree(NULL),
+    treeDepth(0)
+{
+  // Nothing to do.
+}
+
+inline DualTreeAssignment::DualTreeAssignment(
+    const DualTreeAssignment& other) :
+    leafSize(other.leafSize),
+    tree(NULL),
+    treeDepth(0)
+{
+  // Nothing to do.
+}
+
+inline DualTreeAssignment& DualTreeAssignment::operator=(
+    const DualTreeAssignment& other)
+{
+  if (this != &other)
+  {
+    delete tree;
+    tree = NULL;
+    treeDepth = 0;
+    leafSize = other.leafSize;
+  }
+
+  return *this;
+}
+
+inline DualTreeAssignment::~DualTreeAssignment()
+{
+  delete tree;
+}
+
+template<typename MetricType, typename MatType>
+size_t DualTreeAssignment::Assign(const MatType& data,
+                                  const MatType& centroids,
+                                  const MetricType& metric,
+                                  arma::Col<size_t>& assignments,
+                                  arma::Col<size_t>& counts)
+{
+  // The bounds of the trees can't prune with any other metric.
+  return NaiveAssignment::Assign(data, centroids, metric, assignments, counts);
+}
+
+template<bool TakeRoot, typename MatType>
+size_t DualTreeAssignment::Assign(const MatType& data,
+                                  const MatType& centroids,
+                                  const metric::LMetric<2, TakeRoot>& metric,
+                                  arma::Col<size_t>& assignments,
+                                  arma::Col<size_t>& counts)
+{
+  // Build the tree on the points, if it hasn't been built yet.
+  if (tree == NULL || oldFromNew.size() != data.n_cols)
+  {
+    delete tree;
+    treeData = data;
+    tree = new TreeType(treeData, oldFromNew, leafSize);
+    treeDepth = tree->TreeDepth();
+  }
+
+  // Build the tree on the centroids.  A centroid of an empty cluster may be
+  // undefined; it is never the closest centroid, so it is left out.
+  std::vector<size_t> definedCentroids;
+  for (size_t j = 0; j < centroids.n_cols; ++j)
+    if (arma::is_finite(centroids.col(j)))
+      definedCentroids.push_back(j);
+
+  if (definedCentroids.empty())
+    return NaiveAssignment::Assign(data, centroids, metric, assignments,
+        counts);
+
+  arma::mat centroidData(centroids.n_rows, definedCentroids.size());
+  for (size_t j = 0; j < definedCentroids.size(); ++j)
+    centroidData.col(j) = centroids.col(definedCentroids[j]);
+
+  std::vector<size_t> centroidOldFromNew;
+  TreeType centroidTree(centroidData, centroidOldFromNew, 1);
+
+  centroidIndices.resize(definedCentroids.size());
+  for (size_t j = 0; j < definedCentroids.size(); ++j)
+    centroidIndices[j] = definedCentroids[centroidOldFromNew[j]];
+
+  // Each list holds disjoint nodes of the centroid tree, so it has at most one
+  // node per centroid.  The storage only grows, so after the first call it is
+  // not reallocated.
+  const size_t stride = definedCentroids.size();
+  candidates.resize((treeDepth + 2) * stride);
+  work.reserve(stride);
+  leafCandidates.reserve(stride);
+
+  candidates[0] = &centroidTree;
+  const size_t changedAssignments = AssignNode(*tree, 0, 1, data, centroids,
+      metric, assignments);
+
+  if (changedAssignments > 0)
+    RecountClusters(assignments, counts);
+
+  return changedAssignments;
+}
+
+template<typename MetricType, typename MatType>
+size_t DualTreeAssignment::AssignNode(const TreeType& node,
+                                      const size_t level,
+                                      const size_t parentCandidates,
+                                      const MatType& data,
+                                      const MatType& centroids,
+                                      const MetricType& metric,
+                                      arma::Col<size_t>& assignments)
+{
+  const size_t stride = centroidIndices.size();
+  const TreeType** parentList = &candidates[level * stride];
+  const TreeType** list = &candidates[(level + 1) * stride];
+  const bound::HRectBound<2, false>& bound = node.Bound();
+
+  // The squared distance from any point in this node to its closest centroid
+  // is at most the maximum distance to any candidate node.  Candidates with a
+  // minimum distance greater than that (by a small margin, so that rounding
+  // can't drop a tied centroid) hold no closest centroid.
+  const double margin = 1.0 + 1e-10;
+  double upperBound = std::numeric_limits<double>::infinity();
+  work.clear();
+  for (size_t j = 0; j < parentCandidates; ++j)
+  {
+    upperBound = std::min(upperBound,
+        bound.MaxDistance(parentList[j]->Bound()));
+    work.push_back(parentList[j]);
+  }
+
+  // Test each candidate; candidates which are larger than this node (or any
+  // candidates, if this is a leaf) are split and their children are tested.
+  const double diameter = bound.Diameter();
+  size_t count = 0;
+  while (!work.empty())
+  {
+    const TreeType* candidate = work.back();
+    work.pop_back();
+
+    if (bound.MinDistance(candidate->Bound()) > margin * upperBound)
+      continue;
+
+    if (!candidate->IsLeaf() &&
+        (node.IsLeaf() || candidate->Bound().Diameter() > diameter))
+    {
+      upperBound = std::min(upperBound,
+          bound.MaxDistance(candidate->Left()->Bound()));
+      upperBound = std::min(upperBound,
+          bound.MaxDistance(candidate->Right()->Bound()));
+      work.push_back(candidate->Left());
+      work.push_back(candidate->Right());
+      continue;
+    }
+
+    list[count++] = candidate;
+  }
+
+  // The upper bound may have shrunk since some candidates were tested.  Also
+  // find the single centroid with the smallest maximum distance.
+  size_t kept = 0;
+  const TreeType* best = NULL;
+  double bestDistance = std::numeric_limits<double>::infinity();
+  for (size_t j = 0; j < count; ++j)
+  {
+    if (bound.MinDistance(list[j]->Bound()) > margin * upperBound)
+      continue;
+
+    list[kept++] = list[j];
+    if (list[j]->Count() == 1)
+    {
+      const double distance = bound.MaxDistance(list[j]->Bound());
+      if (distance < bestDistance)
+      {
+        bestDistance = distance;
+        best = list[j];
+      }
+    }
+  }
+  count = kept;
+
+  // Now drop each single centroid which is further than the best centroid from
+  // every point in the node (Pelleg and Moore's test).  The difference of the
+  // squared distances to the two centroids is linear, so it is smallest at the
+  // corner of the node furthest in the direction from the best centroid to the
+  // other centroid.
+  if (best != NULL && count > 1)
+  {
+    const arma::mat& centroidData = best->Dataset();
+    const size_t bestIndex = best->Begin();
+    kept = 0;
+    for (size_t j = 0; j < count; ++j)
+    {
+      if (list[j] == best || list[j]->Count() != 1)
+      {
+        list[kept++] = list[j];
+        continue;
+      }
+
+      const size_t index = list[j]->Begin();
+      double otherDistance = 0.0;
+      double bestCornerDistance = 0.0;
+      for (size_t d = 0; d < centroidData.n_rows; ++d)
+      {
+        const double other = centroidData(d, index);
+        const double closest = centroidData(d, bestIndex);
+        const double corner = (other > closest) ? bound[d].Hi() :
+            bound[d].Lo();
+
+        otherDistance += (other - corner) * (other - corner);
+        bestCornerDistance += (closest - corner) * (closest - corner);
+      }
+
+      if (otherDistance - bestCornerDistance <= (margin - 1.0) * bestDistance)
+        list[kept++] = list[j];
+    }
+    count = kept;
+  }
+
+  size_t changedAssignments = 0;
+  if (count == 1 && list[0]->Count() == 1)
+  {
+    // Every point in this node is closest to the same centroid.
+    const size_t owner = centroidIndices[list[0]->Begin()];
+    for (size_t i = node.Begin(); i < node.End(); ++i)
+    {
+      if (assignments[oldFromNew[i]] != owner)
+      {
+        assignments[oldFromNew[i]] = owner;
+        ++changedAssignments;
+      }
+    }
+  }
+  else if (node.IsLeaf())
+  {
+    // Compute the distance to each candidate, in the same order as
+    // NaiveAssignment so that ties are broken the same way.
+    leafCandidates.clear();
+    for (size_t j = 0; j < count; ++j)
+      for (size_t c = list[j]->Begin(); c < list[j]->End(); ++c)
+        leafCandidates.push_back(centroidIndices[c]);
+    std::sort(leafCandidates.begin(), leafCandidates.end());
+
+    for (size_t i = node.Begin(); i < node.End(); ++i)
+    {
+      const size_t point = oldFromNew[i];
+      double minDistance = std::numeric_limits<double>::infinity();
+      size_t closestCluster = centroids.n_cols; // Invalid value.
+
+      for (size_t j = 0; j < leafCandidates.size(); ++j)
+      {
+        const double distance = metric.Evaluate(data.col(point),
+            centroids.col(leafCandidates[j]));
+
+        if (distance < minDistance)
+        {
+          minDistance = distance;
+          closestCluster = leafCandidates[j];
+        }
+      }
+
+      if (assignments[point] != closestCluster)
+      {
+        assignments[point] = closestCluster;
+        ++changedAssignments;
+      }
+    }
+  }
+  else
+  {
+    // The left child only writes to the lists of deeper levels, so this list
+    // is still intact for the right child.
+    changedAssignments += AssignNode(*node.Left(), level + 1, count, data,
+        centroids, metric, assignments);
+    changedAssignments += AssignNode(*node.Right(), level + 1, count, data,
+        centroids, metric, assignments);
+  }
+
+  return changedAssignments;
+}
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,84 @@
+/**
+ * @file elkan_assignment.hpp
+ * @author Ryan Curtin
+ *
+ * An AssignmentPolicy for K-Means which uses Elkan's bounds to avoid most of
+ * the distance calculations of the assignment step.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_ELKAN_ASSIGNMENT_HPP
+#define __MLPACK_METHODS_KMEANS_ELKAN_ASSIGNMENT_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * An assignment step which keeps, for each point, an upper bound on the
+ * distance to its assigned centroid and a lower bound on the distance to every
+ * other centroid, along with the distances between all pairs of centroids.
+ * When a centroid moves, the bounds are loosened by the distance it moved; a
+ * distance is only computed if the bounds can't show that the centroid is
+ * further from the point than the assigned centroid.  This is the algorithm
+ * from the following paper:
+ *
+ * @inproceedings{elkan2003using,
+ *   title={Using the triangle inequality to accelerate k-means},
+ *   author={Elkan, Charles},
+ *   booktitle={Proceedings of the Twentieth International Conference on
+ *       Machine Learning (ICML 2003)},
+ *   pages={147--153},
+ *   year={2003}
+ * }
+ *
+ * The assignments are the same as those given by NaiveAssignment.  This policy
+ * stores (number of clusters) lower bounds for each point, so for large
+ * numbers of clusters HamerlyAssignment or YinyangAssignment may be better
+ * choices.  The metric must satisfy the triangle inequality (or be the squared
+ * Euclidean distance), and the data must be a dense matrix.
+ */
+class ElkanAssignment
+{
+ public:
+  //! Empty constructor, required by the AssignmentPolicy policy.
+  ElkanAssignment() { }
+
+  /**
+   * Assign each point to its closest centroid, updating the counts of points
+   * in each cluster.  The bounds from the previous call are used to avoid
+   * distance calculations.
+   *
+   * @tparam MetricType Type of distance metric.
+   * @tparam MatType Type of data (arma::mat).
+   * @param data Dataset being clustered.
+   * @param centroids Centroids of each cluster (one per column).
+   * @param metric Instantiated distance metric.
+   * @param assignments Cluster assignments of each point; these are modified.
+   * @param counts Number of points in each cluster; these are modified.
+   * @return Number of points whose assignment changed.
+   */
+  template<typename MetricType, typename MatType>
+  size_t Assign(const MatType& data,
+                const MatType& centroids,
+                const MetricType& metric,
+                arma::Col<size_t>& assignments,
+                arma::Col<size_t>& counts);
+
+ private:
+  //! Upper bound on the distance from each point to its assigned centroid.
+  arma::vec upperBounds;
+  //! Lower bound on the distance from each point (column) to each centroid.
+  arma::mat lowerBounds;
+  //! The assignments given by the previous call.
+  arma::Col<size_t> lastAssignments;
+  //! The centroids given in the previous call.
+  arma::mat lastCentroids;
+};
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+// Include implementation.
+#include "elkan_assignment_impl.hpp"
+
+#endif
@@ -0,0 +1,162 @@
+/**
+ * @file elkan_assignment_impl.hpp
+ * @author Ryan Curtin
+ *
+ * Implementation of the ElkanAssignment class.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_ELKAN_ASSIGNMENT_IMPL_HPP
+#define __MLPACK_METHODS_KMEANS_ELKAN_ASSIGNMENT_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "elkan_assignment.hpp"
+#include "recount_clusters.hpp"
+#include "triangle_bounds.hpp"
+
+namespace mlpack {
+namespace kmeans {
+
+template<typename MetricType, typename MatType>
+size_t ElkanAssignment::Assign(const MatType& data,
+                               const MatType& centroids,
+                               const MetricType& metric,
+                               arma::Col<size_t>& assignments,
+                               arma::Col<size_t>& counts)
+{
+  const size_t clusters = centroids.n_cols;
+  const double inf = std::numeric_limits<double>::infinity();
+
+  // Find how far each centroid has moved.  On the first call there are no
+  // bounds yet: the upper bounds are infinite and the lower bounds are zero,
+  // which means every point will be checked.
+  arma::vec drift(clusters);
+  if (upperBounds.n_elem != data.n_cols || lowerBounds.n_rows != clusters)
+  {
+    upperBounds.set_size(data.n_cols);
+    upperBounds.fill(inf);
+    lowerBounds.zeros(clusters, data.n_cols);
+    lastAssignments = assignments;
+    drift.zeros();
+  }
+  else
+  {
+    for (size_t j = 0; j < clusters; ++j)
+      drift[j] = CentroidDrift(metric, lastCentroids.col(j), centroids.col(j));
+  }
+
+  // Half of the distance between each pair of centroids, and half of the
+  // distance from each centroid to the closest other centroid.  A point closer
+  // to its centroid than that can't be closer to any other centroid.  The
+  // diagonal is infinite, so that it is ignored when taking the minimum.
+  arma::mat halfDistances(clusters, clusters);
+  #pragma omp parallel for schedule(dynamic)
+  for (size_t j = 0; j < clusters; ++j)
+  {
+    halfDistances(j, j) = inf;
+    for (size_t l = j + 1; l < clusters; ++l)
+    {
+      const double half = 0.5 * BoundDistance<MetricType>(metric.Evaluate(
+          centroids.col(j), centroids.col(l)));
+      halfDistances(j, l) = half;
+      halfDistances(l, j) = half;
+    }
+  }
+
+  arma::vec separations(clusters);
+  for (size_t j = 0; j < clusters; ++j)
+    separations[j] = arma::min(halfDistances.col(j));
+
+  // Each point has its own bounds, so the points can be split between threads.
+  size_t changedAssignments = 0;
+  #pragma omp parallel for schedule(dynamic, 256) \
+      reduction(+:changedAssignments)
+  for (size_t i = 0; i < data.n_cols; ++i)
+  {
+    const size_t assigned = assignments[i];
+
+    // If the assignment was changed since the last call (by the empty cluster
+    // policy), the upper bound is not known.
+    if (assigned != lastAssignments[i])
+      upperBounds[i] = inf;
+    else
+      upperBounds[i] += drift[assigned];
+    lastAssignments[i] = assigned;
+
+    for (size_t j = 0; j < clusters; ++j)
+      lowerBounds(j, i) = LoosenLowerBound(lowerBounds(j, i), drift[j]);
+
+    if (Separated(upperBounds[i], separations[assigned]))
+      continue;
+
+    // Check whether any centroid could be closer, before paying for the exact
+    // distance to the assigned centroid.
+    bool candidates = false;
+    for (size_t j = 0; j < clusters; ++j)
+    {
+      if (j != assigned &&
+          !Separated(upperBounds[i], lowerBounds(j, i)) &&
+          !Separated(upperBounds[i], halfDistances(assigned, j)))
+      {
+        candidates = true;
+        break;
+      }
+    }
+
+    if (!candidates)
+      continue;
+
+    const double assignedDistance = metric.Evaluate(data.col(i),
+        centroids.col(assigned));
+    upperBounds[i] = BoundDistance<MetricType>(assignedDistance);
+    lowerBounds(assigned, i) = upperBounds[i];
+
+    // Now find the closest centroid, in the same order as NaiveAssignment so
+    // that ties are broken the same way.  The centroids which are skipped are
+    // strictly further away than the assigned centroid.
+    double minDistance = inf;
+    size_t closestCluster = clusters; // Invalid value.
+    for (size_t j = 0; j < clusters; ++j)
+    {
+      double distance;
+      if (j == assigned)
+      {
+        distance = assignedDistance;
+      }
+      else if (Separated(upperBounds[i], lowerBounds(j, i)) ||
+               Separated(upperBounds[i], halfDistances(assigned, j)))
+      {
+        continue;
+      }
+      else
+      {
+        distance = metric.Evaluate(data.col(i), centroids.col(j));
+        lowerBounds(j, i) = BoundDistance<MetricType>(distance);
+      }
+
+      if (distance < minDistance)
+      {
+        minDistance = distance;
+        closestCluster = j;
+      }
+    }
+
+    if (closestCluster != assigned)
+    {
+      assignments[i] = closestCluster;
+      lastAssignments[i] = closestCluster;
+      upperBounds[i] = BoundDistance<MetricType>(minDistance);
+      changedAssignments++;
+    }
+  }
+
+  if (changedAssignments > 0)
+    RecountClusters(assignments, counts);
+
+  lastCentroids = centroids;
+
+  return changedAssignments;
+}
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+#endif
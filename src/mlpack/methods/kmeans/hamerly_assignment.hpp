@@ -0,0 +1,84 @@
+/**
+ * @file hamerly_assignment.hpp
+ * @author Ryan Curtin
+ *
+ * An AssignmentPolicy for K-Means which uses Hamerly's bounds to avoid most of
+ * the distance calculations of the assignment step.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_HAMERLY_ASSIGNMENT_HPP
+#define __MLPACK_METHODS_KMEANS_HAMERLY_ASSIGNMENT_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * An assignment step which keeps, for each point, an upper bound on the
+ * distance to its assigned centroid and a single lower bound on the distance to
+ * the second closest centroid.  If the upper bound is less than the lower bound
+ * (or than half the distance from the assigned centroid to the closest other
+ * centroid), the point can't change clusters and no distances are computed;
+ * otherwise, the distances to all centroids are computed.  This is the
+ * algorithm from the following paper:
+ *
+ * @inproceedings{hamerly2010making,
+ *   title={Making k-means even faster},
+ *   author={Hamerly, Greg},
+ *   booktitle={Proceedings of the 2010 SIAM International Conference on Data
+ *       Mining (SDM 2010)},
+ *   pages={130--140},
+ *   year={2010}
+ * }
+ *
+ * The assignments are the same as those given by NaiveAssignment.  Only two
+ * bounds are stored for each point, so this works well for low-dimensional
+ * data and large numbers of clusters.  The metric must satisfy the triangle
+ * inequality (or be the squared Euclidean distance), and the data must be a
+ * dense matrix.
+ */
+class HamerlyAssignment
+{
+ public:
+  //! Empty constructor, required by the AssignmentPolicy policy.
+  HamerlyAssignment() { }
+
+  /**
+   * Assign each point to its closest centroid, updating the counts of points
+   * in each cluster.  The bounds from the previous call are used to avoid
+   * distance calculations.
+   *
+   * @tparam MetricType Type of distance metric.
+   * @tparam MatType Type of data (arma::mat).
+   * @param data Dataset being clustered.
+   * @param centroids Centroids of each cluster (one per column).
+   * @param metric Instantiated distance metric.
+   * @param assignments Cluster assignments of each point; these are modified.
+   * @param counts Number of points in each cluster; these are modified.
+   * @return Number of points whose assignment changed.
+   */
+  template<typename MetricType, typename MatType>
+  size_t Assign(const MatType& data,
+                const MatType& centroids,
+                const MetricType& metric,
+                arma::Col<size_t>& assignments,
+                arma::Col<size_t>& counts);
+
+ private:
+  //! Upper bound on the distance from each point to its assigned centroid.
+  arma::vec upperBounds;
+  //! Lower bound on the distance from each point to any other centroid.
+  arma::vec lowerBounds;
+  //! The assignments given by the previous call.
+  arma::Col<size_t> lastAssignments;
+  //! The centroids given in the previous call.
+  arma::mat lastCentroids;
+};
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+// Include implementation.
+#include "hamerly_assignment_impl.hpp"
+
+#endif
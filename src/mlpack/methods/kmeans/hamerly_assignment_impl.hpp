@@ -0,0 +1,166 @@
+/**
+ * @file hamerly_assignment_impl.hpp
+ * @author Ryan Curtin
+ *
+ * Implementation of the HamerlyAssignment class.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_HAMERLY_ASSIGNMENT_IMPL_HPP
+#define __MLPACK_METHODS_KMEANS_HAMERLY_ASSIGNMENT_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "hamerly_assignment.hpp"
+#include "recount_clusters.hpp"
+#include "triangle_bounds.hpp"
+
+namespace mlpack {
+namespace kmeans {
+
+template<typename MetricType, typename MatType>
+size_t HamerlyAssignment::Assign(const MatType& data,
+                                 const MatType& centroids,
+                                 const MetricType& metric,
+                                 arma::Col<size_t>& assignments,
+                                 arma::Col<size_t>& counts)
+{
+  const size_t clusters = centroids.n_cols;
+  const double inf = std::numeric_limits<double>::infinity();
+
+  // Find how far each centroid has moved, and which centroids moved furthest.
+  // On the first call there are no bounds yet: the upper bounds are infinite
+  // and the lower bounds are zero, which means every point will be checked.
+  arma::vec drift(clusters);
+  if (upperBounds.n_elem != data.n_cols || lastCentroids.n_cols != clusters)
+  {
+    upperBounds.set_size(data.n_cols);
+    upperBounds.fill(inf);
+    lowerBounds.zeros(data.n_cols);
+    lastAssignments = assignments;
+    drift.zeros();
+  }
+  else
+  {
+    for (size_t j = 0; j < clusters; ++j)
+      drift[j] = CentroidDrift(metric, lastCentroids.col(j), centroids.col(j));
+  }
+
+  size_t maxDriftCluster = 0;
+  double maxDrift = 0.0;
+  double secondMaxDrift = 0.0;
+  for (size_t j = 0; j < clusters; ++j)
+  {
+    if (drift[j] > maxDrift)
+    {
+      secondMaxDrift = maxDrift;
+      maxDrift = drift[j];
+      maxDriftCluster = j;
+    }
+    else if (drift[j] > secondMaxDrift)
+    {
+      secondMaxDrift = drift[j];
+    }
+  }
+
+  // Half of the distance from each centroid to the closest other centroid.  A
+  // point closer to its centroid than that can't be closer to any other
+  // centroid.  Each distance is computed twice, so that the centroids can be
+  // split between threads without storing all the distances.
+  arma::vec separations(clusters);
+  #pragma omp parallel for schedule(static)
+  for (size_t j = 0; j < clusters; ++j)
+  {
+    separations[j] = inf;
+    for (size_t l = 0; l < clusters; ++l)
+    {
+      if (l == j)
+        continue;
+
+      const double half = 0.5 * BoundDistance<MetricType>(metric.Evaluate(
+          centroids.col(j), centroids.col(l)));
+      if (half < separations[j])
+        separations[j] = half;
+    }
+  }
+
+  // Each point has its own bounds, so the points can be split between threads.
+  size_t changedAssignments = 0;
+  #pragma omp parallel for schedule(dynamic, 256) \
+      reduction(+:changedAssignments)
+  for (size_t i = 0; i < data.n_cols; ++i)
+  {
+    const size_t assigned = assignments[i];
+
+    // If the assignment was changed since the last call (by the empty cluster
+    // policy), neither bound is known.
+    if (assigned != lastAssignments[i])
+    {
+      upperBounds[i] = inf;
+      lowerBounds[i] = 0.0;
+    }
+    else
+    {
+      upperBounds[i] += drift[assigned];
+      lowerBounds[i] = LoosenLowerBound(lowerBounds[i],
+          (assigned == maxDriftCluster) ? secondMaxDrift : maxDrift);
+    }
+    lastAssignments[i] = assigned;
+
+    const double bound = std::max(separations[assigned], lowerBounds[i]);
+    if (Separated(upperBounds[i], bound))
+      continue;
+
+    // Tighten the upper bound and try again.
+    const double assignedDistance = metric.Evaluate(data.col(i),
+        centroids.col(assigned));
+    upperBounds[i] = BoundDistance<MetricType>(assignedDistance);
+    if (Separated(upperBounds[i], bound))
+      continue;
+
+    // Now compute the distance to every centroid, in the same order as
+    // NaiveAssignment so that ties are broken the same way, and keep the
+    // distance to the second closest centroid as the new lower bound.
+    double minDistance = inf;
+    size_t closestCluster = clusters; // Invalid value.
+    double closestBound = inf;
+    double secondBound = inf;
+    for (size_t j = 0; j < clusters; ++j)
+    {
+      const double distance = (j == assigned) ? assignedDistance :
+          metric.Evaluate(data.col(i), centroids.col(j));
+      const double distanceBound = BoundDistance<MetricType>(distance);
+
+      if (distance < minDistance)
+      {
+        secondBound = closestBound;
+        minDistance = distance;
+        closestBound = distanceBound;
+        closestCluster = j;
+      }
+      else if (distanceBound < secondBound)
+      {
+        secondBound = distanceBound;
+      }
+    }
+
+    upperBounds[i] = closestBound;
+    lowerBounds[i] = secondBound;
+
+    if (closestCluster != assigned)
+    {
+      assignments[i] = closestCluster;
+      lastAssignments[i] = closestCluster;
+      changedAssignments++;
+    }
+  }
+
+  if (changedAssignments > 0)
+    RecountClusters(assignments, counts);
+
+  lastCentroids = centroids;
+
+  return changedAssignments;
+}
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+#endif
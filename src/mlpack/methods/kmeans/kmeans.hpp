@@ -12,6 +12,7 @@
 #include <mlpack/core/metrics/lmetric.hpp>
 #include "random_partition.hpp"
 #include "max_variance_new_cluster.hpp"
+#include "naive_assignment.hpp"
 
 #include <mlpack/core/tree/binary_space_tree.hpp>
 
@@ -24,9 +25,14 @@ namespace kmeans /** K-Means clustering. */ {
  * found; then, those clusters will be merged together to produce the desired
  * number of clusters.
  *
- * Two template parameters can (optionally) be supplied: the policy for how to
- * find the initial partition of the data, and the actions to be taken when an
- * empty cluster is encountered, as well as the distance metric to be used.
+ * Several template parameters can (optionally) be supplied: the policy for how
+ * to find the initial partition of the data, the actions to be taken when an
+ * empty cluster is encountered, and the way points are assigned to clusters
+ * in each iteration, as well as the distance metric to be used.
+ *
+ * If OpenMP is available, the update step and the assignment step of each
+ * iteration run in parallel; the results do not depend on the number of
+ * threads.
  *
  * A simple example of how to run K-Means clustering is shown below.
  *
@@ -41,6 +47,12 @@ namespace kmeans /** K-Means clustering. */ {
  * // overclustering factor of 4.0.
  * KMeans<metric::ManhattanDistance> k(100, 4.0);
  * k.Cluster(data, 6, assignments); // 6 clusters.
+ *
+ * // Use the triangle inequality to avoid most distance calculations; the
+ * // results are the same.
+ * KMeans<metric::SquaredEuclideanDistance, RandomPartition,
+ *     MaxVarianceNewCluster, HamerlyAssignment> k;
+ * k.Cluster(data, 1000, assignments); // 1000 clusters.
  * @endcode
  *
  * @tparam MetricType The distance metric to use for this KMeans; see
@@ -51,12 +63,19 @@ namespace kmeans /** K-Means clustering. */ {
  * @tparam EmptyClusterPolicy Policy for what to do on an empty cluster; must
  *     implement a default constructor and 'void EmptyCluster(const arma::mat&,
  *     arma::Col<size_t&)'.
+ * @tparam AssignmentPolicy Policy for the assignment step of each iteration;
+ *     must implement a copy constructor and 'size_t Assign(const arma::mat&,
+ *     const arma::mat&, const MetricType&, arma::Col<size_t>&,
+ *     arma::Col<size_t>&)'.  See NaiveAssignment for details.
  *
- * @see RandomPartition, RefinedStart, AllowEmptyClusters, MaxVarianceNewCluster
+ * @see RandomPartition, RefinedStart, AllowEmptyClusters,
+ *     MaxVarianceNewCluster, NaiveAssignment, ElkanAssignment,
+ *     HamerlyAssignment, YinyangAssignment
  */
 template<typename MetricType = metric::SquaredEuclideanDistance,
          typename InitialPartitionPolicy = RandomPartition,
-         typename EmptyClusterPolicy = MaxVarianceNewCluster>
+         typename EmptyClusterPolicy = MaxVarianceNewCluster,
+         typename AssignmentPolicy = NaiveAssignment>
 class KMeans
 {
  public:
@@ -81,12 +100,15 @@ class KMeans
    *     specially initialized partitioning policy is required.
    * @param emptyClusterAction Optional EmptyClusterPolicy object; for when a
    *     specially initialized empty cluster policy is required.
+   * @param assigner Optional AssignmentPolicy object; for when a specially
+   *     initialized assignment policy is required.
    */
   KMeans(const size_t maxIterations = 1000,
          const double overclusteringFactor = 1.0,
          const MetricType metric = MetricType(),
          const InitialPartitionPolicy partitioner = InitialPartitionPolicy(),
-         const EmptyClusterPolicy emptyClusterAction = EmptyClusterPolicy());
+         const EmptyClusterPolicy emptyClusterAction = EmptyClusterPolicy(),
+         const AssignmentPolicy assigner = AssignmentPolicy());
 
 
   /**
@@ -143,9 +165,19 @@ class KMeans
                const bool initialCentroidGuess = false) const;
 
   /**
-   * An implementation of k-means using the Pelleg-Moore algorithm; this is
-   * known to not work -- do not use it!  (Fixing it is TODO, of course; see
-   * #251.)
+   * Perform k-means clustering on the data with the DualTreeAssignment policy
+   * (whatever the AssignmentPolicy of this object is).  A kd-tree is built on
+   * the points once, and the points of each of its nodes are assigned together
+   * when a single centroid is closest to the whole node, as in the Pelleg-Moore
+   * algorithm.  The results are the same as those of Cluster().  The tree is
+   * only used with the Euclidean or squared Euclidean distance (with any other
+   * metric, this is the same as Cluster() with NaiveAssignment), and the data
+   * must be dense.  The data is not modified.
+   *
+   * @tparam MatType Type of data (arma::mat).
+   * @param data Dataset to cluster.
+   * @param clusters Number of clusters to compute.
+   * @param assignments Vector to store cluster assignments in.
    */
   template<typename MatType>
   void FastCluster(MatType& data,
@@ -178,6 +210,11 @@ class KMeans
   //! Modify the empty cluster policy.
   EmptyClusterPolicy& EmptyClusterAction() { return emptyClusterAction; }
 
+  //! Get the assignment policy.
+  const AssignmentPolicy& Assigner() const { return assigner; }
+  //! Modify the assignment policy.
+  AssignmentPolicy& Assigner() { return assigner; }
+
  private:
   //! Factor controlling how many clusters are actually found.
   double overclusteringFactor;
@@ -189,6 +226,20 @@ class KMeans
   InitialPartitionPolicy partitioner;
   //! Instantiated empty cluster policy.
   EmptyClusterPolicy emptyClusterAction;
+  //! Instantiated assignment policy.
+  AssignmentPolicy assigner;
+
+  /**
+   * Calculate the centroid of each cluster from the given assignments and
+   * counts of points in each cluster.  The result does not depend on the
+   * number of threads.  Dense data is summed in parallel; sparse data is
+   * summed by one thread.
+   */
+  template<typename MatType>
+  void UpdateCentroids(const MatType& data,
+                       const arma::Col<size_t>& assignments,
+                       const arma::Col<size_t>& counts,
+                       MatType& centroids) const;
 };
 
 }; // namespace kmeans
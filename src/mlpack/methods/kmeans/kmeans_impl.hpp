@@ -7,10 +7,9 @@
  */
 #include "kmeans.hpp"
 
-#include <mlpack/core/tree/mrkd_statistic.hpp>
 #include <mlpack/core/metrics/lmetric.hpp>
+#include "dual_tree_assignment.hpp"
 
-#include <stack>
 #include <limits>
 
 namespace mlpack {
@@ -21,20 +20,24 @@ namespace kmeans {
  */
 template<typename MetricType,
          typename InitialPartitionPolicy,
-         typename EmptyClusterPolicy>
+         typename EmptyClusterPolicy,
+         typename AssignmentPolicy>
 KMeans<
     MetricType,
     InitialPartitionPolicy,
-    EmptyClusterPolicy>::
+    EmptyClusterPolicy,
+    AssignmentPolicy>::
 KMeans(const size_t maxIterations,
        const double overclusteringFactor,
        const MetricType metric,
        const InitialPartitionPolicy partitioner,
-       const EmptyClusterPolicy emptyClusterAction) :
+       const EmptyClusterPolicy emptyClusterAction,
+       const AssignmentPolicy assigner) :
     maxIterations(maxIterations),
     metric(metric),
     partitioner(partitioner),
-    emptyClusterAction(emptyClusterAction)
+    emptyClusterAction(emptyClusterAction),
+    assigner(assigner)
 {
   // Validate overclustering factor.
   if (overclusteringFactor < 1.0)
@@ -49,437 +52,30 @@ KMeans(const size_t maxIterations,
   }
 }
 
+/**
+ * Perform k-means clustering with the DualTreeAssignment policy, which builds a
+ * kd-tree on the points once and assigns whole nodes of it at a time.
+ */
 template<typename MetricType,
          typename InitialPartitionPolicy,
-         typename EmptyClusterPolicy>
+         typename EmptyClusterPolicy,
+         typename AssignmentPolicy>
 template<typename MatType>
 void KMeans<
     MetricType,
     InitialPartitionPolicy,
-    EmptyClusterPolicy>::
+    EmptyClusterPolicy,
+    AssignmentPolicy>::
 FastCluster(MatType& data,
             const size_t clusters,
             arma::Col<size_t>& assignments) const
 {
-  size_t actualClusters = size_t(overclusteringFactor * clusters);
-  if (actualClusters > data.n_cols)
-  {
-    Log::Warn << "KMeans::Cluster(): overclustering factor is too large.  No "
-        << "overclustering will be done." << std::endl;
-    actualClusters = clusters;
-  }
-
-  size_t dimensionality = data.n_rows;
-
-  // Centroids of each cluster.  Each column corresponds to a centroid.
-  MatType centroids(dimensionality, actualClusters);
-  centroids.zeros();
-
-  // Counts of points in each cluster.
-  arma::Col<size_t> counts(actualClusters);
-  counts.zeros();
-
-  // Build the mrkd-tree on this dataset.
-  tree::BinarySpaceTree<typename bound::HRectBound<2>, tree::MRKDStatistic>
-      tree(data, 1);
-  Log::Debug << "Tree Built." << std::endl;
-  // A pointer for traversing the mrkd-tree.
-  tree::BinarySpaceTree<typename bound::HRectBound<2>, tree::MRKDStatistic>*
-      node;
-
-  // Now, the initial assignments.  First determine if they are necessary.
-  if (assignments.n_elem != data.n_cols)
-  {
-    // Use the partitioner to come up with the partition assignments.
-    partitioner.Cluster(data, actualClusters, assignments);
-  }
-
-  // Set counts correctly.
-  for (size_t i = 0; i < assignments.n_elem; i++)
-    counts[assignments[i]]++;
-
-  // Sum the points for each centroid
-  for (size_t i = 0; i < data.n_cols; i++)
-    centroids.col(assignments[i]) += data.col(i);
-
-  // Then divide the sums by the count to get the center of mass for this
-  // centroids assigned points
-  for (size_t i = 0; i < actualClusters; i++)
-    centroids.col(i) /= counts[i];
-
-  // Instead of retraversing the tree after an iteration, we will update
-  // centroid positions in this matrix, which also prevents clobbering our
-  // centroids from the previous iteration.
-  MatType newCentroids(dimensionality, centroids.n_cols);
-
-  // Create a stack for traversing the mrkd-tree.
-  std::stack<typename tree::BinarySpaceTree<typename bound::HRectBound<2>,
-                                            tree::MRKDStatistic>* > stack;
-
-  // A variable to keep track of how many kmeans iterations we have made.
-  size_t iteration = 0;
-
-  // A variable to keep track of how many nodes assignments have changed in
-  // each kmeans iteration.
-  size_t changedAssignments = 0;
-
-  // A variable to keep track of the number of times something is skipped due
-  // to the blacklist.
-  size_t skip = 0;
-
-  // A variable to keep track of the number of distances calculated.
-  size_t comps = 0;
-
-  // A variable to keep track of how often we stop at a parent node.
-  size_t dominations = 0;
-  do
-  {
-    // Keep track of what iteration we are on.
-    ++iteration;
-    changedAssignments = 0;
-
-    // Reset the newCentroids so that we can store the newly calculated ones
-    // here.
-    newCentroids.zeros();
-
-    // Reset the counts.
-    counts.zeros();
-
-    // Add the root node of the tree to the stack.
-    stack.push(&tree);
-    // Set the top level whitelist.
-    tree.Stat().Whitelist().resize(centroids.n_cols, true);
-
-    // Traverse the tree.
-    while (!stack.empty())
-    {
-      // Get the next node in the tree.
-      node = stack.top();
-      // Remove the node from the stack.
-      stack.pop();
-
-      // Get a reference to the mrkd statistic for this hyperrectangle.
-      tree::MRKDStatistic& mrkd = node->Stat();
-
-      // We use this to store the index of the centroid with the minimum
-      // distance from this hyperrectangle or point.
-      size_t minIndex = 0;
-
-      // If this node is a leaf, then we calculate the distance from
-      // the centroids to every point the node contains.
-      if (node->IsLeaf())
-      {
-        for (size_t i = mrkd.Begin(); i < mrkd.Count() + mrkd.Begin(); ++i)
-        {
-          // Initialize minDistance to be nonzero.
-          double minDistance = metric.Evaluate(data.col(i), centroids.col(0));
-
-          // Find the minimal distance centroid for this point.
-          for (size_t j = 1; j < centroids.n_cols; ++j)
-          {
-            // If this centroid is not in the whitelist, skip it.
-            if (!mrkd.Whitelist()[j])
-            {
-              ++skip;
-              continue;
-            }
-
-            ++comps;
-            double distance = metric.Evaluate(data.col(i), centroids.col(j));
-            if (minDistance > distance)
-            {
-              minIndex = j;
-              minDistance = distance;
-            }
-          }
-
-          // Add this point to the undivided center of mass summation for its
-          // assigned centroid.
-          newCentroids.col(minIndex) += data.col(i);
-
-          // Increment the count for the minimum distance centroid.
-          ++counts(minIndex);
-
-          // If we actually changed assignments, increment changedAssignments
-          // and modify the assignment vector for this point.
-          if (assignments(i) != minIndex)
-          {
-            ++changedAssignments;
-            assignments(i) = minIndex;
-          }
-        }
-      }
-      // If this node is not a leaf, then we continue trying to find dominant
-      // centroids.
-      else
-      {
-        bound::HRectBound<2>& bound = node->Bound();
-
-        // A flag to keep track of if we find a single centroid that is closer
-        // to all points in this hyperrectangle than any other centroid.
-        bool noDomination = false;
-
-        // Calculate the center of mass of this hyperrectangle.
-        arma::vec center = mrkd.CenterOfMass() / mrkd.Count();
-
-        // Set the minDistance to the maximum value of a double so any value
-        // must be smaller than this.
-        double minDistance = std::numeric_limits<double>::max();
-
-        // The candidate distance we calculate for each centroid.
-        double distance = 0.0;
-
-        // How many points are inside this hyperrectangle, we stop if we
-        // see more than 1.
-        size_t contains = 0;
-
-        // Find the "owner" of this hyperrectangle, if one exists.
-        for (size_t i = 0; i < centroids.n_cols; ++i)
-        {
-          // If this centroid is not in the whitelist, skip it.
-          if (!mrkd.Whitelist()[i])
-          {
-            ++skip;
-            continue;
-          }
-
-          // Incrememnt the number of distance calculations for what we are
-          // about to do.
-          comps += 2;
-
-          // Reinitialize the distance so += works right.
-          distance = 0.0;
-
-          // We keep track of how many dimensions have nonzero distance,
-          // if this is 0 then the distance is 0.
-          size_t nonZero = 0;
-
-          /*
-            Compute the distance to the hyperrectangle for this centroid.
-            We do this by finding the furthest point from the centroid inside
-            the hyperrectangle. This is a corner of the hyperrectangle.
-
-            In order to do this faster, we calculate both the distance and the
-            furthest point simultaneously.
-
-            This following code is equivalent to, but faster than:
-
-            arma::vec p;
-            p.zeros(dimensionality);
-
-            for (size_t j = 0; j < dimensionality; ++j)
-            {
-              if (centroids(j,i) < bound[j].Lo())
-                p(j) = bound[j].Lo();
-              else
-                p(j) = bound[j].Hi();
-            }
-
-            distance = metric.Evaluate(p.col(0), centroids.col(i));
-          */
-          for (size_t j = 0; j < dimensionality; ++j)
-          {
-            double ij = centroids(j,i);
-            double lo = bound[j].Lo();
-
-            if (ij < lo)
-            {
-              // (ij - lo)^2
-              ij -= lo;
-              ij *= ij;
-
-              distance += ij;
-              ++nonZero;
-            }
-            else
-            {
-              double hi = bound[j].Hi();
-              if (ij > hi)
-              {
-                // (ij - hi)^2
-                ij -= hi;
-                ij *= ij;
-
-                distance += ij;
-                ++nonZero;
-              }
-            }
-          }
-
-          // The centroid is inside the hyperrectangle.
-          if (nonZero == 0)
-          {
-            ++contains;
-            minDistance = 0.0;
-            minIndex = i;
-
-            // If more than two points are within this hyperrectangle, then
-            // there can be no dominating centroid, so we should continue
-            // to the children nodes.
-            if (contains > 1)
-            {
-              noDomination = true;
-              break;
-            }
-          }
-
-          if (fabs(distance - minDistance) <= 1e-10)
-          {
-            noDomination = true;
-            break;
-          }
-          else if (distance < minDistance)
-          {
-            minIndex = i;
-            minDistance = distance;
-          }
-        }
+  KMeans<MetricType, InitialPartitionPolicy, EmptyClusterPolicy,
+      DualTreeAssignment> kmeans(maxIterations, overclusteringFactor, metric,
+      partitioner, emptyClusterAction);
 
-        distance = minDistance;
-        // Determine if the owner dominates this centroid only if there was
-        // exactly one owner.
-        if (!noDomination)
-        {
-          for (size_t i = 0; i < centroids.n_cols; ++i)
-          {
-            if (i == minIndex)
-              continue;
-            // If this centroid is blacklisted for this hyperrectangle, then
-            // we skip it.
-            if (!mrkd.Whitelist()[i])
-            {
-              ++skip;
-              continue;
-            }
-            /*
-              Compute the dominating centroid for this hyperrectangle, if one
-              exists. We do this by calculating the point which is furthest
-              from the min'th centroid in the direction of c_k - c_min. We do
-              this as outlined in the Pelleg and Moore paper.
-
-              This following code is equivalent to, but faster than:
-
-              arma::vec p;
-              p.zeros(dimensionality);
-
-              for (size_t k = 0; k < dimensionality; ++k)
-              {
-                p(k) = (centroids(k,i) > centroids(k,minIndex)) ?
-                  bound[k].Hi() : bound[k].Lo();
-              }
-
-              double distancei = metric.Evaluate(p.col(0), centroids.col(i));
-              double distanceMin = metric.Evaluate(p.col(0),
-                  centroids.col(minIndex));
-            */
-
-            comps += 1;
-            double distancei = 0.0;
-            double distanceMin = 0.0;
-            for (size_t k = 0; k < dimensionality; ++k)
-            {
-              double ci = centroids(k, i);
-              double cm = centroids(k, minIndex);
-              if (ci > cm)
-              {
-                double hi = bound[k].Hi();
-
-                ci -= hi;
-                cm -= hi;
-
-                ci *= ci;
-                cm *= cm;
-
-                distancei += ci;
-                distanceMin += cm;
-              }
-              else
-              {
-                double lo = bound[k].Lo();
-
-                ci -= lo;
-                cm -= lo;
-
-                ci *= ci;
-                cm *= cm;
-
-                distancei += ci;
-                distanceMin += cm;
-              }
-            }
-
-            if (distanceMin >= distancei)
-            {
-              noDomination = true;
-              break;
-            }
-            else
-            {
-              mrkd.Whitelist()[i] = false;
-            }
-          }
-        }
-
-        // If did found a centroid that was closer to every point in the
-        // hyperrectangle than every other centroid, then update that centroid.
-        if (!noDomination)
-        {
-          // Adjust the new centroid sum for the min distance point to this
-          // hyperrectangle by the center of mass of this hyperrectangle.
-          newCentroids.col(minIndex) += mrkd.CenterOfMass();
-
-          // Increment the counts for this centroid.
-          counts(minIndex) += mrkd.Count();
-
-          // Update all assignments for this node.
-          const size_t begin = node->Begin();
-          const size_t end = node->End();
-
-          // TODO: Do this outside of the kmeans iterations.
-          for (size_t j = begin; j < end; ++j)
-          {
-            if (assignments(j) != minIndex)
-            {
-              ++changedAssignments;
-              assignments(j) = minIndex;
-            }
-          }
-          mrkd.DominatingCentroid() = minIndex;
-
-          // Keep track of the number of times we found a dominating centroid.
-          ++dominations;
-        }
-
-        // If we did not find a dominating centroid then we fall through to the
-        // default case, where we add the children of this node to the stack.
-        else
-        {
-          // Add this hyperrectangle's children to our stack.
-          stack.push(node->Left());
-          stack.push(node->Right());
-
-          // (Re)Initialize the whiteList for the children.
-          node->Left()->Stat().Whitelist() = mrkd.Whitelist();
-          node->Right()->Stat().Whitelist() = mrkd.Whitelist();
-        }
-      }
-
-    }
-
-    // Divide by the number of points assigned to the centroids so that we
-    // have the actual center of mass and update centroids' positions.
-    for (size_t i = 0; i < centroids.n_cols; ++i)
-      if (counts(i))
-        centroids.col(i) = newCentroids.col(i) / counts(i);
-
-    // Stop when we reach max iterations or we changed no assignments
-    // assignments.
-  } while (changedAssignments > 0 && iteration != maxIterations);
-
-  Log::Info << "Iterations: " << iteration << std::endl
-      << "Skips: " << skip << std::endl
-      << "Comparisons: " << comps << std::endl
-      << "Dominations: " << dominations << std::endl;
+  MatType centroids;
+  kmeans.Cluster(data, clusters, assignments, centroids);
 }
 
 /**
@@ -490,12 +86,14 @@ FastCluster(MatType& data,
  */
 template<typename MetricType,
          typename InitialPartitionPolicy,
-         typename EmptyClusterPolicy>
+         typename EmptyClusterPolicy,
+         typename AssignmentPolicy>
 template<typename MatType>
 inline void KMeans<
     MetricType,
     InitialPartitionPolicy,
-    EmptyClusterPolicy>::
+    EmptyClusterPolicy,
+    AssignmentPolicy>::
 Cluster(const MatType& data,
         const size_t clusters,
         arma::Col<size_t>& assignments,
@@ -511,12 +109,14 @@ Cluster(const MatType& data,
  */
 template<typename MetricType,
          typename InitialPartitionPolicy,
-         typename EmptyClusterPolicy>
+         typename EmptyClusterPolicy,
+         typename AssignmentPolicy>
 template<typename MatType>
 void KMeans<
     MetricType,
     InitialPartitionPolicy,
-    EmptyClusterPolicy>::
+    EmptyClusterPolicy,
+    AssignmentPolicy>::
 Cluster(const MatType& data,
         const size_t clusters,
         arma::Col<size_t>& assignments,
@@ -599,52 +199,23 @@ Cluster(const MatType& data,
   for (size_t i = 0; i < assignments.n_elem; i++)
     counts[assignments[i]]++;
 
+  // The assignment policy may keep state between iterations, so it gets a
+  // fresh copy for each clustering.
+  AssignmentPolicy assignmentStep(assigner);
+
   size_t changedAssignments = 0;
   size_t iteration = 0;
   do
   {
     // Update step.
     // Calculate centroids based on given assignments.
-    centroids.zeros();
-
-    for (size_t i = 0; i < data.n_cols; i++)
-      centroids.col(assignments[i]) += data.col(i);
-
-    for (size_t i = 0; i < actualClusters; i++)
-      centroids.col(i) /= counts[i];
+    UpdateCentroids(data, assignments, counts, centroids);
 
     // Assignment step.
     // Find the closest centroid to each point.  We will keep track of how many
     // assignments change.  When no assignments change, we are done.
-    changedAssignments = 0;
-    for (size_t i = 0; i < data.n_cols; i++)
-    {
-      // Find the closest centroid to this point.
-      double minDistance = std::numeric_limits<double>::infinity();
-      size_t closestCluster = actualClusters; // Invalid value.
-
-      for (size_t j = 0; j < actualClusters; j++)
-      {
-        double distance = metric.Evaluate(data.col(i), centroids.col(j));
-
-        if (distance < minDistance)
-        {
-          minDistance = distance;
-          closestCluster = j;
-        }
-      }
-
-      // Reassign this point to the closest cluster.
-      if (assignments[i] != closestCluster)
-      {
-        // Update counts.
-        counts[assignments[i]]--;
-        counts[closestCluster]++;
-        // Update assignment.
-        assignments[i] = closestCluster;
-        changedAssignments++;
-      }
-    }
+    changedAssignments = assignmentStep.Assign(data, centroids, metric,
+        assignments, counts);
 
     // If we are not allowing empty clusters, then check that all of our
     // clusters have points.
@@ -668,13 +239,7 @@ Cluster(const MatType& data,
         << " iterations." << std::endl;
 
     // Recalculate final clusters.
-    centroids.zeros();
-
-    for (size_t i = 0; i < data.n_cols; i++)
-      centroids.col(assignments[i]) += data.col(i);
-
-    for (size_t i = 0; i < actualClusters; i++)
-      centroids.col(i) /= counts[i];
+    UpdateCentroids(data, assignments, counts, centroids);
   }
 
   // If we have overclustered, we need to merge the nearest clusters.
@@ -803,5 +368,68 @@ Cluster(const MatType& data,
   }
 }
 
+/**
+ * Calculate the centroid of each cluster from the given assignments.  The
+ * points are split into shards, each shard is summed into its own matrix (in
+ * parallel, if OpenMP is available), and then the sums of the shards are added
+ * together.  The shards depend only on the number of points, so the result is
+ * the same no matter how many threads are used.
+ */
+template<typename MetricType,
+         typename InitialPartitionPolicy,
+         typename EmptyClusterPolicy,
+         typename AssignmentPolicy>
+template<typename MatType>
+void KMeans<
+    MetricType,
+    InitialPartitionPolicy,
+    EmptyClusterPolicy,
+    AssignmentPolicy>::
+UpdateCentroids(const MatType& data,
+                const arma::Col<size_t>& assignments,
+                const arma::Col<size_t>& counts,
+                MatType& centroids) const
+{
+  // Small datasets are summed in one shard, in the order of the points.  Each
+  // extra shard needs its own copy of the centroids, so there are at most 32.
+  // Writing to the columns of a sparse matrix may reallocate all of its
+  // storage, so the shared sparse centroids can't be written by several threads
+  // at once; sparse data is always summed in one shard.
+#ifdef ARMA_HAS_SPMAT
+  const bool sparse = arma::is_SpMat<MatType>::value;
+#else
+  const bool sparse = false;
+#endif
+  const size_t shards = sparse ? 1 :
+      std::min((size_t) 32, (data.n_cols + 4095) / 4096);
+
+  // The first shard is summed directly into the centroids.
+  std::vector<MatType> shardSums((shards > 1) ? (shards - 1) : 0);
+  centroids.zeros();
+
+  #pragma omp parallel for schedule(static) if (shards > 1)
+  for (size_t s = 0; s < shards; ++s)
+  {
+    MatType& sums = (s == 0) ? centroids : shardSums[s - 1];
+    if (s > 0)
+      sums.zeros(centroids.n_rows, centroids.n_cols);
+
+    const size_t begin = (s * data.n_cols) / shards;
+    const size_t end = ((s + 1) * data.n_cols) / shards;
+    for (size_t i = begin; i < end; i++)
+      sums.col(assignments[i]) += data.col(i);
+  }
+
+  // Add the shards in order, so that the sums are deterministic.
+  #pragma omp parallel for schedule(static) if (shards > 1)
+  for (size_t i = 0; i < centroids.n_cols; i++)
+  {
+    for (size_t s = 1; s < shards; ++s)
+      centroids.col(i) += shardSums[s - 1].col(i);
+
+    centroids.col(i) /= counts[i];
+  }
+}
+
 }; // namespace kmeans
 }; // namespace mlpack
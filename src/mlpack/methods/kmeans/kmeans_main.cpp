@@ -9,6 +9,17 @@
 #include "kmeans.hpp"
 #include "allow_empty_clusters.hpp"
 #include "refined_start.hpp"
+#include "kmeans_plus_plus.hpp"
+#include "kmeans_parallel.hpp"
+#include "elkan_assignment.hpp"
+#include "hamerly_assignment.hpp"
+#include "yinyang_assignment.hpp"
+#include "dual_tree_assignment.hpp"
+#include "mini_batch_kmeans.hpp"
+
+#ifdef HAS_OPENMP
+  #include <omp.h>
+#endif
 
 using namespace mlpack;
 using namespace mlpack::kmeans;
@@ -28,7 +39,40 @@ PROGRAM_INFO("K-Means Clustering", "This program performs K-Means clustering "
     " random samples of the dataset; to specify the number of samples, the "
     "--samples parameter is used, and to specify the percentage of the dataset "
     "to be used in each sample, the --percentage parameter is used (it should "
-    "be a value between 0.0 and 1.0).\n");
+    "be a value between 0.0 and 1.0)."
+    "\n\n"
+    "The initial points can also be chosen with the k-means++ seeding (Arthur "
+    "and Vassilvitskii, 2007) by specifying --kmeans_plus_plus (-k), or with "
+    "its scalable variant k-means|| (Bahmani et al., 2012) by specifying "
+    "--kmeans_parallel (-K).  k-means|| makes --rounds (-R) passes over the "
+    "dataset, each sampling about (--oversampling (-L) * clusters) points, "
+    "instead of one pass for each cluster, so it is much faster for a large "
+    "number of clusters."
+    "\n\n"
+    "The assignment step of each iteration can be accelerated with the "
+    "triangle inequality by specifying the --algorithm (-a) option: 'elkan' "
+    "keeps a bound for every point and cluster, 'hamerly' keeps two bounds for "
+    "every point, and 'yinyang' keeps a bound for every point and group of "
+    "clusters (the number of groups is given by --groups).  The 'dualtree' "
+    "algorithm instead builds a kd-tree on the points and one on the centroids,"
+    " and assigns whole nodes of points to a centroid at once (as in the "
+    "Pelleg-Moore algorithm); the size of the leaves of the tree on the points "
+    "is given by --leaf_size.  All algorithms give the same results as the "
+    "default, 'naive'."
+    "\n\n"
+    "If mlpack was built with OpenMP, each iteration is run in parallel; the "
+    "number of threads can be set with --threads (-t).  The results do not "
+    "depend on the number of threads."
+    "\n\n"
+    "For datasets too large to fit in memory, mini-batch k-means (Sculley, "
+    "\"Web-scale k-means clustering\", 2010) can be used by specifying the "
+    "size of each batch with --mini_batch_size (-b).  The input file (which "
+    "must be a CSV or raw ASCII file) is then read --passes (-n) times in "
+    "batches, and once more to assign each point to a cluster; the whole "
+    "dataset is never held in memory.  The points in the file should be in "
+    "random order.  --max_iterations, --overclustering, --algorithm, and "
+    "--in_place are not used in this mode, and neither are the initial point "
+    "strategies.\n");
 
 // Required options.
 PARAM_STRING_REQ("inputFile", "Input dataset to perform clustering on.", "i");
@@ -55,9 +99,22 @@ PARAM_INT("seed", "Random seed.  If 0, 'std::time(NULL)' is used.", "s", 0);
 PARAM_STRING("initial_centroids", "Start with the specified initial centroids.",
              "I", "");
 
-// This is known to not work (#251).
-//PARAM_FLAG("fast_kmeans", "Use the experimental fast k-means algorithm by "
-//    "Pelleg and Moore.", "f");
+// Assignment step options.
+PARAM_STRING("algorithm", "Algorithm to use for the assignment step; 'naive', "
+    "'elkan', 'hamerly', 'yinyang', or 'dualtree'.", "a", "naive");
+PARAM_INT("groups", "Number of groups of clusters for the 'yinyang' algorithm "
+    "(0 uses one group for every ten clusters).", "g", 0);
+PARAM_INT("leaf_size", "Leaf size of the tree on the points for the 'dualtree' "
+    "algorithm.", "z", 20);
+
+// Mini-batch k-means options.
+PARAM_INT("mini_batch_size", "If nonzero, use mini-batch k-means with batches "
+    "of this many points, reading the input file in batches.", "b", 0);
+PARAM_INT("passes", "Number of passes over the input file for mini-batch "
+    "k-means (use when --mini_batch_size is specified).", "n", 1);
+
+PARAM_INT("threads", "Number of threads to use (0 uses the OpenMP default).",
+    "t", 0);
 
 // Parameters for "refined start" k-means.
 PARAM_FLAG("refined_start", "Use the refined initial point strategy by Bradley "
@@ -67,6 +124,146 @@ PARAM_INT("samplings", "Number of samplings to perform for refined start (use "
 PARAM_DOUBLE("percentage", "Percentage of dataset to use for each refined start"
     " sampling (use when --refined_start is specified).", "p", 0.02);
 
+// Parameters for k-means++ and k-means|| initialization.
+PARAM_FLAG("kmeans_plus_plus", "Use the k-means++ seeding to choose initial "
+    "points.", "k");
+PARAM_FLAG("kmeans_parallel", "Use the k-means|| seeding to choose initial "
+    "points.", "K");
+PARAM_INT("rounds", "Number of sampling rounds for k-means|| (use when "
+    "--kmeans_parallel is specified).", "R", 5);
+PARAM_DOUBLE("oversampling", "Expected number of points sampled in each "
+    "k-means|| round, as a multiple of the number of clusters (use when "
+    "--kmeans_parallel is specified).", "L", 2.0);
+
+
+// Run k-means with the given policies.  This is called by the RunKMeans()
+// below, once the assignment policy is known.
+template<typename InitialPartitionPolicy,
+         typename EmptyClusterPolicy,
+         typename AssignmentPolicy>
+void RunKMeans(const InitialPartitionPolicy& partitioner,
+               const AssignmentPolicy& assigner,
+               const arma::mat& dataset,
+               const size_t clusters,
+               arma::Col<size_t>& assignments,
+               arma::mat& centroids,
+               const bool initialCentroidGuess)
+{
+  KMeans<metric::SquaredEuclideanDistance, InitialPartitionPolicy,
+      EmptyClusterPolicy, AssignmentPolicy> k(
+      (size_t) CLI::GetParam<int>("max_iterations"),
+      CLI::GetParam<double>("overclustering"),
+      metric::SquaredEuclideanDistance(), partitioner, EmptyClusterPolicy(),
+      assigner);
+
+  Timer::Start("clustering");
+  k.Cluster(dataset, clusters, assignments, centroids, false,
+      initialCentroidGuess);
+  Timer::Stop("clustering");
+}
+
+// Run k-means with the given policies and the assignment policy given by
+// --algorithm.
+template<typename InitialPartitionPolicy, typename EmptyClusterPolicy>
+void RunKMeans(const InitialPartitionPolicy& partitioner,
+               const arma::mat& dataset,
+               const size_t clusters,
+               arma::Col<size_t>& assignments,
+               arma::mat& centroids,
+               const bool initialCentroidGuess)
+{
+  const string algorithm = CLI::GetParam<string>("algorithm");
+  if (algorithm == "elkan")
+    RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy>(partitioner,
+        ElkanAssignment(), dataset, clusters, assignments, centroids,
+        initialCentroidGuess);
+  else if (algorithm == "hamerly")
+    RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy>(partitioner,
+        HamerlyAssignment(), dataset, clusters, assignments, centroids,
+        initialCentroidGuess);
+  else if (algorithm == "yinyang")
+    RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy>(partitioner,
+        YinyangAssignment((size_t) CLI::GetParam<int>("groups")), dataset,
+        clusters, assignments, centroids, initialCentroidGuess);
+  else if (algorithm == "dualtree")
+    RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy>(partitioner,
+        DualTreeAssignment((size_t) CLI::GetParam<int>("leaf_size")), dataset,
+        clusters, assignments, centroids, initialCentroidGuess);
+  else
+    RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy>(partitioner,
+        NaiveAssignment(), dataset, clusters, assignments, centroids,
+        initialCentroidGuess);
+}
+
+// Run mini-batch k-means on the input file, and then assign every point of the
+// input file to its closest centroid, in batches, writing the results as they
+// are computed.
+template<typename EmptyClusterPolicy>
+void RunMiniBatchKMeans(const string& inputFile,
+                        const size_t batchSize,
+                        const size_t clusters,
+                        arma::mat& centroids,
+                        const bool initialCentroidGuess)
+{
+  MiniBatchKMeans<metric::SquaredEuclideanDistance, EmptyClusterPolicy>
+      k(batchSize);
+
+  Timer::Start("clustering");
+  k.Cluster(inputFile, clusters, centroids,
+      (size_t) CLI::GetParam<int>("passes"), initialCentroidGuess);
+  Timer::Stop("clustering");
+
+  const bool labelsOnly = CLI::HasParam("labels_only");
+  data::ChunkedLoader loader(inputFile);
+  data::ChunkedSaver saver(CLI::GetParam<string>("output_file"));
+
+  Timer::Start("assignment");
+  arma::mat batch;
+  arma::Col<size_t> assignments;
+  arma::Col<size_t> counts(clusters);
+  metric::SquaredEuclideanDistance distance;
+  while (loader.LoadChunk(batch, batchSize))
+  {
+    assignments.set_size(batch.n_cols);
+    assignments.fill(clusters);
+    NaiveAssignment::Assign(batch, centroids, distance, assignments, counts);
+
+    if (labelsOnly)
+    {
+      const arma::Mat<size_t> output = trans(assignments);
+      saver.SaveChunk(output);
+    }
+    else
+    {
+      // Convert the assignments to doubles.
+      arma::vec converted(assignments.n_elem);
+      for (size_t i = 0; i < assignments.n_elem; i++)
+        converted(i) = (double) assignments(i);
+
+      batch.insert_rows(batch.n_rows, trans(converted));
+      saver.SaveChunk(batch);
+    }
+  }
+  Timer::Stop("assignment");
+}
+
+// Run k-means with the given initial partition policy and the empty cluster
+// policy given by --allow_empty_clusters.
+template<typename InitialPartitionPolicy>
+void RunKMeans(const InitialPartitionPolicy& partitioner,
+               const arma::mat& dataset,
+               const size_t clusters,
+               arma::Col<size_t>& assignments,
+               arma::mat& centroids,
+               const bool initialCentroidGuess)
+{
+  if (CLI::HasParam("allow_empty_clusters"))
+    RunKMeans<InitialPartitionPolicy, AllowEmptyClusters>(partitioner, dataset,
+        clusters, assignments, centroids, initialCentroidGuess);
+  else
+    RunKMeans<InitialPartitionPolicy, MaxVarianceNewCluster>(partitioner,
+        dataset, clusters, assignments, centroids, initialCentroidGuess);
+}
 
 int main(int argc, char** argv)
 {
@@ -108,12 +305,64 @@ int main(int argc, char** argv)
         << endl;
   }
 
-  // Load our dataset.
-  arma::mat dataset;
-  data::Load(inputFile, dataset, true); // Fatal upon failure.
+  const string algorithm = CLI::GetParam<string>("algorithm");
+  if (algorithm != "naive" && algorithm != "elkan" && algorithm != "hamerly" &&
+      algorithm != "yinyang" && algorithm != "dualtree")
+  {
+    Log::Fatal << "Invalid algorithm '" << algorithm << "'; must be 'naive', "
+        << "'elkan', 'hamerly', 'yinyang', or 'dualtree'." << endl;
+  }
+
+  if (CLI::GetParam<int>("leaf_size") < 1)
+  {
+    Log::Fatal << "Invalid leaf size (" << CLI::GetParam<int>("leaf_size")
+        << ")! Must be greater than or equal to 1." << endl;
+  }
+
+  if (CLI::GetParam<int>("groups") < 0)
+  {
+    Log::Fatal << "Invalid number of groups (" << CLI::GetParam<int>("groups")
+        << ")! Must be greater than or equal to 0." << endl;
+  }
+
+  const int threads = CLI::GetParam<int>("threads");
+  if (threads < 0)
+  {
+    Log::Fatal << "Invalid number of threads (" << threads << ")! Must be "
+        << "greater than or equal to 0." << endl;
+  }
+
+  const int miniBatchSize = CLI::GetParam<int>("mini_batch_size");
+  if (miniBatchSize < 0)
+  {
+    Log::Fatal << "Invalid mini-batch size (" << miniBatchSize << ")! Must be "
+        << "greater than or equal to 0." << endl;
+  }
+
+  if (miniBatchSize > 0)
+  {
+    if (CLI::GetParam<int>("passes") < 1)
+      Log::Fatal << "Invalid number of passes (" << CLI::GetParam<int>("passes")
+          << ")! Must be greater than or equal to 1." << endl;
+    if (CLI::HasParam("in_place"))
+      Log::Fatal << "--in_place cannot be used with --mini_batch_size." << endl;
+    if (CLI::HasParam("refined_start") || CLI::HasParam("kmeans_plus_plus") ||
+        CLI::HasParam("kmeans_parallel"))
+      Log::Fatal << "--refined_start, --kmeans_plus_plus, and "
+          << "--kmeans_parallel cannot be used with --mini_batch_size." << endl;
+    if (overclustering != 1.0)
+      Log::Fatal << "--overclustering cannot be used with --mini_batch_size."
+          << endl;
+  }
+
+#ifdef HAS_OPENMP
+  if (threads > 0)
+    omp_set_num_threads(threads);
+#else
+  if (threads > 1)
+    Log::Warn << "OpenMP is not available; --threads is ignored." << endl;
+#endif
 
-  // Now create the KMeans object.  Because we could be using different types,
-  // it gets a little weird...
   arma::Col<size_t> assignments;
   arma::mat centroids;
 
@@ -127,87 +376,79 @@ int main(int argc, char** argv)
     if (CLI::HasParam("refined_start"))
       Log::Warn << "Initial centroids are specified, but will be ignored "
           << "because --refined_start is also specified!" << endl;
+    else if (CLI::HasParam("kmeans_plus_plus"))
+      Log::Warn << "Initial centroids are specified, but will be ignored "
+          << "because --kmeans_plus_plus is also specified!" << endl;
+    else if (CLI::HasParam("kmeans_parallel"))
+      Log::Warn << "Initial centroids are specified, but will be ignored "
+          << "because --kmeans_parallel is also specified!" << endl;
     else
       Log::Info << "Using initial centroid guesses from '" <<
           initialCentroidsFile << "'." << endl;
   }
 
-  if (CLI::HasParam("allow_empty_clusters"))
+  // Mini-batch k-means reads the dataset itself, in batches.
+  if (miniBatchSize > 0)
   {
-    if (CLI::HasParam("refined_start"))
-    {
-      const int samplings = CLI::GetParam<int>("samplings");
-      const double percentage = CLI::GetParam<int>("percentage");
-
-      if (samplings < 0)
-        Log::Fatal << "Number of samplings (" << samplings << ") must be "
-            << "greater than 0!" << endl;
-      if (percentage <= 0.0 || percentage > 1.0)
-        Log::Fatal << "Percentage for sampling (" << percentage << ") must be "
-            << "greater than 0.0 and less than or equal to 1.0!" << endl;
-
-      KMeans<metric::SquaredEuclideanDistance, RefinedStart, AllowEmptyClusters>
-          k(maxIterations, overclustering, metric::SquaredEuclideanDistance(),
-          RefinedStart(samplings, percentage));
-
-      Timer::Start("clustering");
-//      if (CLI::HasParam("fast_kmeans"))
-//        k.FastCluster(dataset, clusters, assignments);
-//      else
-      k.Cluster(dataset, clusters, assignments, centroids);
-      Timer::Stop("clustering");
-    }
+    if (CLI::HasParam("allow_empty_clusters"))
+      RunMiniBatchKMeans<AllowEmptyClusters>(inputFile, (size_t) miniBatchSize,
+          clusters, centroids, initialCentroidGuess);
     else
-    {
-      KMeans<metric::SquaredEuclideanDistance, RandomPartition,
-          AllowEmptyClusters> k(maxIterations, overclustering);
-
-      Timer::Start("clustering");
-//      if (CLI::HasParam("fast_kmeans"))
-//        k.FastCluster(dataset, clusters, assignments);
-//      else
-      k.Cluster(dataset, clusters, assignments, centroids, false,
-          initialCentroidGuess);
-      Timer::Stop("clustering");
-    }
+      RunMiniBatchKMeans<MaxVarianceNewCluster>(inputFile,
+          (size_t) miniBatchSize, clusters, centroids, initialCentroidGuess);
+
+    if (CLI::HasParam("centroid_file"))
+      data::Save(CLI::GetParam<std::string>("centroid_file"), centroids);
+
+    return 0;
+  }
+
+  // Load our dataset.
+  arma::mat dataset;
+  data::Load(inputFile, dataset, true); // Fatal upon failure.
+
+  // Now run k-means.  Because we could be using different types, the KMeans
+  // object is created by RunKMeans() below.
+
+  if (CLI::HasParam("refined_start"))
+  {
+    const int samplings = CLI::GetParam<int>("samplings");
+    const double percentage = CLI::GetParam<double>("percentage");
+
+    if (samplings < 0)
+      Log::Fatal << "Number of samplings (" << samplings << ") must be "
+          << "greater than 0!" << endl;
+    if (percentage <= 0.0 || percentage > 1.0)
+      Log::Fatal << "Percentage for sampling (" << percentage << ") must be "
+          << "greater than 0.0 and less than or equal to 1.0!" << endl;
+
+    RunKMeans(RefinedStart(samplings, percentage), dataset, clusters,
+        assignments, centroids, false);
+  }
+  else if (CLI::HasParam("kmeans_plus_plus"))
+  {
+    RunKMeans(KMeansPlusPlus(), dataset, clusters, assignments, centroids,
+        false);
+  }
+  else if (CLI::HasParam("kmeans_parallel"))
+  {
+    const int rounds = CLI::GetParam<int>("rounds");
+    const double oversampling = CLI::GetParam<double>("oversampling");
+
+    if (rounds < 0)
+      Log::Fatal << "Number of rounds (" << rounds << ") must be greater than "
+          << "or equal to 0!" << endl;
+    if (oversampling <= 0.0)
+      Log::Fatal << "Oversampling factor (" << oversampling << ") must be "
+          << "greater than 0.0!" << endl;
+
+    RunKMeans(KMeansParallel(rounds, oversampling), dataset, clusters,
+        assignments, centroids, false);
   }
   else
   {
-    if (CLI::HasParam("refined_start"))
-    {
-      const int samplings = CLI::GetParam<int>("samplings");
-      const double percentage = CLI::GetParam<int>("percentage");
-
-      if (samplings < 0)
-        Log::Fatal << "Number of samplings (" << samplings << ") must be "
-            << "greater than 0!" << endl;
-      if (percentage <= 0.0 || percentage > 1.0)
-        Log::Fatal << "Percentage for sampling (" << percentage << ") must be "
-            << "greater than 0.0 and less than or equal to 1.0!" << endl;
-
-      KMeans<metric::SquaredEuclideanDistance, RefinedStart, AllowEmptyClusters>
-          k(maxIterations, overclustering, metric::SquaredEuclideanDistance(),
-          RefinedStart(samplings, percentage));
-
-      Timer::Start("clustering");
-//      if (CLI::HasParam("fast_kmeans"))
-//        k.FastCluster(dataset, clusters, assignments);
-//      else
-        k.Cluster(dataset, clusters, assignments, centroids);
-      Timer::Stop("clustering");
-    }
-    else
-    {
-      KMeans<> k(maxIterations, overclustering);
-
-      Timer::Start("clustering");
-//      if (CLI::HasParam("fast_kmeans"))
-//        k.FastCluster(dataset, clusters, assignments);
-//      else
-        k.Cluster(dataset, clusters, assignments, centroids, false,
-            initialCentroidGuess);
-      Timer::Stop("clustering");
-    }
+    RunKMeans(RandomPartition(), dataset, clusters, assignments, centroids,
+        initialCentroidGuess);
   }
 
   // Now figure out what to do with our results.
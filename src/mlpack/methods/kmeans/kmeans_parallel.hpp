@@ -0,0 +1,108 @@
+/**
+ * @file kmeans_parallel.hpp
+ * @author Ryan Curtin
+ *
+ * An InitialPartitionPolicy for K-Means which chooses the initial centroids
+ * with the k-means|| (scalable k-means++) seeding of Bahmani et al.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_KMEANS_PARALLEL_HPP
+#define __MLPACK_METHODS_KMEANS_KMEANS_PARALLEL_HPP
+
+#include <mlpack/core.hpp>
+
+#include "kmeans_plus_plus.hpp"
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * The k-means|| seeding.  KMeansPlusPlus chooses one centroid per pass over
+ * the dataset, which is slow for large k.  Instead, k-means|| starts from one
+ * random point and, in each of a few rounds, samples about (oversampling * k)
+ * points, each independently with probability proportional to its squared
+ * distance to the closest point sampled so far.  Each sampled point is weighted
+ * by the number of points closest to it, and KMeansPlusPlus chooses the k
+ * centroids from the weighted sample.  Each point is then assigned to its
+ * closest centroid.  This is the algorithm from the following paper:
+ *
+ * @article{bahmani2012scalable,
+ *   title={Scalable k-means++},
+ *   author={Bahmani, Bahman and Moseley, Benjamin and Vattani, Andrea and
+ *       Kumar, Ravi and Vassilvitskii, Sergei},
+ *   journal={Proceedings of the VLDB Endowment},
+ *   volume={5},
+ *   number={7},
+ *   pages={622--633},
+ *   year={2012}
+ * }
+ *
+ * The distance computations of each round are split between threads if OpenMP
+ * is available.  The random draws are made by one thread, so the result only
+ * depends on the random seed.
+ */
+class KMeansParallel
+{
+ public:
+  /**
+   * Create the KMeansParallel object, optionally specifying the number of
+   * sampling rounds and the oversampling factor.  The paper finds that five
+   * rounds with an oversampling factor of 2 are as good as k-means++.
+   *
+   * @param rounds Number of sampling rounds.
+   * @param oversampling Expected number of points sampled in each round, as a
+   *     multiple of the number of clusters.
+   */
+  KMeansParallel(const size_t rounds = 5,
+                 const double oversampling = 2.0) :
+      rounds(rounds), oversampling(oversampling) { }
+
+  /**
+   * Partition the given dataset into the given number of clusters with the
+   * k-means|| seeding.
+   *
+   * @tparam MatType Type of data (arma::mat or arma::sp_mat).
+   * @param data Dataset to partition.
+   * @param clusters Number of clusters to split dataset into.
+   * @param assignments Vector to store cluster assignments into.  Values will
+   *     be between 0 and (clusters - 1).
+   */
+  template<typename MatType>
+  void Cluster(const MatType& data,
+               const size_t clusters,
+               arma::Col<size_t>& assignments) const;
+
+  //! Get the number of sampling rounds.
+  size_t Rounds() const { return rounds; }
+  //! Modify the number of sampling rounds.
+  size_t& Rounds() { return rounds; }
+
+  //! Get the oversampling factor.
+  double Oversampling() const { return oversampling; }
+  //! Modify the oversampling factor.
+  double& Oversampling() { return oversampling; }
+
+ private:
+  //! The number of sampling rounds.
+  size_t rounds;
+  //! The expected number of points sampled in each round, per cluster.
+  double oversampling;
+
+  /**
+   * Update the distance from each point to its closest candidate, and the
+   * index of that candidate, with the candidates from the given index on.
+   */
+  template<typename MatType>
+  static void UpdateDistances(const MatType& data,
+                              const std::vector<size_t>& candidates,
+                              const size_t firstNew,
+                              arma::vec& minDistances,
+                              arma::Col<size_t>& closest);
+};
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+// Include implementation.
+#include "kmeans_parallel_impl.hpp"
+
+#endif
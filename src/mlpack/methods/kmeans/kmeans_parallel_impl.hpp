@@ -0,0 +1,148 @@
+/**
+ * @file kmeans_parallel_impl.hpp
+ * @author Ryan Curtin
+ *
+ * Implementation of the KMeansParallel class.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_KMEANS_PARALLEL_IMPL_HPP
+#define __MLPACK_METHODS_KMEANS_KMEANS_PARALLEL_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "kmeans_parallel.hpp"
+
+#include <mlpack/core/metrics/lmetric.hpp>
+
+namespace mlpack {
+namespace kmeans {
+
+template<typename MatType>
+void KMeansParallel::Cluster(const MatType& data,
+                             const size_t clusters,
+                             arma::Col<size_t>& assignments) const
+{
+  if (clusters > data.n_cols)
+    Log::Fatal << "KMeansParallel::Cluster(): more clusters requested ("
+        << clusters << ") than points given (" << data.n_cols << ")!"
+        << std::endl;
+
+  arma::vec minDistances(data.n_cols);
+  minDistances.fill(std::numeric_limits<double>::infinity());
+  arma::Col<size_t> closest(data.n_cols);
+
+  // Start with one random point.
+  std::vector<size_t> candidates;
+  candidates.push_back(std::min((size_t) (math::Random() * data.n_cols),
+      (size_t) data.n_cols - 1));
+  UpdateDistances(data, candidates, 0, minDistances, closest);
+
+  const double expected = oversampling * clusters;
+  for (size_t round = 0; round < rounds; ++round)
+  {
+    const double cost = arma::accu(minDistances);
+    if (cost == 0.0)
+      break; // Every point is a candidate (or a copy of one).
+
+    // A point which is already a candidate has distance 0, so it is never
+    // sampled again.
+    const size_t firstNew = candidates.size();
+    for (size_t i = 0; i < data.n_cols; ++i)
+      if (math::Random() * cost < expected * minDistances[i])
+        candidates.push_back(i);
+
+    UpdateDistances(data, candidates, firstNew, minDistances, closest);
+  }
+
+  // If too few points were sampled (because there are few distinct points),
+  // add random points which aren't candidates yet.
+  if (candidates.size() < clusters)
+  {
+    std::vector<bool> used(data.n_cols, false);
+    for (size_t j = 0; j < candidates.size(); ++j)
+      used[candidates[j]] = true;
+
+    const size_t firstNew = candidates.size();
+    while (candidates.size() < clusters)
+    {
+      const size_t point = (size_t) math::RandInt(data.n_cols);
+      if (!used[point])
+      {
+        used[point] = true;
+        candidates.push_back(point);
+      }
+    }
+
+    UpdateDistances(data, candidates, firstNew, minDistances, closest);
+  }
+
+  Log::Debug << "KMeansParallel::Cluster(): sampled " << candidates.size()
+      << " candidates." << std::endl;
+
+  // Weight each candidate by the number of points closest to it, and choose
+  // the centroids from the candidates with k-means++.
+  MatType candidateData(data.n_rows, candidates.size());
+  arma::vec weights(candidates.size());
+  weights.zeros();
+  for (size_t j = 0; j < candidates.size(); ++j)
+    candidateData.col(j) = data.col(candidates[j]);
+  for (size_t i = 0; i < data.n_cols; ++i)
+    ++weights[closest[i]];
+
+  arma::Col<size_t> centers;
+  arma::Col<size_t> candidateAssignments;
+  KMeansPlusPlus::Seed(candidateData, weights, clusters, centers,
+      candidateAssignments);
+
+  // Now assign each point to its closest centroid.
+  assignments.set_size(data.n_cols);
+  #pragma omp parallel for schedule(static)
+  for (size_t i = 0; i < data.n_cols; ++i)
+  {
+    double minDistance = std::numeric_limits<double>::infinity();
+    size_t closestCluster = clusters; // Invalid value.
+
+    for (size_t c = 0; c < clusters; ++c)
+    {
+      const double distance = metric::SquaredEuclideanDistance::Evaluate(
+          data.col(i), candidateData.col(centers[c]));
+
+      if (distance < minDistance)
+      {
+        minDistance = distance;
+        closestCluster = c;
+      }
+    }
+
+    assignments[i] = closestCluster;
+  }
+}
+
+template<typename MatType>
+void KMeansParallel::UpdateDistances(const MatType& data,
+                                     const std::vector<size_t>& candidates,
+                                     const size_t firstNew,
+                                     arma::vec& minDistances,
+                                     arma::Col<size_t>& closest)
+{
+  // Each point is handled independently, so the points can be split between
+  // threads.
+  #pragma omp parallel for schedule(static)
+  for (size_t i = 0; i < data.n_cols; ++i)
+  {
+    for (size_t j = firstNew; j < candidates.size(); ++j)
+    {
+      const double distance = metric::SquaredEuclideanDistance::Evaluate(
+          data.col(i), data.col(candidates[j]));
+
+      if (distance < minDistances[i])
+      {
+        minDistances[i] = distance;
+        closest[i] = j;
+      }
+    }
+  }
+}
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,102 @@
+/**
+ * @file kmeans_plus_plus.hpp
+ * @author Ryan Curtin
+ *
+ * An InitialPartitionPolicy for K-Means which chooses the initial centroids
+ * with the k-means++ seeding of Arthur and Vassilvitskii.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_KMEANS_PLUS_PLUS_HPP
+#define __MLPACK_METHODS_KMEANS_KMEANS_PLUS_PLUS_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * The k-means++ seeding: the first centroid is a random point of the dataset,
+ * and each following centroid is a point chosen with probability proportional
+ * to its squared distance to the closest centroid chosen so far.  Each point is
+ * then assigned to its closest centroid.  The expected cost of the resulting
+ * clustering is within O(log k) of the optimal clustering, and Lloyd's
+ * algorithm usually converges in far fewer iterations than from a random
+ * partition.  This is the algorithm from the following paper:
+ *
+ * @inproceedings{arthur2007kmeans,
+ *   title={k-means++: The advantages of careful seeding},
+ *   author={Arthur, David and Vassilvitskii, Sergei},
+ *   booktitle={Proceedings of the Eighteenth Annual ACM-SIAM Symposium on
+ *       Discrete Algorithms (SODA 2007)},
+ *   pages={1027--1035},
+ *   year={2007}
+ * }
+ *
+ * The seeding makes k passes over the dataset; each pass computes the distance
+ * from every point to the new centroid, and is split between threads if OpenMP
+ * is available.  For large k, KMeansParallel needs far fewer passes.
+ */
+class KMeansPlusPlus
+{
+ public:
+  //! Empty constructor, required by the InitialPartitionPolicy policy.
+  KMeansPlusPlus() { }
+
+  /**
+   * Partition the given dataset into the given number of clusters with the
+   * k-means++ seeding.
+   *
+   * @tparam MatType Type of data (arma::mat or arma::sp_mat).
+   * @param data Dataset to partition.
+   * @param clusters Number of clusters to split dataset into.
+   * @param assignments Vector to store cluster assignments into.  Values will
+   *     be between 0 and (clusters - 1).
+   */
+  template<typename MatType>
+  inline static void Cluster(const MatType& data,
+                             const size_t clusters,
+                             arma::Col<size_t>& assignments)
+  {
+    arma::Col<size_t> centers;
+    Seed(data, arma::vec(), clusters, centers, assignments);
+  }
+
+  /**
+   * Choose the given number of points of the dataset as centroids with the
+   * k-means++ seeding, where each point may have a weight (the probability of
+   * choosing a point is proportional to its weight times its squared distance
+   * to the closest centroid), and assign each point to its closest centroid.
+   * If the dataset has fewer distinct points than clusters, some centroids
+   * will be the same point.
+   *
+   * @tparam MatType Type of data (arma::mat or arma::sp_mat).
+   * @param data Dataset to choose centroids from.
+   * @param weights Weight of each point, or an empty vector if every point has
+   *     the same weight.
+   * @param clusters Number of centroids to choose.
+   * @param centers Vector to store the indices of the chosen points into.
+   * @param assignments Vector to store the closest centroid of each point into.
+   */
+  template<typename MatType>
+  static void Seed(const MatType& data,
+                   const arma::vec& weights,
+                   const size_t clusters,
+                   arma::Col<size_t>& centers,
+                   arma::Col<size_t>& assignments);
+
+ private:
+  /**
+   * Choose a random point with probability proportional to its weight times
+   * its distance to the closest centroid, or, if all of those are zero, just
+   * its weight.
+   */
+  static size_t SamplePoint(const arma::vec& weights,
+                            const arma::vec& minDistances);
+};
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+// Include implementation.
+#include "kmeans_plus_plus_impl.hpp"
+
+#endif
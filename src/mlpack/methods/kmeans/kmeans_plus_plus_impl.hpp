@@ -0,0 +1,103 @@
+/**
+ * @file kmeans_plus_plus_impl.hpp
+ * @author Ryan Curtin
+ *
+ * Implementation of the KMeansPlusPlus class.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_KMEANS_PLUS_PLUS_IMPL_HPP
+#define __MLPACK_METHODS_KMEANS_KMEANS_PLUS_PLUS_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "kmeans_plus_plus.hpp"
+
+#include <mlpack/core/metrics/lmetric.hpp>
+
+namespace mlpack {
+namespace kmeans {
+
+template<typename MatType>
+void KMeansPlusPlus::Seed(const MatType& data,
+                          const arma::vec& weights,
+                          const size_t clusters,
+                          arma::Col<size_t>& centers,
+                          arma::Col<size_t>& assignments)
+{
+  if (clusters > data.n_cols)
+    Log::Fatal << "KMeansPlusPlus::Seed(): more clusters requested ("
+        << clusters << ") than points given (" << data.n_cols << ")!"
+        << std::endl;
+
+  // The squared distance from each point to its closest centroid so far.  No
+  // centroid has been chosen yet, so the first one is chosen by weight alone.
+  arma::vec minDistances(data.n_cols);
+  minDistances.fill(std::numeric_limits<double>::infinity());
+
+  centers.set_size(clusters);
+  assignments.set_size(data.n_cols);
+  for (size_t c = 0; c < clusters; ++c)
+  {
+    const size_t center = SamplePoint(weights, minDistances);
+    centers[c] = center;
+
+    // Each point is handled independently, so the points can be split between
+    // threads.  The centroids are checked in order, so ties go to the lowest
+    // index, as in NaiveAssignment.
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < data.n_cols; ++i)
+    {
+      const double distance = metric::SquaredEuclideanDistance::Evaluate(
+          data.col(i), data.col(center));
+
+      if (distance < minDistances[i])
+      {
+        minDistances[i] = distance;
+        assignments[i] = c;
+      }
+    }
+  }
+}
+
+inline size_t KMeansPlusPlus::SamplePoint(const arma::vec& weights,
+                                          const arma::vec& minDistances)
+{
+  // The mass of each point is its weight times its distance, if that is finite
+  // and some point has nonzero mass; otherwise it is just its weight.
+  double total = 0.0;
+  for (size_t i = 0; i < minDistances.n_elem; ++i)
+    total += (weights.n_elem == 0) ? minDistances[i] :
+        weights[i] * minDistances[i];
+
+  const bool useDistances = (total > 0.0) &&
+      (total < std::numeric_limits<double>::infinity());
+  if (!useDistances)
+    total = (weights.n_elem == 0) ? (double) minDistances.n_elem :
+        arma::accu(weights);
+
+  // Walk through the points until the cumulative mass passes a random point in
+  // [0, total).
+  const double target = math::Random() * total;
+  double cumulative = 0.0;
+  size_t lastPositive = 0;
+  for (size_t i = 0; i < minDistances.n_elem; ++i)
+  {
+    double mass = (weights.n_elem == 0) ? 1.0 : weights[i];
+    if (useDistances)
+      mass *= minDistances[i];
+
+    if (mass <= 0.0)
+      continue;
+
+    cumulative += mass;
+    lastPositive = i;
+    if (cumulative > target)
+      return i;
+  }
+
+  // Rounding may leave the target just past the end.
+  return lastPositive;
+}
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+#endif
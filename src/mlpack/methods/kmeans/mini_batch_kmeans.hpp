@@ -0,0 +1,195 @@
+/**
+ * @file mini_batch_kmeans.hpp
+ * @author Ryan Curtin
+ *
+ * Mini-batch K-Means clustering, which only looks at a small batch of points
+ * at a time, so that it can cluster datasets which do not fit in memory.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_MINI_BATCH_KMEANS_HPP
+#define __MLPACK_METHODS_KMEANS_MINI_BATCH_KMEANS_HPP
+
+#include <mlpack/core.hpp>
+
+#include <mlpack/core/metrics/lmetric.hpp>
+#include "max_variance_new_cluster.hpp"
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * This class implements mini-batch K-Means clustering.  Instead of assigning
+ * every point in each iteration, as KMeans does, each iteration assigns a
+ * small batch of points to their closest centroids and moves each centroid
+ * towards the mean of the points in the batch assigned to it.  Each centroid
+ * has its own learning rate, which is the fraction of all the points it has
+ * been assigned that are in the current batch; so each centroid is always the
+ * mean of every point it has been assigned.  This is the algorithm from the
+ * following paper:
+ *
+ * @inproceedings{sculley2010web,
+ *   title={Web-scale k-means clustering},
+ *   author={Sculley, David},
+ *   booktitle={Proceedings of the 19th International Conference on World Wide
+ *       Web (WWW 2010)},
+ *   pages={1177--1178},
+ *   year={2010}
+ * }
+ *
+ * Batches can be sampled from a dataset in memory, read in order from a file
+ * (with data::ChunkedLoader), or given one at a time to Update().  Only the
+ * centroids and one batch are held in memory at any time.
+ *
+ * @code
+ * // Cluster a dataset that is too big for memory, in batches of 10000 points.
+ * MiniBatchKMeans<> k(10000);
+ * arma::mat centroids;
+ * k.Cluster("clicks.csv", 100, centroids);
+ *
+ * // Or feed the batches by hand.
+ * k.Reset(initialCentroids);
+ * while (...)
+ *   k.Update(batch);
+ * @endcode
+ *
+ * A cluster is empty when it has not been assigned any point so far, and no
+ * point of the current batch is assigned to it.  The EmptyClusterPolicy is
+ * then called with the batch; MaxVarianceNewCluster moves a point of the batch
+ * into the empty cluster, and AllowEmptyClusters leaves the centroid where it
+ * is.
+ *
+ * @tparam MetricType The distance metric to use.
+ * @tparam EmptyClusterPolicy Policy for what to do on an empty cluster; see
+ *     KMeans.
+ */
+template<typename MetricType = metric::SquaredEuclideanDistance,
+         typename EmptyClusterPolicy = MaxVarianceNewCluster>
+class MiniBatchKMeans
+{
+ public:
+  /**
+   * Create a MiniBatchKMeans object, optionally specifying the parameters.
+   *
+   * @param batchSize Number of points in each batch.
+   * @param maxIterations Number of batches to use when clustering a dataset in
+   *     memory.
+   * @param metric Optional MetricType object; for when the metric has state
+   *     it needs to store.
+   * @param emptyClusterAction Optional EmptyClusterPolicy object; for when a
+   *     specially initialized empty cluster policy is required.
+   */
+  MiniBatchKMeans(const size_t batchSize = 1000,
+                  const size_t maxIterations = 100,
+                  const MetricType metric = MetricType(),
+                  const EmptyClusterPolicy emptyClusterAction =
+                      EmptyClusterPolicy());
+
+  /**
+   * Cluster the given dataset with maxIterations batches of points, each
+   * sampled uniformly at random (with replacement), and then assign every
+   * point to its closest centroid.  Unless initialCentroidGuess is true, the
+   * initial centroids are distinct random points of the dataset.
+   *
+   * @param data Dataset to cluster.
+   * @param clusters Number of clusters to compute.
+   * @param assignments Vector to store cluster assignments in.
+   * @param centroids Matrix in which centroids are stored.
+   * @param initialCentroidGuess If true, then it is assumed that centroids
+   *      contains the initial centroids of each cluster.
+   */
+  void Cluster(const arma::mat& data,
+               const size_t clusters,
+               arma::Col<size_t>& assignments,
+               arma::mat& centroids,
+               const bool initialCentroidGuess = false);
+
+  /**
+   * Cluster the dataset in the given file (which must be a CSV or raw ASCII
+   * file; see data::ChunkedLoader), reading it in batches of batchSize points,
+   * in order.  The file is read the given number of times.  Unless
+   * initialCentroidGuess is true, the initial centroids are distinct random
+   * points of the first batch.  Because the batches are not random samples,
+   * the points in the file should not be sorted in any meaningful way.
+   *
+   * @param filename File holding the dataset to cluster.
+   * @param clusters Number of clusters to compute.
+   * @param centroids Matrix in which centroids are stored.
+   * @param passes Number of times to read the file.
+   * @param initialCentroidGuess If true, then it is assumed that centroids
+   *      contains the initial centroids of each cluster.
+   */
+  void Cluster(const std::string& filename,
+               const size_t clusters,
+               arma::mat& centroids,
+               const size_t passes = 1,
+               const bool initialCentroidGuess = false);
+
+  /**
+   * Start a new clustering with the given centroids; no points have been
+   * assigned to any of them yet.  Call this before Update().
+   *
+   * @param initialCentroids Initial centroids of each cluster.
+   */
+  void Reset(const arma::mat& initialCentroids);
+
+  /**
+   * Assign the points of the given batch to their closest centroids, and move
+   * the centroids.
+   *
+   * @param batch Batch of points (one per column).
+   */
+  void Update(const arma::mat& batch);
+
+  //! Get the current centroids.
+  const arma::mat& Centroids() const { return centroids; }
+  //! Get the number of points that have been assigned to each centroid.
+  const arma::Col<size_t>& Counts() const { return counts; }
+
+  //! Get the number of points in each batch.
+  size_t BatchSize() const { return batchSize; }
+  //! Modify the number of points in each batch.
+  size_t& BatchSize() { return batchSize; }
+
+  //! Get the number of batches for clustering a dataset in memory.
+  size_t MaxIterations() const { return maxIterations; }
+  //! Modify the number of batches for clustering a dataset in memory.
+  size_t& MaxIterations() { return maxIterations; }
+
+  //! Get the distance metric.
+  const MetricType& Metric() const { return metric; }
+  //! Modify the distance metric.
+  MetricType& Metric() { return metric; }
+
+  //! Get the empty cluster policy.
+  const EmptyClusterPolicy& EmptyClusterAction() const
+  { return emptyClusterAction; }
+  //! Modify the empty cluster policy.
+  EmptyClusterPolicy& EmptyClusterAction() { return emptyClusterAction; }
+
+ private:
+  //! Number of points in each batch.
+  size_t batchSize;
+  //! Number of batches for clustering a dataset in memory.
+  size_t maxIterations;
+  //! Instantiated distance metric.
+  MetricType metric;
+  //! Instantiated empty cluster policy.
+  EmptyClusterPolicy emptyClusterAction;
+  //! The current centroids.
+  arma::mat centroids;
+  //! The number of points that have been assigned to each centroid.
+  arma::Col<size_t> counts;
+
+  /**
+   * Reset with distinct random points of the given matrix as the initial
+   * centroids.
+   */
+  void RandomReset(const arma::mat& points, const size_t clusters);
+};
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+// Include implementation.
+#include "mini_batch_kmeans_impl.hpp"
+
+#endif
@@ -0,0 +1,226 @@
+/**
+ * @file mini_batch_kmeans_impl.hpp
+ * @author Ryan Curtin
+ *
+ * Implementation of the MiniBatchKMeans class.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_MINI_BATCH_KMEANS_IMPL_HPP
+#define __MLPACK_METHODS_KMEANS_MINI_BATCH_KMEANS_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "mini_batch_kmeans.hpp"
+#include "naive_assignment.hpp"
+
+namespace mlpack {
+namespace kmeans {
+
+template<typename MetricType, typename EmptyClusterPolicy>
+MiniBatchKMeans<MetricType, EmptyClusterPolicy>::MiniBatchKMeans(
+    const size_t batchSize,
+    const size_t maxIterations,
+    const MetricType metric,
+    const EmptyClusterPolicy emptyClusterAction) :
+    batchSize(batchSize),
+    maxIterations(maxIterations),
+    metric(metric),
+    emptyClusterAction(emptyClusterAction)
+{
+  if (batchSize == 0)
+  {
+    Log::Warn << "MiniBatchKMeans::MiniBatchKMeans(): batch size must be "
+        << "greater than 0.  Setting batch size to 1000." << std::endl;
+    this->batchSize = 1000;
+  }
+}
+
+template<typename MetricType, typename EmptyClusterPolicy>
+void MiniBatchKMeans<MetricType, EmptyClusterPolicy>::Cluster(
+    const arma::mat& data,
+    const size_t clusters,
+    arma::Col<size_t>& assignments,
+    arma::mat& centroids,
+    const bool initialCentroidGuess)
+{
+  if (initialCentroidGuess)
+  {
+    if (centroids.n_cols != clusters)
+      Log::Fatal << "MiniBatchKMeans::Cluster(): wrong number of initial "
+          << "cluster centroids (" << centroids.n_cols << ", should be "
+          << clusters << ")!" << std::endl;
+
+    if (centroids.n_rows != data.n_rows)
+      Log::Fatal << "MiniBatchKMeans::Cluster(): initial cluster centroids "
+          << "have wrong dimensionality (" << centroids.n_rows << ", should be "
+          << data.n_rows << ")!" << std::endl;
+
+    Reset(centroids);
+  }
+  else
+  {
+    RandomReset(data, clusters);
+  }
+
+  // Each batch is a uniform sample of the dataset.
+  const size_t points = std::min(batchSize, (size_t) data.n_cols);
+  arma::mat batch(data.n_rows, points);
+  for (size_t iteration = 0; iteration < maxIterations; ++iteration)
+  {
+    for (size_t i = 0; i < points; ++i)
+    {
+      const size_t index = std::min((size_t) (math::Random() * data.n_cols),
+          (size_t) data.n_cols - 1);
+      batch.col(i) = data.col(index);
+    }
+
+    Update(batch);
+  }
+
+  // Now assign every point to its closest centroid.  Every assignment starts
+  // invalid, so every point is counted as changed.
+  assignments.set_size(data.n_cols);
+  assignments.fill(clusters);
+  arma::Col<size_t> clusterCounts(clusters);
+  NaiveAssignment::Assign(data, this->centroids, metric, assignments,
+      clusterCounts);
+
+  centroids = this->centroids;
+}
+
+template<typename MetricType, typename EmptyClusterPolicy>
+void MiniBatchKMeans<MetricType, EmptyClusterPolicy>::Cluster(
+    const std::string& filename,
+    const size_t clusters,
+    arma::mat& centroids,
+    const size_t passes,
+    const bool initialCentroidGuess)
+{
+  if (initialCentroidGuess)
+  {
+    if (centroids.n_cols != clusters)
+      Log::Fatal << "MiniBatchKMeans::Cluster(): wrong number of initial "
+          << "cluster centroids (" << centroids.n_cols << ", should be "
+          << clusters << ")!" << std::endl;
+
+    Reset(centroids);
+  }
+  else
+  {
+    // The centroids are chosen from the first batch.
+    this->centroids.reset();
+  }
+
+  arma::mat batch;
+  for (size_t pass = 0; pass < passes; ++pass)
+  {
+    data::ChunkedLoader loader(filename);
+    while (loader.LoadChunk(batch, batchSize))
+    {
+      if (this->centroids.n_cols == 0)
+      {
+        if (batch.n_cols < clusters)
+          Log::Fatal << "MiniBatchKMeans::Cluster(): the first batch has "
+              << batch.n_cols << " points, but " << clusters << " clusters "
+              << "were requested; the batch size must be at least the "
+              << "number of clusters." << std::endl;
+
+        RandomReset(batch, clusters);
+      }
+
+      Update(batch);
+    }
+
+    if (loader.PointsLoaded() == 0)
+      Log::Fatal << "MiniBatchKMeans::Cluster(): no points in '" << filename
+          << "'!" << std::endl;
+
+    Log::Info << "MiniBatchKMeans::Cluster(): pass " << (pass + 1) << " read "
+        << loader.PointsLoaded() << " points." << std::endl;
+  }
+
+  centroids = this->centroids;
+}
+
+template<typename MetricType, typename EmptyClusterPolicy>
+void MiniBatchKMeans<MetricType, EmptyClusterPolicy>::Reset(
+    const arma::mat& initialCentroids)
+{
+  centroids = initialCentroids;
+  counts.zeros(centroids.n_cols);
+}
+
+template<typename MetricType, typename EmptyClusterPolicy>
+void MiniBatchKMeans<MetricType, EmptyClusterPolicy>::Update(
+    const arma::mat& batch)
+{
+  if (centroids.n_cols == 0)
+    Log::Fatal << "MiniBatchKMeans::Update(): no centroids; Reset() must be "
+        << "called first!" << std::endl;
+
+  if (batch.n_rows != centroids.n_rows)
+    Log::Fatal << "MiniBatchKMeans::Update(): batch has dimensionality "
+        << batch.n_rows << ", but the centroids have dimensionality "
+        << centroids.n_rows << "!" << std::endl;
+
+  if (batch.n_cols == 0)
+    return;
+
+  // Assign each point of the batch to its closest centroid.  Every assignment
+  // starts invalid, so every point is counted as changed.
+  const size_t clusters = centroids.n_cols;
+  arma::Col<size_t> assignments(batch.n_cols);
+  assignments.fill(clusters);
+  arma::Col<size_t> batchCounts(clusters);
+  NaiveAssignment::Assign(batch, centroids, metric, assignments, batchCounts);
+
+  // A cluster which has never been assigned a point is empty.
+  for (size_t c = 0; c < clusters; ++c)
+    if (counts[c] == 0 && batchCounts[c] == 0)
+      emptyClusterAction.EmptyCluster(batch, c, centroids, batchCounts,
+          assignments);
+
+  arma::mat sums(centroids.n_rows, clusters);
+  sums.zeros();
+  for (size_t i = 0; i < batch.n_cols; ++i)
+    sums.col(assignments[i]) += batch.col(i);
+
+  // Move each centroid towards the mean of its points in the batch.  The
+  // learning rate is the fraction of the centroid's points that are in this
+  // batch, which is the same as applying Sculley's per-point learning rate of
+  // 1 / (number of points assigned so far) to each point in turn.
+  for (size_t c = 0; c < clusters; ++c)
+  {
+    if (batchCounts[c] == 0)
+      continue;
+
+    counts[c] += batchCounts[c];
+    const double rate = (double) batchCounts[c] / (double) counts[c];
+    centroids.col(c) += rate * (sums.col(c) / (double) batchCounts[c] -
+        centroids.col(c));
+  }
+}
+
+template<typename MetricType, typename EmptyClusterPolicy>
+void MiniBatchKMeans<MetricType, EmptyClusterPolicy>::RandomReset(
+    const arma::mat& points,
+    const size_t clusters)
+{
+  if (clusters > points.n_cols)
+    Log::Fatal << "MiniBatchKMeans::Cluster(): more clusters requested ("
+        << clusters << ") than points given (" << points.n_cols << ")!"
+        << std::endl;
+
+  const arma::Col<size_t> order = arma::shuffle(
+      arma::linspace<arma::Col<size_t> >(0, points.n_cols - 1,
+      points.n_cols));
+
+  arma::mat initialCentroids(points.n_rows, clusters);
+  for (size_t c = 0; c < clusters; ++c)
+    initialCentroids.col(c) = points.col(order[c]);
+
+  Reset(initialCentroids);
+}
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+#endif
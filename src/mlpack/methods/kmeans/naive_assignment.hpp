@@ -0,0 +1,97 @@
+/**
+ * @file naive_assignment.hpp
+ * @author Ryan Curtin
+ *
+ * The default AssignmentPolicy for K-Means, which computes the distance
+ * between every point and every centroid in each iteration.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_NAIVE_ASSIGNMENT_HPP
+#define __MLPACK_METHODS_KMEANS_NAIVE_ASSIGNMENT_HPP
+
+#include <mlpack/core.hpp>
+
+#include "recount_clusters.hpp"
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * The standard assignment step of Lloyd's algorithm: each point is assigned to
+ * the closest centroid by computing the distance to every centroid.  If there
+ * are several closest centroids, the one with the lowest index is chosen.  It
+ * has no parameters and no state, so it works with any metric and any type of
+ * matrix.
+ *
+ * An AssignmentPolicy class must implement a copy constructor and the Assign()
+ * method below.  KMeans::Cluster() makes a copy of the policy for each
+ * clustering, and calls Assign() once per iteration with the centroids of that
+ * iteration, so policies may keep state between iterations.  Assign() must
+ * give the same assignments as this class.
+ */
+class NaiveAssignment
+{
+ public:
+  //! Empty constructor, required by the AssignmentPolicy policy.
+  NaiveAssignment() { }
+
+  /**
+   * Assign each point to its closest centroid, updating the counts of points
+   * in each cluster.
+   *
+   * @tparam MetricType Type of distance metric.
+   * @tparam MatType Type of data (arma::mat or arma::sp_mat).
+   * @param data Dataset being clustered.
+   * @param centroids Centroids of each cluster (one per column).
+   * @param metric Instantiated distance metric.
+   * @param assignments Cluster assignments of each point; these are modified.
+   * @param counts Number of points in each cluster; these are modified.
+   * @return Number of points whose assignment changed.
+   */
+  template<typename MetricType, typename MatType>
+  inline static size_t Assign(const MatType& data,
+                              const MatType& centroids,
+                              const MetricType& metric,
+                              arma::Col<size_t>& assignments,
+                              arma::Col<size_t>& counts)
+  {
+    // Each point is handled independently, so the points can be split between
+    // threads.
+    size_t changedAssignments = 0;
+    #pragma omp parallel for schedule(static) reduction(+:changedAssignments)
+    for (size_t i = 0; i < data.n_cols; i++)
+    {
+      // Find the closest centroid to this point.
+      double minDistance = std::numeric_limits<double>::infinity();
+      size_t closestCluster = centroids.n_cols; // Invalid value.
+
+      for (size_t j = 0; j < centroids.n_cols; j++)
+      {
+        double distance = metric.Evaluate(data.col(i), centroids.col(j));
+
+        if (distance < minDistance)
+        {
+          minDistance = distance;
+          closestCluster = j;
+        }
+      }
+
+      // Reassign this point to the closest cluster.
+      if (assignments[i] != closestCluster)
+      {
+        assignments[i] = closestCluster;
+        changedAssignments++;
+      }
+    }
+
+    // Update counts.
+    if (changedAssignments > 0)
+      RecountClusters(assignments, counts);
+
+    return changedAssignments;
+  }
+};
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+#endif
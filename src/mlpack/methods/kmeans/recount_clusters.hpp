@@ -0,0 +1,35 @@
+/**
+ * @file recount_clusters.hpp
+ * @author Ryan Curtin
+ *
+ * A utility function for the K-Means assignment policies, which count the
+ * points in each cluster after the assignments have been made (possibly in
+ * parallel).
+ */
+#ifndef __MLPACK_METHODS_KMEANS_RECOUNT_CLUSTERS_HPP
+#define __MLPACK_METHODS_KMEANS_RECOUNT_CLUSTERS_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * Count the number of points assigned to each cluster.
+ *
+ * @param assignments Cluster assignments of each point.
+ * @param counts Vector to store the number of points in each cluster in; it
+ *     must already have one element for each cluster.
+ */
+inline void RecountClusters(const arma::Col<size_t>& assignments,
+                            arma::Col<size_t>& counts)
+{
+  counts.zeros();
+  for (size_t i = 0; i < assignments.n_elem; i++)
+    counts[assignments[i]]++;
+}
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,96 @@
+/**
+ * @file triangle_bounds.hpp
+ * @author Ryan Curtin
+ *
+ * Utility functions shared by the assignment policies for K-Means which use
+ * the triangle inequality to avoid distance calculations (ElkanAssignment,
+ * HamerlyAssignment, and YinyangAssignment).
+ */
+#ifndef __MLPACK_METHODS_KMEANS_TRIANGLE_BOUNDS_HPP
+#define __MLPACK_METHODS_KMEANS_TRIANGLE_BOUNDS_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/metrics/lmetric.hpp>
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * Convert a value returned by the metric into a distance which satisfies the
+ * triangle inequality, so that it can be used in bounds.  For most metrics
+ * this is the value itself; the squared Euclidean distance is not a metric, so
+ * the square root is taken.  The centroid of an empty cluster is undefined and
+ * gives NaN distances; the assignment step can never choose it, so a NaN is
+ * converted to infinity.
+ *
+ * @param value Value returned by MetricType::Evaluate().
+ */
+template<typename MetricType>
+inline double BoundDistance(const double value)
+{
+  return (value == value) ? value : std::numeric_limits<double>::infinity();
+}
+
+//! The squared Euclidean distance needs to have its root taken.
+template<>
+inline double BoundDistance<metric::SquaredEuclideanDistance>(
+    const double value)
+{
+  return (value == value) ? sqrt(value) :
+      std::numeric_limits<double>::infinity();
+}
+
+/**
+ * Return how far a centroid has moved between two iterations, as a distance
+ * which can be added to upper bounds and subtracted from lower bounds.  If the
+ * new centroid is undefined (because its cluster is empty), it can't be
+ * chosen, so the bounds don't need to change.  If the old centroid was
+ * undefined but the new one is not, nothing is known about it, and the
+ * movement is infinite.
+ *
+ * @param metric Instantiated metric.
+ * @param oldCentroid Centroid before the iteration.
+ * @param newCentroid Centroid after the iteration.
+ */
+template<typename MetricType, typename VecType1, typename VecType2>
+inline double CentroidDrift(const MetricType& metric,
+                            const VecType1& oldCentroid,
+                            const VecType2& newCentroid)
+{
+  const double value = metric.Evaluate(oldCentroid, newCentroid);
+  if (value == value)
+    return BoundDistance<MetricType>(value);
+  else if (arma::is_finite(newCentroid))
+    return std::numeric_limits<double>::infinity();
+  else
+    return 0.0;
+}
+
+/**
+ * Loosen a lower bound by the distance that a centroid (or the furthest moving
+ * of several centroids) has moved.  An infinite movement leaves nothing known,
+ * even if the lower bound was infinite.
+ */
+inline double LoosenLowerBound(const double lowerBound, const double drift)
+{
+  const double inf = std::numeric_limits<double>::infinity();
+  return (drift == inf) ? -inf : (lowerBound - drift);
+}
+
+/**
+ * Return true if the given upper bound on the distance to the assigned
+ * centroid is strictly less than the given lower bound on the distance to some
+ * other centroid, which means that the other centroid can't be the closest
+ * (not even as a tie).  A small relative margin is kept so that rounding error
+ * accumulated in the bounds can never prune a centroid that the plain
+ * assignment step would choose.
+ */
+inline bool Separated(const double upperBound, const double lowerBound)
+{
+  return (upperBound * (1.0 + 1e-10) < lowerBound);
+}
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,112 @@
+/**
+ * @file yinyang_assignment.hpp
+ * @author Ryan Curtin
+ *
+ * An AssignmentPolicy for K-Means which keeps bounds on groups of centroids
+ * (the "Yinyang" algorithm) to avoid most of the distance calculations of the
+ * assignment step.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_YINYANG_ASSIGNMENT_HPP
+#define __MLPACK_METHODS_KMEANS_YINYANG_ASSIGNMENT_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * An assignment step which splits the centroids into groups of nearby
+ * centroids, and keeps, for each point, an upper bound on the distance to its
+ * assigned centroid and a lower bound on the distance to each group (not
+ * counting the assigned centroid).  Only the groups whose lower bound is not
+ * above the upper bound are searched.  The groups are found when Assign() is
+ * first called, by clustering the initial centroids.  This is the global and
+ * group filtering from the following paper:
+ *
+ * @inproceedings{ding2015yinyang,
+ *   title={Yinyang K-Means: A Drop-In Replacement of the Classic K-Means with
+ *       Consistent Speedup},
+ *   author={Ding, Yufei and Zhao, Yue and Shen, Xipeng and Musuvathi, Madanlal
+ *       and Mytkowicz, Todd},
+ *   booktitle={Proceedings of the 32nd International Conference on Machine
+ *       Learning (ICML 2015)},
+ *   pages={579--587},
+ *   year={2015}
+ * }
+ *
+ * The assignments are the same as those given by NaiveAssignment.  With the
+ * default of one group for every ten centroids, far less memory is used than
+ * by ElkanAssignment, and far fewer distances are computed than by
+ * HamerlyAssignment when there are many clusters.  The metric must satisfy the
+ * triangle inequality (or be the squared Euclidean distance), and the data
+ * must be a dense matrix.
+ */
+class YinyangAssignment
+{
+ public:
+  /**
+   * Create the YinyangAssignment object, optionally specifying the number of
+   * groups to split the centroids into.
+   *
+   * @param groups Number of groups of centroids; if 0, one group is used for
+   *     every ten centroids.
+   */
+  YinyangAssignment(const size_t groups = 0) : groups(groups) { }
+
+  /**
+   * Assign each point to its closest centroid, updating the counts of points
+   * in each cluster.  The bounds from the previous call are used to avoid
+   * distance calculations.
+   *
+   * @tparam MetricType Type of distance metric.
+   * @tparam MatType Type of data (arma::mat).
+   * @param data Dataset being clustered.
+   * @param centroids Centroids of each cluster (one per column).
+   * @param metric Instantiated distance metric.
+   * @param assignments Cluster assignments of each point; these are modified.
+   * @param counts Number of points in each cluster; these are modified.
+   * @return Number of points whose assignment changed.
+   */
+  template<typename MetricType, typename MatType>
+  size_t Assign(const MatType& data,
+                const MatType& centroids,
+                const MetricType& metric,
+                arma::Col<size_t>& assignments,
+                arma::Col<size_t>& counts);
+
+  //! Get the number of groups (0 means one for every ten centroids).
+  size_t Groups() const { return groups; }
+  //! Modify the number of groups (0 means one for every ten centroids).
+  size_t& Groups() { return groups; }
+
+ private:
+  /**
+   * Split the given centroids into groups by running a few iterations of
+   * k-means on them, and store the group of each centroid.
+   */
+  template<typename MetricType, typename MatType>
+  void BuildGroups(const MatType& centroids,
+                   const MetricType& metric,
+                   const size_t numGroups);
+
+  //! The requested number of groups.
+  size_t groups;
+  //! The group of each centroid.
+  arma::Col<size_t> centroidGroups;
+  //! Upper bound on the distance from each point to its assigned centroid.
+  arma::vec upperBounds;
+  //! Lower bound on the distance from each point (column) to each group.
+  arma::mat groupLowerBounds;
+  //! The assignments given by the previous call.
+  arma::Col<size_t> lastAssignments;
+  //! The centroids given in the previous call.
+  arma::mat lastCentroids;
+};
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+// Include implementation.
+#include "yinyang_assignment_impl.hpp"
+
+#endif
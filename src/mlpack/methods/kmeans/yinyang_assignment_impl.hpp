@@ -0,0 +1,254 @@
+/**
+ * @file yinyang_assignment_impl.hpp
+ * @author Ryan Curtin
+ *
+ * Implementation of the YinyangAssignment class.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_YINYANG_ASSIGNMENT_IMPL_HPP
+#define __MLPACK_METHODS_KMEANS_YINYANG_ASSIGNMENT_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "yinyang_assignment.hpp"
+#include "recount_clusters.hpp"
+#include "triangle_bounds.hpp"
+
+namespace mlpack {
+namespace kmeans {
+
+template<typename MetricType, typename MatType>
+size_t YinyangAssignment::Assign(const MatType& data,
+                                 const MatType& centroids,
+                                 const MetricType& metric,
+                                 arma::Col<size_t>& assignments,
+                                 arma::Col<size_t>& counts)
+{
+  const size_t clusters = centroids.n_cols;
+  const double inf = std::numeric_limits<double>::infinity();
+
+  // On the first call, group the centroids.  There are no bounds yet: the
+  // upper bounds are infinite and the lower bounds are zero, which means every
+  // point will be checked.
+  arma::vec drift(clusters);
+  if (upperBounds.n_elem != data.n_cols || centroidGroups.n_elem != clusters)
+  {
+    size_t numGroups = (groups == 0) ? (clusters / 10) : groups;
+    if (numGroups == 0)
+      numGroups = 1;
+    else if (numGroups > clusters)
+      numGroups = clusters;
+
+    BuildGroups(centroids, metric, numGroups);
+
+    upperBounds.set_size(data.n_cols);
+    upperBounds.fill(inf);
+    groupLowerBounds.zeros(numGroups, data.n_cols);
+    lastAssignments = assignments;
+    drift.zeros();
+  }
+  else
+  {
+    for (size_t j = 0; j < clusters; ++j)
+      drift[j] = CentroidDrift(metric, lastCentroids.col(j), centroids.col(j));
+  }
+
+  // The lower bound of a group moves by the largest drift in the group.
+  const size_t numGroups = groupLowerBounds.n_rows;
+  arma::vec groupDrift(numGroups);
+  groupDrift.zeros();
+  for (size_t j = 0; j < clusters; ++j)
+    if (drift[j] > groupDrift[centroidGroups[j]])
+      groupDrift[centroidGroups[j]] = drift[j];
+
+  // Each point has its own bounds, so the points can be split between threads.
+  size_t changedAssignments = 0;
+  #pragma omp parallel reduction(+:changedAssignments)
+  {
+    // Workspace for the search of each point, for each thread.
+    std::vector<bool> searchGroup(numGroups);
+    arma::vec groupClosest(numGroups);
+    arma::vec groupSecond(numGroups);
+    arma::Col<size_t> groupClosestCluster(numGroups);
+
+    #pragma omp for schedule(dynamic, 256)
+    for (size_t i = 0; i < data.n_cols; ++i)
+    {
+      const size_t assigned = assignments[i];
+
+      // If the assignment was changed since the last call (by the empty cluster
+      // policy), the upper bound is not known, and the lower bound of the group
+      // of the old centroid no longer covers every centroid it needs to.
+      if (assigned != lastAssignments[i])
+      {
+        upperBounds[i] = inf;
+        groupLowerBounds(centroidGroups[lastAssignments[i]], i) = 0.0;
+      }
+      else
+      {
+        upperBounds[i] += drift[assigned];
+      }
+      lastAssignments[i] = assigned;
+
+      double globalLowerBound = inf;
+      for (size_t g = 0; g < numGroups; ++g)
+      {
+        groupLowerBounds(g, i) = LoosenLowerBound(groupLowerBounds(g, i),
+            groupDrift[g]);
+        if (groupLowerBounds(g, i) < globalLowerBound)
+          globalLowerBound = groupLowerBounds(g, i);
+      }
+
+      if (Separated(upperBounds[i], globalLowerBound))
+        continue;
+
+      // Tighten the upper bound and try again.
+      const double assignedDistance = metric.Evaluate(data.col(i),
+          centroids.col(assigned));
+      upperBounds[i] = BoundDistance<MetricType>(assignedDistance);
+      if (Separated(upperBounds[i], globalLowerBound))
+        continue;
+
+      // Only the groups whose lower bound is not above the upper bound need to
+      // be searched.
+      for (size_t g = 0; g < numGroups; ++g)
+      {
+        searchGroup[g] = !Separated(upperBounds[i], groupLowerBounds(g, i));
+        groupClosest[g] = inf;
+        groupSecond[g] = inf;
+        groupClosestCluster[g] = clusters;
+      }
+
+      // Now find the closest centroid, in the same order as NaiveAssignment so
+      // that ties are broken the same way.  The centroids which are skipped are
+      // strictly further away than the assigned centroid.
+      double minDistance = inf;
+      size_t closestCluster = clusters; // Invalid value.
+      for (size_t j = 0; j < clusters; ++j)
+      {
+        const size_t g = centroidGroups[j];
+        if (!searchGroup[g] && j != assigned)
+          continue;
+
+        const double distance = (j == assigned) ? assignedDistance :
+            metric.Evaluate(data.col(i), centroids.col(j));
+
+        if (distance < minDistance)
+        {
+          minDistance = distance;
+          closestCluster = j;
+        }
+
+        // Keep the two closest centroids of each searched group.
+        if (searchGroup[g])
+        {
+          const double distanceBound = BoundDistance<MetricType>(distance);
+          if (distanceBound < groupClosest[g])
+          {
+            groupSecond[g] = groupClosest[g];
+            groupClosest[g] = distanceBound;
+            groupClosestCluster[g] = j;
+          }
+          else if (distanceBound < groupSecond[g])
+          {
+            groupSecond[g] = distanceBound;
+          }
+        }
+      }
+
+      // The lower bound of each searched group is the distance to the closest
+      // centroid in the group which is not the new assigned centroid.
+      for (size_t g = 0; g < numGroups; ++g)
+      {
+        if (searchGroup[g])
+        {
+          groupLowerBounds(g, i) = (groupClosestCluster[g] == closestCluster) ?
+              groupSecond[g] : groupClosest[g];
+        }
+      }
+
+      upperBounds[i] = BoundDistance<MetricType>(minDistance);
+
+      if (closestCluster != assigned)
+      {
+        // The old assigned centroid is now counted by the lower bound of its
+        // group.
+        const size_t g = centroidGroups[assigned];
+        const double assignedBound =
+            BoundDistance<MetricType>(assignedDistance);
+        if (!searchGroup[g] && assignedBound < groupLowerBounds(g, i))
+          groupLowerBounds(g, i) = assignedBound;
+
+        assignments[i] = closestCluster;
+        lastAssignments[i] = closestCluster;
+        changedAssignments++;
+      }
+    }
+  }
+
+  if (changedAssignments > 0)
+    RecountClusters(assignments, counts);
+
+  lastCentroids = centroids;
+
+  return changedAssignments;
+}
+
+template<typename MetricType, typename MatType>
+void YinyangAssignment::BuildGroups(const MatType& centroids,
+                                    const MetricType& metric,
+                                    const size_t numGroups)
+{
+  const size_t clusters = centroids.n_cols;
+
+  // Start with evenly spaced centroids as the centers of the groups, and with
+  // each centroid in the group of the nearest of those.
+  arma::mat groupCenters(centroids.n_rows, numGroups);
+  centroidGroups.set_size(clusters);
+  for (size_t g = 0; g < numGroups; ++g)
+    groupCenters.col(g) = centroids.col((g * clusters) / numGroups);
+  for (size_t j = 0; j < clusters; ++j)
+    centroidGroups[j] = (j * numGroups) / clusters;
+
+  // A few iterations of k-means are enough; the groups only need to hold
+  // nearby centroids.  The centroids of empty clusters are undefined, so they
+  // don't move the group centers, and a group which loses all its centroids
+  // keeps its center.
+  arma::mat newCenters(centroids.n_rows, numGroups);
+  arma::Col<size_t> groupCounts(numGroups);
+  for (size_t iteration = 0; iteration < 5; ++iteration)
+  {
+    for (size_t j = 0; j < clusters; ++j)
+    {
+      double minDistance = std::numeric_limits<double>::infinity();
+      for (size_t g = 0; g < numGroups; ++g)
+      {
+        const double distance = metric.Evaluate(centroids.col(j),
+            groupCenters.col(g));
+        if (distance < minDistance)
+        {
+          minDistance = distance;
+          centroidGroups[j] = g;
+        }
+      }
+    }
+
+    newCenters.zeros();
+    groupCounts.zeros();
+    for (size_t j = 0; j < clusters; ++j)
+    {
+      if (arma::is_finite(centroids.col(j)))
+      {
+        newCenters.col(centroidGroups[j]) += centroids.col(j);
+        groupCounts[centroidGroups[j]]++;
+      }
+    }
+
+    for (size_t g = 0; g < numGroups; ++g)
+      if (groupCounts[g] > 0)
+        groupCenters.col(g) = newCenters.col(g) / groupCounts[g];
+  }
+}
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+#endif
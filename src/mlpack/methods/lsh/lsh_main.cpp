@@ -41,15 +41,26 @@ PROGRAM_INFO("All K-Approximate-Nearest-Neighbor Search with LSH",
     "\n\n"
     "Because this is approximate-nearest-neighbors search, results may be "
     "different from run to run.  Thus, the --seed option can be specified to "
-    "set the random seed.");
+    "set the random seed."
+    "\n\n"
+    "The hash (with the reference set) can be saved to a file with the "
+    "--output_index_file option, and loaded again with --input_index_file "
+    "instead of being built.  If a reference file is given with an input "
+    "index, its points are added to the index (and given indices after the "
+    "points already in it), without hashing the other points again.  For "
+    "example, the following adds the points in 'new.csv' to the index in "
+    "'index.bin' and saves the updated index:"
+    "\n\n"
+    "$ lsh -i index.bin -r new.csv -o index.bin");
 
 // Define our input parameters that this program will take.
-PARAM_STRING_REQ("reference_file", "File containing the reference dataset.",
-    "r");
+PARAM_STRING("reference_file", "File containing the reference dataset (or, "
+    "with --input_index_file, points to add to the index).", "r", "");
 PARAM_STRING("distances_file", "File to output distances into.", "d", "");
 PARAM_STRING("neighbors_file", "File to output neighbors into.", "n", "");
 
-PARAM_INT_REQ("k", "Number of nearest neighbors to find.", "k");
+PARAM_INT("k", "Number of nearest neighbors to find (if 0, no search is "
+    "done).", "k", 0);
 
 PARAM_STRING("query_file", "File containing query points (optional).", "q", "");
 
@@ -61,8 +72,15 @@ PARAM_DOUBLE("hash_width", "The hash width for the first-level hashing in the "
     "hash width for its use.", "H", 0.0);
 PARAM_INT("second_hash_size", "The size of the second level hash table.", "M",
     99901);
-PARAM_INT("bucket_size", "The size of a bucket in the second level hash.", "B",
-    500);
+PARAM_INT("bucket_size", "The maximum number of points in a bucket of the "
+    "second level hash (0 for no maximum).", "B", 0);
+PARAM_INT("num_probes", "Number of additional buckets to probe in each table "
+    "(multiprobe LSH); probing more buckets allows fewer tables to be used for "
+    "the same recall.", "T", 0);
+PARAM_STRING("input_index_file", "File containing a hash saved with "
+    "--output_index_file, to use instead of building one.", "i", "");
+PARAM_STRING("output_index_file", "File to save the hash (with the reference "
+    "set) into.", "o", "");
 PARAM_INT("seed", "Random seed.  If 0, 'std::time(NULL)' is used.", "s", 0);
 
 int main(int argc, char *argv[])
@@ -79,25 +97,35 @@ int main(int argc, char *argv[])
   string referenceFile = CLI::GetParam<string>("reference_file");
   string distancesFile = CLI::GetParam<string>("distances_file");
   string neighborsFile = CLI::GetParam<string>("neighbors_file");
+  string inputIndexFile = CLI::GetParam<string>("input_index_file");
+  string outputIndexFile = CLI::GetParam<string>("output_index_file");
 
+  if (referenceFile == "" && inputIndexFile == "")
+    Log::Fatal << "Either --reference_file or --input_index_file must be "
+        << "specified!" << endl;
+
+  if (CLI::GetParam<int>("k") < 0)
+  {
+    Log::Fatal << "Invalid k: " << CLI::GetParam<int>("k") << "; must be "
+        << "greater than or equal to 0." << endl;
+  }
   size_t k = CLI::GetParam<int>("k");
   size_t secondHashSize = CLI::GetParam<int>("second_hash_size");
   size_t bucketSize = CLI::GetParam<int>("bucket_size");
 
+  if (k == 0 && outputIndexFile == "")
+    Log::Warn << "Neither -k nor --output_index_file is specified; no results "
+        << "will be saved." << endl;
+
   arma::mat referenceData;
   arma::mat queryData; // So it doesn't go out of scope.
-  data::Load(referenceFile, referenceData, true);
-
-  Log::Info << "Loaded reference data from '" << referenceFile << "' ("
-      << referenceData.n_rows << " x " << referenceData.n_cols << ")." << endl;
-
-  // Sanity check on k value: must be greater than 0, must be less than the
-  // number of reference points.
-  if (k > referenceData.n_cols)
+  if (referenceFile != "")
   {
-    Log::Fatal << "Invalid k: " << k << "; must be greater than 0 and less ";
-    Log::Fatal << "than or equal to the number of reference points (";
-    Log::Fatal << referenceData.n_cols << ")." << endl;
+    data::Load(referenceFile, referenceData, true);
+
+    Log::Info << "Loaded reference data from '" << referenceFile << "' ("
+        << referenceData.n_rows << " x " << referenceData.n_cols << ")."
+        << endl;
   }
 
   // Pick up the LSH-specific parameters.
@@ -105,6 +133,13 @@ int main(int argc, char *argv[])
   const size_t numTables = CLI::GetParam<int>("tables");
   const double hashWidth = CLI::GetParam<double>("hash_width");
 
+  if (CLI::GetParam<int>("num_probes") < 0)
+  {
+    Log::Fatal << "Invalid number of probes: " << CLI::GetParam<int>(
+        "num_probes") << "; must be greater than or equal to 0." << endl;
+  }
+  const size_t numProbes = CLI::GetParam<int>("num_probes");
+
   arma::Mat<size_t> neighbors;
   arma::mat distances;
 
@@ -117,38 +152,73 @@ int main(int argc, char *argv[])
               << queryData.n_rows << " x " << queryData.n_cols << ")." << endl;
   }
 
-  if (hashWidth == 0.0)
-    Log::Info << "Using LSH with " << numProj << " projections (K) and " <<
-        numTables << " tables (L) with default hash width." << endl;
-  else
-    Log::Info << "Using LSH with " << numProj << " projections (K) and " <<
-        numTables << " tables (L) with hash width(r): " << hashWidth << endl;
-
-  Timer::Start("hash_building");
-
   LSHSearch<>* allkann;
 
-  if (CLI::GetParam<string>("query_file") != "")
-    allkann = new LSHSearch<>(referenceData, queryData, numProj, numTables,
-                              hashWidth, secondHashSize, bucketSize);
+  if (inputIndexFile != "")
+  {
+    Timer::Start("hash_loading");
+    allkann = new LSHSearch<>(inputIndexFile);
+    Timer::Stop("hash_loading");
+
+    // Add the new reference points to the loaded hash.
+    if (referenceFile != "")
+    {
+      Log::Info << "Adding " << referenceData.n_cols << " points to the hash."
+          << endl;
+
+      Timer::Start("hash_building");
+      allkann->Insert(referenceData);
+      Timer::Stop("hash_building");
+    }
+  }
   else
+  {
+    if (hashWidth == 0.0)
+      Log::Info << "Using LSH with " << numProj << " projections (K) and " <<
+          numTables << " tables (L) with default hash width." << endl;
+    else
+      Log::Info << "Using LSH with " << numProj << " projections (K) and " <<
+          numTables << " tables (L) with hash width(r): " << hashWidth << endl;
+
+    Timer::Start("hash_building");
     allkann = new LSHSearch<>(referenceData, numProj, numTables, hashWidth,
                               secondHashSize, bucketSize);
+    Timer::Stop("hash_building");
+  }
 
-  Timer::Stop("hash_building");
-
-  Log::Info << "Computing " << k << " distance approximate nearest neighbors "
-      << endl;
-  allkann->Search(k, neighbors, distances);
-
-  Log::Info << "Neighbors computed." << endl;
-
-  // Save output.
-  if (distancesFile != "")
-    data::Save(distancesFile, distances);
+  if (k > 0)
+  {
+    // Sanity check on k value: must be less than the number of reference
+    // points.
+    if (k > allkann->ReferenceSet().n_cols)
+    {
+      Log::Fatal << "Invalid k: " << k << "; must be greater than 0 and less ";
+      Log::Fatal << "than or equal to the number of reference points (";
+      Log::Fatal << allkann->ReferenceSet().n_cols << ")." << endl;
+    }
+
+    Log::Info << "Computing " << k << " distance approximate nearest neighbors "
+        << endl;
+    if (CLI::GetParam<string>("query_file") != "")
+      allkann->Search(queryData, k, neighbors, distances, 0, numProbes);
+    else
+      allkann->Search(k, neighbors, distances, 0, numProbes);
+
+    Log::Info << "Neighbors computed." << endl;
+
+    // Save output.
+    if (distancesFile != "")
+      data::Save(distancesFile, distances);
+
+    if (neighborsFile != "")
+      data::Save(neighborsFile, neighbors);
+  }
 
-  if (neighborsFile != "")
-    data::Save(neighborsFile, neighbors);
+  if (outputIndexFile != "")
+  {
+    Log::Info << "Saving hash to '" << outputIndexFile << "'." << endl;
+    allkann->Save(outputIndexFile);
+  }
 
   delete allkann;
 }
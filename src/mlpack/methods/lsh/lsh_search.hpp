@@ -19,6 +19,19 @@
  *  organization={ACM}
  * }
  *
+ * The multiprobe search, which probes the buckets next to the bucket of the
+ * query as well, is described in the following paper:
+ *
+ * @inproceedings{lv2007multi,
+ *  title={Multi-probe LSH: efficient indexing for high-dimensional similarity
+ *      search},
+ *  author={Lv, Q. and Josephson, W. and Wang, Z. and Charikar, M. and Li, K.},
+ *  booktitle={Proceedings of the 33rd International Conference on Very Large
+ *      Data Bases},
+ *  pages={950--961},
+ *  year={2007},
+ *  organization={VLDB Endowment}
+ * }
  */
 #ifndef __MLPACK_METHODS_NEIGHBOR_SEARCH_LSH_SEARCH_HPP
 #define __MLPACK_METHODS_NEIGHBOR_SEARCH_LSH_SEARCH_HPP
@@ -29,6 +42,8 @@
 
 #include <mlpack/core/metrics/lmetric.hpp>
 #include <mlpack/methods/neighbor_search/sort_policies/nearest_neighbor_sort.hpp>
+#include <mlpack/methods/neighbor_search/neighbor_lists/sorted_neighbor_list.hpp>
+#include <mlpack/methods/neighbor_search/neighbor_lists/heap_neighbor_list.hpp>
 
 namespace mlpack {
 namespace neighbor {
@@ -38,16 +53,26 @@ namespace neighbor {
  * and uses this hash to compute the distance-approximate nearest-neighbors
  * of the given queries.
  *
+ * The class holds a copy of the reference set, so that new reference points
+ * can be inserted into the hash with Insert().  The hash (with the reference
+ * set) can be saved to a binary file with Save() and loaded again with the
+ * constructor which takes a filename, or with Load().
+ *
  * @tparam SortPolicy The sort policy for distances; see NearestNeighborSort.
+ * @tparam NeighborListType The type of candidate list to use; see
+ *     SortedNeighborList.  HeapNeighborList is faster for large k.
  */
-template<typename SortPolicy = NearestNeighborSort>
+template<typename SortPolicy = NearestNeighborSort,
+         typename NeighborListType = SortedNeighborList<SortPolicy> >
 class LSHSearch
 {
  public:
   /**
    * This function initializes the LSH class. It builds the hash on the
    * reference set with 2-stable distributions. See the individual functions
-   * performing the hashing for details on how the hashing is done.
+   * performing the hashing for details on how the hashing is done.  The
+   * reference set is not copied (until points are inserted with Insert()), so
+   * it must not be modified or destroyed while this object is used.
    *
    * @param referenceSet Set of reference points.
    * @param querySet Set of query points.
@@ -61,9 +86,9 @@ class LSHSearch
    *     upper bound on the nearest-neighbor distance in general.
    * @param secondHashSize The size of the second hash table. This should be a
    *     large prime number.
-   * @param bucketSize The size of the bucket in the second hash table. This is
-   *     the maximum number of points that can be hashed into single bucket.
-   *     Default values are already provided here.
+   * @param bucketSize The maximum number of points that can be hashed into a
+   *     single bucket of the second hash table; points hashed into a full
+   *     bucket are dropped.  If 0 (the default), buckets have no maximum size.
    */
   LSHSearch(const arma::mat& referenceSet,
             const arma::mat& querySet,
@@ -71,12 +96,14 @@ class LSHSearch
             const size_t numTables,
             const double hashWidth = 0.0,
             const size_t secondHashSize = 99901,
-            const size_t bucketSize = 500);
+            const size_t bucketSize = 0);
 
   /**
    * This function initializes the LSH class. It builds the hash on the
    * reference set with 2-stable distributions. See the individual functions
-   * performing the hashing for details on how the hashing is done.
+   * performing the hashing for details on how the hashing is done.  The
+   * reference set is not copied (until points are inserted with Insert()), so
+   * it must not be modified or destroyed while this object is used.
    *
    * @param referenceSet Set of reference points and the set of queries.
    * @param numProj Number of projections in each hash table (anything between
@@ -89,16 +116,25 @@ class LSHSearch
    *     upper bound on the nearest-neighbor distance in general.
    * @param secondHashSize The size of the second hash table. This should be a
    *     large prime number.
-   * @param bucketSize The size of the bucket in the second hash table. This is
-   *     the maximum number of points that can be hashed into single bucket.
-   *     Default values are already provided here.
+   * @param bucketSize The maximum number of points that can be hashed into a
+   *     single bucket of the second hash table; points hashed into a full
+   *     bucket are dropped.  If 0 (the default), buckets have no maximum size.
    */
   LSHSearch(const arma::mat& referenceSet,
             const size_t numProj,
             const size_t numTables,
             const double hashWidth = 0.0,
             const size_t secondHashSize = 99901,
-            const size_t bucketSize = 500);
+            const size_t bucketSize = 0);
+
+  /**
+   * Load the hash and the reference set from a file written by Save().  The
+   * reference set is also the set of queries for Search(); another set of
+   * queries can be given to Search() too.
+   *
+   * @param filename File to load the hash from.
+   */
+  LSHSearch(const std::string& filename);
 
   /**
    * Compute the nearest neighbors and store the output in the given matrices.
@@ -106,6 +142,10 @@ class LSHSearch
    * the number of points in the query dataset and k is the number of neighbors
    * being searched for.
    *
+   * The queries are hashed in blocks, with one matrix multiplication per table
+   * for each block, and the candidates of the queries in a block are searched
+   * in parallel if OpenMP is available.
+   *
    * @param k Number of neighbors to search for.
    * @param resultingNeighbors Matrix storing lists of neighbors for each query
    *     point.
@@ -117,11 +157,71 @@ class LSHSearch
    *     available without having to build hashing for every table size.
    *     By default, this is set to zero in which case all tables are
    *     considered.
+   * @param numProbes The number of additional buckets to probe in each table,
+   *     besides the bucket the query is hashed into.  The buckets whose keys
+   *     are closest to the query are probed, so fewer tables are needed for
+   *     the same recall.  By default, this is set to zero, and only the bucket
+   *     of the query is searched.
    */
   void Search(const size_t k,
               arma::Mat<size_t>& resultingNeighbors,
               arma::mat& distances,
-              const size_t numTablesToSearch = 0);
+              const size_t numTablesToSearch = 0,
+              const size_t numProbes = 0);
+
+  /**
+   * Compute the nearest neighbors of the points in the given query set, in
+   * the same way as the other overload of Search().  The query set given to
+   * the constructor (if any) is ignored.
+   *
+   * @param querySet Set of query points.
+   * @param k Number of neighbors to search for.
+   * @param resultingNeighbors Matrix storing lists of neighbors for each query
+   *     point.
+   * @param distances Matrix storing distances of neighbors for each query
+   *     point.
+   * @param numTablesToSearch The number of hash tables to search (0 for all).
+   * @param numProbes The number of additional buckets to probe in each table.
+   */
+  void Search(const arma::mat& querySet,
+              const size_t k,
+              arma::Mat<size_t>& resultingNeighbors,
+              arma::mat& distances,
+              const size_t numTablesToSearch = 0,
+              const size_t numProbes = 0);
+
+  /**
+   * Add the given points to the reference set, and hash them into the
+   * existing buckets.  The hash functions are not changed and the points
+   * already in the hash are not hashed again.  The new points have indices
+   * from the old number of reference points on.  If the buckets have a maximum
+   * size, the new points hashed into full buckets are dropped.  The first
+   * call copies the reference set given to the constructor, which is not
+   * modified.
+   *
+   * @param newPoints Points to add to the reference set.
+   */
+  void Insert(const arma::mat& newPoints);
+
+  /**
+   * Save the hash functions, the buckets and the reference set to the given
+   * binary file.  The query set is not saved.
+   *
+   * @param filename File to save the hash to.
+   */
+  void Save(const std::string& filename) const;
+
+  /**
+   * Load the hash functions, the buckets and the reference set from the given
+   * file, which must have been written by Save(), replacing the hash of this
+   * object.  The reference set is then also the set of queries.
+   *
+   * @param filename File to load the hash from.
+   */
+  void Load(const std::string& filename);
+
+  //! Get the reference set.
+  const arma::mat& ReferenceSet() const { return *referenceSet; }
 
  private:
   /**
@@ -131,7 +231,10 @@ class LSHSearch
    * key is a 'numProj'-dimensional integer vector.
    *
    * Then each key in this hash table is hashed into a second hash table using a
-   * standard hash.
+   * standard hash.  The buckets of the second hash table are stored one after
+   * another in a single array, like the columns of a compressed sparse column
+   * matrix; this is filled in two passes, the first of which counts the points
+   * in each bucket.
    *
    * This function does not have any parameters and relies on parameters which
    * are private members of this class, intialized during the class
@@ -140,56 +243,101 @@ class LSHSearch
   void BuildHash();
 
   /**
-   * This function takes a query and hashes it into each of the hash tables to
-   * get keys for the query and then the key is hashed to a bucket of the second
-   * hash table and all the points (if any) in those buckets are collected as
-   * the potential neighbor candidates.
+   * Hash every one of the given points into the given table, and then into a
+   * bucket of the second hash table.
+   *
+   * @param points The points to hash.
+   * @param table The table to hash the points into.
+   * @param pointBuckets Vector to store the bucket of each point in.
+   */
+  void HashPoints(const arma::mat& points,
+                  const size_t table,
+                  arma::Col<size_t>& pointBuckets) const;
+
+  /**
+   * Put the given points into their buckets in every table.  The buckets are
+   * rebuilt with room for the new points, after the points already in them.
+   * The points are hashed twice: once to count the new points in each bucket,
+   * and once to put them in their places.
+   *
+   * @param points The points to put into the buckets.
+   * @param firstIndex The index in the reference set of the first point.
+   */
+  void InsertIntoBuckets(const arma::mat& points, const size_t firstIndex);
+
+  /**
+   * This function takes the projections of a query into each of the hash
+   * tables (which give the keys of the query), hashes each key to a bucket of
+   * the second hash table, and collects all the points (if any) in those
+   * buckets as the potential neighbor candidates.
    *
-   * @param queryIndex The index of the query currently being processed.
+   * @param queryProjections The projections of the query into each table to
+   *    search (one column per table), offset and divided by the hash width.
+   * @param numProbes The number of additional buckets to probe in each table.
    * @param referenceIndices The list of neighbor candidates obtained from
    *    hashing the query into all the hash tables and eventually into
-   *    multiple buckets of the second hash table.
+   *    multiple buckets of the second hash table, in increasing order and
+   *    without duplicates.
+   */
+  void ReturnIndicesFromTable(const arma::mat& queryProjections,
+                              const size_t numProbes,
+                              std::vector<size_t>& referenceIndices) const;
+
+  /**
+   * Find the bucket of the second hash table for the given projection of a
+   * query into a table, and the buckets of the 'numProbes' keys next to it
+   * which are most likely to hold neighbors of the query.
+   *
+   * A neighboring key is obtained by moving some of the 'numProj' integer
+   * coordinates of the key by -1 or +1.  Its score is the sum of the squared
+   * distances from the projection of the query to the boundaries of the key
+   * that are crossed; the keys with the lowest scores are generated in order
+   * with a heap, using the shift and expand operations of Lv et al.
+   *
+   * @param projection The projection of the query into the table, offset and
+   *     divided by the hash width (so its floor is the key of the query).
+   * @param numProbes The number of additional buckets to find.
+   * @param buckets Vector to store the buckets in; the first one is the bucket
+   *     of the query itself.
    */
-  void ReturnIndicesFromTable(const size_t queryIndex,
-                              arma::uvec& referenceIndices,
-                              size_t numTablesToSearch);
+  void ProbeBuckets(const arma::vec& projection,
+                    const size_t numProbes,
+                    std::vector<size_t>& buckets) const;
 
   /**
    * This is a helper function that computes the distance of the query to the
    * neighbor candidates and appropriately stores the best 'k' candidates
    *
+   * @param querySet The set of queries
    * @param queryIndex The index of the query in question
    * @param referenceIndex The index of the neighbor candidate in question
    */
-  double BaseCase(const size_t queryIndex, const size_t referenceIndex);
-
-  /**
-   * This is a helper function that efficiently inserts better neighbor
-   * candidates into an existing set of neighbor candidates. This function is
-   * only called by the 'BaseCase' function.
-   *
-   * @param queryIndex This is the index of the query being processed currently
-   * @param pos The position of the neighbor candidate in the current list of
-   *    neighbor candidates.
-   * @param neighbor The neighbor candidate that is being inserted into the list
-   *    of the best 'k' candidates for the query in question.
-   * @param distance The distance of the query to the neighbor candidate.
-   */
-  void InsertNeighbor(const size_t queryIndex, const size_t pos,
-                      const size_t neighbor, const double distance);
+  double BaseCase(const arma::mat& querySet,
+                  const size_t queryIndex,
+                  const size_t referenceIndex);
 
  private:
-  //! Reference dataset.
-  const arma::mat& referenceSet;
+  //! Reference dataset.  This is the caller's matrix until points are inserted
+  //! or a hash is loaded; then it is ownedReferenceSet.
+  const arma::mat* referenceSet;
 
-  //! Query dataset (may not be given).
-  const arma::mat& querySet;
+  //! The caller's reference dataset, which holds the first points of the
+  //! reference set (NULL if the hash was loaded from a file).
+  const arma::mat* originalReferenceSet;
+
+  //! The copy of the reference set which is held by this object, if it needed
+  //! to be grown or was loaded from a file.
+  arma::mat ownedReferenceSet;
+
+  //! Query dataset (NULL if not given, in which case the reference set is
+  //! used).
+  const arma::mat* querySet;
 
   //! The number of projections
-  const size_t numProj;
+  size_t numProj;
 
   //! The number of hash tables
-  const size_t numTables;
+  size_t numTables;
 
   //! The std::vector containing the projection matrix of each table
   std::vector<arma::mat> projections; // should be [numProj x dims] x numTables
@@ -201,27 +349,25 @@ class LSHSearch
   double hashWidth;
 
   //! The big prime representing the size of the second hash
-  const size_t secondHashSize;
+  size_t secondHashSize;
 
   //! The weights of the second hash
   arma::vec secondHashWeights;
 
-  //! The bucket size of the second hash
-  const size_t bucketSize;
+  //! The maximum number of points in each bucket of the second hash (0 means
+  //! no maximum).
+  size_t bucketSize;
 
   //! Instantiation of the metric.
   metric::SquaredEuclideanDistance metric;
 
-  //! The final hash table; should be (< secondHashSize) x bucketSize.
-  arma::Mat<size_t> secondHashTable;
-
-  //! The number of elements present in each hash bucket; should be
-  //! secondHashSize.
-  arma::Col<size_t> bucketContentSize;
+  //! The points in each bucket of the second hash, one bucket after another.
+  arma::Col<size_t> bucketContents;
 
-  //! For a particular hash value, points to the row in secondHashTable
-  //! corresponding to this value.  Should be secondHashSize.
-  arma::Col<size_t> bucketRowInHashTable;
+  //! The position in bucketContents of the first point of each bucket; bucket
+  //! i holds the points from bucketOffsets[i] to bucketOffsets[i + 1].  Should
+  //! be (secondHashSize + 1).
+  arma::Col<size_t> bucketOffsets;
 
   //! The pointer to the nearest neighbor distances.
   arma::mat* distancePtr;
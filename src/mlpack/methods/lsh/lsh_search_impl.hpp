@@ -9,12 +9,16 @@
 
 #include <mlpack/core.hpp>
 
+#include <algorithm>
+#include <fstream>
+#include <queue>
+
 namespace mlpack {
 namespace neighbor {
 
 // Construct the object.
-template<typename SortPolicy>
-LSHSearch<SortPolicy>::
+template<typename SortPolicy, typename NeighborListType>
+LSHSearch<SortPolicy, NeighborListType>::
 LSHSearch(const arma::mat& referenceSet,
           const arma::mat& querySet,
           const size_t numProj,
@@ -22,8 +26,9 @@ LSHSearch(const arma::mat& referenceSet,
           const double hashWidthIn,
           const size_t secondHashSize,
           const size_t bucketSize) :
-  referenceSet(referenceSet),
-  querySet(querySet),
+  referenceSet(&referenceSet),
+  originalReferenceSet(&referenceSet),
+  querySet(&querySet),
   numProj(numProj),
   numTables(numTables),
   hashWidth(hashWidthIn),
@@ -50,16 +55,17 @@ LSHSearch(const arma::mat& referenceSet,
   BuildHash();
 }
 
-template<typename SortPolicy>
-LSHSearch<SortPolicy>::
+template<typename SortPolicy, typename NeighborListType>
+LSHSearch<SortPolicy, NeighborListType>::
 LSHSearch(const arma::mat& referenceSet,
           const size_t numProj,
           const size_t numTables,
           const double hashWidthIn,
           const size_t secondHashSize,
           const size_t bucketSize) :
-  referenceSet(referenceSet),
-  querySet(referenceSet),
+  referenceSet(&referenceSet),
+  originalReferenceSet(&referenceSet),
+  querySet(NULL),
   numProj(numProj),
   numTables(numTables),
   hashWidth(hashWidthIn),
@@ -86,126 +92,192 @@ LSHSearch(const arma::mat& referenceSet,
   BuildHash();
 }
 
-template<typename SortPolicy>
-void LSHSearch<SortPolicy>::
-InsertNeighbor(const size_t queryIndex,
-               const size_t pos,
-               const size_t neighbor,
-               const double distance)
+template<typename SortPolicy, typename NeighborListType>
+LSHSearch<SortPolicy, NeighborListType>::
+LSHSearch(const std::string& filename) :
+  referenceSet(&ownedReferenceSet),
+  originalReferenceSet(NULL),
+  querySet(NULL),
+  numProj(0),
+  numTables(0),
+  hashWidth(0.0),
+  secondHashSize(0),
+  bucketSize(0)
 {
-  // We only memmove() if there is actually a need to shift something.
-  if (pos < (distancePtr->n_rows - 1))
-  {
-    int len = (distancePtr->n_rows - 1) - pos;
-    memmove(distancePtr->colptr(queryIndex) + (pos + 1),
-        distancePtr->colptr(queryIndex) + pos,
-        sizeof(double) * len);
-    memmove(neighborPtr->colptr(queryIndex) + (pos + 1),
-        neighborPtr->colptr(queryIndex) + pos,
-        sizeof(size_t) * len);
-  }
-
-  // Now put the new information in the right index.
-  (*distancePtr)(pos, queryIndex) = distance;
-  (*neighborPtr)(pos, queryIndex) = neighbor;
+  Load(filename);
 }
 
-template<typename SortPolicy>
+template<typename SortPolicy, typename NeighborListType>
 inline force_inline
-double LSHSearch<SortPolicy>::
-BaseCase(const size_t queryIndex, const size_t referenceIndex)
+double LSHSearch<SortPolicy, NeighborListType>::
+BaseCase(const arma::mat& querySet,
+         const size_t queryIndex,
+         const size_t referenceIndex)
 {
   // If the datasets are the same, then this search is only using one dataset
-  // and we should not return identical points.
-  if ((&querySet == &referenceSet) && (queryIndex == referenceIndex))
+  // and we should not return identical points.  The caller's reference set
+  // holds the first points of the reference set, even after points have been
+  // inserted, so queries from it are also checked.
+  if ((&querySet == referenceSet || &querySet == originalReferenceSet) &&
+      (queryIndex == referenceIndex))
     return 0.0;
 
   double distance = metric.Evaluate(querySet.unsafe_col(queryIndex),
-                                    referenceSet.unsafe_col(referenceIndex));
-
-  // If this distance is better than any of the current candidates, the
-  // SortDistance() function will give us the position to insert it into.
-  arma::vec queryDist = distancePtr->unsafe_col(queryIndex);
-  size_t insertPosition = SortPolicy::SortDistance(queryDist, distance);
+                                    referenceSet->unsafe_col(referenceIndex));
 
-  // SortDistance() returns (size_t() - 1) if we shouldn't add it.
-  if (insertPosition != (size_t() - 1))
-    InsertNeighbor(queryIndex, insertPosition, referenceIndex, distance);
+  // Insert the point into the candidates, if it is good enough.
+  NeighborListType::Insert(*distancePtr, *neighborPtr, queryIndex,
+      referenceIndex, distance);
 
   return distance;
 }
 
-template<typename SortPolicy>
-void LSHSearch<SortPolicy>::
-ReturnIndicesFromTable(const size_t queryIndex,
-                       arma::uvec& referenceIndices,
-                       size_t numTablesToSearch)
+template<typename SortPolicy, typename NeighborListType>
+void LSHSearch<SortPolicy, NeighborListType>::
+ReturnIndicesFromTable(const arma::mat& queryProjections,
+                       const size_t numProbes,
+                       std::vector<size_t>& referenceIndices) const
 {
-  // Decide on the number of tables to look into.
-  if (numTablesToSearch == 0) // If no user input is given, search all.
-    numTablesToSearch = numTables;
-
-  // Sanity check to make sure that the existing number of tables is not
-  // exceeded.
-  if (numTablesToSearch > numTables)
-    numTablesToSearch = numTables;
-
-  // Hash the query in each of the 'numTablesToSearch' hash tables using the
-  // 'numProj' projections for each table. This gives us 'numTablesToSearch'
-  // keys for the query where each key is a 'numProj' dimensional integer
-  // vector.
+  // For all the buckets that the query is hashed into (and the buckets next to
+  // them, if we are probing), sequentially collect the indices in those
+  // buckets.
+  referenceIndices.clear();
 
-  // Compute the projection of the query in each table.
-  arma::mat allProjInTables(numProj, numTablesToSearch);
-  for (size_t i = 0; i < numTablesToSearch; i++)
+  std::vector<size_t> buckets;
+  for (size_t i = 0; i < queryProjections.n_cols; i++) // For all tables.
   {
-    allProjInTables.unsafe_col(i) = projections[i].t() *
-        querySet.unsafe_col(queryIndex);
-  }
-  allProjInTables += offsets.cols(0, numTablesToSearch - 1);
-  allProjInTables /= hashWidth;
+    // Compute the hash value of the key of the query (and its neighboring
+    // keys) into a bucket of the 'secondHashTable'.
+    ProbeBuckets(queryProjections.unsafe_col(i), numProbes, buckets);
 
-  // Compute the hash value of each key of the query into a bucket of the
-  // 'secondHashTable' using the 'secondHashWeights'.
-  arma::rowvec hashVec = secondHashWeights.t() * arma::floor(allProjInTables);
-
-  for (size_t i = 0; i < hashVec.n_elem; i++)
-    hashVec[i] = (double) ((size_t) hashVec[i] % secondHashSize);
-
-  Log::Assert(hashVec.n_elem == numTablesToSearch);
+    for (size_t b = 0; b < buckets.size(); b++)
+    {
+      // Pick the indices in the bucket corresponding to 'hashInd'.
+      const size_t hashInd = buckets[b];
+      referenceIndices.insert(referenceIndices.end(),
+          bucketContents.memptr() + bucketOffsets[hashInd],
+          bucketContents.memptr() + bucketOffsets[hashInd + 1]);
+    }
+  }
 
-  // For all the buckets that the query is hashed into, sequentially
-  // collect the indices in those buckets.
-  arma::Col<size_t> refPointsConsidered;
-  refPointsConsidered.zeros(referenceSet.n_cols);
+  // A point may be in the buckets of several tables; only keep one copy.  The
+  // number of candidates is usually much smaller than the reference set, so
+  // this is cheaper than marking the candidates in a vector of that size.
+  std::sort(referenceIndices.begin(), referenceIndices.end());
+  referenceIndices.erase(std::unique(referenceIndices.begin(),
+      referenceIndices.end()), referenceIndices.end());
+}
 
-  for (size_t i = 0; i < hashVec.n_elem; i++) // For all tables.
+template<typename SortPolicy, typename NeighborListType>
+void LSHSearch<SortPolicy, NeighborListType>::
+ProbeBuckets(const arma::vec& projection,
+             const size_t numProbes,
+             std::vector<size_t>& buckets) const
+{
+  // The bucket of the key of the query itself.
+  const arma::vec key = arma::floor(projection);
+  const double hash = arma::dot(secondHashWeights, key);
+
+  buckets.clear();
+  buckets.push_back((size_t) hash % secondHashSize);
+
+  if (numProbes == 0)
+    return;
+
+  // Moving coordinate i of the key by -1 crosses the lower boundary of the key
+  // (perturbation 2i), and moving it by +1 crosses the upper boundary
+  // (perturbation 2i + 1).  Each perturbation is scored by the squared
+  // distance from the projection to the boundary, in units of the hash width.
+  std::vector<std::pair<double, size_t> > perturbations(2 * numProj);
+  for (size_t i = 0; i < numProj; i++)
   {
-    size_t hashInd = (size_t) hashVec[i];
+    const double lower = projection[i] - key[i];
+    perturbations[2 * i] = std::make_pair(lower * lower, 2 * i);
+    perturbations[2 * i + 1] = std::make_pair((1.0 - lower) * (1.0 - lower),
+        2 * i + 1);
+  }
+  std::sort(perturbations.begin(), perturbations.end());
+
+  // A perturbation set is a sorted list of positions in 'perturbations'; its
+  // score is the sum of their scores.  Starting from the set holding only the
+  // best perturbation, each set popped from the heap yields the set with its
+  // last position moved forward by one (shift) and the set with the next
+  // position added (expand), so every set is generated once, in order of
+  // score.
+  typedef std::pair<double, std::vector<size_t> > PerturbationSet;
+  std::priority_queue<PerturbationSet, std::vector<PerturbationSet>,
+      std::greater<PerturbationSet> > heap;
+  heap.push(PerturbationSet(perturbations[0].first,
+      std::vector<size_t>(1, 0)));
+
+  while (buckets.size() <= numProbes && !heap.empty())
+  {
+    const PerturbationSet set = heap.top();
+    heap.pop();
 
-    if (bucketContentSize[hashInd] > 0)
+    const size_t last = set.second.back();
+    if (last + 1 < perturbations.size())
     {
-      // Pick the indices in the bucket corresponding to 'hashInd'.
-      size_t tableRow = bucketRowInHashTable[hashInd];
-      assert(tableRow < secondHashSize);
-      assert(tableRow < secondHashTable.n_rows);
+      PerturbationSet shifted = set;
+      shifted.second.back() = last + 1;
+      shifted.first += perturbations[last + 1].first -
+          perturbations[last].first;
+      heap.push(shifted);
+
+      PerturbationSet expanded = set;
+      expanded.second.push_back(last + 1);
+      expanded.first += perturbations[last + 1].first;
+      heap.push(expanded);
+    }
+
+    // A set which moves the same coordinate both ways is not a valid key.
+    bool valid = true;
+    double probeHash = hash;
+    for (size_t j = 0; j < set.second.size() && valid; j++)
+    {
+      const size_t perturbation = perturbations[set.second[j]].second;
+      for (size_t l = 0; l < j; l++)
+        if (perturbations[set.second[l]].second / 2 == perturbation / 2)
+          valid = false;
 
-      for (size_t j = 0; j < bucketContentSize[hashInd]; j++)
-        refPointsConsidered[secondHashTable(tableRow, j)]++;
+      if (perturbation % 2 == 0)
+        probeHash -= secondHashWeights[perturbation / 2];
+      else
+        probeHash += secondHashWeights[perturbation / 2];
     }
-  }
 
-  referenceIndices = arma::find(refPointsConsidered > 0);
+    if (valid)
+      buckets.push_back((size_t) probeHash % secondHashSize);
+  }
 }
 
-
-template<typename SortPolicy>
-void LSHSearch<SortPolicy>::
+template<typename SortPolicy, typename NeighborListType>
+void LSHSearch<SortPolicy, NeighborListType>::
 Search(const size_t k,
        arma::Mat<size_t>& resultingNeighbors,
        arma::mat& distances,
-       const size_t numTablesToSearch)
+       const size_t numTablesToSearch,
+       const size_t numProbes)
 {
+  // If no query set was given, the reference set is also the query set.
+  Search((querySet == NULL) ? *referenceSet : *querySet, k, resultingNeighbors,
+      distances, numTablesToSearch, numProbes);
+}
+
+template<typename SortPolicy, typename NeighborListType>
+void LSHSearch<SortPolicy, NeighborListType>::
+Search(const arma::mat& querySet,
+       const size_t k,
+       arma::Mat<size_t>& resultingNeighbors,
+       arma::mat& distances,
+       const size_t numTablesToSearch,
+       const size_t numProbes)
+{
+  if (querySet.n_rows != referenceSet->n_rows)
+    Log::Fatal << "LSHSearch::Search(): dimensionality of query set ("
+        << querySet.n_rows << ") is not equal to the dimensionality of the "
+        << "reference set (" << referenceSet->n_rows << ")!" << std::endl;
+
   neighborPtr = &resultingNeighbors;
   distancePtr = &distances;
 
@@ -213,30 +285,65 @@ Search(const size_t k,
   neighborPtr->set_size(k, querySet.n_cols);
   distancePtr->set_size(k, querySet.n_cols);
   distancePtr->fill(SortPolicy::WorstDistance());
-  neighborPtr->fill(referenceSet.n_cols);
+  neighborPtr->fill(referenceSet->n_cols);
+
+  // Decide on the number of tables to look into.  If no user input is given,
+  // search all; also make sure that the existing number of tables is not
+  // exceeded.
+  const size_t tablesToSearch = (numTablesToSearch == 0 ||
+      numTablesToSearch > numTables) ? numTables : numTablesToSearch;
 
   size_t avgIndicesReturned = 0;
 
   Timer::Start("computing_neighbors");
 
-  // Go through every query point sequentially.
-  for (size_t i = 0; i < querySet.n_cols; i++)
+  // The queries are processed in blocks.  Each block is hashed into every
+  // table with one matrix multiplication per table; column j of
+  // 'blockProjections' then holds the 'numProj' projections of query j in each
+  // of the 'tablesToSearch' tables, one table after another.
+  const size_t blockSize = 1024;
+  arma::mat blockProjections;
+  for (size_t begin = 0; begin < querySet.n_cols; begin += blockSize)
   {
-    // Hash every query into every hash table and eventually into the
-    // 'secondHashTable' to obtain the neighbor candidates.
-    arma::uvec refIndices;
-    ReturnIndicesFromTable(i, refIndices, numTablesToSearch);
-
-    // An informative book-keeping for the number of neighbor candidates
-    // returned on average.
-    avgIndicesReturned += refIndices.n_elem;
-
-    // Sequentially go through all the candidates and save the best 'k'
-    // candidates.
-    for (size_t j = 0; j < refIndices.n_elem; j++)
-      BaseCase(i, (size_t) refIndices[j]);
+    const size_t end = std::min(begin + blockSize, (size_t) querySet.n_cols);
+
+    blockProjections.set_size(numProj * tablesToSearch, end - begin);
+    for (size_t i = 0; i < tablesToSearch; i++)
+    {
+      blockProjections.rows(i * numProj, (i + 1) * numProj - 1) =
+          projections[i].t() * querySet.cols(begin, end - 1);
+      blockProjections.rows(i * numProj, (i + 1) * numProj - 1) +=
+          arma::repmat(offsets.unsafe_col(i), 1, end - begin);
+    }
+    blockProjections /= hashWidth;
+
+    // Each query only writes to its own column of the results, so the queries
+    // can be split between threads.
+    #pragma omp parallel for schedule(dynamic, 16) \
+        reduction(+:avgIndicesReturned)
+    for (size_t i = begin; i < end; i++)
+    {
+      // Hash every query into every hash table and eventually into the
+      // 'secondHashTable' to obtain the neighbor candidates.
+      const arma::mat queryProjections(blockProjections.colptr(i - begin),
+          numProj, tablesToSearch, false);
+      std::vector<size_t> refIndices;
+      ReturnIndicesFromTable(queryProjections, numProbes, refIndices);
+
+      // An informative book-keeping for the number of neighbor candidates
+      // returned on average.
+      avgIndicesReturned += refIndices.size();
+
+      // Sequentially go through all the candidates and save the best 'k'
+      // candidates.
+      for (size_t j = 0; j < refIndices.size(); j++)
+        BaseCase(querySet, i, refIndices[j]);
+    }
   }
 
+  // Put the candidate lists in order.
+  NeighborListType::Finalize(*distancePtr, *neighborPtr);
+
   Timer::Stop("computing_neighbors");
 
   avgIndicesReturned /= querySet.n_cols;
@@ -244,8 +351,8 @@ Search(const size_t k,
       std::endl;
 }
 
-template<typename SortPolicy>
-void LSHSearch<SortPolicy>::
+template<typename SortPolicy, typename NeighborListType>
+void LSHSearch<SortPolicy, NeighborListType>::
 BuildHash()
 {
   // The first level hash for a single table outputs a 'numProj'-dimensional
@@ -269,123 +376,255 @@ BuildHash()
   secondHashWeights = arma::floor(arma::randu(numProj) *
                                   (double) secondHashSize);
 
-  // The 'secondHashTable' is initially an empty matrix of size
-  // ('secondHashSize' x 'bucketSize'). But by only filling the buckets
-  // as points land in them allows us to shrink the size of the
-  // 'secondHashTable' at the end of the hashing.
-
-  // Fill the second hash table n = referenceSet.n_cols.  This is because no
-  // point has index 'n' so the presence of this in the bucket denotes that
-  // there are no more points in this bucket.
-  secondHashTable.set_size(secondHashSize, bucketSize);
-  secondHashTable.fill(referenceSet.n_cols);
-
-  // Keep track of the size of each bucket in the hash.  At the end of hashing
-  // most buckets will be empty.
-  bucketContentSize.zeros(secondHashSize);
-
-  // Instead of putting the points in the row corresponding to the bucket, we
-  // chose the next empty row and keep track of the row in which the bucket
-  // lies. This allows us to stack together and slice out the empty buckets at
-  // the end of the hashing.
-  bucketRowInHashTable.set_size(secondHashSize);
-  bucketRowInHashTable.fill(secondHashSize);
-
-  // Keep track of number of non-empty rows in the 'secondHashTable'.
-  size_t numRowsInTable = 0;
-
   // Step II: The offsets for all projections in all tables.
   // Since the 'offsets' are in [0, hashWidth], we obtain the 'offsets'
   // as randu(numProj, numTables) * hashWidth.
   offsets.randu(numProj, numTables);
   offsets *= hashWidth;
 
-  // Step III: Create each hash table in the first level hash one by one and
-  // putting them directly into the 'secondHashTable' for memory efficiency.
+  // Step III: Obtain the 'numProj' projections for each table.
+  // For L2 metric, 2-stable distributions are used, and
+  // the normal Z ~ N(0, 1) is a 2-stable distribution.
+  projections.clear();
   for (size_t i = 0; i < numTables; i++)
   {
-    // Step IV: Obtain the 'numProj' projections for each table.
-
-    // For L2 metric, 2-stable distributions are used, and
-    // the normal Z ~ N(0, 1) is a 2-stable distribution.
     arma::mat projMat;
-    projMat.randn(referenceSet.n_rows, numProj);
+    projMat.randn(referenceSet->n_rows, numProj);
 
     // Save the projection matrix for querying.
     projections.push_back(projMat);
+  }
 
-    // Step V: create the 'numProj'-dimensional key for each point in each
-    // table.
-
-    // The following code performs the task of hashing each point to a
-    // 'numProj'-dimensional integer key.  Hence you get a ('numProj' x
-    // 'referenceSet.n_cols') key matrix.
-    //
-    // For a single table, let the 'numProj' projections be denoted by 'proj_i'
-    // and the corresponding offset be 'offset_i'.  Then the key of a single
-    // point is obtained as:
-    // key = { floor( (<proj_i, point> + offset_i) / 'hashWidth' ) forall i }
-    arma::mat offsetMat = arma::repmat(offsets.unsafe_col(i), 1,
-                                       referenceSet.n_cols);
-    arma::mat hashMat = projMat.t() * referenceSet;
-    hashMat += offsetMat;
-    hashMat /= hashWidth;
-
-    // Step VI: Putting the points in the 'secondHashTable' by hashing the key.
-    // Now we hash every key, point ID to its corresponding bucket.
-    arma::rowvec secondHashVec = secondHashWeights.t()
-      * arma::floor(hashMat);
-
-    // This gives us the bucket for the corresponding point ID.
-    for (size_t j = 0; j < secondHashVec.n_elem; j++)
-      secondHashVec[j] = (double)((size_t) secondHashVec[j] % secondHashSize);
-
-    Log::Assert(secondHashVec.n_elem == referenceSet.n_cols);
-
-    // Insert the point in the corresponding row to its bucket in the
-    // 'secondHashTable'.
-    for (size_t j = 0; j < secondHashVec.n_elem; j++)
-    {
-      // This is the bucket number.
-      size_t hashInd = (size_t) secondHashVec[j];
-      // The point ID is 'j'.
+  // Step IV: Put every point of the reference set into its bucket in every
+  // table.
+  bucketOffsets.zeros(secondHashSize + 1);
+  bucketContents.reset();
+  InsertIntoBuckets(*referenceSet, 0);
+}
 
-      // If this is currently an empty bucket, start a new row keep track of
-      // which row corresponds to the bucket.
-      if (bucketContentSize[hashInd] == 0)
-      {
-        // Start a new row for hash.
-        bucketRowInHashTable[hashInd] = numRowsInTable;
-        secondHashTable(numRowsInTable, 0) = j;
+template<typename SortPolicy, typename NeighborListType>
+void LSHSearch<SortPolicy, NeighborListType>::
+Insert(const arma::mat& newPoints)
+{
+  if (newPoints.n_rows != referenceSet->n_rows)
+    Log::Fatal << "LSHSearch::Insert(): dimensionality of new points ("
+        << newPoints.n_rows << ") is not equal to the dimensionality of the "
+        << "reference set (" << referenceSet->n_rows << ")!" << std::endl;
 
-        numRowsInTable++;
-      }
+  // The caller's reference set is only copied when it has to grow.
+  if (referenceSet != &ownedReferenceSet)
+  {
+    ownedReferenceSet = *referenceSet;
+    referenceSet = &ownedReferenceSet;
+  }
 
-      else
+  const size_t firstIndex = ownedReferenceSet.n_cols;
+  ownedReferenceSet.insert_cols(firstIndex, newPoints);
+
+  InsertIntoBuckets(newPoints, firstIndex);
+}
+
+template<typename SortPolicy, typename NeighborListType>
+void LSHSearch<SortPolicy, NeighborListType>::
+InsertIntoBuckets(const arma::mat& points, const size_t firstIndex)
+{
+  // Count the new points in each bucket of the 'secondHashTable'.  Hashing
+  // twice is cheaper than holding the bucket of every point in every table.
+  // If the buckets have a maximum size, the first points hashed into each
+  // bucket are kept.
+  arma::Col<size_t> bucketCounts(secondHashSize);
+  for (size_t i = 0; i < secondHashSize; i++)
+    bucketCounts[i] = bucketOffsets[i + 1] - bucketOffsets[i];
+
+  arma::Col<size_t> pointBuckets;
+  for (size_t i = 0; i < numTables; i++)
+  {
+    HashPoints(points, i, pointBuckets);
+    for (size_t j = 0; j < pointBuckets.n_elem; j++)
+      if (bucketSize == 0 || bucketCounts[pointBuckets[j]] < bucketSize)
+        bucketCounts[pointBuckets[j]]++;
+  }
+
+  // Lay the buckets out one after another, and copy the points that are
+  // already in each bucket to the start of its new place.  The counts are
+  // reused as the number of points placed in each bucket so far.
+  arma::Col<size_t> newOffsets(secondHashSize + 1);
+  newOffsets[0] = 0;
+  for (size_t i = 0; i < secondHashSize; i++)
+    newOffsets[i + 1] = newOffsets[i] + bucketCounts[i];
+
+  arma::Col<size_t> newContents(newOffsets[secondHashSize]);
+  for (size_t i = 0; i < secondHashSize; i++)
+  {
+    bucketCounts[i] = bucketOffsets[i + 1] - bucketOffsets[i];
+    std::copy(bucketContents.memptr() + bucketOffsets[i],
+        bucketContents.memptr() + bucketOffsets[i + 1],
+        newContents.memptr() + newOffsets[i]);
+  }
+
+  // Now put the ID of each new point into the next free place in its bucket.
+  for (size_t i = 0; i < numTables; i++)
+  {
+    HashPoints(points, i, pointBuckets);
+    for (size_t j = 0; j < pointBuckets.n_elem; j++)
+    {
+      const size_t hashInd = pointBuckets[j];
+      const size_t position = newOffsets[hashInd] + bucketCounts[hashInd];
+      if (position < newOffsets[hashInd + 1])
       {
-        // If bucket is already present in the 'secondHashTable', find the
-        // corresponding row and insert the point ID in this row unless the
-        // bucket is full, in which case, do nothing.
-        if (bucketContentSize[hashInd] < bucketSize)
-          secondHashTable(bucketRowInHashTable[hashInd],
-                          bucketContentSize[hashInd]) = j;
+        newContents[position] = firstIndex + j;
+        bucketCounts[hashInd]++;
       }
+    }
+  }
 
-      // Increment the count of the points in this bucket.
-      if (bucketContentSize[hashInd] < bucketSize)
-        bucketContentSize[hashInd]++;
-    } // Loop over all points in the reference set.
-  } // Loop over tables.
+  bucketOffsets.steal_mem(newOffsets);
+  bucketContents.steal_mem(newContents);
 
-  // Step VII: Condensing the 'secondHashTable'.
+  size_t nonEmptyBuckets = 0;
   size_t maxBucketSize = 0;
-  for (size_t i = 0; i < bucketContentSize.n_elem; i++)
-    if (bucketContentSize[i] > maxBucketSize)
-      maxBucketSize = bucketContentSize[i];
+  for (size_t i = 0; i < secondHashSize; i++)
+  {
+    if (bucketCounts[i] > 0)
+      nonEmptyBuckets++;
+    if (bucketCounts[i] > maxBucketSize)
+      maxBucketSize = bucketCounts[i];
+  }
+
+  Log::Info << "Final hash table size: " << bucketContents.n_elem << " points "
+      << "in " << nonEmptyBuckets << " buckets (largest bucket: "
+      << maxBucketSize << " points)." << std::endl;
+}
 
-  Log::Info << "Final hash table size: (" << numRowsInTable << " x "
-            << maxBucketSize << ")" << std::endl;
-  secondHashTable.resize(numRowsInTable, maxBucketSize);
+template<typename SortPolicy, typename NeighborListType>
+void LSHSearch<SortPolicy, NeighborListType>::
+HashPoints(const arma::mat& points,
+           const size_t table,
+           arma::Col<size_t>& pointBuckets) const
+{
+  // The following code performs the task of hashing each point to a
+  // 'numProj'-dimensional integer key.  Hence you get a ('numProj' x
+  // 'points.n_cols') key matrix.
+  //
+  // For a single table, let the 'numProj' projections be denoted by 'proj_i'
+  // and the corresponding offset be 'offset_i'.  Then the key of a single
+  // point is obtained as:
+  // key = { floor( (<proj_i, point> + offset_i) / 'hashWidth' ) forall i }
+  arma::mat offsetMat = arma::repmat(offsets.unsafe_col(table), 1,
+                                     points.n_cols);
+  arma::mat hashMat = projections[table].t() * points;
+  hashMat += offsetMat;
+  hashMat /= hashWidth;
+
+  // Now we hash every key to its corresponding bucket in the
+  // 'secondHashTable'.
+  arma::rowvec secondHashVec = secondHashWeights.t() * arma::floor(hashMat);
+
+  Log::Assert(secondHashVec.n_elem == points.n_cols);
+
+  pointBuckets.set_size(secondHashVec.n_elem);
+  for (size_t j = 0; j < secondHashVec.n_elem; j++)
+    pointBuckets[j] = (size_t) secondHashVec[j] % secondHashSize;
+}
+
+template<typename SortPolicy, typename NeighborListType>
+void LSHSearch<SortPolicy, NeighborListType>::
+Save(const std::string& filename) const
+{
+  std::ofstream stream(filename.c_str(), std::fstream::binary);
+  if (!stream.is_open())
+  {
+    Log::Warn << "LSHSearch::Save(): could not open '" << filename << "' for "
+        << "writing." << std::endl;
+    return;
+  }
+
+  // The parameters come first, then each matrix, in Armadillo's binary format.
+  arma::Col<size_t> parameters(4);
+  parameters[0] = numProj;
+  parameters[1] = numTables;
+  parameters[2] = secondHashSize;
+  parameters[3] = bucketSize;
+  arma::vec width(1);
+  width[0] = hashWidth;
+
+  bool success = parameters.save(stream, arma::arma_binary) &&
+      width.save(stream, arma::arma_binary) &&
+      referenceSet->save(stream, arma::arma_binary) &&
+      offsets.save(stream, arma::arma_binary) &&
+      secondHashWeights.save(stream, arma::arma_binary);
+  for (size_t i = 0; i < numTables && success; i++)
+    success = projections[i].save(stream, arma::arma_binary);
+  success = success && bucketOffsets.save(stream, arma::arma_binary) &&
+      bucketContents.save(stream, arma::arma_binary);
+
+  if (!success)
+    Log::Warn << "LSHSearch::Save(): error saving to '" << filename << "'."
+        << std::endl;
+}
+
+template<typename SortPolicy, typename NeighborListType>
+void LSHSearch<SortPolicy, NeighborListType>::
+Load(const std::string& filename)
+{
+  std::ifstream stream(filename.c_str(), std::fstream::binary);
+  if (!stream.is_open())
+    Log::Fatal << "LSHSearch::Load(): could not read file '" << filename
+        << "'!" << std::endl;
+
+  arma::Col<size_t> parameters;
+  arma::vec width;
+  bool success = parameters.load(stream, arma::arma_binary) &&
+      (parameters.n_elem == 4) &&
+      width.load(stream, arma::arma_binary) &&
+      (width.n_elem == 1);
+  if (!success)
+    Log::Fatal << "LSHSearch::Load(): '" << filename << "' is not a hash "
+        << "saved by LSHSearch::Save()!" << std::endl;
+
+  numProj = parameters[0];
+  numTables = parameters[1];
+  secondHashSize = parameters[2];
+  bucketSize = parameters[3];
+  hashWidth = width[0];
+
+  // The loaded reference set is held by this object.
+  referenceSet = &ownedReferenceSet;
+  originalReferenceSet = NULL;
+  success = ownedReferenceSet.load(stream, arma::arma_binary) &&
+      offsets.load(stream, arma::arma_binary) &&
+      secondHashWeights.load(stream, arma::arma_binary);
+  projections.resize(numTables);
+  for (size_t i = 0; i < numTables && success; i++)
+    success = projections[i].load(stream, arma::arma_binary) &&
+        (projections[i].n_rows == referenceSet->n_rows) &&
+        (projections[i].n_cols == numProj);
+  success = success && bucketOffsets.load(stream, arma::arma_binary) &&
+      bucketContents.load(stream, arma::arma_binary);
+
+  // Make sure the sizes fit together, so that searching can't go out of
+  // bounds.  Bucket i holds the points between bucketOffsets[i] and
+  // bucketOffsets[i + 1], so the offsets can't decrease, and the last one must
+  // be the end of the bucket contents.
+  success = success && (secondHashSize > 0) &&
+      (bucketOffsets.n_elem == secondHashSize + 1);
+  for (size_t i = 0; i < secondHashSize && success; i++)
+    success = (bucketOffsets[i] <= bucketOffsets[i + 1]);
+
+  if (!success || offsets.n_rows != numProj || offsets.n_cols != numTables ||
+      secondHashWeights.n_elem != numProj ||
+      bucketOffsets[secondHashSize] != bucketContents.n_elem ||
+      (bucketContents.n_elem > 0 &&
+       bucketContents.max() >= referenceSet->n_cols))
+    Log::Fatal << "LSHSearch::Load(): error loading hash from '" << filename
+        << "'!" << std::endl;
+
+  // The reference set is now also the query set.
+  querySet = NULL;
+
+  Log::Info << "Loaded hash of " << referenceSet->n_cols << " points with "
+      << numProj << " projections (K) and " << numTables << " tables (L) with "
+      << "hash width " << hashWidth << "." << std::endl;
 }
 
 }; // namespace neighbor
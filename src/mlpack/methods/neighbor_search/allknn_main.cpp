@@ -14,6 +14,7 @@
 
 #include "neighbor_search.hpp"
 #include "unmap.hpp"
+#include "chunked_search.hpp"
 
 using namespace std;
 using namespace mlpack;
@@ -39,11 +40,26 @@ PROGRAM_INFO("All K-Nearest-Neighbors",
     "neighbors output file corresponds to the index of the point in the "
     "reference set which is the i'th nearest neighbor from the point in the "
     "query set with index j.  Row i and column j in the distances output file "
-    "corresponds to the distance between those two points.");
+    "corresponds to the distance between those two points."
+    "\n\n"
+    "When many query sets are used with the same reference set, the reference "
+    "kd-tree can be saved with --save_tree_file and then given to later runs "
+    "with --reference_tree_file (instead of --reference_file), so that it does "
+    "not need to be rebuilt."
+    "\n\n"
+    "Query files which are too large to fit in memory can be processed with "
+    "--query_chunk_size: the query points are then read, searched for, and "
+    "written to the output files that many points at a time.  This requires "
+    "kd-trees, and the query file and the output files must be CSV (.csv) or "
+    "raw ASCII (.txt) files."
+    "\n\n"
+    "With --single_precision, the search is done with single-precision "
+    "(float) data, which halves the memory used by the datasets and the trees, "
+    "at the cost of less accurate distances.");
 
 // Define our input parameters that this program will take.
-PARAM_STRING_REQ("reference_file", "File containing the reference dataset.",
-    "r");
+PARAM_STRING("reference_file", "File containing the reference dataset.", "r",
+    "");
 PARAM_STRING_REQ("distances_file", "File to output distances into.", "d");
 PARAM_STRING_REQ("neighbors_file", "File to output neighbors into.", "n");
 
@@ -51,6 +67,11 @@ PARAM_INT_REQ("k", "Number of nearest neighbors to find.", "k");
 
 PARAM_STRING("query_file", "File containing query points (optional).", "q", "");
 
+PARAM_STRING("reference_tree_file", "File containing a reference kd-tree saved "
+    "with --save_tree_file, to use instead of --reference_file.", "t", "");
+PARAM_STRING("save_tree_file", "If specified, the reference kd-tree (and the "
+    "reference dataset) will be saved to this file.", "T", "");
+
 PARAM_INT("leaf_size", "Leaf size for tree building.", "l", 20);
 PARAM_FLAG("naive", "If true, O(n^2) naive mode is used for computation.", "N");
 PARAM_FLAG("single_mode", "If true, single-tree search is used (as opposed to "
@@ -60,6 +81,12 @@ PARAM_FLAG("cover_tree", "If true, use cover trees to perform the search "
 PARAM_FLAG("random_basis", "Before tree-building, project the data onto a "
     "random orthogonal basis.", "R");
 PARAM_INT("seed", "Random seed (if 0, std::time(NULL) is used).", "s", 0);
+PARAM_FLAG("single_precision", "If true, the datasets are converted to single "
+    "precision and the search is done in single precision (kd-trees only).",
+    "P");
+PARAM_INT("query_chunk_size", "If nonzero, the query file is processed in "
+    "chunks of this many points, so that it does not need to fit in memory.",
+    "C", 0);
 
 int main(int argc, char *argv[])
 {
@@ -74,6 +101,8 @@ int main(int argc, char *argv[])
   // Get all the parameters.
   const string referenceFile = CLI::GetParam<string>("reference_file");
   const string queryFile = CLI::GetParam<string>("query_file");
+  const string referenceTreeFile = CLI::GetParam<string>("reference_tree_file");
+  const string saveTreeFile = CLI::GetParam<string>("save_tree_file");
 
   const string distancesFile = CLI::GetParam<string>("distances_file");
   const string neighborsFile = CLI::GetParam<string>("neighbors_file");
@@ -86,14 +115,82 @@ int main(int argc, char *argv[])
   bool singleMode = CLI::HasParam("single_mode");
   const bool randomBasis = CLI::HasParam("random_basis");
 
+  // Sanity check on the chunk size.
+  if (CLI::GetParam<int>("query_chunk_size") < 0)
+  {
+    Log::Fatal << "Invalid query chunk size: "
+        << CLI::GetParam<int>("query_chunk_size") << ".  Must be greater than "
+        << "or equal to 0." << endl;
+  }
+  const size_t queryChunkSize = CLI::GetParam<int>("query_chunk_size");
+
+  typedef BinarySpaceTree<bound::HRectBound<2>,
+      NeighborSearchStat<NearestNeighborSort> > TreeType;
+
+  // Exactly one source of reference points must be given.
+  if ((referenceFile == "") == (referenceTreeFile == ""))
+  {
+    Log::Fatal << "Exactly one of --reference_file and --reference_tree_file "
+        << "must be specified." << endl;
+  }
+
+  if (referenceTreeFile != "" && (naive || randomBasis ||
+      CLI::HasParam("cover_tree")))
+  {
+    Log::Fatal << "--reference_tree_file cannot be used with --naive, "
+        << "--random_basis, or --cover_tree." << endl;
+  }
+
+  if (saveTreeFile != "" && (randomBasis || CLI::HasParam("cover_tree")))
+  {
+    Log::Fatal << "--save_tree_file cannot be used with --random_basis or "
+        << "--cover_tree." << endl;
+  }
+
+  const bool singlePrecision = CLI::HasParam("single_precision");
+  if (singlePrecision && (CLI::HasParam("cover_tree") ||
+      referenceTreeFile != "" || saveTreeFile != "" || queryChunkSize != 0))
+  {
+    Log::Fatal << "--single_precision cannot be used with --cover_tree, "
+        << "--reference_tree_file, --save_tree_file, or --query_chunk_size."
+        << endl;
+  }
+
+  if (queryChunkSize != 0 && (queryFile == "" || CLI::HasParam("cover_tree")))
+  {
+    Log::Fatal << "--query_chunk_size requires --query_file, and cannot be "
+        << "used with --cover_tree." << endl;
+  }
+
   arma::mat referenceData;
   arma::mat queryData; // So it doesn't go out of scope.
-  data::Load(referenceFile, referenceData, true);
+  MappedTree<TreeType>* mappedTree = NULL;
 
-  Log::Info << "Loaded reference data from '" << referenceFile << "' ("
-      << referenceData.n_rows << " x " << referenceData.n_cols << ")." << endl;
+  if (referenceTreeFile != "")
+  {
+    // The reference set is stored in the tree file.
+    Timer::Start("tree_loading");
+    mappedTree = new MappedTree<TreeType>(referenceTreeFile);
+    Timer::Stop("tree_loading");
+
+    Log::Info << "Loaded reference tree from '" << referenceTreeFile << "' ("
+        << mappedTree->Dataset().n_rows << " x "
+        << mappedTree->Dataset().n_cols << ")." << endl;
+  }
+  else
+  {
+    data::Load(referenceFile, referenceData, true);
 
-  if (queryFile != "")
+    Log::Info << "Loaded reference data from '" << referenceFile << "' ("
+        << referenceData.n_rows << " x " << referenceData.n_cols << ")."
+        << endl;
+  }
+
+  const size_t numReferences = (mappedTree == NULL) ? referenceData.n_cols :
+      mappedTree->Dataset().n_cols;
+
+  // In streaming mode, the queries are loaded later, a chunk at a time.
+  if (queryFile != "" && queryChunkSize == 0)
   {
     data::Load(queryFile, queryData, true);
     Log::Info << "Loaded query data from '" << queryFile << "' ("
@@ -102,11 +199,11 @@ int main(int argc, char *argv[])
 
   // Sanity check on k value: must be greater than 0, must be less than the
   // number of reference points.
-  if (k > referenceData.n_cols)
+  if (k > numReferences)
   {
     Log::Fatal << "Invalid k: " << k << "; must be greater than 0 and less ";
     Log::Fatal << "than or equal to the number of reference points (";
-    Log::Fatal << referenceData.n_cols << ")." << endl;
+    Log::Fatal << numReferences << ")." << endl;
   }
 
   // Sanity check on leaf size.
@@ -126,7 +223,9 @@ int main(int argc, char *argv[])
   if (naive)
     leafSize = referenceData.n_cols;
 
-  // See if we want to project onto a random basis.
+  // See if we want to project onto a random basis.  The basis is kept so that
+  // query chunks can be projected too.
+  arma::mat basis;
   if (randomBasis)
   {
     // Generate the random basis.
@@ -155,8 +254,10 @@ int main(int argc, char *argv[])
         if (arma::det(q) >= 0)
         {
           referenceData = q * referenceData;
-          if (queryFile != "")
+          // In streaming mode, each chunk is projected when it is loaded.
+          if (queryFile != "" && queryChunkSize == 0)
             queryData = q * queryData;
+          basis = q;
           break;
         }
       }
@@ -166,7 +267,37 @@ int main(int argc, char *argv[])
   arma::Mat<size_t> neighbors;
   arma::mat distances;
 
-  if (!CLI::HasParam("cover_tree"))
+  if (singlePrecision)
+  {
+    // Convert the datasets to single precision, and free the double precision
+    // datasets, so that only the single precision datasets are kept in memory
+    // during the search.
+    Log::Info << "Converting datasets to single precision..." << endl;
+    arma::fmat referenceDataF = arma::conv_to<arma::fmat>::from(referenceData);
+    referenceData.reset();
+    arma::fmat queryDataF = arma::conv_to<arma::fmat>::from(queryData);
+    queryData.reset();
+
+    // The trees are built on the datasets, which are taken by the search
+    // object, and the results are mapped back to the original indices.
+    Log::Info << "Building trees..." << endl;
+    AllkNNSinglePrecision* allknn = NULL;
+    if (queryFile != "")
+      allknn = new AllkNNSinglePrecision(&referenceDataF, &queryDataF, naive,
+          singleMode, leafSize);
+    else
+      allknn = new AllkNNSinglePrecision(&referenceDataF, naive, singleMode,
+          leafSize);
+    Log::Info << "Trees built." << endl;
+
+    Log::Info << "Computing " << k << " nearest neighbors..." << endl;
+    allknn->Search(k, neighbors, distances);
+
+    Log::Info << "Neighbors computed." << endl;
+
+    delete allknn;
+  }
+  else if (!CLI::HasParam("cover_tree"))
   {
     // Because we may construct it differently, we need a pointer.
     AllkNN* allknn = NULL;
@@ -174,84 +305,117 @@ int main(int argc, char *argv[])
     // Mappings for when we build the tree.
     std::vector<size_t> oldFromNewRefs;
 
-    // Build trees by hand, so we can save memory: if we pass a tree to
-    // NeighborSearch, it does not copy the matrix.
-    Log::Info << "Building reference tree..." << endl;
-    Timer::Start("tree_building");
+    TreeType* refTree = NULL;
+    TreeType* queryTree = NULL; // Empty for now.
 
-    BinarySpaceTree<bound::HRectBound<2>,
-        NeighborSearchStat<NearestNeighborSort> >
-        refTree(referenceData, oldFromNewRefs, leafSize);
-    BinarySpaceTree<bound::HRectBound<2>,
-        NeighborSearchStat<NearestNeighborSort> >*
-        queryTree = NULL; // Empty for now.
+    if (mappedTree != NULL)
+    {
+      // The loaded tree is used as-is.
+      refTree = &mappedTree->Tree();
+      oldFromNewRefs = mappedTree->OldFromNew();
+    }
+    else
+    {
+      // Build trees by hand, so we can save memory: if we pass a tree to
+      // NeighborSearch, it does not copy the matrix.
+      Log::Info << "Building reference tree..." << endl;
+      Timer::Start("tree_building");
 
-    Timer::Stop("tree_building");
+      refTree = new TreeType(referenceData, oldFromNewRefs, leafSize);
+
+      // Lay the tree out contiguously in memory, for faster traversals.
+      refTree->Compact();
+
+      Timer::Stop("tree_building");
+
+      if (saveTreeFile != "")
+      {
+        Log::Info << "Saving reference tree to '" << saveTreeFile << "'..."
+            << endl;
+        MappedTree<TreeType>::Save(saveTreeFile, *refTree, oldFromNewRefs);
+      }
+    }
 
     std::vector<size_t> oldFromNewQueries;
 
-    if (CLI::GetParam<string>("query_file") != "")
+    if (queryChunkSize != 0)
     {
-      if (naive && leafSize < queryData.n_cols)
-        leafSize = queryData.n_cols;
+      // Stream the queries through the reference tree, one chunk at a time,
+      // so that only one chunk of queries and results is in memory at once.
+      ChunkedSearch(*refTree, oldFromNewRefs, queryFile, queryChunkSize, k,
+          neighborsFile, distancesFile, naive, singleMode, leafSize, basis);
 
-      Log::Info << "Loaded query data from '" << queryFile << "' ("
-          << queryData.n_rows << " x " << queryData.n_cols << ")." << endl;
+      Log::Info << "Neighbors computed." << endl;
+    }
+    else
+    {
+      if (CLI::GetParam<string>("query_file") != "")
+      {
+        if (naive && leafSize < queryData.n_cols)
+          leafSize = queryData.n_cols;
 
-      Log::Info << "Building query tree..." << endl;
+        Log::Info << "Loaded query data from '" << queryFile << "' ("
+            << queryData.n_rows << " x " << queryData.n_cols << ")." << endl;
 
-      // Build trees by hand, so we can save memory: if we pass a tree to
-      // NeighborSearch, it does not copy the matrix.
-      if (!singleMode)
-      {
-        Timer::Start("tree_building");
+        Log::Info << "Building query tree..." << endl;
 
-        queryTree = new BinarySpaceTree<bound::HRectBound<2>,
-            NeighborSearchStat<NearestNeighborSort> >(queryData,
-            oldFromNewQueries, leafSize);
+        // Build trees by hand, so we can save memory: if we pass a tree to
+        // NeighborSearch, it does not copy the matrix.
+        if (!singleMode)
+        {
+          Timer::Start("tree_building");
 
-        Timer::Stop("tree_building");
-      }
+          queryTree = new TreeType(queryData, oldFromNewQueries, leafSize);
+          queryTree->Compact();
 
-      allknn = new AllkNN(&refTree, queryTree, referenceData, queryData,
-          singleMode);
+          Timer::Stop("tree_building");
+        }
 
-      Log::Info << "Tree built." << endl;
-    }
-    else
-    {
-      allknn = new AllkNN(&refTree, referenceData, singleMode);
+        allknn = new AllkNN(refTree, queryTree, refTree->Dataset(), queryData,
+            singleMode);
 
-      Log::Info << "Trees built." << endl;
-    }
+        Log::Info << "Tree built." << endl;
+      }
+      else
+      {
+        allknn = new AllkNN(refTree, refTree->Dataset(), singleMode);
 
-    arma::mat distancesOut;
-    arma::Mat<size_t> neighborsOut;
+        Log::Info << "Trees built." << endl;
+      }
 
-    Log::Info << "Computing " << k << " nearest neighbors..." << endl;
-    allknn->Search(k, neighborsOut, distancesOut);
+      arma::mat distancesOut;
+      arma::Mat<size_t> neighborsOut;
 
-    Log::Info << "Neighbors computed." << endl;
+      Log::Info << "Computing " << k << " nearest neighbors..." << endl;
+      allknn->Search(k, neighborsOut, distancesOut);
 
-    // We have to map back to the original indices from before the tree
-    // construction.
-    Log::Info << "Re-mapping indices..." << endl;
+      Log::Info << "Neighbors computed." << endl;
 
-    // Map the results back to the correct places.
-    if ((CLI::GetParam<string>("query_file") != "") && !singleMode)
-      Unmap(neighborsOut, distancesOut, oldFromNewRefs, oldFromNewQueries,
-          neighbors, distances);
-    else if ((CLI::GetParam<string>("query_file") != "") && singleMode)
-      Unmap(neighborsOut, distancesOut, oldFromNewRefs, neighbors, distances);
-    else
-      Unmap(neighborsOut, distancesOut, oldFromNewRefs, oldFromNewRefs,
-          neighbors, distances);
+      // We have to map back to the original indices from before the tree
+      // construction.
+      Log::Info << "Re-mapping indices..." << endl;
+
+      // Map the results back to the correct places.
+      if ((CLI::GetParam<string>("query_file") != "") && !singleMode)
+        Unmap(neighborsOut, distancesOut, oldFromNewRefs, oldFromNewQueries,
+            neighbors, distances);
+      else if ((CLI::GetParam<string>("query_file") != "") && singleMode)
+        Unmap(neighborsOut, distancesOut, oldFromNewRefs, neighbors, distances);
+      else
+        Unmap(neighborsOut, distancesOut, oldFromNewRefs, oldFromNewRefs,
+            neighbors, distances);
+    }
 
     // Clean up.
     if (queryTree)
       delete queryTree;
 
     delete allknn;
+
+    if (mappedTree != NULL)
+      delete mappedTree;
+    else
+      delete refTree;
   }
   else // Cover trees.
   {
@@ -310,7 +474,10 @@ int main(int argc, char *argv[])
       delete queryTree;
   }
 
-  // Save output.
-  data::Save(distancesFile, distances);
-  data::Save(neighborsFile, neighbors);
+  // Save output.  In streaming mode, it has already been saved.
+  if (queryChunkSize == 0)
+  {
+    data::Save(distancesFile, distances);
+    data::Save(neighborsFile, neighbors);
+  }
 }
@@ -0,0 +1,64 @@
+/**
+ * @file chunked_search.hpp
+ * @author Ryan Curtin
+ *
+ * A function which finds the nearest neighbors of the points in a query file
+ * that is too large to be held in memory, a chunk of query points at a time.
+ */
+#ifndef __MLPACK_METHODS_NEIGHBOR_SEARCH_CHUNKED_SEARCH_HPP
+#define __MLPACK_METHODS_NEIGHBOR_SEARCH_CHUNKED_SEARCH_HPP
+
+#include <mlpack/core.hpp>
+
+#include "neighbor_search.hpp"
+#include "unmap.hpp"
+
+namespace mlpack {
+namespace neighbor {
+
+/**
+ * Find the k nearest neighbors of the points in a query file, loading the
+ * query points a chunk at a time with data::ChunkedLoader and saving the
+ * results of each chunk with data::ChunkedSaver as soon as they are found, so
+ * that only one chunk of query points and results is in memory at once.  The
+ * saved files are the same as the files data::Save() would write for the
+ * results of a search on the whole query set: column i holds the results of
+ * the i'th query point in the file, and the neighbors are indices into the
+ * original (unmapped) reference set.
+ *
+ * @tparam TreeType Type of the reference tree (a kd-tree).
+ * @param referenceTree Tree built on the reference set.
+ * @param oldFromNewReferences Mapping from the indices of the points in the
+ *     tree's dataset to the original reference indices.
+ * @param queryFile File containing the query points.
+ * @param chunkSize Maximum number of query points to load at once.
+ * @param k Number of nearest neighbors to find.
+ * @param neighborsFile File to save the neighbors into.
+ * @param distancesFile File to save the distances into.
+ * @param naive If true, each chunk is searched as a single leaf.
+ * @param singleMode If true, single-tree search is used.
+ * @param leafSize Leaf size of the trees built on the query chunks.
+ * @param basis If not empty, each query chunk is multiplied by this matrix
+ *     before it is searched (use this if the reference set was projected onto
+ *     a basis).
+ */
+template<typename TreeType>
+void ChunkedSearch(TreeType& referenceTree,
+                   const std::vector<size_t>& oldFromNewReferences,
+                   const std::string& queryFile,
+                   const size_t chunkSize,
+                   const size_t k,
+                   const std::string& neighborsFile,
+                   const std::string& distancesFile,
+                   const bool naive = false,
+                   const bool singleMode = false,
+                   const size_t leafSize = 20,
+                   const arma::mat& basis = arma::mat());
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+// Include implementation.
+#include "chunked_search_impl.hpp"
+
+#endif
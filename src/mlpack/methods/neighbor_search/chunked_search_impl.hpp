@@ -0,0 +1,97 @@
+/**
+ * @file chunked_search_impl.hpp
+ * @author Ryan Curtin
+ *
+ * Implementation of ChunkedSearch().
+ */
+#ifndef __MLPACK_METHODS_NEIGHBOR_SEARCH_CHUNKED_SEARCH_IMPL_HPP
+#define __MLPACK_METHODS_NEIGHBOR_SEARCH_CHUNKED_SEARCH_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "chunked_search.hpp"
+
+namespace mlpack {
+namespace neighbor {
+
+template<typename TreeType>
+void ChunkedSearch(TreeType& referenceTree,
+                   const std::vector<size_t>& oldFromNewReferences,
+                   const std::string& queryFile,
+                   const size_t chunkSize,
+                   const size_t k,
+                   const std::string& neighborsFile,
+                   const std::string& distancesFile,
+                   const bool naive,
+                   const bool singleMode,
+                   const size_t leafSize,
+                   const arma::mat& basis)
+{
+  typedef NeighborSearch<NearestNeighborSort, metric::EuclideanDistance,
+      TreeType> SearchType;
+
+  data::ChunkedLoader queryLoader(queryFile);
+  data::ChunkedSaver neighborsSaver(neighborsFile);
+  data::ChunkedSaver distancesSaver(distancesFile);
+
+  Log::Info << "Computing " << k << " nearest neighbors of the points in '"
+      << queryFile << "', " << chunkSize << " points at a time..."
+      << std::endl;
+
+  arma::mat queryData;
+  std::vector<size_t> oldFromNewQueries;
+  while (queryLoader.LoadChunk(queryData, chunkSize))
+  {
+    if (queryData.n_rows != referenceTree.Dataset().n_rows)
+    {
+      Log::Fatal << "Query points have " << queryData.n_rows
+          << " dimensions, but reference points have "
+          << referenceTree.Dataset().n_rows << " dimensions." << std::endl;
+    }
+
+    if (basis.n_elem > 0)
+      queryData = basis * queryData;
+
+    const size_t chunkLeafSize = (naive && leafSize < queryData.n_cols) ?
+        queryData.n_cols : leafSize;
+
+    TreeType* queryTree = NULL;
+    if (!singleMode)
+    {
+      Timer::Start("tree_building");
+      queryTree = new TreeType(queryData, oldFromNewQueries, chunkLeafSize);
+      queryTree->Compact();
+      Timer::Stop("tree_building");
+    }
+
+    SearchType* search = new SearchType(&referenceTree, queryTree,
+        referenceTree.Dataset(), queryData, singleMode);
+
+    arma::mat distancesOut;
+    arma::Mat<size_t> neighborsOut;
+    search->Search(k, neighborsOut, distancesOut);
+
+    // Map the results of this chunk back to the original indices.
+    arma::mat distances;
+    arma::Mat<size_t> neighbors;
+    if (!singleMode)
+      Unmap(neighborsOut, distancesOut, oldFromNewReferences,
+          oldFromNewQueries, neighbors, distances);
+    else
+      Unmap(neighborsOut, distancesOut, oldFromNewReferences, neighbors,
+          distances);
+
+    neighborsSaver.SaveChunk(neighbors);
+    distancesSaver.SaveChunk(distances);
+
+    delete search;
+    delete queryTree;
+
+    Log::Info << queryLoader.PointsLoaded() << " query points done."
+        << std::endl;
+  }
+}
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+#endif
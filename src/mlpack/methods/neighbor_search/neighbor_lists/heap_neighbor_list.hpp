@@ -0,0 +1,93 @@
+/**
+ * @file heap_neighbor_list.hpp
+ * @author Ryan Curtin
+ *
+ * Definition of the HeapNeighborList class, which keeps the list of candidate
+ * neighbors of each query point as a binary heap during the search.
+ */
+#ifndef __MLPACK_METHODS_NEIGHBOR_SEARCH_HEAP_NEIGHBOR_LIST_HPP
+#define __MLPACK_METHODS_NEIGHBOR_SEARCH_HEAP_NEIGHBOR_LIST_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace neighbor {
+
+/**
+ * This class implements the NeighborListType template parameter of the
+ * NeighborSearch, RASearch, and LSHSearch classes (see SortedNeighborList for
+ * the required interface).  During the search, each column of the distances and
+ * neighbors matrices is kept as a binary heap with the worst candidate at the
+ * root (row 0), so finding the k'th best distance takes O(1) time and inserting
+ * a new candidate takes O(log k) time, instead of the O(k) time that
+ * SortedNeighborList needs.  When the search is done, Finalize() heapsorts each
+ * column so that the results are in the usual order, best candidate first.
+ *
+ * For small k the sorted list is usually just as fast, but for large k (in the
+ * hundreds or more) the heap is much faster.
+ *
+ * @tparam SortPolicy The sort policy for distances; see NearestNeighborSort.
+ */
+template<typename SortPolicy>
+class HeapNeighborList
+{
+ public:
+  /**
+   * Return the worst distance among the current candidates of the given query
+   * point (the k'th best distance), which is the root of its heap.
+   *
+   * @param distances Matrix of candidate distances.
+   * @param queryIndex Index of query point.
+   */
+  static double WorstDistance(const arma::mat& distances,
+                              const size_t queryIndex)
+  {
+    return distances(0, queryIndex);
+  }
+
+  /**
+   * Insert the given neighbor into the candidates of the given query point, if
+   * its distance is at least as good as the k'th best distance, by replacing
+   * the root of the heap.  Otherwise, nothing is done.
+   *
+   * @param distances Matrix of candidate distances.
+   * @param neighbors Matrix of candidate neighbor indices.
+   * @param queryIndex Index of query point.
+   * @param neighbor Index of reference point which is being inserted.
+   * @param distance Distance from query point to reference point.
+   */
+  static void Insert(arma::mat& distances,
+                     arma::Mat<size_t>& neighbors,
+                     const size_t queryIndex,
+                     const size_t neighbor,
+                     const double distance);
+
+  /**
+   * Sort every column of the given matrices (which must be heaps) so that the
+   * best candidate is first.
+   *
+   * @param distances Matrix of candidate distances.
+   * @param neighbors Matrix of candidate neighbor indices.
+   */
+  static void Finalize(arma::mat& distances, arma::Mat<size_t>& neighbors);
+
+ private:
+  /**
+   * Restore the heap property of the first n elements of the given column,
+   * where only the element at the root may be out of place, by moving the
+   * given candidate down from the root to its place.
+   */
+  static void SiftDown(double* distances,
+                       size_t* neighbors,
+                       const size_t n,
+                       const size_t neighbor,
+                       const double distance);
+};
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+// Include implementation.
+#include "heap_neighbor_list_impl.hpp"
+
+#endif
@@ -0,0 +1,92 @@
+/**
+ * @file heap_neighbor_list_impl.hpp
+ * @author Ryan Curtin
+ *
+ * Implementation of the HeapNeighborList class.
+ */
+#ifndef __MLPACK_METHODS_NEIGHBOR_SEARCH_HEAP_NEIGHBOR_LIST_IMPL_HPP
+#define __MLPACK_METHODS_NEIGHBOR_SEARCH_HEAP_NEIGHBOR_LIST_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "heap_neighbor_list.hpp"
+
+namespace mlpack {
+namespace neighbor {
+
+template<typename SortPolicy>
+inline void HeapNeighborList<SortPolicy>::Insert(
+    arma::mat& distances,
+    arma::Mat<size_t>& neighbors,
+    const size_t queryIndex,
+    const size_t neighbor,
+    const double distance)
+{
+  // Like SortedNeighborList, a candidate as good as the k'th best distance is
+  // inserted, and the worst candidate is dropped.
+  if (SortPolicy::IsBetter(distances(0, queryIndex), distance))
+    return;
+
+  SiftDown(distances.colptr(queryIndex), neighbors.colptr(queryIndex),
+      distances.n_rows, neighbor, distance);
+}
+
+template<typename SortPolicy>
+void HeapNeighborList<SortPolicy>::Finalize(arma::mat& distances,
+                                            arma::Mat<size_t>& neighbors)
+{
+  const size_t k = distances.n_rows;
+
+  #pragma omp parallel for schedule(static)
+  for (long i = 0; i < (long) distances.n_cols; ++i)
+  {
+    double* queryDistances = distances.colptr(i);
+    size_t* queryNeighbors = neighbors.colptr(i);
+
+    // Repeatedly move the worst remaining candidate to the end of the heap.
+    for (size_t heapSize = k; heapSize > 1; --heapSize)
+    {
+      const size_t last = heapSize - 1;
+      const double distance = queryDistances[last];
+      const size_t neighbor = queryNeighbors[last];
+      queryDistances[last] = queryDistances[0];
+      queryNeighbors[last] = queryNeighbors[0];
+
+      SiftDown(queryDistances, queryNeighbors, last, neighbor, distance);
+    }
+  }
+}
+
+template<typename SortPolicy>
+inline void HeapNeighborList<SortPolicy>::SiftDown(double* distances,
+                                                   size_t* neighbors,
+                                                   const size_t n,
+                                                   const size_t neighbor,
+                                                   const double distance)
+{
+  // Move the hole at the root down until the candidate fits.
+  size_t hole = 0;
+  size_t child = 1;
+  while (child < n)
+  {
+    // Find the worse child.
+    if ((child + 1 < n) &&
+        SortPolicy::IsBetter(distances[child], distances[child + 1]))
+      ++child;
+
+    if (!SortPolicy::IsBetter(distance, distances[child]))
+      break;
+
+    distances[hole] = distances[child];
+    neighbors[hole] = neighbors[child];
+    hole = child;
+    child = 2 * hole + 1;
+  }
+
+  distances[hole] = distance;
+  neighbors[hole] = neighbor;
+}
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+#endif
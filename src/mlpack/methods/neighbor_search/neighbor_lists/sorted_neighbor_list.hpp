@@ -0,0 +1,84 @@
+/**
+ * @file sorted_neighbor_list.hpp
+ * @author Ryan Curtin
+ *
+ * Definition of the SortedNeighborList class, which keeps the list of
+ * candidate neighbors of each query point sorted at all times.
+ */
+#ifndef __MLPACK_METHODS_NEIGHBOR_SEARCH_SORTED_NEIGHBOR_LIST_HPP
+#define __MLPACK_METHODS_NEIGHBOR_SEARCH_SORTED_NEIGHBOR_LIST_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace neighbor {
+
+/**
+ * This class implements the NeighborListType template parameter of the
+ * NeighborSearch, RASearch, and LSHSearch classes.  Each column of the
+ * distances and neighbors matrices holds the k candidate neighbors of one query
+ * point, and a column is kept sorted (best candidate first) after every
+ * insertion.  An insertion takes O(k) time, because every candidate after the
+ * insertion position must be shifted down; this is fast when k is small.
+ *
+ * This class is also meant to serve as a guide to implement a custom
+ * NeighborListType.  All of the methods implemented here must be implemented by
+ * any other NeighborListType classes.  Before the search, every distance is set
+ * to SortPolicy::WorstDistance(); after the search, Finalize() is called, and
+ * then each column must be sorted with the best candidate first.
+ *
+ * @tparam SortPolicy The sort policy for distances; see NearestNeighborSort.
+ */
+template<typename SortPolicy>
+class SortedNeighborList
+{
+ public:
+  /**
+   * Return the worst distance among the current candidates of the given query
+   * point (the k'th best distance).  This is the distance which a new candidate
+   * must be at least as good as to be inserted.
+   *
+   * @param distances Matrix of candidate distances.
+   * @param queryIndex Index of query point.
+   */
+  static double WorstDistance(const arma::mat& distances,
+                              const size_t queryIndex)
+  {
+    return distances(distances.n_rows - 1, queryIndex);
+  }
+
+  /**
+   * Insert the given neighbor into the candidates of the given query point, if
+   * its distance is at least as good as the k'th best distance.  Otherwise,
+   * nothing is done.
+   *
+   * @param distances Matrix of candidate distances.
+   * @param neighbors Matrix of candidate neighbor indices.
+   * @param queryIndex Index of query point.
+   * @param neighbor Index of reference point which is being inserted.
+   * @param distance Distance from query point to reference point.
+   */
+  static void Insert(arma::mat& distances,
+                     arma::Mat<size_t>& neighbors,
+                     const size_t queryIndex,
+                     const size_t neighbor,
+                     const double distance);
+
+  /**
+   * Prepare the lists for output after the search.  The lists are always
+   * sorted, so nothing needs to be done.
+   *
+   * @param distances Matrix of candidate distances.
+   * @param neighbors Matrix of candidate neighbor indices.
+   */
+  static void Finalize(arma::mat& /* distances */,
+                       arma::Mat<size_t>& /* neighbors */) { }
+};
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+// Include implementation.
+#include "sorted_neighbor_list_impl.hpp"
+
+#endif
@@ -0,0 +1,53 @@
+/**
+ * @file sorted_neighbor_list_impl.hpp
+ * @author Ryan Curtin
+ *
+ * Implementation of the SortedNeighborList class.
+ */
+#ifndef __MLPACK_METHODS_NEIGHBOR_SEARCH_SORTED_NEIGHBOR_LIST_IMPL_HPP
+#define __MLPACK_METHODS_NEIGHBOR_SEARCH_SORTED_NEIGHBOR_LIST_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "sorted_neighbor_list.hpp"
+
+namespace mlpack {
+namespace neighbor {
+
+template<typename SortPolicy>
+inline void SortedNeighborList<SortPolicy>::Insert(
+    arma::mat& distances,
+    arma::Mat<size_t>& neighbors,
+    const size_t queryIndex,
+    const size_t neighbor,
+    const double distance)
+{
+  // If this distance is better than any of the current candidates, the
+  // SortDistance() function will give us the position to insert it into.
+  arma::vec queryDist = distances.unsafe_col(queryIndex);
+  const size_t pos = SortPolicy::SortDistance(queryDist, distance);
+
+  // SortDistance() returns (size_t() - 1) if we shouldn't add it.
+  if (pos == (size_t() - 1))
+    return;
+
+  // We only memmove() if there is actually a need to shift something.
+  if (pos < (distances.n_rows - 1))
+  {
+    const size_t len = (distances.n_rows - 1) - pos;
+    memmove(distances.colptr(queryIndex) + (pos + 1),
+        distances.colptr(queryIndex) + pos,
+        sizeof(double) * len);
+    memmove(neighbors.colptr(queryIndex) + (pos + 1),
+        neighbors.colptr(queryIndex) + pos,
+        sizeof(size_t) * len);
+  }
+
+  // Now put the new information in the right index.
+  distances(pos, queryIndex) = distance;
+  neighbors(pos, queryIndex) = neighbor;
+}
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+#endif
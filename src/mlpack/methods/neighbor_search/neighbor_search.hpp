@@ -17,6 +17,8 @@
 #include <mlpack/core/metrics/lmetric.hpp>
 #include "neighbor_search_stat.hpp"
 #include "sort_policies/nearest_neighbor_sort.hpp"
+#include "neighbor_lists/sorted_neighbor_list.hpp"
+#include "neighbor_lists/heap_neighbor_list.hpp"
 
 namespace mlpack {
 namespace neighbor /** Neighbor-search routines.  These include
@@ -37,14 +39,23 @@ namespace neighbor /** Neighbor-search routines.  These include
  * can be found in the NearestNeighborSort class and the kernel::ExampleKernel
  * class.
  *
+ * The NeighborListType template parameter defines how the list of candidate
+ * neighbors of each query point is kept during the search.  The default,
+ * SortedNeighborList, is fast for small k; for large k (in the hundreds or
+ * more), HeapNeighborList is much faster.  The results are the same either
+ * way.
+ *
  * @tparam SortPolicy The sort policy for distances; see NearestNeighborSort.
  * @tparam MetricType The metric to use for computation.
  * @tparam TreeType The tree type to use.
+ * @tparam NeighborListType The type of candidate list to use; see
+ *     SortedNeighborList.
  */
 template<typename SortPolicy = NearestNeighborSort,
          typename MetricType = mlpack::metric::SquaredEuclideanDistance,
          typename TreeType = tree::BinarySpaceTree<bound::HRectBound<2>,
-             NeighborSearchStat<SortPolicy> > >
+             NeighborSearchStat<SortPolicy> >,
+         typename NeighborListType = SortedNeighborList<SortPolicy> >
 class NeighborSearch
 {
  public:
@@ -102,6 +113,53 @@ class NeighborSearch
                  const size_t leafSize = 20,
                  const MetricType metric = MetricType());
 
+  /**
+   * Initialize the NeighborSearch object, taking the memory of the given query
+   * and reference datasets instead of copying them.  Otherwise, this is the
+   * same as the constructor which takes both datasets by reference.  This
+   * avoids an extra copy of each dataset when they are not needed by the
+   * caller anymore.  The given matrices should not be used after this (they
+   * will usually be empty; if their memory cannot be taken, as for very small
+   * matrices, they are copied and left unchanged).
+   *
+   * @param referenceSet Set of reference points, which will be taken.
+   * @param querySet Set of query points, which will be taken.
+   * @param naive If true, O(n^2) naive search will be used (as opposed to
+   *      dual-tree search).  This overrides singleMode (if it is set to true).
+   * @param singleMode If true, single-tree search will be used (as opposed to
+   *      dual-tree search).
+   * @param leafSize Leaf size for tree construction.
+   * @param metric An optional instance of the MetricType class.
+   */
+  NeighborSearch(typename TreeType::Mat* referenceSet,
+                 typename TreeType::Mat* querySet,
+                 const bool naive = false,
+                 const bool singleMode = false,
+                 const size_t leafSize = 20,
+                 const MetricType metric = MetricType());
+
+  /**
+   * Initialize the NeighborSearch object, taking the memory of the given
+   * dataset (which is used as both the query and the reference dataset)
+   * instead of copying it.  Otherwise, this is the same as the constructor
+   * which takes only a reference dataset by reference.  The given matrix should
+   * not be used after this (it will usually be empty; if its memory cannot be
+   * taken, as for very small matrices, it is copied and left unchanged).
+   *
+   * @param referenceSet Set of reference points, which will be taken.
+   * @param naive If true, O(n^2) naive search will be used (as opposed to
+   *      dual-tree search).  This overrides singleMode (if it is set to true).
+   * @param singleMode If true, single-tree search will be used (as opposed to
+   *      dual-tree search).
+   * @param leafSize Leaf size for tree construction.
+   * @param metric An optional instance of the MetricType class.
+   */
+  NeighborSearch(typename TreeType::Mat* referenceSet,
+                 const bool naive = false,
+                 const bool singleMode = false,
+                 const size_t leafSize = 20,
+                 const MetricType metric = MetricType());
+
   /**
    * Initialize the NeighborSearch object with the given datasets and
    * pre-constructed trees.  It is assumed that the points in referenceSet and
@@ -148,9 +206,10 @@ class NeighborSearch
    * an instantiated distance metric can be given, for the case where the
    * distance metric holds data.
    *
-   * There is no copying of the data matrices in this constructor (because
-   * tree-building is not necessary), so this is the constructor to use when
-   * copies absolutely must be avoided.
+   * There is no copying of the data matrices or the tree in this constructor
+   * (because tree-building is not necessary, and dual-tree search traverses
+   * the reference tree as both the query and the reference tree), so this is
+   * the constructor to use when copies absolutely must be avoided.
    *
    * @note
    * Because tree-building (at least with BinarySpaceTree) modifies the ordering
@@ -196,18 +255,19 @@ class NeighborSearch
  private:
   //! Copy of reference dataset (if we need it, because tree building modifies
   //! it).
-  arma::mat referenceCopy;
+  typename TreeType::Mat referenceCopy;
   //! Copy of query dataset (if we need it, because tree building modifies it).
-  arma::mat queryCopy;
+  typename TreeType::Mat queryCopy;
 
   //! Reference dataset.
-  const arma::mat& referenceSet;
+  const typename TreeType::Mat& referenceSet;
   //! Query dataset (may not be given).
-  const arma::mat& querySet;
+  const typename TreeType::Mat& querySet;
 
   //! Pointer to the root of the reference tree.
   TreeType* referenceTree;
-  //! Pointer to the root of the query tree (might not exist).
+  //! Pointer to the root of the query tree (might not exist).  If there is no
+  //! query set, the reference tree is used as the query tree.
   TreeType* queryTree;
 
   //! If true, this object created the trees and is responsible for them.
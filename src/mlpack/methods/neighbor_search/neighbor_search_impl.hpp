@@ -15,8 +15,11 @@
 using namespace mlpack::neighbor;
 
 // Construct the object.
-template<typename SortPolicy, typename MetricType, typename TreeType>
-NeighborSearch<SortPolicy, MetricType, TreeType>::
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+NeighborSearch<SortPolicy, MetricType, TreeType, NeighborListType>::
 NeighborSearch(const typename TreeType::Mat& referenceSet,
                const typename TreeType::Mat& querySet,
                const bool naive,
@@ -55,8 +58,11 @@ NeighborSearch(const typename TreeType::Mat& referenceSet,
 }
 
 // Construct the object.
-template<typename SortPolicy, typename MetricType, typename TreeType>
-NeighborSearch<SortPolicy, MetricType, TreeType>::
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+NeighborSearch<SortPolicy, MetricType, TreeType, NeighborListType>::
 NeighborSearch(const typename TreeType::Mat& referenceSet,
                const bool naive,
                const bool singleMode,
@@ -77,19 +83,101 @@ NeighborSearch(const typename TreeType::Mat& referenceSet,
   // We'll time tree building, but only if we are building trees.
   Timer::Start("tree_building");
 
-  // Construct as a naive object if we need to.
+  // Construct as a naive object if we need to.  The reference tree is also
+  // used as the query tree.
   referenceTree = new TreeType(referenceCopy, oldFromNewReferences,
       (naive ? referenceSet.n_cols : leafSize));
+
+  // Stop the timer we started above.
+  Timer::Stop("tree_building");
+}
+
+// Construct the object, taking the memory of the datasets.
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+NeighborSearch<SortPolicy, MetricType, TreeType, NeighborListType>::
+NeighborSearch(typename TreeType::Mat* referenceSet,
+               typename TreeType::Mat* querySet,
+               const bool naive,
+               const bool singleMode,
+               const size_t leafSize,
+               const MetricType metric) :
+    referenceSet(referenceCopy),
+    querySet(queryCopy),
+    referenceTree(NULL),
+    queryTree(NULL),
+    treeOwner(true),
+    hasQuerySet(true),
+    naive(naive),
+    singleMode(!naive && singleMode), // No single mode if naive.
+    metric(metric),
+    numberOfPrunes(0)
+{
+  // Take the memory of the given matrices (or copy them, if we can't).
+  referenceCopy.steal_mem(*referenceSet);
+  queryCopy.steal_mem(*querySet);
+
+  // We'll time tree building, but only if we are building trees.
+  Timer::Start("tree_building");
+
+  // Construct as a naive object if we need to.
+  referenceTree = new TreeType(referenceCopy, oldFromNewReferences,
+      (naive ? referenceCopy.n_cols : leafSize));
+
   if (!singleMode)
-    queryTree = new TreeType(*referenceTree);
+    queryTree = new TreeType(queryCopy, oldFromNewQueries,
+        (naive ? queryCopy.n_cols : leafSize));
+
+  // Stop the timer we started above (if we need to).
+  Timer::Stop("tree_building");
+}
+
+// Construct the object, taking the memory of the dataset.
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+NeighborSearch<SortPolicy, MetricType, TreeType, NeighborListType>::
+NeighborSearch(typename TreeType::Mat* referenceSet,
+               const bool naive,
+               const bool singleMode,
+               const size_t leafSize,
+               const MetricType metric) :
+    referenceSet(referenceCopy),
+    querySet(referenceCopy),
+    referenceTree(NULL),
+    queryTree(NULL),
+    treeOwner(true),
+    hasQuerySet(false),
+    naive(naive),
+    singleMode(!naive && singleMode), // No single mode if naive.
+    metric(metric),
+    numberOfPrunes(0)
+{
+  // Take the memory of the given matrix (or copy it, if we can't).
+  referenceCopy.steal_mem(*referenceSet);
+
+  // We'll time tree building, but only if we are building trees.
+  Timer::Start("tree_building");
+
+  // Construct as a naive object if we need to.  The reference tree is also
+  // used as the query tree.
+  referenceTree = new TreeType(referenceCopy, oldFromNewReferences,
+      (naive ? referenceCopy.n_cols : leafSize));
 
   // Stop the timer we started above.
   Timer::Stop("tree_building");
 }
 
 // Construct the object.
-template<typename SortPolicy, typename MetricType, typename TreeType>
-NeighborSearch<SortPolicy, MetricType, TreeType>::NeighborSearch(
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+NeighborSearch<SortPolicy, MetricType, TreeType,
+    NeighborListType>::NeighborSearch(
     TreeType* referenceTree,
     TreeType* queryTree,
     const typename TreeType::Mat& referenceSet,
@@ -111,8 +199,12 @@ NeighborSearch<SortPolicy, MetricType, TreeType>::NeighborSearch(
 }
 
 // Construct the object.
-template<typename SortPolicy, typename MetricType, typename TreeType>
-NeighborSearch<SortPolicy, MetricType, TreeType>::NeighborSearch(
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+NeighborSearch<SortPolicy, MetricType, TreeType,
+    NeighborListType>::NeighborSearch(
     TreeType* referenceTree,
     const typename TreeType::Mat& referenceSet,
     const bool singleMode,
@@ -122,27 +214,26 @@ NeighborSearch<SortPolicy, MetricType, TreeType>::NeighborSearch(
     referenceTree(referenceTree),
     queryTree(NULL),
     treeOwner(false),
-    hasQuerySet(false), // In this case we will own a tree, if singleMode.
+    hasQuerySet(false),
     naive(false),
     singleMode(singleMode),
     metric(metric),
     numberOfPrunes(0)
 {
-  Timer::Start("tree_building");
-
-  // The query tree cannot be the same as the reference tree.
-  if (referenceTree && !singleMode)
-    queryTree = new TreeType(*referenceTree);
-
-  Timer::Stop("tree_building");
+  // Nothing else to initialize; the reference tree is also used as the query
+  // tree.
 }
 
 /**
  * The tree is the only member we may be responsible for deleting.  The others
  * will take care of themselves.
  */
-template<typename SortPolicy, typename MetricType, typename TreeType>
-NeighborSearch<SortPolicy, MetricType, TreeType>::~NeighborSearch()
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+NeighborSearch<SortPolicy, MetricType, TreeType,
+    NeighborListType>::~NeighborSearch()
 {
   if (treeOwner)
   {
@@ -151,19 +242,17 @@ NeighborSearch<SortPolicy, MetricType, TreeType>::~NeighborSearch()
     if (queryTree)
       delete queryTree;
   }
-  else if (!treeOwner && !hasQuerySet && !singleMode)
-  {
-    // We replicated the reference tree to create a query tree.
-    delete queryTree;
-  }
 }
 
 /**
  * Computes the best neighbors and stores them in resultingNeighbors and
  * distances.
  */
-template<typename SortPolicy, typename MetricType, typename TreeType>
-void NeighborSearch<SortPolicy, MetricType, TreeType>::Search(
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+void NeighborSearch<SortPolicy, MetricType, TreeType, NeighborListType>::Search(
     const size_t k,
     arma::Mat<size_t>& resultingNeighbors,
     arma::mat& distances)
@@ -190,30 +279,55 @@ void NeighborSearch<SortPolicy, MetricType, TreeType>::Search(
   size_t numPrunes = 0;
 
   // Create the helper object for the tree traversal.
-  typedef NeighborSearchRules<SortPolicy, MetricType, TreeType> RuleType;
+  typedef NeighborSearchRules<SortPolicy, MetricType, TreeType,
+      NeighborListType> RuleType;
   RuleType rules(referenceSet, querySet, *neighborPtr, *distancePtr, metric);
 
   if (singleMode)
   {
-    // Create the traverser.
-    typename TreeType::template SingleTreeTraverser<RuleType> traverser(rules);
+    // Each thread gets its own copy of the rules (and its own traverser), so
+    // the base case cache in the rules is never shared between threads.  If
+    // the rules cannot be used in parallel, this runs on one thread.
+    #pragma omp parallel if (tree::RuleTraits<RuleType>::IsParallelSafe) \
+        reduction(+:numPrunes)
+    {
+      RuleType threadRules(rules);
+      typename TreeType::template SingleTreeTraverser<RuleType>
+          traverser(threadRules);
+
+      // Now have it traverse for each point.
+      #pragma omp for schedule(dynamic, 64)
+      for (size_t i = 0; i < querySet.n_cols; ++i)
+        traverser.Traverse(i, *referenceTree);
 
-    // Now have it traverse for each point.
-    for (size_t i = 0; i < querySet.n_cols; ++i)
-      traverser.Traverse(i, *referenceTree);
+      numPrunes += traverser.NumPrunes();
+    }
+
+    numberOfPrunes = numPrunes;
+    Log::Info << numPrunes << " nodes were pruned.\n";
   }
   else // Dual-tree recursion.
   {
     // Create the traverser.
     typename TreeType::template DualTreeTraverser<RuleType> traverser(rules);
 
-    traverser.Traverse(*queryTree, *referenceTree);
+    // If there is no query set, the reference tree is also the query tree.
+    // The rules only modify the statistics of the query nodes (and for trees
+    // whose statistics also cache distances, those caches are symmetric), so
+    // this is safe.
+    if (hasQuerySet)
+      traverser.Traverse(*queryTree, *referenceTree);
+    else
+      traverser.Traverse(*referenceTree, *referenceTree);
 
     Log::Info << traverser.NumVisited() << " node combinations were visited.\n";
     Log::Info << traverser.NumScores() << " node combinations were scored.\n";
     Log::Info << traverser.NumBaseCases() << " base cases were calculated.\n";
   }
 
+  // Put the candidate lists in order.
+  NeighborListType::Finalize(*distancePtr, *neighborPtr);
+
   Timer::Stop("computing_neighbors");
 
   // Now, do we need to do mapping of indices?
@@ -262,6 +376,10 @@ void NeighborSearch<SortPolicy, MetricType, TreeType>::Search(
             oldFromNewReferences[(*neighborPtr)(j, i)];
       }
     }
+
+    // Finished with temporary matrices.
+    delete neighborPtr;
+    delete distancePtr;
   }
   else if (treeOwner && hasQuerySet && singleMode) // Map only references.
   {
@@ -8,21 +8,49 @@
 #ifndef __MLPACK_METHODS_NEIGHBOR_SEARCH_NEIGHBOR_SEARCH_RULES_HPP
 #define __MLPACK_METHODS_NEIGHBOR_SEARCH_NEIGHBOR_SEARCH_RULES_HPP
 
+#include <mlpack/core/tree/tree_traits.hpp>
+#include <mlpack/core/tree/rule_traits.hpp>
+#include <mlpack/core/metrics/lmetric.hpp>
+#include "neighbor_lists/sorted_neighbor_list.hpp"
+
 namespace mlpack {
 namespace neighbor {
 
-template<typename SortPolicy, typename MetricType, typename TreeType>
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType = SortedNeighborList<SortPolicy> >
 class NeighborSearchRules
 {
  public:
-  NeighborSearchRules(const arma::mat& referenceSet,
-                      const arma::mat& querySet,
+  NeighborSearchRules(const typename TreeType::Mat& referenceSet,
+                      const typename TreeType::Mat& querySet,
                       arma::Mat<size_t>& neighbors,
                       arma::mat& distances,
                       MetricType& metric);
 
   double BaseCase(const size_t queryIndex, const size_t referenceIndex);
 
+  /**
+   * Compute the base cases between each of the given query points and each of
+   * the reference points in [referenceBegin, referenceEnd), with the same
+   * results as calling BaseCase() for each pair.  The squared distances of the
+   * whole block are estimated at once from the norms of the points and one
+   * matrix product (||q||^2 + ||r||^2 - 2 q^T r), which is much faster than
+   * evaluating them one at a time on high-dimensional data.  Only the pairs
+   * which could improve the current results (allowing for rounding error in
+   * the estimates) are then evaluated exactly with BaseCase().
+   *
+   * This is only available when MetricType is LMetric<2, TakeRoot>.
+   *
+   * @param queryIndices Indices of query points.
+   * @param referenceBegin Index of first reference point.
+   * @param referenceEnd Index one past the last reference point.
+   */
+  void BaseCases(const std::vector<size_t>& queryIndices,
+                 const size_t referenceBegin,
+                 const size_t referenceEnd);
+
   /**
    * Get the score for recursion order.  A low score indicates priority for
    * recursion, while DBL_MAX indicates that the node should not be recursed
@@ -75,10 +103,10 @@ class NeighborSearchRules
 
  private:
   //! The reference set.
-  const arma::mat& referenceSet;
+  const typename TreeType::Mat& referenceSet;
 
   //! The query set.
-  const arma::mat& querySet;
+  const typename TreeType::Mat& querySet;
 
   //! The matrix the resultant neighbor indices should be stored in.
   arma::Mat<size_t>& neighbors;
@@ -100,23 +128,51 @@ class NeighborSearchRules
    * Recalculate the bound for a given query node.
    */
   double CalculateBound(TreeType& queryNode) const;
-
-  /**
-   * Insert a point into the neighbors and distances matrices; this is a helper
-   * function.
-   *
-   * @param queryIndex Index of point whose neighbors we are inserting into.
-   * @param pos Position in list to insert into.
-   * @param neighbor Index of reference point which is being inserted.
-   * @param distance Distance from query point to reference point.
-   */
-  void InsertNeighbor(const size_t queryIndex,
-                      const size_t pos,
-                      const size_t neighbor,
-                      const double distance);
 };
 
 }; // namespace neighbor
+
+namespace tree {
+
+/**
+ * Each query point only writes to its own column of the neighbors and distances
+ * matrices, and the query statistics touched while scoring belong to the query
+ * subtree being traversed, so copies of NeighborSearchRules can traverse
+ * disjoint query subtrees in parallel.  This does not hold for trees where the
+ * first point is the centroid, because then the reference statistics are used
+ * to cache base cases.
+ */
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+class RuleTraits<neighbor::NeighborSearchRules<SortPolicy, MetricType,
+    TreeType, NeighborListType> >
+{
+ public:
+  static const bool IsParallelSafe =
+      !TreeTraits<TreeType>::FirstPointIsCentroid;
+  static const bool HasBlockBaseCase = false;
+};
+
+/**
+ * With the Euclidean (or squared Euclidean) distance, NeighborSearchRules can
+ * also compute whole blocks of base cases at once with BaseCases().
+ */
+template<typename SortPolicy,
+         bool TakeRoot,
+         typename TreeType,
+         typename NeighborListType>
+class RuleTraits<neighbor::NeighborSearchRules<SortPolicy,
+    metric::LMetric<2, TakeRoot>, TreeType, NeighborListType> >
+{
+ public:
+  static const bool IsParallelSafe =
+      !TreeTraits<TreeType>::FirstPointIsCentroid;
+  static const bool HasBlockBaseCase = true;
+};
+
+}; // namespace tree
 }; // namespace mlpack
 
 // Include implementation.
@@ -10,13 +10,19 @@
 // In case it hasn't been included yet.
 #include "neighbor_search_rules.hpp"
 
+#include <limits>
+
 namespace mlpack {
 namespace neighbor {
 
-template<typename SortPolicy, typename MetricType, typename TreeType>
-NeighborSearchRules<SortPolicy, MetricType, TreeType>::NeighborSearchRules(
-    const arma::mat& referenceSet,
-    const arma::mat& querySet,
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+NeighborSearchRules<SortPolicy, MetricType, TreeType,
+    NeighborListType>::NeighborSearchRules(
+    const typename TreeType::Mat& referenceSet,
+    const typename TreeType::Mat& querySet,
     arma::Mat<size_t>& neighbors,
     arma::mat& distances,
     MetricType& metric) :
@@ -26,12 +32,16 @@ NeighborSearchRules<SortPolicy, MetricType, TreeType>::NeighborSearchRules(
     distances(distances),
     metric(metric),
     lastQueryIndex(querySet.n_cols),
-    lastReferenceIndex(referenceSet.n_cols)
+    lastReferenceIndex(referenceSet.n_cols),
+    lastBaseCase(0.0)
 { /* Nothing left to do. */ }
 
-template<typename SortPolicy, typename MetricType, typename TreeType>
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
 inline force_inline // Absolutely MUST be inline so optimizations can happen.
-double NeighborSearchRules<SortPolicy, MetricType, TreeType>::
+double NeighborSearchRules<SortPolicy, MetricType, TreeType, NeighborListType>::
 BaseCase(const size_t queryIndex, const size_t referenceIndex)
 {
   // If the datasets are the same, then this search is only using one dataset
@@ -46,14 +56,9 @@ BaseCase(const size_t queryIndex, const size_t referenceIndex)
   double distance = metric.Evaluate(querySet.unsafe_col(queryIndex),
                                     referenceSet.unsafe_col(referenceIndex));
 
-  // If this distance is better than any of the current candidates, the
-  // SortDistance() function will give us the position to insert it into.
-  arma::vec queryDist = distances.unsafe_col(queryIndex);
-  const size_t insertPosition = SortPolicy::SortDistance(queryDist, distance);
-
-  // SortDistance() returns (size_t() - 1) if we shouldn't add it.
-  if (insertPosition != (size_t() - 1))
-    InsertNeighbor(queryIndex, insertPosition, referenceIndex, distance);
+  // Insert the point into the candidates, if it is good enough.
+  NeighborListType::Insert(distances, neighbors, queryIndex, referenceIndex,
+      distance);
 
   // Cache this information for the next time BaseCase() is called.
   lastQueryIndex = queryIndex;
@@ -63,8 +68,109 @@ BaseCase(const size_t queryIndex, const size_t referenceIndex)
   return distance;
 }
 
-template<typename SortPolicy, typename MetricType, typename TreeType>
-inline double NeighborSearchRules<SortPolicy, MetricType, TreeType>::Score(
+//! Convert a squared distance to a Euclidean distance.
+inline double SquaredToDistance(const double squared,
+                                const metric::LMetric<2, true>& /* metric */)
+{
+  return sqrt(squared);
+}
+
+//! Squared Euclidean distances need no conversion.
+inline double SquaredToDistance(const double squared,
+                                const metric::LMetric<2, false>& /* metric */)
+{
+  return squared;
+}
+
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+void NeighborSearchRules<SortPolicy, MetricType, TreeType,
+    NeighborListType>::BaseCases(
+    const std::vector<size_t>& queryIndices,
+    const size_t referenceBegin,
+    const size_t referenceEnd)
+{
+  typedef typename TreeType::Mat MatType;
+  typedef typename MatType::elem_type ElemType;
+
+  const size_t dimensions = querySet.n_rows;
+
+  // The rounding error of each estimated squared distance, plus the rounding
+  // error of the exact evaluation in BaseCase(), is bounded by a small multiple
+  // of this times the sum of the squared norms.
+  const double relativeError = (4.0 * dimensions + 16.0) *
+      std::numeric_limits<ElemType>::epsilon();
+
+  // The block is split into tiles of at most tileSize query points and
+  // tileSize reference points, so that the memory used does not grow with the
+  // size of the leaves (in naive mode, one leaf holds the whole dataset).
+  const size_t tileSize = 256;
+  MatType queries;
+  MatType products;
+  for (size_t queryBegin = 0; queryBegin < queryIndices.size();
+       queryBegin += tileSize)
+  {
+    const size_t numQueries = std::min(tileSize,
+        queryIndices.size() - queryBegin);
+
+    // Gather the query points of this tile.
+    queries.set_size(dimensions, numQueries);
+    for (size_t i = 0; i < numQueries; ++i)
+      queries.col(i) = querySet.unsafe_col(queryIndices[queryBegin + i]);
+    const arma::Row<ElemType> queryNorms = arma::sum(queries % queries, 0);
+
+    for (size_t tileBegin = referenceBegin; tileBegin < referenceEnd;
+         tileBegin += tileSize)
+    {
+      const size_t numReferences = std::min(tileSize, referenceEnd -
+          tileBegin);
+
+      // The reference points are already contiguous, so we can use them
+      // without copying.
+      const MatType references(const_cast<ElemType*>(
+          referenceSet.colptr(tileBegin)), dimensions, numReferences, false,
+          true);
+
+      // Find the squared norms of every point, and the inner products of every
+      // pair of points (with one matrix multiplication).  These are computed
+      // in the precision of the dataset.
+      const arma::Row<ElemType> referenceNorms = arma::sum(references %
+          references, 0);
+      products = arma::trans(queries) * references;
+
+      for (size_t i = 0; i < numQueries; ++i)
+      {
+        const size_t queryIndex = queryIndices[queryBegin + i];
+        for (size_t j = 0; j < numReferences; ++j)
+        {
+          const double normSum = queryNorms[i] + referenceNorms[j];
+          const double squared = std::max(normSum - 2.0 * products(i, j),
+              0.0);
+
+          // Only evaluate the pair exactly if its distance could be as good as
+          // the current k'th best distance.
+          const double bestDistance = SquaredToDistance(
+              SortPolicy::CombineBest(squared, relativeError * normSum),
+              metric);
+          if (SortPolicy::IsBetter(NeighborListType::WorstDistance(distances,
+              queryIndex), bestDistance))
+            continue;
+
+          BaseCase(queryIndex, tileBegin + j);
+        }
+      }
+    }
+  }
+}
+
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+inline double NeighborSearchRules<SortPolicy, MetricType, TreeType,
+    NeighborListType>::Score(
     const size_t queryIndex,
     TreeType& referenceNode)
 {
@@ -93,18 +199,24 @@ inline double NeighborSearchRules<SortPolicy, MetricType, TreeType>::Score(
   }
   else
   {
-    const arma::vec queryPoint = querySet.unsafe_col(queryIndex);
+    const arma::Col<typename TreeType::Mat::elem_type> queryPoint =
+        querySet.unsafe_col(queryIndex);
     distance = SortPolicy::BestPointToNodeDistance(queryPoint, &referenceNode);
   }
 
   // Compare against the best k'th distance for this query point so far.
-  const double bestDistance = distances(distances.n_rows - 1, queryIndex);
+  const double bestDistance = NeighborListType::WorstDistance(distances,
+      queryIndex);
 
   return (SortPolicy::IsBetter(distance, bestDistance)) ? distance : DBL_MAX;
 }
 
-template<typename SortPolicy, typename MetricType, typename TreeType>
-inline double NeighborSearchRules<SortPolicy, MetricType, TreeType>::Rescore(
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+inline double NeighborSearchRules<SortPolicy, MetricType, TreeType,
+    NeighborListType>::Rescore(
     const size_t queryIndex,
     TreeType& /* referenceNode */,
     const double oldScore) const
@@ -114,13 +226,18 @@ inline double NeighborSearchRules<SortPolicy, MetricType, TreeType>::Rescore(
     return oldScore;
 
   // Just check the score again against the distances.
-  const double bestDistance = distances(distances.n_rows - 1, queryIndex);
+  const double bestDistance = NeighborListType::WorstDistance(distances,
+      queryIndex);
 
   return (SortPolicy::IsBetter(oldScore, bestDistance)) ? oldScore : DBL_MAX;
 }
 
-template<typename SortPolicy, typename MetricType, typename TreeType>
-inline double NeighborSearchRules<SortPolicy, MetricType, TreeType>::Score(
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+inline double NeighborSearchRules<SortPolicy, MetricType, TreeType,
+    NeighborListType>::Score(
     TreeType& queryNode,
     TreeType& referenceNode)
 {
@@ -217,8 +334,12 @@ inline double NeighborSearchRules<SortPolicy, MetricType, TreeType>::Score(
   return (SortPolicy::IsBetter(distance, bestDistance)) ? distance : DBL_MAX;
 }
 
-template<typename SortPolicy, typename MetricType, typename TreeType>
-inline double NeighborSearchRules<SortPolicy, MetricType, TreeType>::Rescore(
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+inline double NeighborSearchRules<SortPolicy, MetricType, TreeType,
+    NeighborListType>::Rescore(
     TreeType& queryNode,
     TreeType& /* referenceNode */,
     const double oldScore) const
@@ -234,8 +355,12 @@ inline double NeighborSearchRules<SortPolicy, MetricType, TreeType>::Rescore(
 
 // Calculate the bound for a given query node in its current state and update
 // it.
-template<typename SortPolicy, typename MetricType, typename TreeType>
-inline double NeighborSearchRules<SortPolicy, MetricType, TreeType>::
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+inline double NeighborSearchRules<SortPolicy, MetricType, TreeType,
+    NeighborListType>::
     CalculateBound(TreeType& queryNode) const
 {
   // We have five possible bounds, and we must take the best of them all.  We
@@ -264,7 +389,8 @@ inline double NeighborSearchRules<SortPolicy, MetricType, TreeType>::
   // candidates (for (1) and (2)).
   for (size_t i = 0; i < queryNode.NumPoints(); ++i)
   {
-    const double distance = distances(distances.n_rows - 1, queryNode.Point(i));
+    const double distance = NeighborListType::WorstDistance(distances,
+        queryNode.Point(i));
     if (SortPolicy::IsBetter(distance, bestPointDistance))
       bestPointDistance = distance;
     if (SortPolicy::IsBetter(worstPointDistance, distance))
@@ -340,38 +466,6 @@ inline double NeighborSearchRules<SortPolicy, MetricType, TreeType>::
   return queryNode.Stat().Bound();
 }
 
-/**
- * Helper function to insert a point into the neighbors and distances matrices.
- *
- * @param queryIndex Index of point whose neighbors we are inserting into.
- * @param pos Position in list to insert into.
- * @param neighbor Index of reference point which is being inserted.
- * @param distance Distance from query point to reference point.
- */
-template<typename SortPolicy, typename MetricType, typename TreeType>
-void NeighborSearchRules<SortPolicy, MetricType, TreeType>::InsertNeighbor(
-    const size_t queryIndex,
-    const size_t pos,
-    const size_t neighbor,
-    const double distance)
-{
-  // We only memmove() if there is actually a need to shift something.
-  if (pos < (distances.n_rows - 1))
-  {
-    int len = (distances.n_rows - 1) - pos;
-    memmove(distances.colptr(queryIndex) + (pos + 1),
-        distances.colptr(queryIndex) + pos,
-        sizeof(double) * len);
-    memmove(neighbors.colptr(queryIndex) + (pos + 1),
-        neighbors.colptr(queryIndex) + pos,
-        sizeof(size_t) * len);
-  }
-
-  // Now put the new information in the right index.
-  distances(pos, queryIndex) = distance;
-  neighbors(pos, queryIndex) = neighbor;
-}
-
 }; // namespace neighbor
 }; // namespace mlpack
 
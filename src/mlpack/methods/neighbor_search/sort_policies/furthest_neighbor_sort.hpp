@@ -95,8 +95,8 @@ class FurthestNeighborSort
    * this is the maximum distance between the tree node and the point using the
    * given distance function.
    */
-  template<typename TreeType>
-  static double BestPointToNodeDistance(const arma::vec& queryPoint,
+  template<typename VecType, typename TreeType>
+  static double BestPointToNodeDistance(const VecType& queryPoint,
                                         const TreeType* referenceNode);
 
   /**
@@ -105,8 +105,8 @@ class FurthestNeighborSort
    * calculated.  This is used in conjunction with trees that have
    * self-children (like cover trees).
    */
-  template<typename TreeType>
-  static double BestPointToNodeDistance(const arma::vec& queryPoint,
+  template<typename VecType, typename TreeType>
+  static double BestPointToNodeDistance(const VecType& queryPoint,
                                         const TreeType* referenceNode,
                                         const double pointToCenterDistance);
 
@@ -26,6 +26,16 @@ namespace neighbor {
  */
 typedef NeighborSearch<NearestNeighborSort, metric::EuclideanDistance> AllkNN;
 
+/**
+ * The AllkNNSinglePrecision class is the all-k-nearest-neighbors method for
+ * single-precision (arma::fmat) datasets.  It returns L2 distances (Euclidean
+ * distances) for each of the k nearest neighbors.
+ */
+typedef NeighborSearch<NearestNeighborSort, metric::EuclideanDistance,
+    tree::BinarySpaceTree<bound::HRectBound<2>,
+    NeighborSearchStat<NearestNeighborSort>, arma::fmat> >
+    AllkNNSinglePrecision;
+
 /**
  * The AllkFN class is the all-k-furthest-neighbors method.  It returns L2
  * distances (Euclidean distances) for each of the k furthest neighbors.
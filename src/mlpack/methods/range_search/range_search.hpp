@@ -15,6 +15,7 @@
 #include <mlpack/core/tree/binary_space_tree.hpp>
 
 #include "range_search_stat.hpp"
+#include "range_search_results.hpp"
 
 namespace mlpack {
 namespace range /** Range-search routines. */ {
@@ -186,6 +187,25 @@ class RangeSearch
               std::vector<std::vector<size_t> >& neighbors,
               std::vector<std::vector<double> >& distances);
 
+  /**
+   * Search for all points in the given range, passing each result (query
+   * index, reference index, and distance) to the given result object.  This
+   * allows the results to be stored compactly (CSRResults), counted
+   * (CountResults), or streamed elsewhere as they are found (CallbackResults),
+   * instead of being stored in a vector for each query point; see
+   * range_search_results.hpp for the interface a result type must provide.
+   *
+   * As with the other overload, the indices passed to the result object are
+   * those of the original datasets, unless the trees were built outside of
+   * this object.
+   *
+   * @tparam ResultType Type of the result object.
+   * @param range Range of distances in which to search.
+   * @param results Object to pass the results to.
+   */
+  template<typename ResultType>
+  void Search(const math::Range& range, ResultType& results);
+
  private:
   //! Copy of reference matrix; used when a tree is built internally.
   typename TreeType::Mat referenceCopy;
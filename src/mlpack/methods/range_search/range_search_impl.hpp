@@ -145,45 +145,62 @@ void RangeSearch<MetricType, TreeType>::Search(
     const math::Range& range,
     std::vector<std::vector<size_t> >& neighbors,
     std::vector<std::vector<double> >& distances)
+{
+  VectorResults results(neighbors, distances);
+  Search(range, results);
+}
+
+template<typename MetricType, typename TreeType>
+template<typename ResultType>
+void RangeSearch<MetricType, TreeType>::Search(const math::Range& range,
+                                               ResultType& results)
 {
   Timer::Start("range_search/computing_neighbors");
 
   // Set size of prunes to 0.
   numPrunes = 0;
 
-  // If we have built the trees ourselves, then we will have to map all the
-  // indices back to their original indices when this computation is finished.
-  // To avoid extra copies, we will store the unmapped neighbors and distances
-  // in a separate object.
-  std::vector<std::vector<size_t> >* neighborPtr = &neighbors;
-  std::vector<std::vector<double> >* distancePtr = &distances;
-
-  if (treeOwner && !(singleMode && hasQuerySet))
-    distancePtr = new std::vector<std::vector<double> >;
+  // If we have built the trees ourselves, then the indices must be mapped back
+  // to their original indices.  This is done as each result is found, so no
+  // unmapped copy of the results is ever made.
+  const std::vector<size_t>* queryMap = NULL;
+  const std::vector<size_t>* referenceMap = NULL;
   if (treeOwner)
-    neighborPtr = new std::vector<std::vector<size_t> >;
+  {
+    queryMap = (hasQuerySet ? &oldFromNewQueries : &oldFromNewReferences);
+    referenceMap = &oldFromNewReferences;
+  }
 
-  // Resize each vector.
-  neighborPtr->clear(); // Just in case there was anything in it.
-  neighborPtr->resize(querySet.n_cols);
-  distancePtr->clear();
-  distancePtr->resize(querySet.n_cols);
+  typedef MappedResults<ResultType> MappedResultType;
+  MappedResultType mappedResults(results, queryMap, referenceMap);
+  mappedResults.Reset(querySet.n_cols);
 
   // Create the helper object for the traversal.
-  typedef RangeSearchRules<MetricType, TreeType> RuleType;
-  RuleType rules(referenceSet, querySet, range, *neighborPtr, *distancePtr,
-      metric);
+  typedef RangeSearchRules<MetricType, TreeType, MappedResultType> RuleType;
+  RuleType rules(referenceSet, querySet, range, mappedResults, metric);
 
   if (singleMode)
   {
-    // Create the traverser.
-    typename TreeType::template SingleTreeTraverser<RuleType> traverser(rules);
+    // Each thread gets its own copy of the rules (and its own traverser), so
+    // the base case cache in the rules is never shared between threads.  If
+    // the rules cannot be used in parallel, this runs on one thread.
+    size_t prunes = 0;
+    #pragma omp parallel if (tree::RuleTraits<RuleType>::IsParallelSafe) \
+        reduction(+:prunes)
+    {
+      RuleType threadRules(rules);
+      typename TreeType::template SingleTreeTraverser<RuleType>
+          traverser(threadRules);
 
-    // Now have it traverse for each point.
-    for (size_t i = 0; i < querySet.n_cols; ++i)
-      traverser.Traverse(i, *referenceTree);
+      // Now have it traverse for each point.
+      #pragma omp for schedule(dynamic, 64)
+      for (size_t i = 0; i < querySet.n_cols; ++i)
+        traverser.Traverse(i, *referenceTree);
 
-    numPrunes = traverser.NumPrunes();
+      prunes += traverser.NumPrunes();
+    }
+
+    numPrunes = prunes;
   }
   else // Dual-tree recursion.
   {
@@ -195,86 +212,13 @@ void RangeSearch<MetricType, TreeType>::Search(
     numPrunes = traverser.NumPrunes();
   }
 
+  mappedResults.Finalize();
+
   Timer::Stop("range_search/computing_neighbors");
 
   // Output number of prunes.
   Log::Info << "Number of pruned nodes during computation: " << numPrunes
       << "." << std::endl;
-
-  // Map points back to original indices, if necessary.
-  if (!treeOwner)
-  {
-    // No mapping needed.  We are done.
-    return;
-  }
-  else if (treeOwner && hasQuerySet && !singleMode) // Map both sets.
-  {
-    neighbors.clear();
-    neighbors.resize(querySet.n_cols);
-    distances.clear();
-    distances.resize(querySet.n_cols);
-
-    for (size_t i = 0; i < distances.size(); i++)
-    {
-      // Map distances (copy a column).
-      size_t queryMapping = oldFromNewQueries[i];
-      distances[queryMapping] = (*distancePtr)[i];
-
-      // Copy each neighbor individually, because we need to map it.
-      neighbors[queryMapping].resize(distances[queryMapping].size());
-      for (size_t j = 0; j < distances[queryMapping].size(); j++)
-      {
-        neighbors[queryMapping][j] = oldFromNewReferences[(*neighborPtr)[i][j]];
-      }
-    }
-
-    // Finished with temporary objects.
-    delete neighborPtr;
-    delete distancePtr;
-  }
-  else if (treeOwner && !hasQuerySet)
-  {
-    neighbors.clear();
-    neighbors.resize(querySet.n_cols);
-    distances.clear();
-    distances.resize(querySet.n_cols);
-
-    for (size_t i = 0; i < distances.size(); i++)
-    {
-      // Map distances (copy a column).
-      size_t refMapping = oldFromNewReferences[i];
-      distances[refMapping] = (*distancePtr)[i];
-
-      // Copy each neighbor individually, because we need to map it.
-      neighbors[refMapping].resize(distances[refMapping].size());
-      for (size_t j = 0; j < distances[refMapping].size(); j++)
-      {
-        neighbors[refMapping][j] = oldFromNewReferences[(*neighborPtr)[i][j]];
-      }
-    }
-
-    // Finished with temporary objects.
-    delete neighborPtr;
-    delete distancePtr;
-  }
-  else if (treeOwner && hasQuerySet && singleMode) // Map only references.
-  {
-    neighbors.clear();
-    neighbors.resize(querySet.n_cols);
-
-    // Map indices of neighbors.
-    for (size_t i = 0; i < neighbors.size(); i++)
-    {
-      neighbors[i].resize((*neighborPtr)[i].size());
-      for (size_t j = 0; j < neighbors[i].size(); j++)
-      {
-        neighbors[i][j] = oldFromNewReferences[(*neighborPtr)[i][j]];
-      }
-    }
-
-    // Finished with temporary object.
-    delete neighborPtr;
-  }
 }
 
 }; // namespace range
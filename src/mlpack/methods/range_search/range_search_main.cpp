@@ -45,13 +45,26 @@ PROGRAM_INFO("Range Search",
     " resultant CSV-like files may not be loadable by many programs.  However, "
     "at this time a better way to store this non-square result is not known.  "
     "As a result, any output files will be written as CSVs in this manner, "
-    "regardless of the given extension.");
+    "regardless of the given extension."
+    "\n\n"
+    "When the results are too many to hold in memory, the --triples_file option"
+    " can be used instead of --distances_file and --neighbors_file: each result"
+    " is then written to the given file as soon as it is found, as a line "
+    "'query, reference, distance'.  If only the number of points in the range "
+    "is needed, the --counts_file option writes that number for each query "
+    "point (one per line) without storing any results.");
 
 // Define our input parameters that this program will take.
 PARAM_STRING_REQ("reference_file", "File containing the reference dataset.",
     "r");
-PARAM_STRING_REQ("distances_file", "File to output distances into.", "d");
-PARAM_STRING_REQ("neighbors_file", "File to output neighbors into.", "n");
+PARAM_STRING("distances_file", "File to output distances into.", "d", "");
+PARAM_STRING("neighbors_file", "File to output neighbors into.", "n", "");
+PARAM_STRING("triples_file", "File to write each result into as it is found, "
+    "as 'query, reference, distance' lines (instead of --distances_file and "
+    "--neighbors_file).", "T", "");
+PARAM_STRING("counts_file", "File to output the number of points in the range "
+    "of each query point into (instead of --distances_file and "
+    "--neighbors_file).", "C", "");
 
 PARAM_DOUBLE_REQ("max", "Upper bound in range.", "M");
 PARAM_DOUBLE("min", "Lower bound in range.", "m", 0.0);
@@ -70,6 +83,82 @@ typedef CoverTree<metric::EuclideanDistance, tree::FirstPointIsRoot,
     RangeSearchStat> CoverTreeType;
 typedef RangeSearch<metric::EuclideanDistance, CoverTreeType> RSCoverType;
 
+/**
+ * Write each result to a stream as a 'query, reference, distance' line.
+ */
+class TripleWriter
+{
+ public:
+  TripleWriter(ostream& stream) : stream(stream) { }
+
+  void operator()(const size_t queryIndex,
+                  const size_t referenceIndex,
+                  const double distance)
+  {
+    stream << queryIndex << ", " << referenceIndex << ", " << distance << "\n";
+  }
+
+ private:
+  ostream& stream;
+};
+
+/**
+ * Run the search in the mode given on the command line.  The counts and triples
+ * are written here; the neighbors and distances are returned, to be written by
+ * the caller.  If the trees were built outside of the RangeSearch object, the
+ * given mappings are used to map the indices back.
+ */
+template<typename SearchType>
+void RunSearch(SearchType& rangeSearch,
+               const math::Range& r,
+               const vector<size_t>* queryMap,
+               const vector<size_t>* referenceMap,
+               vector<vector<size_t> >& neighbors,
+               vector<vector<double> >& distances)
+{
+  const string countsFile = CLI::GetParam<string>("counts_file");
+  const string triplesFile = CLI::GetParam<string>("triples_file");
+
+  if (countsFile != "")
+  {
+    CountResults counts;
+    MappedResults<CountResults> results(counts, queryMap, referenceMap);
+    rangeSearch.Search(r, results);
+
+    fstream countsStr(countsFile.c_str(), fstream::out);
+    if (!countsStr.is_open())
+    {
+      Log::Warn << "Cannot open file '" << countsFile << "' to save output "
+          << "counts to!" << endl;
+      return;
+    }
+
+    for (size_t i = 0; i < counts.Counts().n_elem; ++i)
+      countsStr << counts.Counts()[i] << endl;
+  }
+  else if (triplesFile != "")
+  {
+    // The file must be open before the search, because results are written to
+    // it as they are found.
+    fstream triplesStr(triplesFile.c_str(), fstream::out);
+    if (!triplesStr.is_open())
+      Log::Fatal << "Cannot open file '" << triplesFile << "' to save output "
+          << "triples to!" << endl;
+
+    TripleWriter writer(triplesStr);
+    CallbackResults<TripleWriter> callback(writer);
+    MappedResults<CallbackResults<TripleWriter> > results(callback, queryMap,
+        referenceMap);
+    rangeSearch.Search(r, results);
+  }
+  else
+  {
+    VectorResults vectors(neighbors, distances);
+    MappedResults<VectorResults> results(vectors, queryMap, referenceMap);
+    rangeSearch.Search(r, results);
+  }
+}
+
 int main(int argc, char *argv[])
 {
   // Give CLI the command line parameters the user passed in.
@@ -80,6 +169,8 @@ int main(int argc, char *argv[])
 
   string distancesFile = CLI::GetParam<string>("distances_file");
   string neighborsFile = CLI::GetParam<string>("neighbors_file");
+  const bool counts = (CLI::GetParam<string>("counts_file") != "");
+  const bool triples = (CLI::GetParam<string>("triples_file") != "");
 
   int lsInt = CLI::GetParam<int>("leaf_size");
 
@@ -97,6 +188,14 @@ int main(int argc, char *argv[])
 
   Log::Info << "Loaded reference data from '" << referenceFile << "'." << endl;
 
+  // Exactly one kind of output must be chosen.
+  const bool vectors = (distancesFile != "" || neighborsFile != "");
+  if ((int) vectors + (int) counts + (int) triples != 1)
+  {
+    Log::Fatal << "Exactly one of --counts_file, --triples_file, or "
+        << "--distances_file/--neighbors_file must be specified!" << endl;
+  }
+
   // Sanity check on range value: max must be greater than min.
   if (max <= min)
   {
@@ -160,7 +259,7 @@ int main(int argc, char *argv[])
     Log::Info << "Trees built." << endl;
 
     const math::Range r(min, max);
-    rangeSearch->Search(r, neighbors, distances);
+    RunSearch(*rangeSearch, r, NULL, NULL, neighbors, distances);
 
     if (queryTree)
       delete queryTree;
@@ -224,113 +323,81 @@ int main(int argc, char *argv[])
     Log::Info << "Computing neighbors within range [" << min << ", " << max
         << "]." << endl;
 
-    // Collect the results in these vectors before remapping.
-    vector<vector<double> > distancesOut;
-    vector<vector<size_t> > neighborsOut;
+    // The results are mapped back to the original indices from before the
+    // tree construction as they are found.
+    const vector<size_t>* queryMap = (CLI::GetParam<string>("query_file") !=
+        "") ? &oldFromNewQueries : &oldFromNewRefs;
 
     const math::Range r(min, max);
-    rangeSearch->Search(r, neighborsOut, distancesOut);
+    RunSearch(*rangeSearch, r, queryMap, &oldFromNewRefs, neighbors,
+        distances);
 
     Log::Info << "Neighbors computed." << endl;
 
-    // We have to map back to the original indices from before the tree
-    // construction.
-    Log::Info << "Re-mapping indices..." << endl;
-
-    distances.resize(distancesOut.size());
-    neighbors.resize(neighborsOut.size());
+    // Clean up.
+    if (queryTree)
+      delete queryTree;
+    delete rangeSearch;
+  }
 
-    // Do the actual remapping.
-    if (CLI::GetParam<string>("query_file") != "")
+  // Save output.  We have to do this by hand.
+  if (distancesFile != "")
+  {
+    fstream distancesStr(distancesFile.c_str(), fstream::out);
+    if (!distancesStr.is_open())
     {
-      for (size_t i = 0; i < distances.size(); ++i)
-      {
-        // Map distances (copy a column).
-        distances[oldFromNewQueries[i]] = distancesOut[i];
-
-        // Map indices of neighbors.
-        neighbors[oldFromNewQueries[i]].resize(neighborsOut[i].size());
-        for (size_t j = 0; j < distancesOut[i].size(); ++j)
-        {
-          neighbors[oldFromNewQueries[i]][j] =
-              oldFromNewRefs[neighborsOut[i][j]];
-        }
-      }
+      Log::Warn << "Cannot open file '" << distancesFile << "' to save output "
+          << "distances to!" << endl;
     }
     else
     {
+      // Loop over each point.
       for (size_t i = 0; i < distances.size(); ++i)
       {
-        // Map distances (copy a column).
-        distances[oldFromNewRefs[i]] = distancesOut[i];
-
-        // Map indices of neighbors.
-        neighbors[oldFromNewRefs[i]].resize(neighborsOut[i].size());
-        for (size_t j = 0; j < distancesOut[i].size(); ++j)
+        // Store the distances of each point.  We may have 0 points to store, so
+        // we must account for that possibility.
+        for (size_t j = 0; j + 1 < distances[i].size(); ++j)
         {
-          neighbors[oldFromNewRefs[i]][j] = oldFromNewRefs[neighborsOut[i][j]];
+          distancesStr << distances[i][j] << ", ";
         }
-      }
-    }
 
-    // Clean up.
-    if (queryTree)
-      delete queryTree;
-    delete rangeSearch;
-  }
+        if (distances[i].size() > 0)
+          distancesStr << distances[i][distances[i].size() - 1];
 
-  // Save output.  We have to do this by hand.
-  fstream distancesStr(distancesFile.c_str(), fstream::out);
-  if (!distancesStr.is_open())
-  {
-    Log::Warn << "Cannot open file '" << distancesFile << "' to save output "
-        << "distances to!" << endl;
-  }
-  else
-  {
-    // Loop over each point.
-    for (size_t i = 0; i < distances.size(); ++i)
-    {
-      // Store the distances of each point.  We may have 0 points to store, so
-      // we must account for that possibility.
-      for (size_t j = 0; j + 1 < distances[i].size(); ++j)
-      {
-        distancesStr << distances[i][j] << ", ";
+        distancesStr << endl;
       }
 
-      if (distances[i].size() > 0)
-        distancesStr << distances[i][distances[i].size() - 1];
-
-      distancesStr << endl;
+      distancesStr.close();
     }
-
-    distancesStr.close();
   }
 
-  fstream neighborsStr(neighborsFile.c_str(), fstream::out);
-  if (!neighborsStr.is_open())
-  {
-    Log::Warn << "Cannot open file '" << neighborsFile << "' to save output "
-        << "neighbor indices to!" << endl;
-  }
-  else
+  if (neighborsFile != "")
   {
-    // Loop over each point.
-    for (size_t i = 0; i < neighbors.size(); ++i)
+    fstream neighborsStr(neighborsFile.c_str(), fstream::out);
+    if (!neighborsStr.is_open())
     {
-      // Store the neighbors of each point.  We may have 0 points to store, so
-      // we must account for that possibility.
-      for (size_t j = 0; j + 1 < neighbors[i].size(); ++j)
+      Log::Warn << "Cannot open file '" << neighborsFile << "' to save output "
+          << "neighbor indices to!" << endl;
+    }
+    else
+    {
+      // Loop over each point.
+      for (size_t i = 0; i < neighbors.size(); ++i)
       {
-        neighborsStr << neighbors[i][j] << ", ";
-      }
+        // Store the neighbors of each point.  We may have 0 points to store, so
+        // we must account for that possibility.
+        for (size_t j = 0; j + 1 < neighbors[i].size(); ++j)
+        {
+          neighborsStr << neighbors[i][j] << ", ";
+        }
 
-      if (neighbors[i].size() > 0)
-        neighborsStr << neighbors[i][neighbors[i].size() - 1];
+        if (neighbors[i].size() > 0)
+          neighborsStr << neighbors[i][neighbors[i].size() - 1];
 
-      neighborsStr << endl;
-    }
+        neighborsStr << endl;
+      }
 
-    neighborsStr.close();
+      neighborsStr.close();
+    }
   }
 }
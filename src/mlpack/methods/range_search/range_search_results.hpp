@@ -0,0 +1,300 @@
+/**
+ * @file range_search_results.hpp
+ * @author Ryan Curtin
+ *
+ * Result types for RangeSearch: each one receives the (query, reference,
+ * distance) triples found by the search and stores (or streams, or counts)
+ * them.
+ *
+ * A result type must provide the following methods:
+ *
+ * @code
+ * // Prepare for a search with the given number of query points.
+ * void Reset(const size_t numQueries);
+ *
+ * // Add the given reference point to the results of the given query point.
+ * void Add(const size_t queryIndex,
+ *          const size_t referenceIndex,
+ *          const double distance);
+ *
+ * // The search is done; do any final work.
+ * void Finalize();
+ *
+ * // Whether the distances passed to Add() are used.  If false, the distances
+ * // of the points in a reference node which lies entirely inside the range
+ * // are not computed, and 0 is passed instead.
+ * static const bool NeedsDistances;
+ * @endcode
+ *
+ * Add() may be called from several threads at once, but never for the same
+ * query point at the same time.
+ */
+#ifndef __MLPACK_METHODS_RANGE_SEARCH_RANGE_SEARCH_RESULTS_HPP
+#define __MLPACK_METHODS_RANGE_SEARCH_RANGE_SEARCH_RESULTS_HPP
+
+#include <mlpack/core.hpp>
+
+#ifdef HAS_OPENMP
+  #include <omp.h>
+#endif
+
+namespace mlpack {
+namespace range {
+
+/**
+ * Store the results as one vector of neighbors and one vector of distances for
+ * each query point.  Each query point costs two heap allocations, and more as
+ * the vectors grow; for many results, CSRResults is more compact.
+ */
+class VectorResults
+{
+ public:
+  /**
+   * Store the results in the given vectors.
+   *
+   * @param neighbors Vector which will hold the neighbors of each query point.
+   * @param distances Vector which will hold the distances of each query point.
+   */
+  VectorResults(std::vector<std::vector<size_t> >& neighbors,
+                std::vector<std::vector<double> >& distances) :
+      neighbors(neighbors), distances(distances) { }
+
+  //! Empty the vectors and make room for the given number of query points.
+  void Reset(const size_t numQueries)
+  {
+    neighbors.clear();
+    neighbors.resize(numQueries);
+    distances.clear();
+    distances.resize(numQueries);
+  }
+
+  //! Add the given result.
+  void Add(const size_t queryIndex,
+           const size_t referenceIndex,
+           const double distance)
+  {
+    neighbors[queryIndex].push_back(referenceIndex);
+    distances[queryIndex].push_back(distance);
+  }
+
+  //! Nothing to do.
+  void Finalize() { }
+
+  //! The distances are stored, so they must be computed.
+  static const bool NeedsDistances = true;
+
+ private:
+  //! The neighbors of each query point.
+  std::vector<std::vector<size_t> >& neighbors;
+  //! The distances of each query point.
+  std::vector<std::vector<double> >& distances;
+};
+
+/**
+ * Store the results in compressed sparse row form: the neighbors and distances
+ * of all the query points are held in two flat arrays, and the results of query
+ * point i are those from Offsets()[i] to Offsets()[i + 1].
+ *
+ * During the search, each thread appends its results to its own buffer, so no
+ * locking is needed; the buffers are merged into the flat arrays by
+ * Finalize().  The results of each query point are not in any particular
+ * order.
+ */
+class CSRResults
+{
+ public:
+  //! Create an empty result set.
+  CSRResults() { }
+
+  //! Prepare the per-thread buffers for the given number of query points.
+  void Reset(const size_t numQueries);
+
+  //! Add the given result to the buffer of the calling thread.
+  void Add(const size_t queryIndex,
+           const size_t referenceIndex,
+           const double distance)
+  {
+#ifdef HAS_OPENMP
+    const size_t thread = (size_t) omp_get_thread_num();
+#else
+    const size_t thread = 0;
+#endif
+    buffers[thread].push_back(Result(queryIndex, referenceIndex, distance));
+  }
+
+  //! Merge the per-thread buffers into the flat arrays.
+  void Finalize();
+
+  //! The distances are stored, so they must be computed.
+  static const bool NeedsDistances = true;
+
+  //! Get the number of results of the given query point.
+  size_t NumResults(const size_t queryIndex) const
+  { return offsets[queryIndex + 1] - offsets[queryIndex]; }
+
+  //! Get the position of the first result of each query point (and, last, the
+  //! total number of results).
+  const arma::Col<size_t>& Offsets() const { return offsets; }
+  //! Get the neighbors of all the query points, one after another.
+  const arma::Col<size_t>& Neighbors() const { return neighbors; }
+  //! Get the distances of all the query points, one after another.
+  const arma::vec& Distances() const { return distances; }
+
+ private:
+  //! A result held in a per-thread buffer.
+  struct Result
+  {
+    Result(const size_t query, const size_t reference, const double distance) :
+        query(query), reference(reference), distance(distance) { }
+
+    size_t query;
+    size_t reference;
+    double distance;
+  };
+
+  //! The results found by each thread, before merging.
+  std::vector<std::vector<Result> > buffers;
+
+  //! The position of the first result of each query point.
+  arma::Col<size_t> offsets;
+  //! The neighbors of all the query points.
+  arma::Col<size_t> neighbors;
+  //! The distances of all the query points.
+  arma::vec distances;
+};
+
+/**
+ * Pass each result to a callback, such as a functor which writes the results
+ * to a file, without storing them.  The callback is called as
+ * callback(queryIndex, referenceIndex, distance), from one thread at a time.
+ *
+ * @tparam CallbackType Type of the callback.
+ * @tparam ComputeDistances If false, the distances of the points in reference
+ *     nodes entirely inside the range are not computed (0 is passed instead);
+ *     use this when the callback ignores the distances.
+ */
+template<typename CallbackType, bool ComputeDistances = true>
+class CallbackResults
+{
+ public:
+  /**
+   * Pass the results to the given callback.
+   *
+   * @param callback Callback to call for each result.
+   */
+  CallbackResults(CallbackType& callback) : callback(callback) { }
+
+  //! Nothing to do.
+  void Reset(const size_t /* numQueries */) { }
+
+  //! Pass the given result to the callback.
+  void Add(const size_t queryIndex,
+           const size_t referenceIndex,
+           const double distance)
+  {
+    #pragma omp critical(range_search_callback_results)
+    callback(queryIndex, referenceIndex, distance);
+  }
+
+  //! Nothing to do.
+  void Finalize() { }
+
+  //! Whether the callback needs the distances.
+  static const bool NeedsDistances = ComputeDistances;
+
+ private:
+  //! The callback.
+  CallbackType& callback;
+};
+
+/**
+ * Only count the results of each query point.
+ */
+class CountResults
+{
+ public:
+  //! Create an empty result set.
+  CountResults() { }
+
+  //! Set the count of each of the given number of query points to 0.
+  void Reset(const size_t numQueries) { counts.zeros(numQueries); }
+
+  //! Count the given result.
+  void Add(const size_t queryIndex,
+           const size_t /* referenceIndex */,
+           const double /* distance */)
+  { ++counts[queryIndex]; }
+
+  //! Nothing to do.
+  void Finalize() { }
+
+  //! Only the number of results is kept, so no distances are needed.
+  static const bool NeedsDistances = false;
+
+  //! Get the number of results of each query point.
+  const arma::Col<size_t>& Counts() const { return counts; }
+
+ private:
+  //! The number of results of each query point.
+  arma::Col<size_t> counts;
+};
+
+/**
+ * Map the query and reference indices of each result through the given
+ * mappings (from the indices of rearranged datasets to the original indices)
+ * and pass it on to another result type.  RangeSearch uses this when it has
+ * built its own trees.
+ *
+ * @tparam ResultType Type of results to pass the mapped results to.
+ */
+template<typename ResultType>
+class MappedResults
+{
+ public:
+  /**
+   * Pass the results to the given results object after mapping the indices.
+   *
+   * @param results Results object to pass the mapped results to.
+   * @param queryMap Mapping of the query indices (NULL for none).
+   * @param referenceMap Mapping of the reference indices (NULL for none).
+   */
+  MappedResults(ResultType& results,
+                const std::vector<size_t>* queryMap,
+                const std::vector<size_t>* referenceMap) :
+      results(results), queryMap(queryMap), referenceMap(referenceMap) { }
+
+  //! Prepare the results for the given number of query points.
+  void Reset(const size_t numQueries) { results.Reset(numQueries); }
+
+  //! Map the given result and pass it on.
+  void Add(const size_t queryIndex,
+           const size_t referenceIndex,
+           const double distance)
+  {
+    results.Add((queryMap == NULL) ? queryIndex : (*queryMap)[queryIndex],
+        (referenceMap == NULL) ? referenceIndex :
+        (*referenceMap)[referenceIndex], distance);
+  }
+
+  //! Finalize the results.
+  void Finalize() { results.Finalize(); }
+
+  //! The distances are needed if the wrapped results need them.
+  static const bool NeedsDistances = ResultType::NeedsDistances;
+
+ private:
+  //! The results to pass the mapped results to.
+  ResultType& results;
+  //! Mapping of the query indices (NULL for none).
+  const std::vector<size_t>* queryMap;
+  //! Mapping of the reference indices (NULL for none).
+  const std::vector<size_t>* referenceMap;
+};
+
+}; // namespace range
+}; // namespace mlpack
+
+// Include implementation.
+#include "range_search_results_impl.hpp"
+
+#endif
@@ -0,0 +1,68 @@
+/**
+ * @file range_search_results_impl.hpp
+ * @author Ryan Curtin
+ *
+ * Implementation of the CSRResults class.
+ */
+#ifndef __MLPACK_METHODS_RANGE_SEARCH_RANGE_SEARCH_RESULTS_IMPL_HPP
+#define __MLPACK_METHODS_RANGE_SEARCH_RANGE_SEARCH_RESULTS_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "range_search_results.hpp"
+
+namespace mlpack {
+namespace range {
+
+inline void CSRResults::Reset(const size_t numQueries)
+{
+  // One buffer for each thread that the search may use.
+  buffers.clear();
+#ifdef HAS_OPENMP
+  buffers.resize((size_t) omp_get_max_threads());
+#else
+  buffers.resize(1);
+#endif
+
+  offsets.zeros(numQueries + 1);
+  neighbors.reset();
+  distances.reset();
+}
+
+inline void CSRResults::Finalize()
+{
+  // Count the results of each query point; offsets[i + 1] holds the count of
+  // query point i.
+  for (size_t t = 0; t < buffers.size(); ++t)
+    for (size_t i = 0; i < buffers[t].size(); ++i)
+      ++offsets[buffers[t][i].query + 1];
+
+  // Turn the counts into offsets.
+  for (size_t i = 1; i < offsets.n_elem; ++i)
+    offsets[i] += offsets[i - 1];
+
+  // Now place each result, using the offsets as insertion positions and then
+  // shifting them back.
+  neighbors.set_size(offsets[offsets.n_elem - 1]);
+  distances.set_size(offsets[offsets.n_elem - 1]);
+  for (size_t t = 0; t < buffers.size(); ++t)
+  {
+    for (size_t i = 0; i < buffers[t].size(); ++i)
+    {
+      const size_t position = offsets[buffers[t][i].query]++;
+      neighbors[position] = buffers[t][i].reference;
+      distances[position] = buffers[t][i].distance;
+    }
+
+    // Release the memory of the buffer.
+    std::vector<Result>().swap(buffers[t]);
+  }
+
+  for (size_t i = offsets.n_elem - 1; i > 0; --i)
+    offsets[i] = offsets[i - 1];
+  offsets[0] = 0;
+}
+
+}; // namespace range
+}; // namespace mlpack
+
+#endif
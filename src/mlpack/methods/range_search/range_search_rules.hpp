@@ -7,11 +7,26 @@
 #ifndef __MLPACK_METHODS_RANGE_SEARCH_RANGE_SEARCH_RULES_HPP
 #define __MLPACK_METHODS_RANGE_SEARCH_RANGE_SEARCH_RULES_HPP
 
+#include <mlpack/core/tree/tree_traits.hpp>
+#include <mlpack/core/tree/rule_traits.hpp>
+
+#include "range_search_results.hpp"
+
 namespace mlpack {
 namespace range {
 
-
-template<typename MetricType, typename TreeType>
+/**
+ * The rules for range search.  Each point found in the range is passed to a
+ * result object of type ResultType, which may store the results, count them,
+ * or pass them on; see range_search_results.hpp.
+ *
+ * @tparam MetricType Metric to use for the search.
+ * @tparam TreeType Type of tree to search.
+ * @tparam ResultType Type of result object.
+ */
+template<typename MetricType,
+         typename TreeType,
+         typename ResultType = VectorResults>
 class RangeSearchRules
 {
  public:
@@ -22,15 +37,13 @@ class RangeSearchRules
    * @param referenceSet Set of reference data.
    * @param querySet Set of query data.
    * @param range Range to search for.
-   * @param neighbors Vector to store resulting neighbors in.
-   * @param distances Vector to store resulting distances in.
+   * @param results Object to pass the results to.
    * @param metric Instantiated metric.
    */
-  RangeSearchRules(const arma::mat& referenceSet,
-                   const arma::mat& querySet,
+  RangeSearchRules(const typename TreeType::Mat& referenceSet,
+                   const typename TreeType::Mat& querySet,
                    const math::Range& range,
-                   std::vector<std::vector<size_t> >& neighbors,
-                   std::vector<std::vector<double> >& distances,
+                   ResultType& results,
                    MetricType& metric);
 
   /**
@@ -93,19 +106,16 @@ class RangeSearchRules
 
  private:
   //! The reference set.
-  const arma::mat& referenceSet;
+  const typename TreeType::Mat& referenceSet;
 
   //! The query set.
-  const arma::mat& querySet;
+  const typename TreeType::Mat& querySet;
 
   //! The range of distances for which we are searching.
   const math::Range& range;
 
-  //! The vector the resultant neighbor indices should be stored in.
-  std::vector<std::vector<size_t> >& neighbors;
-
-  //! The vector the resultant neighbor distances should be stored in.
-  std::vector<std::vector<double> >& distances;
+  //! The object the results are passed to.
+  ResultType& results;
 
   //! The instantiated metric.
   MetricType& metric;
@@ -120,9 +130,43 @@ class RangeSearchRules
   //! add that to the results twice.
   void AddResult(const size_t queryIndex,
                  TreeType& referenceNode);
+
+  //! Add all the points in the given reference node to the results of each
+  //! point in the given query node.
+  void AddResults(TreeType& queryNode, TreeType& referenceNode);
+
+  //! Add the points held in the leaves under the given node to the results for
+  //! the given query point, except the point with index skipIndex.  This is
+  //! used for trees with self-children, where Descendant() is slow.
+  void AddLeaves(const size_t queryIndex,
+                 TreeType& referenceNode,
+                 const size_t skipIndex);
+
+  //! Add the given reference point to the results for the given query point,
+  //! computing the distance only if the results need it.
+  void AddPoint(const size_t queryIndex, const size_t referenceIndex);
 };
 
 }; // namespace range
+
+namespace tree {
+
+/**
+ * Each query point only adds to its own results, so copies of
+ * RangeSearchRules can traverse disjoint query subtrees in parallel, as long as
+ * the reference statistics are not used to cache base cases (which happens when
+ * the first point of a node is its centroid).
+ */
+template<typename MetricType, typename TreeType, typename ResultType>
+class RuleTraits<range::RangeSearchRules<MetricType, TreeType, ResultType> >
+{
+ public:
+  static const bool IsParallelSafe =
+      !TreeTraits<TreeType>::FirstPointIsCentroid;
+  static const bool HasBlockBaseCase = false;
+};
+
+}; // namespace tree
 }; // namespace mlpack
 
 // Include implementation.
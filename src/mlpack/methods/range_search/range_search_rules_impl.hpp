@@ -13,19 +13,17 @@
 namespace mlpack {
 namespace range {
 
-template<typename MetricType, typename TreeType>
-RangeSearchRules<MetricType, TreeType>::RangeSearchRules(
-    const arma::mat& referenceSet,
-    const arma::mat& querySet,
+template<typename MetricType, typename TreeType, typename ResultType>
+RangeSearchRules<MetricType, TreeType, ResultType>::RangeSearchRules(
+    const typename TreeType::Mat& referenceSet,
+    const typename TreeType::Mat& querySet,
     const math::Range& range,
-    std::vector<std::vector<size_t> >& neighbors,
-    std::vector<std::vector<double> >& distances,
+    ResultType& results,
     MetricType& metric) :
     referenceSet(referenceSet),
     querySet(querySet),
     range(range),
-    neighbors(neighbors),
-    distances(distances),
+    results(results),
     metric(metric),
     lastQueryIndex(querySet.n_cols),
     lastReferenceIndex(referenceSet.n_cols)
@@ -35,8 +33,8 @@ RangeSearchRules<MetricType, TreeType>::RangeSearchRules(
 
 //! The base case.  Evaluate the distance between the two points and add to the
 //! results if necessary.
-template<typename MetricType, typename TreeType>
-double RangeSearchRules<MetricType, TreeType>::BaseCase(
+template<typename MetricType, typename TreeType, typename ResultType>
+double RangeSearchRules<MetricType, TreeType, ResultType>::BaseCase(
     const size_t queryIndex,
     const size_t referenceIndex)
 {
@@ -59,18 +57,16 @@ double RangeSearchRules<MetricType, TreeType>::BaseCase(
   lastReferenceIndex = referenceIndex;
 
   if (range.Contains(distance))
-  {
-    neighbors[queryIndex].push_back(referenceIndex);
-    distances[queryIndex].push_back(distance);
-  }
+    results.Add(queryIndex, referenceIndex, distance);
 
   return distance;
 }
 
 //! Single-tree scoring function.
-template<typename MetricType, typename TreeType>
-double RangeSearchRules<MetricType, TreeType>::Score(const size_t queryIndex,
-                                                     TreeType& referenceNode)
+template<typename MetricType, typename TreeType, typename ResultType>
+double RangeSearchRules<MetricType, TreeType, ResultType>::Score(
+    const size_t queryIndex,
+    TreeType& referenceNode)
 {
   // We must get the minimum and maximum distances and store them in this
   // object.
@@ -127,8 +123,8 @@ double RangeSearchRules<MetricType, TreeType>::Score(const size_t queryIndex,
 }
 
 //! Single-tree rescoring function.
-template<typename MetricType, typename TreeType>
-double RangeSearchRules<MetricType, TreeType>::Rescore(
+template<typename MetricType, typename TreeType, typename ResultType>
+double RangeSearchRules<MetricType, TreeType, ResultType>::Rescore(
     const size_t /* queryIndex */,
     TreeType& /* referenceNode */,
     const double oldScore) const
@@ -138,9 +134,10 @@ double RangeSearchRules<MetricType, TreeType>::Rescore(
 }
 
 //! Dual-tree scoring function.
-template<typename MetricType, typename TreeType>
-double RangeSearchRules<MetricType, TreeType>::Score(TreeType& queryNode,
-                                                     TreeType& referenceNode)
+template<typename MetricType, typename TreeType, typename ResultType>
+double RangeSearchRules<MetricType, TreeType, ResultType>::Score(
+    TreeType& queryNode,
+    TreeType& referenceNode)
 {
   math::Range distances;
   if (tree::TreeTraits<TreeType>::FirstPointIsCentroid)
@@ -235,8 +232,7 @@ double RangeSearchRules<MetricType, TreeType>::Score(TreeType& queryNode,
   // the results for each point in the query node.
   if ((distances.Lo() >= range.Lo()) && (distances.Hi() <= range.Hi()))
   {
-    for (size_t i = 0; i < queryNode.NumDescendants(); ++i)
-      AddResult(queryNode.Descendant(i), referenceNode);
+    AddResults(queryNode, referenceNode);
     return DBL_MAX; // We don't need to go any deeper.
   }
 
@@ -246,8 +242,8 @@ double RangeSearchRules<MetricType, TreeType>::Score(TreeType& queryNode,
 }
 
 //! Dual-tree rescoring function.
-template<typename MetricType, typename TreeType>
-double RangeSearchRules<MetricType, TreeType>::Rescore(
+template<typename MetricType, typename TreeType, typename ResultType>
+double RangeSearchRules<MetricType, TreeType, ResultType>::Rescore(
     TreeType& /* queryNode */,
     TreeType& /* referenceNode */,
     const double oldScore) const
@@ -258,44 +254,102 @@ double RangeSearchRules<MetricType, TreeType>::Rescore(
 
 //! Add all the points in the given node to the results for the given query
 //! point.
-template<typename MetricType, typename TreeType>
-void RangeSearchRules<MetricType, TreeType>::AddResult(const size_t queryIndex,
-                                                       TreeType& referenceNode)
+template<typename MetricType, typename TreeType, typename ResultType>
+void RangeSearchRules<MetricType, TreeType, ResultType>::AddResult(
+    const size_t queryIndex,
+    TreeType& referenceNode)
 {
   // Some types of trees calculate the base case evaluation before Score() is
   // called, so if the base case has already been calculated, then we must avoid
-  // adding that point to the results again.
-  size_t baseCaseMod = 0;
+  // adding that point to the results again.  (No point has index n_cols.)
+  size_t skipIndex = referenceSet.n_cols;
   if (tree::TreeTraits<TreeType>::FirstPointIsCentroid &&
       (queryIndex == lastQueryIndex) &&
       (referenceNode.Point(0) == lastReferenceIndex))
   {
-    baseCaseMod = 1;
+    skipIndex = referenceNode.Point(0);
   }
 
-  // Resize distances and neighbors vectors appropriately.  We have to use
-  // reserve() and not resize(), because we don't know if we will encounter the
-  // case where the datasets and points are the same (and we skip in that case).
-  const size_t oldSize = neighbors[queryIndex].size();
-  neighbors[queryIndex].reserve(oldSize + referenceNode.NumDescendants() -
-      baseCaseMod);
-  distances[queryIndex].reserve(oldSize + referenceNode.NumDescendants() -
-      baseCaseMod);
-
-  for (size_t i = baseCaseMod; i < referenceNode.NumDescendants(); ++i)
+  // In a tree with self-children, each point is held by exactly one leaf, and
+  // walking the leaves is much cheaper than calling Descendant() for each
+  // point.  Otherwise (such as for the BinarySpaceTree, whose descendants are
+  // contiguous), Descendant() is cheap.
+  if (tree::TreeTraits<TreeType>::HasSelfChildren)
+  {
+    AddLeaves(queryIndex, referenceNode, skipIndex);
+  }
+  else
   {
-    if ((&referenceSet == &querySet) &&
-        (queryIndex == referenceNode.Descendant(i)))
-      continue;
+    for (size_t i = 0; i < referenceNode.NumDescendants(); ++i)
+      if (referenceNode.Descendant(i) != skipIndex)
+        AddPoint(queryIndex, referenceNode.Descendant(i));
+  }
+}
 
-    const double distance = metric.Evaluate(querySet.unsafe_col(queryIndex),
-        referenceNode.Dataset().unsafe_col(referenceNode.Descendant(i)));
+//! Add all the points in the given reference node to the results of each point
+//! in the given query node.
+template<typename MetricType, typename TreeType, typename ResultType>
+void RangeSearchRules<MetricType, TreeType, ResultType>::AddResults(
+    TreeType& queryNode,
+    TreeType& referenceNode)
+{
+  if (!tree::TreeTraits<TreeType>::HasSelfChildren)
+  {
+    for (size_t i = 0; i < queryNode.NumDescendants(); ++i)
+      AddResult(queryNode.Descendant(i), referenceNode);
+  }
+  else if (queryNode.NumChildren() == 0)
+  {
+    AddResult(queryNode.Point(0), referenceNode);
+  }
+  else
+  {
+    // Walk the leaves of the query node, as in AddLeaves().
+    for (size_t i = 0; i < queryNode.NumChildren(); ++i)
+      AddResults(queryNode.Child(i), referenceNode);
+  }
+}
 
-    neighbors[queryIndex].push_back(referenceNode.Descendant(i));
-    distances[queryIndex].push_back(distance);
+//! Add the points in the leaves under the given node to the results for the
+//! given query point.
+template<typename MetricType, typename TreeType, typename ResultType>
+void RangeSearchRules<MetricType, TreeType, ResultType>::AddLeaves(
+    const size_t queryIndex,
+    TreeType& referenceNode,
+    const size_t skipIndex)
+{
+  if (referenceNode.NumChildren() == 0)
+  {
+    for (size_t i = 0; i < referenceNode.NumPoints(); ++i)
+      if (referenceNode.Point(i) != skipIndex)
+        AddPoint(queryIndex, referenceNode.Point(i));
+  }
+  else
+  {
+    for (size_t i = 0; i < referenceNode.NumChildren(); ++i)
+      AddLeaves(queryIndex, referenceNode.Child(i), skipIndex);
   }
 }
 
+//! Add a single point to the results for the given query point.
+template<typename MetricType, typename TreeType, typename ResultType>
+inline void RangeSearchRules<MetricType, TreeType, ResultType>::AddPoint(
+    const size_t queryIndex,
+    const size_t referenceIndex)
+{
+  // Don't return a point as in its own range.
+  if ((&referenceSet == &querySet) && (queryIndex == referenceIndex))
+    return;
+
+  // The point is known to be in the range, so the distance is only needed if
+  // the results keep it.
+  const double distance = (ResultType::NeedsDistances) ?
+      metric.Evaluate(querySet.unsafe_col(queryIndex),
+      referenceSet.unsafe_col(referenceIndex)) : 0.0;
+
+  results.Add(queryIndex, referenceIndex, distance);
+}
+
 }; // namespace range
 }; // namespace mlpack
 
@@ -16,6 +16,10 @@
 
 #include "ra_search.hpp"
 
+#ifdef HAS_OPENMP
+  #include <omp.h>
+#endif
+
 using namespace std;
 using namespace mlpack;
 using namespace mlpack::neighbor;
@@ -46,7 +50,14 @@ PROGRAM_INFO("All K-Rank-Approximate-Nearest-Neighbors",
     "neighbors output file corresponds to the index of the point in the "
     "reference set which is the i'th nearest neighbor from the point in the "
     "query set with index j.  Row i and column j in the distances output file "
-    "corresponds to the distance between those two points.");
+    "corresponds to the distance between those two points."
+    "\n\n"
+    "The search is split between threads if OpenMP is available; the number "
+    "of threads can be set with --threads (-T).  Because the neighbors are "
+    "found by sampling, results differ from run to run unless --seed is "
+    "given.  For a given seed, single-tree and naive results do not depend on "
+    "the number of threads, and dual-tree results are the same for the same "
+    "number of threads.");
 
 // Define our input parameters that this program will take.
 PARAM_STRING_REQ("reference_file", "File containing the reference dataset.",
@@ -77,11 +88,34 @@ PARAM_FLAG("first_leaf_exact", "The flag to trigger sampling only after "
 PARAM_INT("single_sample_limit", "The limit on the maximum number of "
     "samples (and hence the largest node you can approximate).", "S", 20);
 
+PARAM_INT("seed", "Random seed.  If 0, 'std::time(NULL)' is used.", "e", 0);
+PARAM_INT("threads", "Number of threads to use (0 uses the OpenMP default).",
+    "T", 0);
+
 int main(int argc, char *argv[])
 {
   // Give CLI the command line parameters the user passed in.
   CLI::ParseCommandLine(argc, argv);
-  math::RandomSeed(time(NULL));
+
+  if (CLI::GetParam<int>("seed") != 0)
+    math::RandomSeed((size_t) CLI::GetParam<int>("seed"));
+  else
+    math::RandomSeed((size_t) time(NULL));
+
+  const int threads = CLI::GetParam<int>("threads");
+  if (threads < 0)
+  {
+    Log::Fatal << "Invalid number of threads (" << threads << ")! Must be "
+        << "greater than or equal to 0." << endl;
+  }
+
+#ifdef HAS_OPENMP
+  if (threads > 0)
+    omp_set_num_threads(threads);
+#else
+  if (threads > 1)
+    Log::Warn << "OpenMP is not available; --threads is ignored." << endl;
+#endif
 
   // Get all the parameters.
   string referenceFile = CLI::GetParam<string>("reference_file");
@@ -24,6 +24,8 @@
 
 #include <mlpack/core/metrics/lmetric.hpp>
 #include <mlpack/methods/neighbor_search/sort_policies/nearest_neighbor_sort.hpp>
+#include <mlpack/methods/neighbor_search/neighbor_lists/sorted_neighbor_list.hpp>
+#include <mlpack/methods/neighbor_search/neighbor_lists/heap_neighbor_list.hpp>
 
 namespace mlpack {
 namespace neighbor /** Neighbor-search routines.  These include
@@ -94,11 +96,14 @@ class RAQueryStat
  * @tparam SortPolicy The sort policy for distances; see NearestNeighborSort.
  * @tparam MetricType The metric to use for computation.
  * @tparam TreeType The tree type to use.
+ * @tparam NeighborListType The type of candidate list to use; see
+ *     SortedNeighborList.  HeapNeighborList is faster for large k.
  */
 template<typename SortPolicy = NearestNeighborSort,
          typename MetricType = mlpack::metric::SquaredEuclideanDistance,
          typename TreeType = tree::BinarySpaceTree<bound::HRectBound<2, false>,
-                                                   RAQueryStat<SortPolicy> > >
+                                                   RAQueryStat<SortPolicy> >,
+         typename NeighborListType = SortedNeighborList<SortPolicy> >
 class RASearch
 {
  public:
@@ -16,8 +16,11 @@ namespace mlpack {
 namespace neighbor {
 
 // Construct the object.
-template<typename SortPolicy, typename MetricType, typename TreeType>
-RASearch<SortPolicy, MetricType, TreeType>::
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+RASearch<SortPolicy, MetricType, TreeType, NeighborListType>::
 RASearch(const typename TreeType::Mat& referenceSet,
          const typename TreeType::Mat& querySet,
          const bool naive,
@@ -52,8 +55,11 @@ RASearch(const typename TreeType::Mat& referenceSet,
 }
 
 // Construct the object.
-template<typename SortPolicy, typename MetricType, typename TreeType>
-RASearch<SortPolicy, MetricType, TreeType>::
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+RASearch<SortPolicy, MetricType, TreeType, NeighborListType>::
 RASearch(const typename TreeType::Mat& referenceSet,
          const bool naive,
          const bool singleMode,
@@ -83,8 +89,11 @@ RASearch(const typename TreeType::Mat& referenceSet,
 }
 
 // Construct the object.
-template<typename SortPolicy, typename MetricType, typename TreeType>
-RASearch<SortPolicy, MetricType, TreeType>::
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+RASearch<SortPolicy, MetricType, TreeType, NeighborListType>::
 RASearch(TreeType* referenceTree,
          TreeType* queryTree,
          const typename TreeType::Mat& referenceSet,
@@ -105,8 +114,11 @@ RASearch(TreeType* referenceTree,
 {  }
 
 // Construct the object.
-template<typename SortPolicy, typename MetricType, typename TreeType>
-RASearch<SortPolicy, MetricType, TreeType>::
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+RASearch<SortPolicy, MetricType, TreeType, NeighborListType>::
 RASearch(TreeType* referenceTree,
          const typename TreeType::Mat& referenceSet,
          const bool singleMode,
@@ -128,8 +140,11 @@ RASearch(TreeType* referenceTree,
  * The tree is the only member we may be responsible for deleting.  The others
  * will take care of themselves.
  */
-template<typename SortPolicy, typename MetricType, typename TreeType>
-RASearch<SortPolicy, MetricType, TreeType>::
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+RASearch<SortPolicy, MetricType, TreeType, NeighborListType>::
 ~RASearch()
 {
   if (ownReferenceTree)
@@ -142,8 +157,11 @@ RASearch<SortPolicy, MetricType, TreeType>::
  * Computes the best neighbors and stores them in resultingNeighbors and
  * distances.
  */
-template<typename SortPolicy, typename MetricType, typename TreeType>
-void RASearch<SortPolicy, MetricType, TreeType>::
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+void RASearch<SortPolicy, MetricType, TreeType, NeighborListType>::
 Search(const size_t k,
        arma::Mat<size_t>& resultingNeighbors,
        arma::mat& distances,
@@ -177,14 +195,20 @@ Search(const size_t k,
 
   size_t numPrunes = 0;
 
+  // The number of samples made and of distance evaluations for each query
+  // point; these are shared by all the copies of the rules.
+  arma::Col<size_t> numSamplesMade;
+  arma::Col<size_t> numDistComputations;
+
   if (singleMode || naive)
   {
     // Create the helper object for the tree traversal.  Initialization of
     // RASearchRules already implicitly performs the naive tree traversal.
-    typedef RASearchRules<SortPolicy, MetricType, TreeType> RuleType;
+    typedef RASearchRules<SortPolicy, MetricType, TreeType,
+        NeighborListType> RuleType;
     RuleType rules(referenceSet, querySet, *neighborPtr, *distancePtr,
-                   metric, tau, alpha, naive, sampleAtLeaves, firstLeafExact,
-                   singleSampleLimit);
+                   numSamplesMade, numDistComputations, metric, tau, alpha,
+                   naive, sampleAtLeaves, firstLeafExact, singleSampleLimit);
 
     // If the reference root node is a leaf, then the sampling has already been
     // done in the RASearchRules constructor.  This happens when naive = true.
@@ -192,15 +216,23 @@ Search(const size_t k,
     {
       Log::Info << "Performing single-tree traversal..." << std::endl;
 
-      // Create the traverser.
-      typename TreeType::template SingleTreeTraverser<RuleType>
-        traverser(rules);
+      // Each thread gets its own copy of the rules (and its own traverser).
+      // The samples drawn for each query point do not depend on the thread
+      // that searches for it.
+      #pragma omp parallel if (tree::RuleTraits<RuleType>::IsParallelSafe) \
+          reduction(+:numPrunes)
+      {
+        RuleType threadRules(rules);
+        typename TreeType::template SingleTreeTraverser<RuleType>
+            traverser(threadRules);
 
-      // Now have it traverse for each point.
-      for (size_t i = 0; i < querySet.n_cols; ++i)
-        traverser.Traverse(i, *referenceTree);
+        // Now have it traverse for each point.
+        #pragma omp for schedule(dynamic, 64)
+        for (size_t i = 0; i < querySet.n_cols; ++i)
+          traverser.Traverse(i, *referenceTree);
 
-      numPrunes = traverser.NumPrunes();
+        numPrunes += traverser.NumPrunes();
+      }
 
       Log::Info << "Single-tree traversal complete." << std::endl;
       Log::Info << "Average number of distance calculations per query point: "
@@ -212,11 +244,13 @@ Search(const size_t k,
   {
     Log::Info << "Performing dual-tree traversal..." << std::endl;
 
-    typedef RASearchRules<SortPolicy, MetricType, TreeType> RuleType;
+    typedef RASearchRules<SortPolicy, MetricType, TreeType,
+        NeighborListType> RuleType;
     RuleType rules(referenceSet, querySet, *neighborPtr, *distancePtr,
-                   metric, tau, alpha, sampleAtLeaves, firstLeafExact,
-                   singleSampleLimit);
+                   numSamplesMade, numDistComputations, metric, tau, alpha,
+                   false, sampleAtLeaves, firstLeafExact, singleSampleLimit);
 
+    // The traverser splits the query tree between threads, if it can.
     typename TreeType::template DualTreeTraverser<RuleType> traverser(rules);
 
     if (queryTree)
@@ -239,6 +273,9 @@ Search(const size_t k,
         << (rules.NumDistComputations() / querySet.n_cols) << "." << std::endl;
   }
 
+  // Put the candidate lists in order.
+  NeighborListType::Finalize(*distancePtr, *neighborPtr);
+
   Timer::Stop("computing_neighbors");
   Log::Info << "Pruned " << numPrunes << " nodes." << std::endl;
 
@@ -331,8 +368,12 @@ Search(const size_t k,
   }
 } // Search
 
-template<typename SortPolicy, typename MetricType, typename TreeType>
-void RASearch<SortPolicy, MetricType, TreeType>::ResetQueryTree()
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+void RASearch<SortPolicy, MetricType, TreeType,
+    NeighborListType>::ResetQueryTree()
 {
   if (!singleMode)
   {
@@ -343,8 +384,12 @@ void RASearch<SortPolicy, MetricType, TreeType>::ResetQueryTree()
   }
 }
 
-template<typename SortPolicy, typename MetricType, typename TreeType>
-void RASearch<SortPolicy, MetricType, TreeType>::ResetRAQueryStat(
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+void RASearch<SortPolicy, MetricType, TreeType,
+    NeighborListType>::ResetRAQueryStat(
     TreeType* treeNode)
 {
   treeNode->Stat().Bound() = SortPolicy::WorstDistance();
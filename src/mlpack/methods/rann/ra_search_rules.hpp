@@ -9,17 +9,68 @@
 #ifndef __MLPACK_METHODS_RANN_RA_SEARCH_RULES_HPP
 #define __MLPACK_METHODS_RANN_RA_SEARCH_RULES_HPP
 
+#include <mlpack/core/metrics/lmetric.hpp>
+#include <mlpack/core/tree/tree_traits.hpp>
+#include <mlpack/core/tree/rule_traits.hpp>
+#include <mlpack/methods/neighbor_search/neighbor_lists/sorted_neighbor_list.hpp>
+
 namespace mlpack {
 namespace neighbor {
 
-template<typename SortPolicy, typename MetricType, typename TreeType>
+/**
+ * The rules for rank-approximate nearest neighbor search.
+ *
+ * The points sampled from a reference node are drawn from a random stream
+ * determined by a seed (taken from the mlpack random number generator when the
+ * rules are created), the query point (or query node), the reference node, and
+ * the number of samples already made.  So the same samples are drawn whichever
+ * thread does the drawing, and a search is reproducible given the seed.
+ * Copies of the rules can be used to search for different query points (or
+ * disjoint query subtrees) in parallel: the number of samples made and of
+ * distance evaluations are counted per query point, in vectors shared by the
+ * copies.
+ *
+ * When a reference node is approximated by sampling in dual-tree search, every
+ * query point in the query node is compared with the same sampled points.  Each
+ * query point still sees a uniform random sample of the reference node, which
+ * is all the rank guarantee needs, and with the Euclidean (or squared
+ * Euclidean) distance the comparisons are done as one matrix product.
+ */
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType = SortedNeighborList<SortPolicy> >
 class RASearchRules
 {
  public:
+  /**
+   * Construct the RASearchRules object.  This is usually done from within the
+   * RASearch class at search time.  If naive is true, the sampling is done
+   * here, for every query point.
+   *
+   * @param referenceSet Set of reference data.
+   * @param querySet Set of query data.
+   * @param neighbors Matrix to store resulting neighbors in.
+   * @param distances Matrix to store resulting distances in.
+   * @param numSamplesMade Vector which will hold the number of samples made
+   *     for each query point.
+   * @param numDistComputations Vector which will hold the number of distance
+   *     evaluations made for each query point.
+   * @param metric Instantiated metric.
+   * @param tau The rank-approximation in percentile of the data.
+   * @param alpha The desired success probability.
+   * @param naive If true, sample from the whole reference set without a tree.
+   * @param sampleAtLeaves Whether to sample at leaves.
+   * @param firstLeafExact Whether to search the first leaf exactly.
+   * @param singleSampleLimit The largest node that can be approximated by
+   *     sampling.
+   */
   RASearchRules(const arma::mat& referenceSet,
                 const arma::mat& querySet,
                 arma::Mat<size_t>& neighbors,
                 arma::mat& distances,
+                arma::Col<size_t>& numSamplesMade,
+                arma::Col<size_t>& numDistComputations,
                 MetricType& metric,
                 const double tau = 5,
                 const double alpha = 0.95,
@@ -197,14 +248,35 @@ class RASearchRules
                  const double oldScore);
 
 
-  size_t NumDistComputations() { return numDistComputations; }
-  size_t NumEffectiveSamples()
-  {
-    if (numSamplesMade.n_elem == 0)
-      return 0;
-    else
-      return arma::sum(numSamplesMade);
-  }
+  //! Get the total number of distance evaluations.
+  size_t NumDistComputations() const
+  { return arma::accu(numDistComputations); }
+  //! Get the total number of samples made (including the implicit samples of
+  //! pruned nodes).
+  size_t NumEffectiveSamples() const { return arma::accu(numSamplesMade); }
+  //! Get the minimum number of samples required per query.
+  size_t NumSamplesReqd() const { return numSamplesReqd; }
+
+  /**
+   * Pick up desired number of samples (with replacement) from a given range
+   * of integers so that only the distinct samples are returned from
+   * the range [0 - specified upper bound).  The samples are drawn from the
+   * random stream identified by the seed and the given keys.
+   *
+   * @param numSamples Number of random samples.
+   * @param rangeUpperBound The upper bound on the range of integers.
+   * @param queryKey Index of the query point (or first point of the query
+   *     node) the samples are for.
+   * @param referenceKey Index of the first point of the reference node.
+   * @param samplesMade Number of samples already made for the query.
+   * @param distinctSamples The list of the distinct samples (sorted).
+   */
+  void ObtainDistinctSamples(const size_t numSamples,
+                             const size_t rangeUpperBound,
+                             const size_t queryKey,
+                             const size_t referenceKey,
+                             const size_t samplesMade,
+                             std::vector<size_t>& distinctSamples) const;
 
  private:
   //! The reference set.
@@ -235,27 +307,16 @@ class RASearchRules
   size_t numSamplesReqd;
 
   //! The number of samples made for every query
-  arma::Col<size_t> numSamplesMade;
+  arma::Col<size_t>& numSamplesMade;
+
+  //! The number of distance evaluations made for every query.
+  arma::Col<size_t>& numDistComputations;
 
   //! The sampling ratio
   double samplingRatio;
 
-  // TO REMOVE: just for testing
-  size_t numDistComputations;
-
-  /**
-   * Insert a point into the neighbors and distances matrices; this is a helper
-   * function.
-   *
-   * @param queryIndex Index of point whose neighbors we are inserting into.
-   * @param pos Position in list to insert into.
-   * @param neighbor Index of reference point which is being inserted.
-   * @param distance Distance from query point to reference point.
-   */
-  void InsertNeighbor(const size_t queryIndex,
-                      const size_t pos,
-                      const size_t neighbor,
-                      const double distance);
+  //! The seed of the random streams the samples are drawn from.
+  uint64_t seed;
 
   /**
    * Compute the minimum number of samples required to guarantee
@@ -286,17 +347,46 @@ class RASearchRules
                             const size_t t) const;
 
   /**
-   * Pick up desired number of samples (with replacement) from a given range
-   * of integers so that only the distinct samples are returned from
-   * the range [0 - specified upper bound)
+   * Sample the given number of points from the reference points
+   * [referenceBegin, referenceBegin + referenceCount), and evaluate the base
+   * cases between each sampled point and each query point in
+   * [queryBegin, queryEnd).
    *
-   * @param numSamples Number of random samples.
-   * @param rangeUpperBound The upper bound on the range of integers.
-   * @param distinctSamples The list of the distinct samples.
+   * @param queryBegin Index of the first query point.
+   * @param queryEnd Index one past the last query point.
+   * @param referenceBegin Index of the first reference point.
+   * @param referenceCount Number of reference points to sample from.
+   * @param numSamples Number of samples to make.
+   * @param samplesMade Number of samples already made for the query points.
    */
-  void ObtainDistinctSamples(const size_t numSamples,
-                             const size_t rangeUpperBound,
-                             arma::uvec& distinctSamples) const;
+  void SampleBaseCases(const size_t queryBegin,
+                       const size_t queryEnd,
+                       const size_t referenceBegin,
+                       const size_t referenceCount,
+                       const size_t numSamples,
+                       const size_t samplesMade);
+
+  /**
+   * Evaluate the base cases between each query point in [queryBegin, queryEnd)
+   * and each of the given reference points, one at a time.
+   */
+  template<typename AnyMetricType>
+  void BaseCases(const size_t queryBegin,
+                 const size_t queryEnd,
+                 const std::vector<size_t>& referenceIndices,
+                 const AnyMetricType& /* metric */);
+
+  /**
+   * Evaluate the base cases between each query point in [queryBegin, queryEnd)
+   * and each of the given reference points, with one matrix product.  Only the
+   * pairs which could be among the nearest neighbors are evaluated exactly;
+   * the others are only counted as samples.
+   */
+  template<bool TakeRoot>
+  void BaseCases(const size_t queryBegin,
+                 const size_t queryEnd,
+                 const std::vector<size_t>& referenceIndices,
+                 const metric::LMetric<2, TakeRoot>& /* metric */);
 
   /**
    * Perform actual scoring for single-tree case.
@@ -317,6 +407,30 @@ class RASearchRules
 }; // class RASearchRules
 
 }; // namespace neighbor
+
+namespace tree {
+
+/**
+ * Each query point only touches its own results and counters (and, in
+ * dual-tree search, the statistics of the query node and its children), so
+ * copies of RASearchRules can search for different query points or disjoint
+ * query subtrees in parallel, as long as the tree has no centroid first
+ * points.
+ */
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+class RuleTraits<neighbor::RASearchRules<SortPolicy, MetricType, TreeType,
+    NeighborListType> >
+{
+ public:
+  static const bool IsParallelSafe =
+      !TreeTraits<TreeType>::FirstPointIsCentroid;
+  static const bool HasBlockBaseCase = false;
+};
+
+}; // namespace tree
 }; // namespace mlpack
 
 // Include implementation.
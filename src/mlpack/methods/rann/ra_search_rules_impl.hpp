@@ -10,15 +10,23 @@
 // In case it hasn't been included yet.
 #include "ra_search_rules.hpp"
 
+// For SquaredToDistance().
+#include <mlpack/methods/neighbor_search/neighbor_search_rules.hpp>
+
 namespace mlpack {
 namespace neighbor {
 
-template<typename SortPolicy, typename MetricType, typename TreeType>
-RASearchRules<SortPolicy, MetricType, TreeType>::
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+RASearchRules<SortPolicy, MetricType, TreeType, NeighborListType>::
 RASearchRules(const arma::mat& referenceSet,
               const arma::mat& querySet,
               arma::Mat<size_t>& neighbors,
               arma::mat& distances,
+              arma::Col<size_t>& numSamplesMade,
+              arma::Col<size_t>& numDistComputations,
               MetricType& metric,
               const double tau,
               const double alpha,
@@ -33,7 +41,9 @@ RASearchRules(const arma::mat& referenceSet,
   metric(metric),
   sampleAtLeaves(sampleAtLeaves),
   firstLeafExact(firstLeafExact),
-  singleSampleLimit(singleSampleLimit)
+  singleSampleLimit(singleSampleLimit),
+  numSamplesMade(numSamplesMade),
+  numDistComputations(numDistComputations)
 {
   // Validate tau to make sure that the rank approximation is greater than the
   // number of neighbors requested.
@@ -59,49 +69,178 @@ RASearchRules(const arma::mat& referenceSet,
   Timer::Stop("computing_number_of_samples_reqd");
 
   // Initialize some statistics to be collected during the search.
-  numSamplesMade = arma::zeros<arma::Col<size_t> >(querySet.n_cols);
-  numDistComputations = 0;
+  numSamplesMade.zeros(querySet.n_cols);
+  numDistComputations.zeros(querySet.n_cols);
   samplingRatio = (double) numSamplesReqd / (double) n;
 
+  // Take the seed of the sampling streams from the mlpack random number
+  // generator, so that math::RandomSeed() makes the search reproducible.
+  seed = ((uint64_t) math::RandInt(std::numeric_limits<int>::max()) << 32) ^
+      (uint64_t) math::RandInt(std::numeric_limits<int>::max());
+
   Log::Info << "Minimum samples required per query: " << numSamplesReqd <<
     ", sampling ratio: " << samplingRatio << std::endl;
 
   if (naive) // No tree traversal; just do naive sampling here.
   {
-    // Sample enough points.
+    // Sample enough points.  Each query point is independent of the others.
+    #pragma omp parallel for schedule(dynamic, 16)
     for (size_t i = 0; i < querySet.n_cols; ++i)
-    {
-      arma::uvec distinctSamples;
-      ObtainDistinctSamples(numSamplesReqd, n, distinctSamples);
-      for (size_t j = 0; j < distinctSamples.n_elem; j++)
-        BaseCase(i, (size_t) distinctSamples[j]);
-    }
+      SampleBaseCases(i, i + 1, 0, n, numSamplesReqd, 0);
   }
 }
 
 
-template<typename SortPolicy, typename MetricType, typename TreeType>
+//! Mix the bits of the given integer (the finalizer of the SplitMix64
+//! generator); consecutive inputs give statistically independent outputs.
+inline uint64_t MixBits(uint64_t x)
+{
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
 inline force_inline
-void RASearchRules<SortPolicy, MetricType, TreeType>::
+void RASearchRules<SortPolicy, MetricType, TreeType, NeighborListType>::
 ObtainDistinctSamples(const size_t numSamples,
                       const size_t rangeUpperBound,
-                      arma::uvec& distinctSamples) const
+                      const size_t queryKey,
+                      const size_t referenceKey,
+                      const size_t samplesMade,
+                      std::vector<size_t>& distinctSamples) const
 {
-  // Keep track of the points that are sampled.
-  arma::Col<size_t> sampledPoints;
-  sampledPoints.zeros(rangeUpperBound);
+  // The state of the stream is determined by the seed and the keys, so it does
+  // not matter which thread draws the samples, or when.
+  uint64_t state = MixBits(seed ^ (uint64_t) queryKey);
+  state = MixBits(state ^ (uint64_t) referenceKey);
+  state = MixBits(state ^ (uint64_t) samplesMade);
 
+  distinctSamples.resize(numSamples);
   for (size_t i = 0; i < numSamples; i++)
-    sampledPoints[(size_t) math::RandInt(rangeUpperBound)]++;
+  {
+    // Use the top 53 bits of each draw as a uniform double in [0, 1).
+    state += 0x9e3779b97f4a7c15ULL;
+    const double u = (double) (MixBits(state) >> 11) / 9007199254740992.0;
+    distinctSamples[i] = (size_t) (u * (double) rangeUpperBound);
+  }
+
+  // Keep only the distinct samples.
+  std::sort(distinctSamples.begin(), distinctSamples.end());
+  distinctSamples.erase(std::unique(distinctSamples.begin(),
+      distinctSamples.end()), distinctSamples.end());
+}
 
-  distinctSamples = arma::find(sampledPoints > 0);
-  return;
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+void RASearchRules<SortPolicy, MetricType, TreeType, NeighborListType>::
+SampleBaseCases(const size_t queryBegin,
+                const size_t queryEnd,
+                const size_t referenceBegin,
+                const size_t referenceCount,
+                const size_t numSamples,
+                const size_t samplesMade)
+{
+  std::vector<size_t> distinctSamples;
+  ObtainDistinctSamples(numSamples, referenceCount, queryBegin, referenceBegin,
+      samplesMade, distinctSamples);
+  for (size_t i = 0; i < distinctSamples.size(); i++)
+    distinctSamples[i] += referenceBegin;
+
+  // The counting of the samples is done in BaseCases() so no book-keeping is
+  // required here.
+  BaseCases(queryBegin, queryEnd, distinctSamples, metric);
+}
+
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+template<typename AnyMetricType>
+void RASearchRules<SortPolicy, MetricType, TreeType, NeighborListType>::
+BaseCases(const size_t queryBegin,
+          const size_t queryEnd,
+          const std::vector<size_t>& referenceIndices,
+          const AnyMetricType& /* metric */)
+{
+  for (size_t queryIndex = queryBegin; queryIndex < queryEnd; queryIndex++)
+    for (size_t i = 0; i < referenceIndices.size(); i++)
+      BaseCase(queryIndex, referenceIndices[i]);
 }
 
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+template<bool TakeRoot>
+void RASearchRules<SortPolicy, MetricType, TreeType, NeighborListType>::
+BaseCases(const size_t queryBegin,
+          const size_t queryEnd,
+          const std::vector<size_t>& referenceIndices,
+          const metric::LMetric<2, TakeRoot>& /* metric */)
+{
+  const size_t dimensions = querySet.n_rows;
+  const size_t numQueries = queryEnd - queryBegin;
+
+  // The query points are contiguous, so we can use them without copying; the
+  // sampled reference points must be gathered.
+  const arma::mat queries(const_cast<double*>(querySet.colptr(queryBegin)),
+      dimensions, numQueries, false, true);
+  arma::mat references(dimensions, referenceIndices.size());
+  for (size_t i = 0; i < referenceIndices.size(); i++)
+    references.col(i) = referenceSet.unsafe_col(referenceIndices[i]);
+
+  // Find the squared norms of every point, and the inner products of every
+  // pair of points (with one matrix multiplication).
+  const arma::rowvec queryNorms = arma::sum(queries % queries, 0);
+  const arma::rowvec referenceNorms = arma::sum(references % references, 0);
+  const arma::mat products = arma::trans(queries) * references;
+
+  // The rounding error of each estimated squared distance, plus the rounding
+  // error of the exact evaluation in BaseCase(), is bounded by a small multiple
+  // of this times the sum of the squared norms.
+  const double relativeError = (4.0 * dimensions + 16.0) *
+      std::numeric_limits<double>::epsilon();
+
+  for (size_t i = 0; i < numQueries; i++)
+  {
+    const size_t queryIndex = queryBegin + i;
+    for (size_t j = 0; j < referenceIndices.size(); j++)
+    {
+      // As in BaseCase(), a point is not compared with itself.
+      if ((&querySet == &referenceSet) && (queryIndex == referenceIndices[j]))
+        continue;
+
+      const double normSum = queryNorms[i] + referenceNorms[j];
+      const double squared = std::max(normSum - 2.0 * products(i, j), 0.0);
+
+      // If the pair cannot be among the nearest neighbors found so far, it
+      // still counts as a sample, but there is no need to evaluate it exactly.
+      const double bestDistance = SquaredToDistance(SortPolicy::CombineBest(
+          squared, relativeError * normSum), metric);
+      if (SortPolicy::IsBetter(NeighborListType::WorstDistance(distances,
+          queryIndex), bestDistance))
+      {
+        numSamplesMade[queryIndex]++;
+        numDistComputations[queryIndex]++;
+        continue;
+      }
 
+      BaseCase(queryIndex, referenceIndices[j]);
+    }
+  }
+}
 
-template<typename SortPolicy, typename MetricType, typename TreeType>
-size_t RASearchRules<SortPolicy, MetricType, TreeType>::
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+size_t RASearchRules<SortPolicy, MetricType, TreeType, NeighborListType>::
 MinimumSamplesReqd(const size_t n,
                    const size_t k,
                    const double tau,
@@ -164,8 +303,11 @@ MinimumSamplesReqd(const size_t n,
 }
 
 
-template<typename SortPolicy, typename MetricType, typename TreeType>
-double RASearchRules<SortPolicy, MetricType, TreeType>::
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+double RASearchRules<SortPolicy, MetricType, TreeType, NeighborListType>::
 SuccessProbability(const size_t n,
                    const size_t k,
                    const size_t m,
@@ -260,9 +402,12 @@ SuccessProbability(const size_t n,
   } // For k > 1.
 }
 
-template<typename SortPolicy, typename MetricType, typename TreeType>
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
 inline force_inline
-double RASearchRules<SortPolicy, MetricType, TreeType>::
+double RASearchRules<SortPolicy, MetricType, TreeType, NeighborListType>::
 BaseCase(const size_t queryIndex, const size_t referenceIndex)
 {
   // If the datasets are the same, then this search is only using one dataset
@@ -273,26 +418,23 @@ BaseCase(const size_t queryIndex, const size_t referenceIndex)
   double distance = metric.Evaluate(querySet.unsafe_col(queryIndex),
                                     referenceSet.unsafe_col(referenceIndex));
 
-  // If this distance is better than any of the current candidates, the
-  // SortDistance() function will give us the position to insert it into.
-  arma::vec queryDist = distances.unsafe_col(queryIndex);
-  size_t insertPosition = SortPolicy::SortDistance(queryDist, distance);
-
-  // SortDistance() returns (size_t() - 1) if we shouldn't add it.
-  if (insertPosition != (size_t() - 1))
-    InsertNeighbor(queryIndex, insertPosition, referenceIndex, distance);
+  // Insert the point into the candidates, if it is good enough.
+  NeighborListType::Insert(distances, neighbors, queryIndex, referenceIndex,
+      distance);
 
   numSamplesMade[queryIndex]++;
-
-  // TO REMOVE
-  numDistComputations++;
+  numDistComputations[queryIndex]++;
 
   return distance;
 }
 
 
-template<typename SortPolicy, typename MetricType, typename TreeType>
-inline double RASearchRules<SortPolicy, MetricType, TreeType>::
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+inline double RASearchRules<SortPolicy, MetricType, TreeType,
+    NeighborListType>::
 Prescore(TreeType& queryNode,
          TreeType& referenceNode,
          TreeType& referenceChildNode,
@@ -302,8 +444,12 @@ Prescore(TreeType& queryNode,
 }
 
 
-template<typename SortPolicy, typename MetricType, typename TreeType>
-inline double RASearchRules<SortPolicy, MetricType, TreeType>::
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+inline double RASearchRules<SortPolicy, MetricType, TreeType,
+    NeighborListType>::
 PrescoreQ(TreeType& queryNode,
           TreeType& queryChildNode,
           TreeType& referenceNode,
@@ -313,20 +459,29 @@ PrescoreQ(TreeType& queryNode,
 }
 
 
-template<typename SortPolicy, typename MetricType, typename TreeType>
-inline double RASearchRules<SortPolicy, MetricType, TreeType>::
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+inline double RASearchRules<SortPolicy, MetricType, TreeType,
+    NeighborListType>::
 Score(const size_t queryIndex, TreeType& referenceNode)
 {
   const arma::vec queryPoint = querySet.unsafe_col(queryIndex);
   const double distance = SortPolicy::BestPointToNodeDistance(queryPoint,
       &referenceNode);
-  const double bestDistance = distances(distances.n_rows - 1, queryIndex);
+  const double bestDistance = NeighborListType::WorstDistance(distances,
+      queryIndex);
 
   return Score(queryIndex, referenceNode, distance, bestDistance);
 }
 
-template<typename SortPolicy, typename MetricType, typename TreeType>
-inline double RASearchRules<SortPolicy, MetricType, TreeType>::
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+inline double RASearchRules<SortPolicy, MetricType, TreeType,
+    NeighborListType>::
 Score(const size_t queryIndex,
       TreeType& referenceNode,
       const double baseCaseResult)
@@ -334,13 +489,18 @@ Score(const size_t queryIndex,
   const arma::vec queryPoint = querySet.unsafe_col(queryIndex);
   const double distance = SortPolicy::BestPointToNodeDistance(queryPoint,
       &referenceNode, baseCaseResult);
-  const double bestDistance = distances(distances.n_rows - 1, queryIndex);
+  const double bestDistance = NeighborListType::WorstDistance(distances,
+      queryIndex);
 
   return Score(queryIndex, referenceNode, distance, bestDistance);
 }
 
-template<typename SortPolicy, typename MetricType, typename TreeType>
-inline double RASearchRules<SortPolicy, MetricType, TreeType>::
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+inline double RASearchRules<SortPolicy, MetricType, TreeType,
+    NeighborListType>::
 Score(const size_t queryIndex,
       TreeType& referenceNode,
       const double distance,
@@ -375,14 +535,8 @@ Score(const size_t queryIndex,
         {
           // Then samplesReqd <= singleSampleLimit.
           // Hence, approximate the node by sampling enough number of points.
-          arma::uvec distinctSamples;
-          ObtainDistinctSamples(samplesReqd, referenceNode.Count(),
-                                distinctSamples);
-          for (size_t i = 0; i < distinctSamples.n_elem; i++)
-            // The counting of the samples are done in the 'BaseCase' function
-            // so no book-keeping is required here.
-            BaseCase(queryIndex,
-                     referenceNode.Begin() + (size_t) distinctSamples[i]);
+          SampleBaseCases(queryIndex, queryIndex + 1, referenceNode.Begin(),
+              referenceNode.Count(), samplesReqd, numSamplesMade[queryIndex]);
 
           // Node approximated, so we can prune it.
           return DBL_MAX;
@@ -392,14 +546,8 @@ Score(const size_t queryIndex,
           if (sampleAtLeaves) // If allowed to sample at leaves.
           {
             // Approximate node by sampling enough number of points.
-            arma::uvec distinctSamples;
-            ObtainDistinctSamples(samplesReqd, referenceNode.Count(),
-                                  distinctSamples);
-            for (size_t i = 0; i < distinctSamples.n_elem; i++)
-              // The counting of the samples are done in the 'BaseCase' function
-              // so no book-keeping is required here.
-              BaseCase(queryIndex,
-                       referenceNode.Begin() + (size_t) distinctSamples[i]);
+            SampleBaseCases(queryIndex, queryIndex + 1, referenceNode.Begin(),
+                referenceNode.Count(), samplesReqd, numSamplesMade[queryIndex]);
 
             // (Leaf) node approximated so can prune it.
             return DBL_MAX;
@@ -436,8 +584,12 @@ Score(const size_t queryIndex,
   }
 }
 
-template<typename SortPolicy, typename MetricType, typename TreeType>
-inline double RASearchRules<SortPolicy, MetricType, TreeType>::
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+inline double RASearchRules<SortPolicy, MetricType, TreeType,
+    NeighborListType>::
 Rescore(const size_t queryIndex,
         TreeType& referenceNode,
         const double oldScore)
@@ -447,7 +599,8 @@ Rescore(const size_t queryIndex,
     return oldScore;
 
   // Just check the score again against the distances.
-  const double bestDistance = distances(distances.n_rows - 1, queryIndex);
+  const double bestDistance = NeighborListType::WorstDistance(distances,
+      queryIndex);
 
   // If this is better than the best distance we've seen so far,
   // maybe there will be something down this node.
@@ -480,14 +633,8 @@ Rescore(const size_t queryIndex,
       {
         // Then, samplesReqd <= singleSampleLimit.  Hence, approximate the node
         // by sampling enough number of points.
-        arma::uvec distinctSamples;
-        ObtainDistinctSamples(samplesReqd, referenceNode.Count(),
-            distinctSamples);
-        for (size_t i = 0; i < distinctSamples.n_elem; i++)
-          // The counting of the samples are done in the 'BaseCase' function so
-          // no book-keeping is required here.
-          BaseCase(queryIndex, referenceNode.Begin() + (size_t)
-              distinctSamples[i]);
+        SampleBaseCases(queryIndex, queryIndex + 1, referenceNode.Begin(),
+            referenceNode.Count(), samplesReqd, numSamplesMade[queryIndex]);
 
         // Node approximated, so we can prune it.
         return DBL_MAX;
@@ -497,14 +644,8 @@ Rescore(const size_t queryIndex,
         if (sampleAtLeaves)
         {
           // Approximate node by sampling enough points.
-          arma::uvec distinctSamples;
-          ObtainDistinctSamples(samplesReqd, referenceNode.Count(),
-                                distinctSamples);
-          for (size_t i = 0; i < distinctSamples.n_elem; i++)
-            // The counting of the samples are done in the 'BaseCase' function
-            // so no book-keeping is required here.
-            BaseCase(queryIndex,
-                     referenceNode.Begin() + (size_t) distinctSamples[i]);
+          SampleBaseCases(queryIndex, queryIndex + 1, referenceNode.Begin(),
+              referenceNode.Count(), samplesReqd, numSamplesMade[queryIndex]);
 
           // (Leaf) node approximated, so we can prune it.
           return DBL_MAX;
@@ -532,8 +673,12 @@ Rescore(const size_t queryIndex,
   }
 } // Rescore(point, node, oldScore)
 
-template<typename SortPolicy, typename MetricType, typename TreeType>
-inline double RASearchRules<SortPolicy, MetricType, TreeType>::Score(
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+inline double RASearchRules<SortPolicy, MetricType, TreeType,
+    NeighborListType>::Score(
     TreeType& queryNode,
     TreeType& referenceNode)
 {
@@ -549,8 +694,8 @@ inline double RASearchRules<SortPolicy, MetricType, TreeType>::Score(
 
   for (size_t i = 0; i < queryNode.NumPoints(); i++)
   {
-    const double bound = distances(distances.n_rows - 1, queryNode.Point(i))
-        + maxDescendantDistance;
+    const double bound = NeighborListType::WorstDistance(distances,
+        queryNode.Point(i)) + maxDescendantDistance;
     if (bound < pointBound)
       pointBound = bound;
   }
@@ -569,8 +714,12 @@ inline double RASearchRules<SortPolicy, MetricType, TreeType>::Score(
   return Score(queryNode, referenceNode, distance, bestDistance);
 }
 
-template<typename SortPolicy, typename MetricType, typename TreeType>
-inline double RASearchRules<SortPolicy, MetricType, TreeType>::Score(
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+inline double RASearchRules<SortPolicy, MetricType, TreeType,
+    NeighborListType>::Score(
       TreeType& queryNode,
       TreeType& referenceNode,
       const double baseCaseResult)
@@ -588,8 +737,8 @@ inline double RASearchRules<SortPolicy, MetricType, TreeType>::Score(
 
   for (size_t i = 0; i < queryNode.NumPoints(); i++)
   {
-    const double bound = distances(distances.n_rows - 1, queryNode.Point(i))
-      + maxDescendantDistance;
+    const double bound = NeighborListType::WorstDistance(distances,
+        queryNode.Point(i)) + maxDescendantDistance;
     if (bound < pointBound)
       pointBound = bound;
   }
@@ -608,8 +757,12 @@ inline double RASearchRules<SortPolicy, MetricType, TreeType>::Score(
   return Score(queryNode, referenceNode, distance, bestDistance);
 }
 
-template<typename SortPolicy, typename MetricType, typename TreeType>
-inline double RASearchRules<SortPolicy, MetricType, TreeType>::Score(
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+inline double RASearchRules<SortPolicy, MetricType, TreeType,
+    NeighborListType>::Score(
     TreeType& queryNode,
     TreeType& referenceNode,
     const double distance,
@@ -682,18 +835,9 @@ inline double RASearchRules<SortPolicy, MetricType, TreeType>::Score(
         {
           // Then samplesReqd <= singleSampleLimit.  Hence, approximate node by
           // sampling enough number of points for every query in the query node.
-          for (size_t queryIndex = queryNode.Begin();
-              queryIndex < queryNode.End(); queryIndex++)
-          {
-            arma::uvec distinctSamples;
-            ObtainDistinctSamples(samplesReqd, referenceNode.Count(),
-                                  distinctSamples);
-            for (size_t i = 0; i < distinctSamples.n_elem; i++)
-              // The counting of the samples are done in the 'BaseCase' function
-              // so no book-keeping is required here.
-              BaseCase(queryIndex, referenceNode.Begin() + (size_t)
-                  distinctSamples[i]);
-          }
+          SampleBaseCases(queryNode.Begin(), queryNode.End(),
+              referenceNode.Begin(), referenceNode.Count(), samplesReqd,
+              queryNode.Stat().NumSamplesMade());
 
           // Update the number of samples made for the queryNode and also update
           // the number of sample made for the child nodes.
@@ -712,18 +856,9 @@ inline double RASearchRules<SortPolicy, MetricType, TreeType>::Score(
           {
             // Approximate node by sampling enough number of points for every
             // query in the query node.
-            for (size_t queryIndex = queryNode.Begin();
-                 queryIndex < queryNode.End(); queryIndex++)
-            {
-              arma::uvec distinctSamples;
-              ObtainDistinctSamples(samplesReqd, referenceNode.Count(),
-                                    distinctSamples);
-              for (size_t i = 0; i < distinctSamples.n_elem; i++)
-                // The counting of the samples are done in the 'BaseCase'
-                // function so no book-keeping is required here.
-                BaseCase(queryIndex, referenceNode.Begin() +
-                    (size_t) distinctSamples[i]);
-            }
+            SampleBaseCases(queryNode.Begin(), queryNode.End(),
+                referenceNode.Begin(), referenceNode.Count(), samplesReqd,
+                queryNode.Stat().NumSamplesMade());
 
             // Update the number of samples made for the queryNode and also
             // update the number of sample made for the child nodes.
@@ -786,8 +921,12 @@ inline double RASearchRules<SortPolicy, MetricType, TreeType>::Score(
   }
 }
 
-template<typename SortPolicy, typename MetricType, typename TreeType>
-inline double RASearchRules<SortPolicy, MetricType, TreeType>::
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename NeighborListType>
+inline double RASearchRules<SortPolicy, MetricType, TreeType,
+    NeighborListType>::
 Rescore(TreeType& queryNode,
         TreeType& referenceNode,
         const double oldScore)
@@ -802,8 +941,8 @@ Rescore(TreeType& queryNode,
 
   for (size_t i = 0; i < queryNode.NumPoints(); i++)
   {
-    const double bound = distances(distances.n_rows - 1, queryNode.Point(i))
-      + maxDescendantDistance;
+    const double bound = NeighborListType::WorstDistance(distances,
+        queryNode.Point(i)) + maxDescendantDistance;
     if (bound < pointBound)
       pointBound = bound;
   }
@@ -894,18 +1033,9 @@ Rescore(TreeType& queryNode,
         // Then samplesReqd <= singleSampleLimit.
         // Hence approximate node by sampling enough number of points
         // for every query in the 'queryNode'
-        for (size_t queryIndex = queryNode.Begin();
-             queryIndex < queryNode.End(); queryIndex++)
-        {
-          arma::uvec distinctSamples;
-          ObtainDistinctSamples(samplesReqd, referenceNode.Count(),
-                                distinctSamples);
-          for (size_t i = 0; i < distinctSamples.n_elem; i++)
-            // The counting of the samples are done in the 'BaseCase'
-            // function so no book-keeping is required here.
-            BaseCase(queryIndex,
-                     referenceNode.Begin() + (size_t) distinctSamples[i]);
-        }
+        SampleBaseCases(queryNode.Begin(), queryNode.End(),
+            referenceNode.Begin(), referenceNode.Count(), samplesReqd,
+            queryNode.Stat().NumSamplesMade());
 
         // update the number of samples made for the queryNode and
         // also update the number of sample made for the child nodes.
@@ -924,18 +1054,9 @@ Rescore(TreeType& queryNode,
         {
           // Approximate node by sampling enough number of points
           // for every query in the 'queryNode'.
-          for (size_t queryIndex = queryNode.Begin();
-               queryIndex < queryNode.End(); queryIndex++)
-          {
-            arma::uvec distinctSamples;
-            ObtainDistinctSamples(samplesReqd, referenceNode.Count(),
-                                  distinctSamples);
-            for (size_t i = 0; i < distinctSamples.n_elem; i++)
-              // The counting of the samples are done in the 'BaseCase'
-              // function so no book-keeping is required here.
-              BaseCase(queryIndex,
-                       referenceNode.Begin() + (size_t) distinctSamples[i]);
-          }
+          SampleBaseCases(queryNode.Begin(), queryNode.End(),
+              referenceNode.Begin(), referenceNode.Count(), samplesReqd,
+              queryNode.Stat().NumSamplesMade());
 
           // Update the number of samples made for the query node and also
           // update the number of sample made for the child nodes.
@@ -981,38 +1102,6 @@ Rescore(TreeType& queryNode,
   }
 } // Rescore(node, node, oldScore)
 
-/**
- * Helper function to insert a point into the neighbors and distances matrices.
- *
- * @param queryIndex Index of point whose neighbors we are inserting into.
- * @param pos Position in list to insert into.
- * @param neighbor Index of reference point which is being inserted.
- * @param distance Distance from query point to reference point.
- */
-template<typename SortPolicy, typename MetricType, typename TreeType>
-void RASearchRules<SortPolicy, MetricType, TreeType>::InsertNeighbor(
-    const size_t queryIndex,
-    const size_t pos,
-    const size_t neighbor,
-    const double distance)
-{
-  // We only memmove() if there is actually a need to shift something.
-  if (pos < (distances.n_rows - 1))
-  {
-    int len = (distances.n_rows - 1) - pos;
-    memmove(distances.colptr(queryIndex) + (pos + 1),
-        distances.colptr(queryIndex) + pos,
-        sizeof(double) * len);
-    memmove(neighbors.colptr(queryIndex) + (pos + 1),
-        neighbors.colptr(queryIndex) + pos,
-        sizeof(size_t) * len);
-  }
-
-  // Now put the new information in the right index.
-  distances(pos, queryIndex) = distance;
-  neighbors(pos, queryIndex) = neighbor;
-}
-
 }; // namespace neighbor
 }; // namespace mlpack
 
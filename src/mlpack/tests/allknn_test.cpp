@@ -6,6 +6,7 @@
 #include <mlpack/core.hpp>
 #include <mlpack/methods/neighbor_search/neighbor_search.hpp>
 #include <mlpack/methods/neighbor_search/unmap.hpp>
+#include <mlpack/methods/neighbor_search/chunked_search.hpp>
 #include <mlpack/core/tree/cover_tree.hpp>
 #include <boost/test/unit_test.hpp>
 #include "old_boost_test_definitions.hpp"
@@ -573,6 +574,388 @@ BOOST_AUTO_TEST_CASE(SingleTreeVsNaive)
   }
 }
 
+/**
+ * Test the dual-tree nearest-neighbors method against the naive method on a
+ * dataset large enough that, when compiled with OpenMP, the query tree is
+ * split into many subtrees which are traversed in parallel.
+ */
+BOOST_AUTO_TEST_CASE(ParallelDualTreeVsNaive)
+{
+  arma::mat dataset;
+  dataset.randu(4, 5000);
+
+  arma::mat dualQuery(dataset);
+  arma::mat dualReferences(dataset);
+  arma::mat naiveQuery(dataset);
+  arma::mat naiveReferences(dataset);
+
+  AllkNN allknn(dualQuery, dualReferences, false, false, 5);
+  AllkNN naive(naiveQuery, naiveReferences, true);
+
+  arma::Mat<size_t> neighborsTree;
+  arma::mat distancesTree;
+  allknn.Search(10, neighborsTree, distancesTree);
+
+  arma::Mat<size_t> neighborsNaive;
+  arma::mat distancesNaive;
+  naive.Search(10, neighborsNaive, distancesNaive);
+
+  for (size_t i = 0; i < neighborsTree.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(neighborsTree[i], neighborsNaive[i]);
+    BOOST_REQUIRE_CLOSE(distancesTree[i], distancesNaive[i], 1e-5);
+  }
+}
+
+/**
+ * Test the dual-tree nearest-neighbors method on compacted trees against the
+ * naive method.
+ */
+BOOST_AUTO_TEST_CASE(CompactDualTreeVsNaive)
+{
+  arma::mat referenceData;
+  referenceData.randu(3, 2000);
+  arma::mat queryData;
+  queryData.randu(3, 1500);
+
+  std::vector<size_t> oldFromNewRefs;
+  std::vector<size_t> oldFromNewQueries;
+  arma::mat treeReferences(referenceData);
+  arma::mat treeQueries(queryData);
+
+  typedef tree::BinarySpaceTree<bound::HRectBound<2>,
+      NeighborSearchStat<NearestNeighborSort> > TreeType;
+  TreeType referenceTree(treeReferences, oldFromNewRefs, 5);
+  TreeType queryTree(treeQueries, oldFromNewQueries, 5);
+  referenceTree.Compact();
+  queryTree.Compact();
+
+  AllkNN allknn(&referenceTree, &queryTree, treeReferences, treeQueries);
+  AllkNN naive(referenceData, queryData, true);
+
+  arma::Mat<size_t> neighborsTree;
+  arma::mat distancesTree;
+  allknn.Search(5, neighborsTree, distancesTree);
+
+  arma::Mat<size_t> neighborsNaive;
+  arma::mat distancesNaive;
+  naive.Search(5, neighborsNaive, distancesNaive);
+
+  for (size_t i = 0; i < neighborsNaive.n_cols; ++i)
+  {
+    for (size_t j = 0; j < neighborsNaive.n_rows; ++j)
+    {
+      BOOST_REQUIRE_EQUAL(oldFromNewRefs[neighborsTree(j, i)],
+          neighborsNaive(j, oldFromNewQueries[i]));
+      BOOST_REQUIRE_CLOSE(distancesTree(j, i),
+          distancesNaive(j, oldFromNewQueries[i]), 1e-5);
+    }
+  }
+}
+
+/**
+ * Test the single-tree nearest-neighbors method with a separate query set
+ * against the naive method.  With OpenMP, the queries are split between
+ * threads, each with its own copy of the rules.
+ */
+BOOST_AUTO_TEST_CASE(ParallelSingleTreeVsNaive)
+{
+  arma::mat referenceData;
+  referenceData.randu(3, 3000);
+  arma::mat queryData;
+  queryData.randu(3, 2000);
+
+  AllkNN allknn(referenceData, queryData, false, true);
+  AllkNN naive(referenceData, queryData, true);
+
+  arma::Mat<size_t> neighborsTree;
+  arma::mat distancesTree;
+  allknn.Search(7, neighborsTree, distancesTree);
+
+  arma::Mat<size_t> neighborsNaive;
+  arma::mat distancesNaive;
+  naive.Search(7, neighborsNaive, distancesNaive);
+
+  for (size_t i = 0; i < neighborsTree.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(neighborsTree[i], neighborsNaive[i]);
+    BOOST_REQUIRE_CLOSE(distancesTree[i], distancesNaive[i], 1e-5);
+  }
+}
+
+/**
+ * Make sure that the constructors which take the memory of the datasets give
+ * the same results as the constructors which copy them, and that the given
+ * matrices are emptied.
+ */
+BOOST_AUTO_TEST_CASE(TakeDatasetsVsNaive)
+{
+  arma::mat referenceData;
+  referenceData.randu(3, 2000);
+  arma::mat queryData;
+  queryData.randu(3, 1000);
+
+  // Monochromatic search (which traverses one tree as the query and reference
+  // tree).
+  arma::mat monoData(referenceData);
+  AllkNN monoAllknn(&monoData);
+  AllkNN monoNaive(referenceData, true);
+  BOOST_REQUIRE(monoData.is_empty());
+
+  arma::Mat<size_t> neighborsTree;
+  arma::mat distancesTree;
+  monoAllknn.Search(5, neighborsTree, distancesTree);
+
+  arma::Mat<size_t> neighborsNaive;
+  arma::mat distancesNaive;
+  monoNaive.Search(5, neighborsNaive, distancesNaive);
+
+  for (size_t i = 0; i < neighborsTree.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(neighborsTree[i], neighborsNaive[i]);
+    BOOST_REQUIRE_CLOSE(distancesTree[i], distancesNaive[i], 1e-5);
+  }
+
+  // Bichromatic search.
+  arma::mat biReferences(referenceData);
+  arma::mat biQueries(queryData);
+  AllkNN biAllknn(&biReferences, &biQueries);
+  AllkNN biNaive(referenceData, queryData, true);
+  BOOST_REQUIRE(biReferences.is_empty());
+  BOOST_REQUIRE(biQueries.is_empty());
+
+  biAllknn.Search(5, neighborsTree, distancesTree);
+  biNaive.Search(5, neighborsNaive, distancesNaive);
+
+  for (size_t i = 0; i < neighborsTree.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(neighborsTree[i], neighborsNaive[i]);
+    BOOST_REQUIRE_CLOSE(distancesTree[i], distancesNaive[i], 1e-5);
+  }
+}
+
+/**
+ * Test the dual-tree nearest-neighbors method against the naive method on
+ * high-dimensional data, where leaf-leaf base cases are computed in blocks.
+ * The points are offset from the origin so that the block estimates are not
+ * exact.
+ */
+BOOST_AUTO_TEST_CASE(BlockBaseCasesVsNaive)
+{
+  arma::mat referenceData;
+  referenceData.randu(100, 1500);
+  referenceData += 10.0;
+  arma::mat queryData;
+  queryData.randu(100, 800);
+  queryData += 10.0;
+
+  AllkNN allknn(referenceData, queryData);
+  AllkNN naive(referenceData, queryData, true);
+
+  arma::Mat<size_t> neighborsTree;
+  arma::mat distancesTree;
+  allknn.Search(10, neighborsTree, distancesTree);
+
+  arma::Mat<size_t> neighborsNaive;
+  arma::mat distancesNaive;
+  naive.Search(10, neighborsNaive, distancesNaive);
+
+  for (size_t i = 0; i < neighborsTree.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(neighborsTree[i], neighborsNaive[i]);
+    BOOST_REQUIRE_CLOSE(distancesTree[i], distancesNaive[i], 1e-5);
+  }
+}
+
+/**
+ * Naive mode computes the base cases of its single leaf in tiles.  Make sure
+ * that the results are right when the sets span several partial tiles, by
+ * comparing with a brute-force computation.
+ */
+BOOST_AUTO_TEST_CASE(NaiveTiledBaseCases)
+{
+  arma::mat referenceData;
+  referenceData.randu(10, 1000);
+  referenceData += 10.0;
+  arma::mat queryData;
+  queryData.randu(10, 700);
+  queryData += 10.0;
+
+  AllkNN naive(referenceData, queryData, true);
+
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  naive.Search(3, neighbors, distances);
+
+  BOOST_REQUIRE_EQUAL(neighbors.n_cols, 700);
+  for (size_t q = 0; q < queryData.n_cols; ++q)
+  {
+    arma::vec allDistances(referenceData.n_cols);
+    for (size_t r = 0; r < referenceData.n_cols; ++r)
+      allDistances[r] = metric::EuclideanDistance::Evaluate(
+          queryData.unsafe_col(q), referenceData.unsafe_col(r));
+    const arma::uvec order = arma::sort_index(allDistances);
+
+    for (size_t i = 0; i < 3; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(neighbors(i, q), order[i]);
+      BOOST_REQUIRE_CLOSE(distances(i, q), allDistances[order[i]], 1e-5);
+    }
+  }
+}
+
+/**
+ * Search for the neighbors of a query file a chunk at a time, in dual-tree and
+ * single-tree mode, with and without projecting the points onto a random
+ * basis, and make sure that the saved results are the same as the results of
+ * a search on the whole query set.
+ */
+BOOST_AUTO_TEST_CASE(ChunkedSearchTest)
+{
+  typedef tree::BinarySpaceTree<bound::HRectBound<2>,
+      NeighborSearchStat<NearestNeighborSort> > TreeType;
+
+  arma::mat referenceData;
+  referenceData.randu(3, 1000);
+  arma::mat queryData;
+  queryData.randu(3, 300);
+  data::Save("chunked_queries.csv", queryData);
+
+  // Search with the query points as they were saved.
+  data::Load("chunked_queries.csv", queryData);
+
+  AllkNN allknn(referenceData, queryData);
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  allknn.Search(3, neighbors, distances);
+
+  // A random orthonormal basis does not change the distances.
+  arma::mat q, r;
+  BOOST_REQUIRE(arma::qr(q, r, arma::randn<arma::mat>(3, 3)));
+
+  for (size_t useBasis = 0; useBasis < 2; ++useBasis)
+  {
+    for (size_t singleMode = 0; singleMode < 2; ++singleMode)
+    {
+      arma::mat basis;
+      arma::mat treeData(referenceData);
+      if (useBasis == 1)
+      {
+        basis = q;
+        treeData = basis * treeData;
+      }
+
+      std::vector<size_t> oldFromNew;
+      TreeType tree(treeData, oldFromNew, 20);
+
+      // 37 does not divide the number of query points.
+      ChunkedSearch(tree, oldFromNew, "chunked_queries.csv", 37, 3,
+          "chunked_neighbors.csv", "chunked_distances.csv", false,
+          (singleMode == 1), 20, basis);
+
+      arma::Mat<size_t> chunkedNeighbors;
+      arma::mat chunkedDistances;
+      data::Load("chunked_neighbors.csv", chunkedNeighbors);
+      data::Load("chunked_distances.csv", chunkedDistances);
+
+      BOOST_REQUIRE_EQUAL(chunkedNeighbors.n_rows, neighbors.n_rows);
+      BOOST_REQUIRE_EQUAL(chunkedNeighbors.n_cols, neighbors.n_cols);
+      BOOST_REQUIRE_EQUAL(chunkedDistances.n_rows, distances.n_rows);
+      BOOST_REQUIRE_EQUAL(chunkedDistances.n_cols, distances.n_cols);
+      for (size_t i = 0; i < neighbors.n_elem; ++i)
+      {
+        BOOST_REQUIRE_EQUAL(chunkedNeighbors[i], neighbors[i]);
+        BOOST_REQUIRE_CLOSE(chunkedDistances[i], distances[i], 1e-3);
+      }
+    }
+  }
+
+  remove("chunked_queries.csv");
+  remove("chunked_neighbors.csv");
+  remove("chunked_distances.csv");
+}
+
+/**
+ * Make sure that a search with HeapNeighborList gives the same results as a
+ * naive search with the default sorted lists, for a large k, in dual-tree and
+ * single-tree mode.
+ */
+BOOST_AUTO_TEST_CASE(HeapNeighborListVsNaive)
+{
+  arma::mat dataset;
+  dataset.randu(3, 1000);
+
+  typedef NeighborSearch<NearestNeighborSort,
+      metric::EuclideanDistance,
+      tree::BinarySpaceTree<bound::HRectBound<2>,
+      NeighborSearchStat<NearestNeighborSort> >,
+      HeapNeighborList<NearestNeighborSort> > HeapAllkNN;
+
+  HeapAllkNN dualTree(dataset);
+  HeapAllkNN singleTree(dataset, false, true);
+  AllkNN naive(dataset, true);
+
+  arma::Mat<size_t> neighborsDual;
+  arma::mat distancesDual;
+  dualTree.Search(200, neighborsDual, distancesDual);
+
+  arma::Mat<size_t> neighborsSingle;
+  arma::mat distancesSingle;
+  singleTree.Search(200, neighborsSingle, distancesSingle);
+
+  arma::Mat<size_t> neighborsNaive;
+  arma::mat distancesNaive;
+  naive.Search(200, neighborsNaive, distancesNaive);
+
+  for (size_t i = 0; i < neighborsNaive.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(neighborsDual[i], neighborsNaive[i]);
+    BOOST_REQUIRE_CLOSE(distancesDual[i], distancesNaive[i], 1e-5);
+    BOOST_REQUIRE_EQUAL(neighborsSingle[i], neighborsNaive[i]);
+    BOOST_REQUIRE_CLOSE(distancesSingle[i], distancesNaive[i], 1e-5);
+  }
+}
+
+/**
+ * Make sure that single-precision dual-tree and single-tree search give the
+ * same results as double-precision naive search (up to the precision of
+ * floats).
+ */
+BOOST_AUTO_TEST_CASE(SinglePrecisionVsNaive)
+{
+  arma::mat dataset;
+  dataset.randu(5, 1000);
+  arma::fmat datasetF = arma::conv_to<arma::fmat>::from(dataset);
+
+  // Use the single-precision data for the naive search too, so that both
+  // searches see the same points.
+  dataset = arma::conv_to<arma::mat>::from(datasetF);
+
+  AllkNNSinglePrecision dualTree(datasetF);
+  AllkNNSinglePrecision singleTree(datasetF, false, true);
+  AllkNN naive(dataset, true);
+
+  arma::Mat<size_t> neighborsDual;
+  arma::mat distancesDual;
+  dualTree.Search(10, neighborsDual, distancesDual);
+
+  arma::Mat<size_t> neighborsSingle;
+  arma::mat distancesSingle;
+  singleTree.Search(10, neighborsSingle, distancesSingle);
+
+  arma::Mat<size_t> neighborsNaive;
+  arma::mat distancesNaive;
+  naive.Search(10, neighborsNaive, distancesNaive);
+
+  for (size_t i = 0; i < neighborsNaive.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(neighborsDual[i], neighborsNaive[i]);
+    BOOST_REQUIRE_CLOSE(distancesDual[i], distancesNaive[i], 1e-3);
+    BOOST_REQUIRE_EQUAL(neighborsSingle[i], neighborsNaive[i]);
+    BOOST_REQUIRE_CLOSE(distancesSingle[i], distancesNaive[i], 1e-3);
+  }
+}
+
 /**
  * Test the cover tree single-tree nearest-neighbors method against the naive
  * method.  This uses only a random reference dataset.
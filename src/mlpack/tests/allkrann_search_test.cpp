@@ -13,6 +13,10 @@
 
 #include <mlpack/methods/rann/ra_search.hpp>
 
+#ifdef HAS_OPENMP
+  #include <omp.h>
+#endif
+
 using namespace std;
 using namespace mlpack;
 using namespace mlpack::neighbor;
@@ -20,8 +24,9 @@ using namespace mlpack::neighbor;
 BOOST_AUTO_TEST_SUITE(AllkRANNTest);
 
 // Test AllkRANN in naive mode for exact results when the random seeds are set
-// the same.  This may not be the best test; if the implementation of RANN-RS
-// gets random numbers in a different way, then this test might fail.
+// the same.  The samples that naive search will make for each query point are
+// regenerated from the same seed, and the neighbor returned must be the nearest
+// of those samples.
 BOOST_AUTO_TEST_CASE(AllkRANNNaiveSearchExact)
 {
   // First test on a small set.
@@ -42,33 +47,35 @@ BOOST_AUTO_TEST_CASE(AllkRANNNaiveSearchExact)
   arma::Mat<size_t> neighbors;
   arma::mat distances;
 
-  // Test naive rank-approximate search.
-  // Predict what the actual RANN-RS result would be.
-  math::RandomSeed(0);
+  // Predict what the actual RANN-RS result would be.  Rules constructed
+  // without naive sampling draw the same seed as the naive search, and give
+  // the samples of the stream of each query point.
+  typedef RASearchRules<NearestNeighborSort, metric::SquaredEuclideanDistance,
+      tree::BinarySpaceTree<bound::HRectBound<2, false>,
+      RAQueryStat<NearestNeighborSort> > > RuleType;
 
-  size_t numSamples = (size_t) ceil(log(1.0 / (1.0 - successProb)) /
-      log(1.0 / (1.0 - (rankApproximation / 100.0))));
+  arma::Mat<size_t> ruleNeighbors(1, qdata.n_cols);
+  arma::mat ruleDistances(1, qdata.n_cols);
+  ruleDistances.fill(DBL_MAX);
+  arma::Col<size_t> numSamplesMade;
+  arma::Col<size_t> numDistComputations;
 
-  arma::Mat<size_t> samples(qdata.n_cols, numSamples);
-  for (size_t j = 0; j < qdata.n_cols; j++)
-    for (size_t i = 0; i < numSamples; i++)
-      samples(j, i) = (size_t) math::RandInt(10);
+  math::RandomSeed(0);
+  RuleType rules(rdata, qdata, ruleNeighbors, ruleDistances, numSamplesMade,
+      numDistComputations, dMetric, rankApproximation, successProb, false);
 
-  arma::Col<size_t> rann(qdata.n_cols);
   arma::vec rannDistances(qdata.n_cols);
   rannDistances.fill(DBL_MAX);
-
+  std::vector<std::vector<size_t> > samples(qdata.n_cols);
   for (size_t j = 0; j < qdata.n_cols; j++)
   {
-    for (size_t i = 0; i < numSamples; i++)
+    rules.ObtainDistinctSamples(rules.NumSamplesReqd(), rdata.n_cols, j, 0, 0,
+        samples[j]);
+    for (size_t i = 0; i < samples[j].size(); i++)
     {
       double dist = dMetric.Evaluate(qdata.unsafe_col(j),
-                                     rdata.unsafe_col(samples(j, i)));
-      if (dist < rannDistances[j])
-      {
-        rann[j] = samples(j, i);
-        rannDistances[j] = dist;
-      }
+                                     rdata.unsafe_col(samples[j][i]));
+      rannDistances[j] = std::min(rannDistances[j], dist);
     }
   }
 
@@ -76,18 +83,37 @@ BOOST_AUTO_TEST_CASE(AllkRANNNaiveSearchExact)
   math::RandomSeed(0);
 
   RASearch<> naive(rdata, qdata, true);
-  naive.Search(1, neighbors, distances, rankApproximation);
+  naive.Search(1, neighbors, distances, rankApproximation, successProb);
 
   // Things to check:
   //
   // 1. (implicitly) The minimum number of required samples for guaranteed
   //    approximation.
   // 2. (implicitly) Check the samples obtained.
-  // 3. Check the neighbor returned.
+  // 3. Check the neighbor returned: it must be one of the samples, at the
+  //    smallest distance of any of the samples (there may be ties).
   for (size_t i = 0; i < qdata.n_cols; i++)
   {
-    BOOST_REQUIRE(neighbors(0, i) == rann[i]);
     BOOST_REQUIRE_CLOSE(distances(0, i), rannDistances[i], 1e-5);
+    BOOST_REQUIRE(std::find(samples[i].begin(), samples[i].end(),
+        neighbors(0, i)) != samples[i].end());
+
+    const double dist = dMetric.Evaluate(qdata.unsafe_col(i),
+        rdata.unsafe_col(neighbors(0, i)));
+    BOOST_REQUIRE_CLOSE(distances(0, i), dist, 1e-5);
+  }
+
+  // The same seed must give the same results again.
+  arma::Mat<size_t> neighbors2;
+  arma::mat distances2;
+
+  math::RandomSeed(0);
+  naive.Search(1, neighbors2, distances2, rankApproximation, successProb);
+
+  for (size_t i = 0; i < qdata.n_cols; i++)
+  {
+    BOOST_REQUIRE(neighbors(0, i) == neighbors2(0, i));
+    BOOST_REQUIRE_CLOSE(distances(0, i), distances2(0, i), 1e-5);
   }
 }
 
@@ -324,4 +350,50 @@ BOOST_AUTO_TEST_CASE(AllkRANNSingleDatasetSearch)
   BOOST_REQUIRE_EQUAL(distances.n_cols, 2500);
 }
 
+// Ensure that, for a given random seed, single-tree and naive rank-approximate
+// search give the same results with any number of threads.
+BOOST_AUTO_TEST_CASE(AllkRANNThreadIndependenceTest)
+{
+  arma::mat dataset(5, 2000);
+  dataset.randu();
+
+  for (size_t mode = 0; mode < 2; ++mode)
+  {
+    const bool naive = (mode == 0);
+
+    // Use the reference set as the query set.
+    RASearch<> allkrann(dataset, naive, true);
+
+    arma::Mat<size_t> neighbors;
+    arma::mat distances;
+    arma::Mat<size_t> parallelNeighbors;
+    arma::mat parallelDistances;
+
+#ifdef HAS_OPENMP
+    const int oldThreads = omp_get_max_threads();
+    omp_set_num_threads(1);
+#endif
+
+    math::RandomSeed(7);
+    allkrann.Search(3, neighbors, distances, 5.0);
+
+#ifdef HAS_OPENMP
+    omp_set_num_threads(4);
+#endif
+
+    math::RandomSeed(7);
+    allkrann.Search(3, parallelNeighbors, parallelDistances, 5.0);
+
+#ifdef HAS_OPENMP
+    omp_set_num_threads(oldThreads);
+#endif
+
+    for (size_t i = 0; i < neighbors.n_elem; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(neighbors[i], parallelNeighbors[i]);
+      BOOST_REQUIRE_CLOSE(distances[i], parallelDistances[i], 1e-5);
+    }
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
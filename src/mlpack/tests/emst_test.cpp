@@ -8,6 +8,10 @@
 #include <boost/test/unit_test.hpp>
 #include "old_boost_test_definitions.hpp"
 
+#ifdef HAS_OPENMP
+  #include <omp.h>
+#endif
+
 using namespace mlpack;
 using namespace mlpack::emst;
 
@@ -125,4 +129,47 @@ BOOST_AUTO_TEST_CASE(DualTreeVsNaive)
   }
 }
 
+/**
+ * Test the dual tree method, with several threads, against the naive
+ * computation.  The dataset is large enough that the query tree is split
+ * between the threads.
+ */
+BOOST_AUTO_TEST_CASE(ParallelDualTreeVsNaive)
+{
+  arma::mat inputData(3, 5000);
+  inputData.randu();
+
+  arma::mat dualData = inputData;
+  arma::mat naiveData = inputData;
+
+#ifdef HAS_OPENMP
+  const int maxThreads = omp_get_max_threads();
+  omp_set_num_threads(std::max(maxThreads, 4));
+#endif
+
+  DualTreeBoruvka<> dtb(dualData);
+
+  arma::mat dualResults;
+  dtb.ComputeMST(dualResults);
+
+#ifdef HAS_OPENMP
+  omp_set_num_threads(maxThreads);
+#endif
+
+  DualTreeBoruvka<> dtbNaive(naiveData, true);
+
+  arma::mat naiveResults;
+  dtbNaive.ComputeMST(naiveResults);
+
+  BOOST_REQUIRE(dualResults.n_cols == naiveResults.n_cols);
+  BOOST_REQUIRE(dualResults.n_rows == naiveResults.n_rows);
+
+  for (size_t i = 0; i < dualResults.n_cols; i++)
+  {
+    BOOST_REQUIRE(dualResults(0, i) == naiveResults(0, i));
+    BOOST_REQUIRE(dualResults(1, i) == naiveResults(1, i));
+    BOOST_REQUIRE_CLOSE(dualResults(2, i), naiveResults(2, i), 1e-5);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
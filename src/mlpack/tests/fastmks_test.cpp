@@ -8,6 +8,7 @@
 #include <mlpack/methods/fastmks/fastmks.hpp>
 #include <mlpack/core/kernels/linear_kernel.hpp>
 #include <mlpack/core/kernels/polynomial_kernel.hpp>
+#include <mlpack/core/kernels/cosine_distance.hpp>
 
 #include <boost/test/unit_test.hpp>
 #include "old_boost_test_definitions.hpp"
@@ -121,4 +122,104 @@ BOOST_AUTO_TEST_CASE(DualTreeVsSingleTree)
   }
 }
 
+/**
+ * Make sure that BlockKernel gives the same kernel values and self-kernels as
+ * evaluating the kernel for each pair of points.
+ */
+template<typename KernelType>
+void CheckBlockKernel(KernelType& kernel)
+{
+  arma::mat a;
+  a.randn(5, 30);
+  arma::mat b;
+  b.randn(5, 40);
+  b.col(7).zeros(); // The cosine distance is special for zero vectors.
+
+  arma::mat blockKernels;
+  BlockKernel<KernelType>::Evaluate(kernel, a, b, blockKernels);
+
+  BOOST_REQUIRE_EQUAL(blockKernels.n_rows, a.n_cols);
+  BOOST_REQUIRE_EQUAL(blockKernels.n_cols, b.n_cols);
+  for (size_t j = 0; j < b.n_cols; ++j)
+  {
+    for (size_t i = 0; i < a.n_cols; ++i)
+    {
+      const double eval = kernel.Evaluate(a.unsafe_col(i), b.unsafe_col(j));
+      if (std::abs(eval) < 1e-10)
+        BOOST_REQUIRE_SMALL(blockKernels(i, j), 1e-10);
+      else
+        BOOST_REQUIRE_CLOSE(blockKernels(i, j), eval, 1e-5);
+    }
+  }
+
+  arma::vec selfKernels;
+  BlockKernel<KernelType>::SelfKernels(kernel, b, selfKernels);
+
+  BOOST_REQUIRE_EQUAL(selfKernels.n_elem, b.n_cols);
+  for (size_t i = 0; i < b.n_cols; ++i)
+  {
+    const double eval = sqrt(kernel.Evaluate(b.unsafe_col(i),
+        b.unsafe_col(i)));
+    if (std::abs(eval) < 1e-10)
+      BOOST_REQUIRE_SMALL(selfKernels[i], 1e-10);
+    else
+      BOOST_REQUIRE_CLOSE(selfKernels[i], eval, 1e-5);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(BlockKernelTest)
+{
+  LinearKernel lk;
+  CheckBlockKernel(lk);
+
+  PolynomialKernel pk(4.0, 1.5);
+  CheckBlockKernel(pk);
+
+  CosineDistance cd;
+  CheckBlockKernel(cd);
+}
+
+/**
+ * Search for several batches of query points with one FastMKS object, in
+ * single-tree and dual-tree mode, and compare with naive search.
+ */
+BOOST_AUTO_TEST_CASE(QueryBatchTest)
+{
+  arma::mat referenceData;
+  referenceData.randn(5, 1000);
+  PolynomialKernel pk(3.0, 1.0);
+
+  for (size_t mode = 0; mode < 2; ++mode)
+  {
+    const bool single = (mode == 0);
+    FastMKS<PolynomialKernel> fastmks(referenceData, pk, single);
+
+    for (size_t batch = 0; batch < 3; ++batch)
+    {
+      arma::mat queryData;
+      queryData.randn(5, 200);
+
+      arma::Mat<size_t> indices;
+      arma::mat products;
+      fastmks.Search(queryData, 5, indices, products);
+
+      FastMKS<PolynomialKernel> naive(referenceData, queryData, pk, false,
+          true);
+      arma::Mat<size_t> naiveIndices;
+      arma::mat naiveProducts;
+      naive.Search(5, naiveIndices, naiveProducts);
+
+      BOOST_REQUIRE_EQUAL(indices.n_cols, queryData.n_cols);
+      for (size_t q = 0; q < indices.n_cols; ++q)
+      {
+        for (size_t r = 0; r < indices.n_rows; ++r)
+        {
+          BOOST_REQUIRE_EQUAL(indices(r, q), naiveIndices(r, q));
+          BOOST_REQUIRE_CLOSE(products(r, q), naiveProducts(r, q), 1e-5);
+        }
+      }
+    }
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -7,6 +7,17 @@
 #include <mlpack/methods/kmeans/kmeans.hpp>
 #include <mlpack/methods/kmeans/allow_empty_clusters.hpp>
 #include <mlpack/methods/kmeans/refined_start.hpp>
+#include <mlpack/methods/kmeans/kmeans_plus_plus.hpp>
+#include <mlpack/methods/kmeans/kmeans_parallel.hpp>
+#include <mlpack/methods/kmeans/elkan_assignment.hpp>
+#include <mlpack/methods/kmeans/hamerly_assignment.hpp>
+#include <mlpack/methods/kmeans/yinyang_assignment.hpp>
+#include <mlpack/methods/kmeans/dual_tree_assignment.hpp>
+#include <mlpack/methods/kmeans/mini_batch_kmeans.hpp>
+
+#ifdef HAS_OPENMP
+  #include <omp.h>
+#endif
 
 #include <boost/test/unit_test.hpp>
 #include "old_boost_test_definitions.hpp"
@@ -444,6 +455,262 @@ BOOST_AUTO_TEST_CASE(RefinedStartTest)
   BOOST_REQUIRE_LT(distortion, 14000.0);
 }
 
+/**
+ * Make sure the k-means++ and k-means|| seedings find the three classes of the
+ * test dataset; they are so far apart that every seed should be in a different
+ * class.
+ */
+BOOST_AUTO_TEST_CASE(KMeansPlusPlusTest)
+{
+  math::RandomSeed(42);
+  const arma::mat data = trans(kMeansData);
+
+  arma::Col<size_t> plusPlusAssignments;
+  KMeansPlusPlus::Cluster(data, 3, plusPlusAssignments);
+
+  arma::Col<size_t> parallelAssignments;
+  KMeansParallel parallel;
+  parallel.Cluster(data, 3, parallelAssignments);
+
+  const size_t classStarts[] = { 0, 13, 20, 30 };
+  for (size_t c = 0; c < 3; ++c)
+  {
+    for (size_t i = classStarts[c]; i < classStarts[c + 1]; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(plusPlusAssignments[i],
+          plusPlusAssignments[classStarts[c]]);
+      BOOST_REQUIRE_EQUAL(parallelAssignments[i],
+          parallelAssignments[classStarts[c]]);
+    }
+  }
+
+  BOOST_REQUIRE_NE(plusPlusAssignments[0], plusPlusAssignments[13]);
+  BOOST_REQUIRE_NE(plusPlusAssignments[0], plusPlusAssignments[20]);
+  BOOST_REQUIRE_NE(plusPlusAssignments[13], plusPlusAssignments[20]);
+  BOOST_REQUIRE_NE(parallelAssignments[0], parallelAssignments[13]);
+  BOOST_REQUIRE_NE(parallelAssignments[0], parallelAssignments[20]);
+  BOOST_REQUIRE_NE(parallelAssignments[13], parallelAssignments[20]);
+
+  // The seeding should also work as the partitioner of KMeans.
+  KMeans<metric::SquaredEuclideanDistance, KMeansParallel> kmeans;
+  arma::Col<size_t> assignments;
+  kmeans.Cluster(data, 3, assignments);
+  BOOST_REQUIRE_EQUAL(assignments.n_elem, 30);
+  for (size_t i = 1; i < 13; ++i)
+    BOOST_REQUIRE_EQUAL(assignments[i], assignments[0]);
+}
+
+/**
+ * Make sure that the assignment policies which use the triangle inequality
+ * give exactly the same clustering as the naive assignment policy, from the
+ * same initial assignments.
+ */
+BOOST_AUTO_TEST_CASE(AcceleratedAssignmentTest)
+{
+  // Some blobs of points, so that the clustering takes a few iterations.
+  arma::mat data(3, 2000);
+  for (size_t i = 0; i < data.n_cols; ++i)
+    data.col(i) = arma::randn<arma::vec>(3) + 5.0 * (i % 7);
+
+  const size_t clusters = 40;
+  const arma::Col<size_t> initialAssignments = arma::shuffle(
+      arma::linspace<arma::Col<size_t> >(0, clusters - 1, data.n_cols));
+
+  arma::Col<size_t> naiveAssignments = initialAssignments;
+  arma::mat naiveCentroids;
+  KMeans<> naive(100);
+  naive.Cluster(data, clusters, naiveAssignments, naiveCentroids, true);
+
+  arma::Col<size_t> elkanAssignments = initialAssignments;
+  arma::mat elkanCentroids;
+  KMeans<metric::SquaredEuclideanDistance, RandomPartition,
+      MaxVarianceNewCluster, ElkanAssignment> elkan(100);
+  elkan.Cluster(data, clusters, elkanAssignments, elkanCentroids, true);
+
+  arma::Col<size_t> hamerlyAssignments = initialAssignments;
+  arma::mat hamerlyCentroids;
+  KMeans<metric::SquaredEuclideanDistance, RandomPartition,
+      MaxVarianceNewCluster, HamerlyAssignment> hamerly(100);
+  hamerly.Cluster(data, clusters, hamerlyAssignments, hamerlyCentroids, true);
+
+  arma::Col<size_t> yinyangAssignments = initialAssignments;
+  arma::mat yinyangCentroids;
+  KMeans<metric::SquaredEuclideanDistance, RandomPartition,
+      MaxVarianceNewCluster, YinyangAssignment> yinyang(100, 1.0,
+      metric::SquaredEuclideanDistance(), RandomPartition(),
+      MaxVarianceNewCluster(), YinyangAssignment(4));
+  yinyang.Cluster(data, clusters, yinyangAssignments, yinyangCentroids, true);
+
+  arma::Col<size_t> dualTreeAssignments = initialAssignments;
+  arma::mat dualTreeCentroids;
+  KMeans<metric::SquaredEuclideanDistance, RandomPartition,
+      MaxVarianceNewCluster, DualTreeAssignment> dualTree(100);
+  dualTree.Cluster(data, clusters, dualTreeAssignments, dualTreeCentroids,
+      true);
+
+  for (size_t i = 0; i < data.n_cols; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(elkanAssignments[i], naiveAssignments[i]);
+    BOOST_REQUIRE_EQUAL(hamerlyAssignments[i], naiveAssignments[i]);
+    BOOST_REQUIRE_EQUAL(yinyangAssignments[i], naiveAssignments[i]);
+    BOOST_REQUIRE_EQUAL(dualTreeAssignments[i], naiveAssignments[i]);
+  }
+
+  for (size_t i = 0; i < naiveCentroids.n_elem; ++i)
+  {
+    BOOST_REQUIRE_CLOSE(elkanCentroids[i], naiveCentroids[i], 1e-5);
+    BOOST_REQUIRE_CLOSE(hamerlyCentroids[i], naiveCentroids[i], 1e-5);
+    BOOST_REQUIRE_CLOSE(yinyangCentroids[i], naiveCentroids[i], 1e-5);
+    BOOST_REQUIRE_CLOSE(dualTreeCentroids[i], naiveCentroids[i], 1e-5);
+  }
+}
+
+/**
+ * The dual-tree assignment can only prune with the Euclidean distance, so with
+ * the Manhattan distance it must give the same clustering as the naive
+ * assignment policy.
+ */
+BOOST_AUTO_TEST_CASE(DualTreeAssignmentOtherMetricTest)
+{
+  arma::mat data(3, 1000);
+  for (size_t i = 0; i < data.n_cols; ++i)
+    data.col(i) = arma::randn<arma::vec>(3) + 3.0 * (i % 5);
+
+  const size_t clusters = 10;
+  const arma::Col<size_t> initialAssignments = arma::shuffle(
+      arma::linspace<arma::Col<size_t> >(0, clusters - 1, data.n_cols));
+
+  arma::Col<size_t> naiveAssignments = initialAssignments;
+  arma::mat naiveCentroids;
+  KMeans<metric::ManhattanDistance> naive(100);
+  naive.Cluster(data, clusters, naiveAssignments, naiveCentroids, true);
+
+  arma::Col<size_t> dualTreeAssignments = initialAssignments;
+  arma::mat dualTreeCentroids;
+  KMeans<metric::ManhattanDistance, RandomPartition, MaxVarianceNewCluster,
+      DualTreeAssignment> dualTree(100);
+  dualTree.Cluster(data, clusters, dualTreeAssignments, dualTreeCentroids,
+      true);
+
+  for (size_t i = 0; i < data.n_cols; ++i)
+    BOOST_REQUIRE_EQUAL(dualTreeAssignments[i], naiveAssignments[i]);
+  for (size_t i = 0; i < naiveCentroids.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(dualTreeCentroids[i], naiveCentroids[i], 1e-5);
+}
+
+/**
+ * Make sure that the clustering does not depend on the number of threads.  The
+ * dataset is large enough that the centroids are summed in several shards.
+ */
+BOOST_AUTO_TEST_CASE(ThreadCountDeterminismTest)
+{
+  arma::mat data(3, 20000);
+  for (size_t i = 0; i < data.n_cols; ++i)
+    data.col(i) = arma::randn<arma::vec>(3) + 5.0 * (i % 5);
+
+  const size_t clusters = 25;
+  const arma::Col<size_t> initialAssignments = arma::shuffle(
+      arma::linspace<arma::Col<size_t> >(0, clusters - 1, data.n_cols));
+
+  KMeans<> naive(30);
+  KMeans<metric::SquaredEuclideanDistance, RandomPartition,
+      MaxVarianceNewCluster, HamerlyAssignment> hamerly(30);
+
+#ifdef HAS_OPENMP
+  const int maxThreads = omp_get_max_threads();
+  omp_set_num_threads(1);
+#endif
+
+  arma::Col<size_t> serialAssignments = initialAssignments;
+  arma::mat serialCentroids;
+  naive.Cluster(data, clusters, serialAssignments, serialCentroids, true);
+
+  arma::Col<size_t> serialHamerlyAssignments = initialAssignments;
+  arma::mat serialHamerlyCentroids;
+  hamerly.Cluster(data, clusters, serialHamerlyAssignments,
+      serialHamerlyCentroids, true);
+
+#ifdef HAS_OPENMP
+  omp_set_num_threads(std::max(maxThreads, 4));
+#endif
+
+  arma::Col<size_t> parallelAssignments = initialAssignments;
+  arma::mat parallelCentroids;
+  naive.Cluster(data, clusters, parallelAssignments, parallelCentroids, true);
+
+  arma::Col<size_t> parallelHamerlyAssignments = initialAssignments;
+  arma::mat parallelHamerlyCentroids;
+  hamerly.Cluster(data, clusters, parallelHamerlyAssignments,
+      parallelHamerlyCentroids, true);
+
+#ifdef HAS_OPENMP
+  omp_set_num_threads(maxThreads);
+#endif
+
+  for (size_t i = 0; i < data.n_cols; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(parallelAssignments[i], serialAssignments[i]);
+    BOOST_REQUIRE_EQUAL(parallelHamerlyAssignments[i], serialAssignments[i]);
+    BOOST_REQUIRE_EQUAL(serialHamerlyAssignments[i], serialAssignments[i]);
+  }
+
+  // The sums are done in the same order, so the centroids are exactly equal.
+  for (size_t i = 0; i < serialCentroids.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(parallelCentroids[i], serialCentroids[i]);
+    BOOST_REQUIRE_EQUAL(parallelHamerlyCentroids[i], serialCentroids[i]);
+    BOOST_REQUIRE_EQUAL(serialHamerlyCentroids[i], serialCentroids[i]);
+  }
+}
+
+/**
+ * Make sure mini-batch k-means finds the three classes of the test dataset, and
+ * that each centroid is the mean of the points it has been assigned.
+ */
+BOOST_AUTO_TEST_CASE(MiniBatchKMeansTest)
+{
+  const arma::mat data = trans(kMeansData);
+
+  // One point of each class.
+  arma::mat centroids(2, 3);
+  centroids.col(0) = data.col(0);
+  centroids.col(1) = data.col(13);
+  centroids.col(2) = data.col(20);
+
+  arma::Col<size_t> assignments;
+  MiniBatchKMeans<> k(10, 50);
+  k.Cluster(data, 3, assignments, centroids, true);
+
+  // Every batch point has been assigned to a centroid.
+  BOOST_REQUIRE_EQUAL(accu(k.Counts()), 500);
+
+  for (size_t i = 0; i < 13; ++i)
+    BOOST_REQUIRE_EQUAL(assignments[i], 0);
+  for (size_t i = 13; i < 20; ++i)
+    BOOST_REQUIRE_EQUAL(assignments[i], 1);
+  for (size_t i = 20; i < 30; ++i)
+    BOOST_REQUIRE_EQUAL(assignments[i], 2);
+
+  // The centroids are means of samples of each class, so they are inside the
+  // class.
+  BOOST_REQUIRE_SMALL(centroids(0, 0), 0.5);
+  BOOST_REQUIRE_SMALL(centroids(1, 0), 0.5);
+  BOOST_REQUIRE_CLOSE(centroids(0, 1), 10.0, 5.0);
+  BOOST_REQUIRE_CLOSE(centroids(1, 1), 10.0, 5.0);
+  BOOST_REQUIRE_CLOSE(centroids(0, 2), -10.0, 5.0);
+  BOOST_REQUIRE_CLOSE(centroids(1, 2), 5.0, 10.0);
+
+  // Feeding the whole dataset as one batch after a reset gives the means of
+  // the classes exactly.
+  k.Reset(centroids);
+  k.Update(data);
+  const arma::mat means = k.Centroids();
+  BOOST_REQUIRE_CLOSE(means(0, 1), arma::mean(data.row(0).cols(13, 19)),
+      1e-5);
+  BOOST_REQUIRE_CLOSE(means(1, 2), arma::mean(data.row(1).cols(20, 29)),
+      1e-5);
+}
+
 #ifdef ARMA_HAS_SPMAT
 // Can't do this test on Armadillo 3.4; var(SpBase) is not implemented.
 #if !((ARMA_VERSION_MAJOR == 3) && (ARMA_VERSION_MINOR == 4))
@@ -491,6 +758,51 @@ BOOST_AUTO_TEST_CASE(SparseKMeansTest)
   BOOST_REQUIRE_EQUAL(assignments[11], clusterTwo);
 }
 
+/**
+ * Make sure sparse k-means gives the same results as dense k-means on a dataset
+ * large enough that dense centroids are summed in several shards.
+ */
+BOOST_AUTO_TEST_CASE(LargeSparseKMeansTest)
+{
+  // Two clusters, each with one large coordinate and a little sparse noise.
+  arma::mat data(20, 10000);
+  data.zeros();
+  for (size_t i = 0; i < data.n_cols; ++i)
+  {
+    data((i < 5000) ? 3 : 11, i) = ((i < 5000) ? 5.0 : -5.0) + math::Random();
+    data(i % 20, i) += math::Random();
+  }
+  arma::SpMat<double> sparseData(data);
+
+  arma::mat centroids(20, 2);
+  centroids.zeros();
+  centroids(3, 0) = 4.0;
+  centroids(11, 1) = -4.0;
+  arma::SpMat<double> sparseCentroids(centroids);
+
+  KMeans<> kmeans;
+  arma::Col<size_t> assignments;
+  arma::Col<size_t> sparseAssignments;
+  kmeans.Cluster(data, 2, assignments, centroids, false, true);
+  kmeans.Cluster(sparseData, 2, sparseAssignments, sparseCentroids, false,
+      true);
+
+  for (size_t i = 0; i < data.n_cols; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(assignments[i], (i < 5000) ? 0 : 1);
+    BOOST_REQUIRE_EQUAL(sparseAssignments[i], assignments[i]);
+  }
+
+  const arma::mat denseCentroids(sparseCentroids);
+  for (size_t i = 0; i < centroids.n_elem; ++i)
+  {
+    if (std::abs(centroids[i]) < 1e-5)
+      BOOST_REQUIRE_SMALL(denseCentroids[i], 1e-5);
+    else
+      BOOST_REQUIRE_CLOSE(denseCentroids[i], centroids[i], 1e-5);
+  }
+}
+
 #endif // Exclude Armadillo 3.4.
 #endif // ARMA_HAS_SPMAT
 
@@ -561,4 +561,58 @@ BOOST_AUTO_TEST_CASE(NormalizeLabelTest)
     BOOST_REQUIRE_EQUAL(randLabels[i], revertedLabels[i]);
 }
 
+/**
+ * Make sure that loading a CSV in chunks gives the same points as loading it
+ * all at once, and that saving it in chunks gives the same points back.
+ */
+BOOST_AUTO_TEST_CASE(ChunkedLoadSaveCSVTest)
+{
+  arma::mat dataset;
+  dataset.randu(3, 11);
+  data::Save("test_file.csv", dataset);
+
+  arma::mat loaded;
+  data::Load("test_file.csv", loaded);
+
+  // Load and save the dataset four points at a time.
+  {
+    data::ChunkedLoader loader("test_file.csv");
+    data::ChunkedSaver saver("test_file_chunked.csv");
+    arma::mat chunk;
+    size_t chunks = 0;
+    while (loader.LoadChunk(chunk, 4))
+    {
+      BOOST_REQUIRE_EQUAL(chunk.n_rows, 3);
+      BOOST_REQUIRE_EQUAL(chunk.n_cols, (chunks < 2) ? 4 : 3);
+
+      for (size_t i = 0; i < chunk.n_cols; ++i)
+        for (size_t j = 0; j < chunk.n_rows; ++j)
+          BOOST_REQUIRE_CLOSE(chunk(j, i), loaded(j, 4 * chunks + i), 1e-5);
+
+      saver.SaveChunk(chunk);
+      ++chunks;
+    }
+
+    BOOST_REQUIRE_EQUAL(chunks, 3);
+    BOOST_REQUIRE_EQUAL(loader.PointsLoaded(), 11);
+    BOOST_REQUIRE_EQUAL(saver.PointsSaved(), 11);
+
+    // There is nothing left to load.
+    BOOST_REQUIRE(!loader.LoadChunk(chunk, 4));
+    BOOST_REQUIRE_EQUAL(chunk.n_cols, 0);
+  }
+
+  arma::mat chunkedLoaded;
+  data::Load("test_file_chunked.csv", chunkedLoaded);
+
+  BOOST_REQUIRE_EQUAL(chunkedLoaded.n_rows, loaded.n_rows);
+  BOOST_REQUIRE_EQUAL(chunkedLoaded.n_cols, loaded.n_cols);
+  for (size_t i = 0; i < loaded.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(chunkedLoaded[i], loaded[i], 1e-5);
+
+  // Remove the files.
+  remove("test_file.csv");
+  remove("test_file_chunked.csv");
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -61,16 +61,14 @@ BOOST_AUTO_TEST_CASE(LSHSearchTest)
   LSHSearch<> lsh_test(rdata, qdata, 3, 2, hashWidth, 11, 3);
 //   LSHSearch<> lsh_test(rdata, qdata, 3, 2, 0.0, 11, 3);
 
-  // Given this, the 'LSHSearch::bucketRowInHashTable' should be:
-  // COR.SOL.: [2 11 4 7 6 3 11 0 5 1 8]
-  //
-  // The 'LSHSearch::bucketContentSize' should be:
+  // Given this, the number of points in each bucket should be:
   // COR.SOL.: [2 0 1 1 3 1 0 3 3 3 1]
   //
-  // The final hash table 'LSHSearch::secondHashTable' should be
-  // of size (3 x 9) with the following content:
-  // COR.SOL.:
-  // [0 2 4; 1 7 8; 3 9 10; 5 10 10; 6 10 10; 0 5 6; 1 2 8; 3 10 10; 4 10 10]
+  // So 'LSHSearch::bucketOffsets' should be:
+  // COR.SOL.: [0 2 2 3 4 7 8 8 11 14 17 18]
+  //
+  // And 'LSHSearch::bucketContents' should be:
+  // COR.SOL.: [3 9 6 3 1 2 8 5 0 2 4 0 5 6 1 7 8 4]
 
   arma::Mat<size_t> neighbors;
   arma::mat distances;
@@ -108,4 +106,200 @@ BOOST_AUTO_TEST_CASE(LSHSearchTest)
   }
 }
 
+/**
+ * With no maximum bucket size, every point hashed into a bucket must be found.
+ * The hash width is so large that all the points are in the same bucket, which
+ * is larger than the old default maximum of 500 points.
+ */
+BOOST_AUTO_TEST_CASE(LSHUnlimitedBucketTest)
+{
+  arma::mat rdata(1, 600);
+  for (size_t i = 0; i < rdata.n_cols; i++)
+    rdata(0, i) = 0.001 * i;
+
+  LSHSearch<> lsh(rdata, 5, 2, 1e6);
+
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  lsh.Search(5, neighbors, distances);
+
+  // The last points are only found if the bucket holds every point.
+  for (size_t j = 0; j < 5; j++)
+  {
+    BOOST_REQUIRE_EQUAL(neighbors(j, 599), 598 - j);
+    BOOST_REQUIRE_CLOSE(distances(j, 599), std::pow(0.001 * (j + 1), 2.0),
+        1e-3);
+  }
+}
+
+/**
+ * Probing more buckets can only add neighbor candidates, so the neighbors
+ * found with multiprobe LSH must be at least as close as those found without
+ * it.
+ */
+BOOST_AUTO_TEST_CASE(LSHMultiprobeTest)
+{
+  math::RandomSeed(42);
+
+  arma::mat rdata;
+  rdata.randu(5, 300);
+
+  LSHSearch<> lsh(rdata, 10, 2);
+
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  lsh.Search(5, neighbors, distances);
+
+  arma::Mat<size_t> probeNeighbors;
+  arma::mat probeDistances;
+  lsh.Search(5, probeNeighbors, probeDistances, 0, 20);
+
+  for (size_t i = 0; i < rdata.n_cols; i++)
+    for (size_t j = 0; j < 5; j++)
+      BOOST_REQUIRE_LE(probeDistances(j, i), distances(j, i));
+}
+
+/**
+ * The queries are searched in blocks; make sure the results of a query don't
+ * depend on the block it is in, by searching the same queries alone with the
+ * same hash functions.
+ */
+BOOST_AUTO_TEST_CASE(LSHQueryBlockTest)
+{
+  arma::mat rdata;
+  rdata.randu(4, 500);
+  arma::mat qdata;
+  qdata.randu(4, 1500);
+  arma::mat qdataEnd = qdata.cols(1000, 1499);
+
+  math::RandomSeed(7);
+  LSHSearch<> lsh(rdata, qdata, 8, 5, 0.5);
+
+  math::RandomSeed(7);
+  LSHSearch<> lshEnd(rdata, qdataEnd, 8, 5, 0.5);
+
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  lsh.Search(3, neighbors, distances, 0, 2);
+
+  arma::Mat<size_t> neighborsEnd;
+  arma::mat distancesEnd;
+  lshEnd.Search(3, neighborsEnd, distancesEnd, 0, 2);
+
+  for (size_t i = 0; i < qdataEnd.n_cols; i++)
+  {
+    for (size_t j = 0; j < 3; j++)
+    {
+      BOOST_REQUIRE_EQUAL(neighbors(j, 1000 + i), neighborsEnd(j, i));
+      BOOST_REQUIRE_EQUAL(distances(j, 1000 + i), distancesEnd(j, i));
+    }
+  }
+}
+
+/**
+ * Inserting points into a hash must give the same results as building the hash
+ * on all the points with the same hash functions.
+ */
+BOOST_AUTO_TEST_CASE(LSHInsertTest)
+{
+  arma::mat rdata;
+  rdata.randu(4, 600);
+  arma::mat qdata;
+  qdata.randu(4, 100);
+  arma::mat rdataStart = rdata.cols(0, 399);
+  arma::mat rdataEnd = rdata.cols(400, 599);
+
+  math::RandomSeed(11);
+  LSHSearch<> lsh(rdataStart, 8, 5, 0.5);
+  lsh.Insert(rdataEnd);
+
+  math::RandomSeed(11);
+  LSHSearch<> lshAll(rdata, 8, 5, 0.5);
+
+  BOOST_REQUIRE_EQUAL(lsh.ReferenceSet().n_cols, 600);
+
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  lsh.Search(qdata, 3, neighbors, distances);
+
+  arma::Mat<size_t> neighborsAll;
+  arma::mat distancesAll;
+  lshAll.Search(qdata, 3, neighborsAll, distancesAll);
+
+  for (size_t i = 0; i < qdata.n_cols; i++)
+  {
+    for (size_t j = 0; j < 3; j++)
+    {
+      BOOST_REQUIRE_EQUAL(neighbors(j, i), neighborsAll(j, i));
+      BOOST_REQUIRE_EQUAL(distances(j, i), distancesAll(j, i));
+    }
+  }
+}
+
+/**
+ * The reference set must not be copied until points are inserted, the caller's
+ * matrix must never be modified, and searching with the caller's matrix as the
+ * query set must skip self-matches both before and after points are inserted.
+ */
+BOOST_AUTO_TEST_CASE(LSHReferenceSetNotCopiedTest)
+{
+  arma::mat rdata;
+  rdata.randu(4, 300);
+
+  LSHSearch<> lsh(rdata, 8, 5, 0.5);
+  BOOST_REQUIRE(lsh.ReferenceSet().memptr() == rdata.memptr());
+
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  lsh.Search(rdata, 1, neighbors, distances);
+  for (size_t i = 0; i < rdata.n_cols; i++)
+    BOOST_REQUIRE(neighbors(0, i) != i);
+
+  arma::mat newPoints;
+  newPoints.randu(4, 50);
+  lsh.Insert(newPoints);
+
+  BOOST_REQUIRE_EQUAL(rdata.n_cols, 300);
+  BOOST_REQUIRE_EQUAL(lsh.ReferenceSet().n_cols, 350);
+  BOOST_REQUIRE(lsh.ReferenceSet().memptr() != rdata.memptr());
+
+  lsh.Search(rdata, 1, neighbors, distances);
+  for (size_t i = 0; i < rdata.n_cols; i++)
+    BOOST_REQUIRE(neighbors(0, i) != i);
+}
+
+/**
+ * A hash loaded from a file must give the same results as the saved hash.
+ */
+BOOST_AUTO_TEST_CASE(LSHSaveLoadTest)
+{
+  arma::mat rdata;
+  rdata.randu(4, 300);
+
+  LSHSearch<> lsh(rdata, 8, 5);
+  lsh.Save("test-lsh-save.bin");
+
+  LSHSearch<> lshLoaded("test-lsh-save.bin");
+  remove("test-lsh-save.bin");
+
+  BOOST_REQUIRE_EQUAL(lshLoaded.ReferenceSet().n_cols, 300);
+
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  lsh.Search(3, neighbors, distances, 0, 1);
+
+  arma::Mat<size_t> neighborsLoaded;
+  arma::mat distancesLoaded;
+  lshLoaded.Search(3, neighborsLoaded, distancesLoaded, 0, 1);
+
+  for (size_t i = 0; i < rdata.n_cols; i++)
+  {
+    for (size_t j = 0; j < 3; j++)
+    {
+      BOOST_REQUIRE_EQUAL(neighbors(j, i), neighborsLoaded(j, i));
+      BOOST_REQUIRE_EQUAL(distances(j, i), distancesLoaded(j, i));
+    }
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -815,4 +815,147 @@ BOOST_AUTO_TEST_CASE(CoverTreeSingleTreeTest)
   }
 }
 
+/**
+ * A callback for CallbackResults which stores every result it is given.
+ */
+struct TripleCollector
+{
+  void operator()(const size_t queryIndex,
+                  const size_t referenceIndex,
+                  const double distance)
+  {
+    triples.push_back(make_pair(queryIndex, make_pair(distance,
+        referenceIndex)));
+  }
+
+  vector<pair<size_t, pair<double, size_t> > > triples;
+};
+
+/**
+ * Ensure that the CSR, counting, and callback result types give the same
+ * results as naive search with vectors, with a separate query set, in both
+ * single-tree and dual-tree mode (so the indices must be mapped back through
+ * both trees).
+ */
+BOOST_AUTO_TEST_CASE(ResultTypesTest)
+{
+  arma::mat referenceData;
+  if (!data::Load("test_data_3_1000.csv", referenceData))
+    BOOST_FAIL("Cannot load test dataset test_data_3_1000.csv!");
+
+  arma::mat queryData = referenceData.cols(0, 299) + 0.05 *
+      arma::randu<arma::mat>(3, 300);
+
+  RangeSearch<> naive(referenceData, queryData, true);
+  vector<vector<size_t> > neighborsNaive;
+  vector<vector<double> > distancesNaive;
+  naive.Search(Range(0.25, 1.05), neighborsNaive, distancesNaive);
+  vector<vector<pair<double, size_t> > > sortedNaive;
+  SortResults(neighborsNaive, distancesNaive, sortedNaive);
+
+  for (size_t mode = 0; mode < 2; ++mode)
+  {
+    RangeSearch<> rs(referenceData, queryData, false, (mode == 1));
+
+    CSRResults csr;
+    rs.Search(Range(0.25, 1.05), csr);
+
+    CountResults counts;
+    rs.Search(Range(0.25, 1.05), counts);
+
+    TripleCollector collector;
+    CallbackResults<TripleCollector> callback(collector);
+    rs.Search(Range(0.25, 1.05), callback);
+
+    BOOST_REQUIRE_EQUAL(csr.Offsets().n_elem, queryData.n_cols + 1);
+    BOOST_REQUIRE_EQUAL(counts.Counts().n_elem, queryData.n_cols);
+
+    // Rebuild per-query lists from the CSR and callback results.
+    vector<vector<pair<double, size_t> > > sortedCSR(queryData.n_cols);
+    vector<vector<pair<double, size_t> > > sortedCallback(queryData.n_cols);
+    for (size_t i = 0; i < queryData.n_cols; ++i)
+      for (size_t j = csr.Offsets()[i]; j < csr.Offsets()[i + 1]; ++j)
+        sortedCSR[i].push_back(make_pair(csr.Distances()[j],
+            csr.Neighbors()[j]));
+    for (size_t i = 0; i < collector.triples.size(); ++i)
+      sortedCallback[collector.triples[i].first].push_back(
+          collector.triples[i].second);
+
+    for (size_t i = 0; i < queryData.n_cols; ++i)
+    {
+      sort(sortedCSR[i].begin(), sortedCSR[i].end());
+      sort(sortedCallback[i].begin(), sortedCallback[i].end());
+
+      BOOST_REQUIRE_EQUAL(csr.NumResults(i), sortedNaive[i].size());
+      BOOST_REQUIRE_EQUAL(counts.Counts()[i], sortedNaive[i].size());
+      BOOST_REQUIRE_EQUAL(sortedCallback[i].size(), sortedNaive[i].size());
+
+      for (size_t j = 0; j < sortedNaive[i].size(); ++j)
+      {
+        BOOST_REQUIRE_EQUAL(sortedCSR[i][j].second, sortedNaive[i][j].second);
+        BOOST_REQUIRE_CLOSE(sortedCSR[i][j].first, sortedNaive[i][j].first,
+            1e-5);
+        BOOST_REQUIRE_EQUAL(sortedCallback[i][j].second,
+            sortedNaive[i][j].second);
+        BOOST_REQUIRE_CLOSE(sortedCallback[i][j].first,
+            sortedNaive[i][j].first, 1e-5);
+      }
+    }
+  }
+}
+
+/**
+ * The Euclidean distance, counting the number of times it is evaluated.
+ */
+class CountingDistance
+{
+ public:
+  template<typename VecType1, typename VecType2>
+  static double Evaluate(const VecType1& a, const VecType2& b)
+  {
+    #pragma omp atomic
+    ++evaluations;
+
+    return metric::EuclideanDistance::Evaluate(a, b);
+  }
+
+  static size_t evaluations;
+};
+
+size_t CountingDistance::evaluations = 0;
+
+/**
+ * When every reference node is inside the range, counting the results should
+ * need far fewer distance evaluations than storing them (whose distances must
+ * all be computed), and both should find the same number of points.
+ */
+BOOST_AUTO_TEST_CASE(CountWithoutDistancesTest)
+{
+  arma::mat data;
+  data.randu(3, 1000);
+
+  RangeSearch<CountingDistance> rs(data);
+
+  CountingDistance::evaluations = 0;
+  vector<vector<size_t> > neighbors;
+  vector<vector<double> > distances;
+  rs.Search(Range(0.0, DBL_MAX), neighbors, distances);
+  const size_t vectorEvaluations = CountingDistance::evaluations;
+
+  CountingDistance::evaluations = 0;
+  CountResults counts;
+  rs.Search(Range(0.0, DBL_MAX), counts);
+  const size_t countEvaluations = CountingDistance::evaluations;
+
+  // Each distance must be computed once to be stored.
+  BOOST_REQUIRE_GE(vectorEvaluations, 1000 * 999);
+  BOOST_REQUIRE_LT(countEvaluations, vectorEvaluations / 10);
+
+  for (size_t i = 0; i < 1000; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(neighbors[i].size(), 999);
+    BOOST_REQUIRE_EQUAL(counts.Counts()[i], 999);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
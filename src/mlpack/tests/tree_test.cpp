@@ -6,11 +6,16 @@
 #include <mlpack/core.hpp>
 #include <mlpack/core/tree/bounds.hpp>
 #include <mlpack/core/tree/binary_space_tree/binary_space_tree.hpp>
+#include <mlpack/core/tree/binary_space_tree/mapped_tree.hpp>
 #include <mlpack/core/metrics/lmetric.hpp>
 #include <mlpack/core/tree/cover_tree/cover_tree.hpp>
 #include <mlpack/core/tree/cosine_tree/cosine_tree.hpp>
 #include <mlpack/core/tree/cosine_tree/cosine_tree_builder.hpp>
 
+#ifdef HAS_OPENMP
+  #include <omp.h>
+#endif
+
 #include <boost/test/unit_test.hpp>
 #include "old_boost_test_definitions.hpp"
 
@@ -1685,6 +1690,150 @@ BOOST_AUTO_TEST_CASE(KdTreeTest)
   BOOST_REQUIRE_EQUAL(root.TreeDepth(), 7);
 }
 
+// Recursively check that two trees have the same structure and bounds.
+template<typename TreeType>
+void CheckSameTree(const TreeType& a, const TreeType& b)
+{
+  BOOST_REQUIRE_EQUAL(a.Begin(), b.Begin());
+  BOOST_REQUIRE_EQUAL(a.Count(), b.Count());
+  BOOST_REQUIRE_EQUAL(a.NumChildren(), b.NumChildren());
+  BOOST_REQUIRE_EQUAL(a.FurthestDescendantDistance(),
+      b.FurthestDescendantDistance());
+
+  for (size_t d = 0; d < a.Bound().Dim(); ++d)
+  {
+    BOOST_REQUIRE_EQUAL(a.Bound()[d].Lo(), b.Bound()[d].Lo());
+    BOOST_REQUIRE_EQUAL(a.Bound()[d].Hi(), b.Bound()[d].Hi());
+  }
+
+  for (size_t i = 0; i < a.NumChildren(); ++i)
+    CheckSameTree(a.Child(i), b.Child(i));
+}
+
+/**
+ * Make sure that building a tree with the root constructor (which builds large
+ * nodes in parallel when OpenMP is available) gives exactly the same tree and
+ * permutation as building it with the recursive constructor, which never
+ * creates a parallel region.
+ */
+BOOST_AUTO_TEST_CASE(ParallelBuildMatchesSerialBuild)
+{
+  typedef BinarySpaceTree<HRectBound<2> > TreeType;
+
+  arma::mat dataset(5, 20000);
+  dataset.randu();
+  arma::mat serialDataset(dataset);
+
+  std::vector<size_t> oldFromNew;
+  TreeType root(dataset, oldFromNew);
+
+  std::vector<size_t> serialOldFromNew(serialDataset.n_cols);
+  for (size_t i = 0; i < serialDataset.n_cols; ++i)
+    serialOldFromNew[i] = i;
+  TreeType serialRoot(serialDataset, 0, serialDataset.n_cols,
+      serialOldFromNew);
+
+  for (size_t i = 0; i < oldFromNew.size(); ++i)
+    BOOST_REQUIRE_EQUAL(oldFromNew[i], serialOldFromNew[i]);
+  for (size_t i = 0; i < dataset.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(dataset[i], serialDataset[i]);
+
+  CheckSameTree(root, serialRoot);
+}
+
+/**
+ * Check that a node and all of its descendants are laid out in depth-first
+ * order, starting at the given position.  Returns the position after the last
+ * descendant.
+ */
+template<typename TreeType>
+const TreeType* CheckCompactLayout(const TreeType& node, const TreeType* next)
+{
+  BOOST_REQUIRE_EQUAL(&node, next);
+  BOOST_REQUIRE(node.IsCompact());
+  ++next;
+
+  for (size_t i = 0; i < node.NumChildren(); ++i)
+  {
+    BOOST_REQUIRE_EQUAL(node.Child(i).Parent(), &node);
+    next = CheckCompactLayout(node.Child(i), next);
+  }
+
+  return next;
+}
+
+/**
+ * Make sure that compacting a tree doesn't change it, and that the nodes end up
+ * in depth-first order in one block of memory.
+ */
+BOOST_AUTO_TEST_CASE(CompactTreeMatchesTree)
+{
+  typedef BinarySpaceTree<HRectBound<2> > TreeType;
+
+  arma::mat dataset(4, 3000);
+  dataset.randu();
+
+  TreeType root(dataset, 10);
+  TreeType compactRoot(root);
+  compactRoot.Compact();
+
+  BOOST_REQUIRE(compactRoot.IsCompact());
+  BOOST_REQUIRE_EQUAL(compactRoot.TreeSize(), root.TreeSize());
+  CheckSameTree(root, compactRoot);
+
+  // The root itself is not in the arena, but every descendant is.
+  const TreeType* next = compactRoot.Left();
+  for (size_t i = 0; i < compactRoot.NumChildren(); ++i)
+    next = CheckCompactLayout(compactRoot.Child(i), next);
+  BOOST_REQUIRE_EQUAL(next, compactRoot.Left() + (root.TreeSize() - 1));
+
+  // Compacting again must give the same tree.
+  compactRoot.Compact();
+  CheckSameTree(root, compactRoot);
+}
+
+/**
+ * Save a tree to a file, map it back in, and make sure that we get the same
+ * tree, dataset, and mapping back.
+ */
+BOOST_AUTO_TEST_CASE(MappedTreeSaveLoad)
+{
+  typedef BinarySpaceTree<HRectBound<2> > TreeType;
+
+  arma::mat dataset(3, 2000);
+  dataset.randu();
+
+  std::vector<size_t> oldFromNew;
+  TreeType root(dataset, oldFromNew, 15);
+  MappedTree<TreeType>::Save("test-mapped-tree.bin", root, oldFromNew);
+
+  {
+    MappedTree<TreeType> mappedTree("test-mapped-tree.bin");
+
+    BOOST_REQUIRE_EQUAL(mappedTree.Dataset().n_rows, dataset.n_rows);
+    BOOST_REQUIRE_EQUAL(mappedTree.Dataset().n_cols, dataset.n_cols);
+    for (size_t i = 0; i < dataset.n_elem; ++i)
+      BOOST_REQUIRE_EQUAL(mappedTree.Dataset()[i], dataset[i]);
+
+    BOOST_REQUIRE_EQUAL(mappedTree.OldFromNew().size(), oldFromNew.size());
+    for (size_t i = 0; i < oldFromNew.size(); ++i)
+      BOOST_REQUIRE_EQUAL(mappedTree.OldFromNew()[i], oldFromNew[i]);
+
+    const TreeType& loaded = mappedTree.Tree();
+    BOOST_REQUIRE_EQUAL(&loaded.Dataset(), &mappedTree.Dataset());
+    BOOST_REQUIRE_EQUAL(loaded.LeafSize(), (size_t) 15);
+    BOOST_REQUIRE_EQUAL(loaded.TreeSize(), root.TreeSize());
+    CheckSameTree(root, loaded);
+
+    // The loaded tree is laid out like a compacted tree.
+    const TreeType* next = loaded.Left();
+    for (size_t i = 0; i < loaded.NumChildren(); ++i)
+      next = CheckCompactLayout(loaded.Child(i), next);
+  }
+
+  remove("test-mapped-tree.bin");
+}
+
 // Recursively checks that each node contains all points that it claims to have.
 template<typename TreeType, typename MatType>
 bool CheckPointBounds(TreeType* node, const MatType& data)
@@ -2043,6 +2192,54 @@ BOOST_AUTO_TEST_CASE(CoverTreeConstructionTest)
   CheckSeparation<CoverTree<>, LMetric<2, true> >(tree, tree);
 }
 
+// Recursively check that two cover trees are the same.
+template<typename TreeType>
+void CheckSameCoverTree(const TreeType& a, const TreeType& b)
+{
+  BOOST_REQUIRE_EQUAL(a.Point(), b.Point());
+  BOOST_REQUIRE_EQUAL(a.Scale(), b.Scale());
+  BOOST_REQUIRE_EQUAL(a.NumChildren(), b.NumChildren());
+  BOOST_REQUIRE_EQUAL(a.NumDescendants(), b.NumDescendants());
+  BOOST_REQUIRE_EQUAL(a.ParentDistance(), b.ParentDistance());
+  BOOST_REQUIRE_EQUAL(a.FurthestDescendantDistance(),
+      b.FurthestDescendantDistance());
+
+  for (size_t i = 0; i < a.NumChildren(); ++i)
+    CheckSameCoverTree(a.Child(i), b.Child(i));
+}
+
+/**
+ * Make sure that a cover tree built with one thread is the same as one built
+ * with several threads (the distances of large nodes are computed in parallel
+ * when OpenMP is available).
+ */
+BOOST_AUTO_TEST_CASE(CoverTreeParallelConstructionTest)
+{
+  arma::mat dataset;
+  dataset.randu(20, 5000);
+
+#ifdef HAS_OPENMP
+  const int maxThreads = omp_get_max_threads();
+  omp_set_num_threads(1);
+#endif
+
+  CoverTree<> serialTree(dataset);
+
+#ifdef HAS_OPENMP
+  omp_set_num_threads(std::max(maxThreads, 4));
+#endif
+
+  CoverTree<> parallelTree(dataset);
+
+#ifdef HAS_OPENMP
+  omp_set_num_threads(maxThreads);
+#endif
+
+  BOOST_REQUIRE_EQUAL(serialTree.DistanceComps(),
+      parallelTree.DistanceComps());
+  CheckSameCoverTree(serialTree, parallelTree);
+}
+
 /**
  * Test the manual constructor.
  */